@@ -4,11 +4,17 @@
  * Author:  Joseph Smith
  ***************/
 
+#include <cstdint>
 #include <iostream>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "engine/buffer.hpp"
+#include "engine/index_optimizer.hpp"
+#include "engine/render_state.hpp"
+#include "engine/vertex_array.hpp"
+
 #define VAR_NAME(var) (#var)
 
 const unsigned int WIN_WIDTH = 800;
@@ -94,8 +100,8 @@ int main(void)
 
     // Initialise/configure GLFW
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__    // MAC OS X only
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -119,6 +125,12 @@ int main(void)
         std::cout << "Failed to initialise GLAD" << std::endl;
         return -1;
     }
+    // Buffers and vertex arrays are set up with Direct State Access
+    if (!GLAD_GL_VERSION_4_5) {
+        std::cout << "OpenGL 4.5 or later is required" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
 
     /*******************
      * COMPILE SHADERS
@@ -176,31 +188,30 @@ int main(void)
         0.8f, -0.5f, 0.0f,
         0.2f, -0.5f, 0.0f
     };
-    unsigned int indices[] = {
+    uint32_t indices[] = {
         0, 1, 2,
         3, 4, 5
     };
 
-    // Setup Vertex Buffer Object, Vertex Array Object, Element Buffer Object
-    unsigned int VAO, VBO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    // Bind VAO first to stop VBO/EBO code duplication
-    glBindVertexArray(VAO);
-
-    // Copy vertices array into the vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // Copy indices array into the element buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    // Link vertex attributes and unbind VAO
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    // Reorder triangles/vertices for the vertex caches and store indices with
+    // the smallest type able to address every vertex (16-bit here)
+    size_t indexCount = sizeof(indices) / sizeof(indices[0]);
+    size_t vertexCount = sizeof(vertices) / (3 * sizeof(float));
+    optimizeVertexCache(indices, indexCount, vertexCount);
+    vertexCount = optimizeVertexFetch(indices, indexCount, vertices,
+                                      vertexCount, 3 * sizeof(float));
+    IndexData indexData = narrowIndices(indices, indexCount, vertexCount);
+
+    // Setup Vertex Buffer Object, Element Buffer Object, Vertex Array Object
+    // (DSA: nothing is bound while the buffers are created and filled)
+    Buffer VBO(vertices, 0);
+    Buffer EBO(GLsizeiptr(indexData.bytes.size()), indexData.bytes.data(), 0);
+    VertexArray VAO;
+    VAO.setVertexBuffer(0, VBO, 0, 3 * sizeof(float));
+    VAO.setElementBuffer(EBO);
+
+    // Link vertex attributes
+    VAO.setAttribute(0, 0, 3, GL_FLOAT, GL_FALSE, 0);
 
     // Set up keypress callback
     glfwSetKeyCallback(window, key_callback);
@@ -209,6 +220,7 @@ int main(void)
      * RENDER LOOP
      ***************/
 
+    RenderState renderState;
     while(!glfwWindowShouldClose(window)) {
         // Process input
         processInput(window);
@@ -218,10 +230,10 @@ int main(void)
         glClear(GL_COLOR_BUFFER_BIT);
 
         // Draw triangles
-        glUseProgram(orangeShaderProgram);
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        renderState.useProgram(orangeShaderProgram);
+        renderState.bindVertexArray(VAO.ID);
+        glDrawElements(GL_TRIANGLES, GLsizei(indexData.count), indexData.type,
+                       0);
 
         // Swap buffers, poll input
         glfwSwapBuffers(window);
@@ -229,9 +241,9 @@ int main(void)
     }
 
     // Deallocated no longer needed resources
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    VAO.destroy();
+    VBO.destroy();
+    EBO.destroy();
     glDeleteProgram(orangeShaderProgram);
     glDeleteProgram(yellowShaderProgram);
 
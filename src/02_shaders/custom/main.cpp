@@ -4,10 +4,13 @@
  * Author:  Joseph Smith
  ***************/
 
+#include <cstdint>
 #include <iostream>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "engine/buffer.hpp"
+#include "engine/vertex_layout.hpp"
 #include "shader.hpp"
 
 const unsigned int WIN_WIDTH = 800;
@@ -35,8 +38,8 @@ void processInput(GLFWwindow* window) {
 
     // Initialise/configure GLFW
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__    // MAC OS X only
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -60,6 +63,12 @@ void processInput(GLFWwindow* window) {
         std::cout << "Failed to initialise GLAD" << std::endl;
         return -1;
     }
+    // Buffers and vertex arrays are set up with Direct State Access
+    if (!GLAD_GL_VERSION_4_5) {
+        std::cout << "OpenGL 4.5 or later is required" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
 
 
     // BUILD AND COMPILE SHADERS
@@ -70,32 +79,28 @@ void processInput(GLFWwindow* window) {
      * SETUP VERTICES, BUFFERS AND VERTEX ATTRIBUTES
      *************************************************/
 
-    float vertices[] {
-        // positions           // colors
-        0.5f,  -0.5f, 0.0f,    1.0f, 0.0f, 0.0f,    // BR
-        -0.5f, -0.5f, 0.0f,    0.0f, 1.0f, 0.0f,    // BL
-        0.0f,   0.5f, 0.0f,    0.0f, 0.0f, 1.0f     // T
+    // Colours are packed as unorm8 x 4 (4 bytes rather than 3 floats)
+    struct Vertex {
+        float position[3];
+        uint32_t color;
+    };
+    Vertex vertices[] {
+        // positions              // colors
+        {{0.5f,  -0.5f, 0.0f},    packColor4u8(1.0f, 0.0f, 0.0f)},    // BR
+        {{-0.5f, -0.5f, 0.0f},    packColor4u8(0.0f, 1.0f, 0.0f)},    // BL
+        {{0.0f,   0.5f, 0.0f},    packColor4u8(0.0f, 0.0f, 1.0f)}     // T
     };
 
-    // Setup Vertex Buffer Object, Vertex Array Object, Element Buffer Object
-    unsigned int VAO, VBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-
-    // Bind VAO first to stop VBO code duplication
-    glBindVertexArray(VAO);
-
-    // Copy vertices array into the vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // Setup Vertex Buffer Object (DSA: nothing is bound while it is filled)
+    Buffer VBO(vertices, 0);
 
-    // Link vertex attributes for position and colour attributes
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-                          (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-                          (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // Vertex Array Object for position and colour attributes, the layout
+    // computes stride/offsets and issues the attribute format calls
+    using ColoredVertex = VertexLayout<Pos3f, Color4u8>;
+    static_assert(sizeof(Vertex) == ColoredVertex::stride,
+                  "Vertex must match its layout");
+    VertexArrayCache vertexArrays;
+    const VertexArray& VAO = vertexArrays.get<ColoredVertex>(VBO);
 
 
     /***************
@@ -112,7 +117,7 @@ void processInput(GLFWwindow* window) {
 
         // Draw triangle
         customShader.use();
-        glBindVertexArray(VAO);
+        VAO.bind();
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
         // Swap buffers, poll input
@@ -121,8 +126,8 @@ void processInput(GLFWwindow* window) {
     }
 
     // Deallocated no longer needed resources
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    vertexArrays.destroy();
+    VBO.destroy();
 
     glfwTerminate();
     return 0;
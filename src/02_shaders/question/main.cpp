@@ -10,6 +10,9 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "engine/buffer.hpp"
+#include "engine/vertex_array.hpp"
+
 #define VAR_NAME(var) (#var)
 
 const unsigned int WIN_WIDTH = 800;
@@ -92,8 +95,8 @@ int main(void)
 
     // Initialise/configure GLFW
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__    // MAC OS X only
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -117,6 +120,12 @@ int main(void)
         std::cout << "Failed to initialise GLAD" << std::endl;
         return -1;
     }
+    // Buffers and vertex arrays are set up with Direct State Access
+    if (!GLAD_GL_VERSION_4_5) {
+        std::cout << "OpenGL 4.5 or later is required" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
 
 
     /*******************
@@ -158,22 +167,14 @@ int main(void)
         0.0f,  0.5f, 0.0f
     };
 
-    // Setup Vertex Buffer Object, Vertex Array Object, Element Buffer Object
-    unsigned int VAO, VBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-
-    // Bind VAO first to stop VBO code duplication
-    glBindVertexArray(VAO);
-
-    // Copy vertices array into the vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // Setup Vertex Buffer Object, Vertex Array Object
+    // (DSA: nothing is bound while the buffer is created and filled)
+    Buffer VBO(vertices, 0);
+    VertexArray VAO;
+    VAO.setVertexBuffer(0, VBO, 0, 3 * sizeof(float));
 
-    // Link vertex attributes for position and colour attributes
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
-                          (void*)0);
-    glEnableVertexAttribArray(0);
+    // Link vertex attributes for position attribute
+    VAO.setAttribute(0, 0, 3, GL_FLOAT, GL_FALSE, 0);
 
 
     /***************
@@ -199,6 +200,7 @@ int main(void)
         glUniform4f(vertexColorLocation, redValue, greenValue, 0.5f, 1.0f);
 
         // Draw triangle
+        VAO.bind();
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
         // Swap buffers, poll input
@@ -207,8 +209,8 @@ int main(void)
     }
 
     // Deallocated no longer needed resources
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    VAO.destroy();
+    VBO.destroy();
     glDeleteProgram(ShaderProgram);
 
     glfwTerminate();
@@ -0,0 +1,175 @@
+/****************
+ * Title:   03_textures/basic/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "engine/buffer.hpp"
+// The stb_image implementation is compiled into this executable
+#define STB_IMAGE_IMPLEMENTATION
+#include "engine/texture_loader.hpp"
+#include "engine/vertex_layout.hpp"
+#include "02_shaders/custom/shader.hpp"
+
+// Usage: 03_textures_basic [image ...]
+//
+// Shows each image on a quad in turn. Images load in the background and
+// the quad shows a checkerboard until the current one is ready.
+
+const unsigned int WIN_WIDTH = 800;
+const unsigned int WIN_HEIGHT = 600;
+const double SECONDS_PER_IMAGE = 2.0;
+
+
+// React to window resizing by setting viewport size to window size
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    glViewport(0, 0, width, height);
+}
+
+
+// Query keypresses and react to result
+void processInput(GLFWwindow* window) {
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, true);
+}
+
+
+int main(int argc, char** argv)
+{
+    /****************
+     * SETUP WINDOW
+     ****************/
+
+    // Initialise/configure GLFW
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__    // MAC OS X only
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    // GLFW window creation
+    GLFWwindow* window = glfwCreateWindow(
+        WIN_WIDTH, WIN_HEIGHT, "OpenGLGraphics", NULL, NULL
+    );
+    if (window == NULL) {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    // Set window resizing callback
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+    // Initialise GLAD to load OpenGL function pointers
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Failed to initialise GLAD" << std::endl;
+        return -1;
+    }
+    // Textures and buffers are set up with Direct State Access
+    if (!GLAD_GL_VERSION_4_5) {
+        std::cout << "OpenGL 4.5 or later is required" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+
+
+    // BUILD AND COMPILE SHADERS
+    Shader textureShader("../src/03_textures/basic/shader.vert",
+                         "../src/03_textures/basic/shader.frag");
+
+    /*************************************************
+     * SETUP VERTICES, BUFFERS AND VERTEX ATTRIBUTES
+     *************************************************/
+
+    struct Vertex {
+        float position[3];
+        float texCoord[2];
+    };
+    Vertex vertices[] {
+        // positions              // texture coords
+        {{0.5f,   0.5f, 0.0f},    {1.0f, 1.0f}},    // TR
+        {{0.5f,  -0.5f, 0.0f},    {1.0f, 0.0f}},    // BR
+        {{-0.5f, -0.5f, 0.0f},    {0.0f, 0.0f}},    // BL
+        {{-0.5f,  0.5f, 0.0f},    {0.0f, 1.0f}}     // TL
+    };
+    uint32_t indices[] = {
+        0, 1, 3,    // first triangle
+        1, 2, 3     // second triangle
+    };
+
+    Buffer VBO(vertices, 0);
+    Buffer EBO(indices, 0);
+    using TexturedVertex = VertexLayout<Pos3f, TexCoord2f>;
+    static_assert(sizeof(Vertex) == TexturedVertex::stride,
+                  "Vertex must match its layout");
+    VertexArrayCache vertexArrays;
+    const VertexArray& VAO = vertexArrays.get<TexturedVertex>(VBO, &EBO);
+
+
+    /****************
+     * LOAD TEXTURES
+     ****************/
+
+    // Decoding happens on worker threads, the render loop only uploads
+    TextureLoader textures;
+    if (!textures.create()) {
+        glfwTerminate();
+        return -1;
+    }
+    std::vector<TextureHandle> images;
+    for (int i = 1; i < argc; ++i)
+        images.push_back(textures.load(argv[i]));
+    if (images.empty())
+        std::cout << "Usage: 03_textures_basic [image ...]" << std::endl;
+
+    textureShader.use();
+    textureShader.setInt("image", 0);
+
+
+    /***************
+     * RENDER LOOP
+     ***************/
+
+    while(!glfwWindowShouldClose(window)) {
+        // Process input
+        processInput(window);
+
+        // Start uploads of images decoded since the last frame
+        textures.update();
+
+        // Render
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // Draw quad with the current image (checkerboard until ready)
+        TextureHandle current;
+        if (!images.empty())
+            current = images[size_t(glfwGetTime() / SECONDS_PER_IMAGE) %
+                             images.size()];
+        glBindTextureUnit(0, textures.resolve(current));
+        textureShader.use();
+        VAO.bind();
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+        // Swap buffers, poll input
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    // Deallocated no longer needed resources
+    textures.destroy();
+    vertexArrays.destroy();
+    VBO.destroy();
+    EBO.destroy();
+
+    glfwTerminate();
+    return 0;
+}
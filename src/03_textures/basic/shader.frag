@@ -0,0 +1,10 @@
+#version 460 core
+
+out vec4 FragColor;
+in vec2 texCoord;
+
+uniform sampler2D image;
+
+void main() {
+    FragColor = texture(image, texCoord);
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#version 460 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+out vec2 texCoord;
+
+void main() {
+    gl_Position = vec4(aPos, 1.0);
+    // Images are stored top row first
+    texCoord = vec2(aTexCoord.x, 1.0 - aTexCoord.y);
+}
\ No newline at end of file
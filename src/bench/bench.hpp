@@ -0,0 +1,292 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "engine/gl_extensions.hpp"
+#include "engine/program.hpp"
+#include "engine/vertex_array.hpp"
+
+/**
+ * Shared helpers for the benchmark executables in src/bench. Benchmarks run
+ * in a hidden window so they can be used headless (e.g. under Mesa llvmpipe
+ * with a virtual framebuffer).
+ */
+
+/**
+ * Creates a hidden window with a current GL 4.6 core context, falling back
+ * to 4.5 (e.g. Mesa llvmpipe) when 4.6 is not available. Extensions in
+ * gl_extensions.hpp are loaded too.
+ *
+ * @param title  window title, used in error messages
+ * @return window or NULL on failure (GLFW is terminated in that case)
+ */
+inline GLFWwindow* createBenchContext(const char* title) {
+    if (!glfwInit()) {
+        std::cout << "Failed to initialise GLFW" << std::endl;
+        return NULL;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef __APPLE__    // MAC OS X only
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, title, NULL, NULL);
+    if (window == NULL) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+        window = glfwCreateWindow(64, 64, title, NULL, NULL);
+    }
+    if (window == NULL) {
+        std::cout << "Failed to create GLFW window for " << title << std::endl;
+        glfwTerminate();
+        return NULL;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Failed to initialise GLAD" << std::endl;
+        glfwTerminate();
+        return NULL;
+    }
+    if (!GLAD_GL_VERSION_4_5) {
+        std::cout << "OpenGL 4.5 or later is required" << std::endl;
+        glfwTerminate();
+        return NULL;
+    }
+    loadGlExtensions((GLADloadproc)glfwGetProcAddress);
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+    return window;
+}
+
+// Offscreen RGBA8 framebuffer, with a 24-bit depth renderbuffer when
+// depth is not 0, that the benchmarks draw into
+struct BenchTarget {
+    unsigned int colour = 0;
+    unsigned int depth = 0;
+    unsigned int framebuffer = 0;
+    int width = 0;
+    int height = 0;
+
+    // Binds the framebuffer and sets the viewport to cover it
+    void bind() const {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, width, height);
+    }
+
+    void destroy() {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colour);
+        glDeleteRenderbuffers(1, &depth);
+        colour = depth = framebuffer = 0;
+    }
+};
+
+/**
+ * Creates an offscreen target and binds it
+ *
+ * @param withDepth  attach a depth renderbuffer too
+ * @return false if the framebuffer is incomplete, nothing is left created
+ */
+inline bool createBenchTarget(int width, int height, bool withDepth,
+                              BenchTarget& target) {
+    target.width = width;
+    target.height = height;
+    glCreateRenderbuffers(1, &target.colour);
+    glNamedRenderbufferStorage(target.colour, GL_RGBA8, width, height);
+    glCreateFramebuffers(1, &target.framebuffer);
+    glNamedFramebufferRenderbuffer(target.framebuffer, GL_COLOR_ATTACHMENT0,
+                                   GL_RENDERBUFFER, target.colour);
+    if (withDepth) {
+        glCreateRenderbuffers(1, &target.depth);
+        glNamedRenderbufferStorage(target.depth, GL_DEPTH_COMPONENT24, width,
+                                   height);
+        glNamedFramebufferRenderbuffer(target.framebuffer,
+                                       GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                                       target.depth);
+    }
+    if (glCheckNamedFramebufferStatus(target.framebuffer, GL_FRAMEBUFFER) !=
+        GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE" << std::endl;
+        target.destroy();
+        return false;
+    }
+    target.bind();
+    return true;
+}
+
+// Quad centred on the origin, two floats a vertex at attribute 0, drawn
+// with glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0)
+struct BenchQuad {
+    Buffer vertices;
+    Buffer elements;
+    VertexArray vertexArray;
+
+    // halfSize 1 covers the viewport
+    explicit BenchQuad(float halfSize) {
+        const float quad[] = { -halfSize, -halfSize, halfSize, -halfSize,
+                               halfSize, halfSize, -halfSize, halfSize };
+        const uint32_t quadIndices[] = { 0, 1, 2, 0, 2, 3 };
+        vertices = Buffer(quad, 0);
+        elements = Buffer(quadIndices, 0);
+        vertexArray.setVertexBuffer(0, vertices, 0, 2 * sizeof(float));
+        vertexArray.setElementBuffer(elements);
+        vertexArray.setAttribute(0, 0, 2, GL_FLOAT, GL_FALSE, 0);
+    }
+
+    void destroy() {
+        vertexArray.destroy();
+        vertices.destroy();
+        elements.destroy();
+    }
+};
+
+// Draws every culled object as a cube scaled to its bounds, read from the
+// GpuCuller bounds buffer (GPU_CULL_BOUNDS_BINDING) through the object id
+// at location 1
+const char* const BENCH_CUBE_VERTEX_GLSL =
+    "#version 450 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in uint aObject;\n"
+    "struct ObjectBounds { vec4 center; vec4 extent; };\n"
+    "layout (std430, binding = 0) readonly buffer BoundsBuffer {\n"
+    "    ObjectBounds bounds[];\n"
+    "};\n"
+    "uniform mat4 uViewProjection;\n"
+    "void main() {\n"
+    "    vec3 position = bounds[aObject].center.xyz +\n"
+    "        aPos * bounds[aObject].extent.xyz;\n"
+    "    gl_Position = uViewProjection * vec4(position, 1.0);\n"
+    "}\0";
+const char* const BENCH_CUBE_FRAGMENT_GLSL =
+    "#version 450 core\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "    FragColor = vec4(1.0, 0.5, 0.2, 1.0);\n"
+    "}\0";
+
+// Cube from -1 to 1, 36 unsigned short indices, positions at attribute 0
+struct BenchCube {
+    Buffer vertices;
+    Buffer indices;
+    VertexArray vertexArray;
+
+    BenchCube() {
+        const float cubeVertices[] = {
+            -1, -1, -1,  1, -1, -1,  1,  1, -1, -1,  1, -1,
+            -1, -1,  1,  1, -1,  1,  1,  1,  1, -1,  1,  1
+        };
+        const unsigned short cubeIndices[] = {
+            0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,  0, 1, 5, 0, 5, 4,
+            2, 3, 7, 2, 7, 6,  1, 2, 6, 1, 6, 5,  0, 4, 7, 0, 7, 3
+        };
+        vertices = Buffer(cubeVertices, 0);
+        indices = Buffer(cubeIndices, 0);
+        vertexArray.setVertexBuffer(0, vertices, 0, 3 * sizeof(float));
+        vertexArray.setElementBuffer(indices);
+        vertexArray.setAttribute(0, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    }
+
+    void destroy() {
+        vertexArray.destroy();
+        vertices.destroy();
+        indices.destroy();
+    }
+};
+
+// Wall clock timer for CPU work
+class CpuTimer {
+public:
+    CpuTimer() : start(std::chrono::steady_clock::now()) {}
+
+    void reset() {
+        start = std::chrono::steady_clock::now();
+    }
+
+    double elapsedMs() const {
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// GPU timer based on GL_TIME_ELAPSED queries (not nestable)
+class GpuTimer {
+public:
+    GpuTimer() {
+        glCreateQueries(GL_TIME_ELAPSED, 1, &query);
+    }
+
+    void begin() const {
+        glBeginQuery(GL_TIME_ELAPSED, query);
+    }
+
+    void end() const {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+
+    // Blocks until the result is available
+    double resultMs() const {
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+        return double(nanoseconds) / 1.0e6;
+    }
+
+    void destroy() {
+        glDeleteQueries(1, &query);
+        query = 0;
+    }
+
+private:
+    unsigned int query = 0;
+};
+
+/**
+ * Unit sphere with bumps, segmentsU * segmentsV * 2 triangles, appended
+ * as xyz positions and triangle indices
+ */
+inline void buildBenchSphere(std::vector<float>& positions,
+                             std::vector<uint32_t>& indices,
+                             int segmentsU = 256, int segmentsV = 128) {
+    const float pi = 3.14159265358979f;
+    uint32_t first = uint32_t(positions.size() / 3);
+    for (int y = 0; y <= segmentsV; ++y) {
+        for (int x = 0; x <= segmentsU; ++x) {
+            float u = float(x) / float(segmentsU) * 2.0f * pi;
+            float v = float(y) / float(segmentsV) * pi;
+            float radius = 1.0f + 0.05f * std::sin(u * 9.0f) *
+                std::sin(v * 7.0f);
+            positions.push_back(radius * std::sin(v) * std::cos(u));
+            positions.push_back(radius * std::cos(v));
+            positions.push_back(radius * std::sin(v) * std::sin(u));
+        }
+    }
+    for (int y = 0; y < segmentsV; ++y) {
+        for (int x = 0; x < segmentsU; ++x) {
+            uint32_t a = first + uint32_t(y * (segmentsU + 1) + x);
+            uint32_t b = a + 1, c = a + uint32_t(segmentsU) + 1, d = c + 1;
+            uint32_t quad[6] = { a, c, b, b, c, d };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+// Deterministic pseudo random float in [0, 1), a small LCG so every run
+// and platform sees the same scene
+inline float randomFloat(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return float(state >> 8) / float(1 << 24);
+}
+
+#endif
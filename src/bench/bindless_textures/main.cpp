@@ -0,0 +1,241 @@
+/****************
+ * Title:   bench/bindless_textures/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/buffer.hpp"
+#include "engine/indirect_draw.hpp"
+#include "engine/material_textures.hpp"
+#include "engine/vertex_array.hpp"
+
+// Draws a grid of quads that each sample a different texture: with a
+// texture bind and a draw per quad, then as one multi-draw indexing
+// MaterialTextures through its texture array fallback and, when
+// ARB_bindless_texture is available, through resident handles. Reports
+// binds and GL calls per frame and CPU/GPU frame times.
+
+const int MATERIAL_COUNT = 1024;
+const int TEXTURE_SIZE = 64;
+const int FRAMES = 60;
+const GLsizei TARGET_WIDTH = 1280;
+const GLsizei TARGET_HEIGHT = 720;
+
+// The quad's material arrives through baseInstance, one per draw, and
+// places it in a grid of 32 a row
+const char* vertexShaderSource =
+    "#version 450 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec2 aTexCoord;\n"
+    "layout (location = 2) in uint aMaterial;\n"
+    "out vec2 texCoord;\n"
+    "flat out uint material;\n"
+    "void main() {\n"
+    "    const float cell = 2.0 / 32.0;\n"
+    "    vec2 corner = vec2(aMaterial % 32u, aMaterial / 32u) * cell - 1.0;\n"
+    "    texCoord = aTexCoord * 2.0;\n"
+    "    material = aMaterial;\n"
+    "    gl_Position = vec4(corner + aPos * cell, 0.0, 1.0);\n"
+    "}\0";
+const char* bindFragmentSource =
+    "#version 450 core\n"
+    "in vec2 texCoord;\n"
+    "flat in uint material;\n"
+    "out vec4 FragColor;\n"
+    "layout (binding = 0) uniform sampler2D image;\n"
+    "void main() {\n"
+    "    FragColor = texture(image, texCoord);\n"
+    "}\0";
+const char* materialFragmentMain =
+    "in vec2 texCoord;\n"
+    "flat in uint material;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "    FragColor = sampleMaterial(material, texCoord);\n"
+    "}\n";
+
+
+// Checkerboard in two random colours
+std::vector<uint8_t> generateImage(uint32_t& seed) {
+    uint8_t colours[2][4];
+    for (int c = 0; c < 4; ++c) {
+        colours[0][c] = uint8_t(randomFloat(seed) * 255.0f);
+        colours[1][c] = uint8_t(randomFloat(seed) * 255.0f);
+    }
+    colours[0][3] = colours[1][3] = 255;
+    std::vector<uint8_t> rgba(size_t(TEXTURE_SIZE) * TEXTURE_SIZE * 4);
+    for (int y = 0; y < TEXTURE_SIZE; ++y)
+        for (int x = 0; x < TEXTURE_SIZE; ++x)
+            std::memcpy(&rgba[(size_t(y) * TEXTURE_SIZE + x) * 4],
+                        colours[((x / 8) + (y / 8)) & 1], 4);
+    return rgba;
+}
+
+void printRow(const char* name, int binds, int calls, double cpuMs,
+              double gpuMs) {
+    std::printf("%-16s %7d %9d %9.3fms %9.3fms\n", name, binds, calls, cpuMs,
+                gpuMs);
+}
+
+
+int main()
+{
+    GLFWwindow* window = createBenchContext("bench_bindless_textures");
+    if (window == NULL)
+        return -1;
+    unsigned int bindProgram = buildProgram(vertexShaderSource,
+                                            bindFragmentSource);
+    if (!bindProgram) {
+        glfwTerminate();
+        return -1;
+    }
+
+    uint32_t seed = 3u;
+    std::vector<std::vector<uint8_t>> images;
+    for (int i = 0; i < MATERIAL_COUNT; ++i)
+        images.push_back(generateImage(seed));
+
+    const float quad[] = {
+        // positions    // texture coords
+        0.0f, 0.0f,     0.0f, 0.0f,
+        1.0f, 0.0f,     1.0f, 0.0f,
+        1.0f, 1.0f,     1.0f, 1.0f,
+        0.0f, 1.0f,     0.0f, 1.0f
+    };
+    const uint32_t quadIndices[] = { 0, 1, 2, 0, 2, 3 };
+    std::vector<uint32_t> materialIds(MATERIAL_COUNT);
+    std::vector<DrawElementsIndirectCommand> commands(MATERIAL_COUNT);
+    for (int i = 0; i < MATERIAL_COUNT; ++i) {
+        materialIds[size_t(i)] = uint32_t(i);
+        commands[size_t(i)] = { 6, 1, 0, 0, uint32_t(i) };
+    }
+    Buffer vertices(quad, 0);
+    Buffer elements(quadIndices, 0);
+    Buffer ids(GLsizeiptr(materialIds.size() * sizeof(uint32_t)),
+               materialIds.data(), 0);
+    Buffer indirect(GLsizeiptr(commands.size() *
+                               sizeof(DrawElementsIndirectCommand)),
+                    commands.data(), 0);
+    VertexArray vertexArray;
+    vertexArray.setVertexBuffer(0, vertices, 0, 4 * sizeof(float));
+    vertexArray.setElementBuffer(elements);
+    vertexArray.setAttribute(0, 0, 2, GL_FLOAT, GL_FALSE, 0);
+    vertexArray.setAttribute(1, 0, 2, GL_FLOAT, GL_FALSE,
+                             2 * sizeof(float));
+    vertexArray.setVertexBuffer(1, ids, 0, sizeof(uint32_t));
+    vertexArray.setBindingDivisor(1, 1);
+    vertexArray.setIntegerAttribute(2, 1, 1, GL_UNSIGNED_INT, 0);
+
+    BenchTarget target;
+    if (!createBenchTarget(TARGET_WIDTH, TARGET_HEIGHT, false, target)) {
+        glfwTerminate();
+        return -1;
+    }
+
+    std::printf("%d materials with %dx%d textures, bindless %s\n\n",
+                MATERIAL_COUNT, TEXTURE_SIZE, TEXTURE_SIZE,
+                GLAD_GL_ARB_bindless_texture ? "available" : "unavailable");
+    std::printf("%-16s %7s %9s %11s %11s\n", "Path", "Binds", "GL calls",
+                "CPU", "GPU");
+
+    // A texture bind and a draw per quad
+    {
+        std::vector<GLuint> textures(MATERIAL_COUNT);
+        glCreateTextures(GL_TEXTURE_2D, MATERIAL_COUNT, textures.data());
+        for (int i = 0; i < MATERIAL_COUNT; ++i) {
+            glTextureStorage2D(textures[i], 7, GL_SRGB8_ALPHA8, TEXTURE_SIZE,
+                               TEXTURE_SIZE);
+            glTextureSubImage2D(textures[i], 0, 0, 0, TEXTURE_SIZE,
+                                TEXTURE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE,
+                                images[size_t(i)].data());
+            glGenerateTextureMipmap(textures[i]);
+        }
+        GpuTimer gpuTimer;
+        double cpuMs = 0.0, gpuMs = 0.0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            glClear(GL_COLOR_BUFFER_BIT);
+            CpuTimer cpuTimer;
+            gpuTimer.begin();
+            glUseProgram(bindProgram);
+            vertexArray.bind();
+            for (int i = 0; i < MATERIAL_COUNT; ++i) {
+                glBindTextureUnit(0, textures[i]);
+                glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 6,
+                                                    GL_UNSIGNED_INT, 0, 1,
+                                                    GLuint(i));
+            }
+            gpuTimer.end();
+            cpuMs += cpuTimer.elapsedMs();
+            gpuMs += gpuTimer.resultMs();
+        }
+        printRow("Bind per draw", MATERIAL_COUNT, MATERIAL_COUNT * 2,
+                 cpuMs / FRAMES, gpuMs / FRAMES);
+        gpuTimer.destroy();
+        glDeleteTextures(MATERIAL_COUNT, textures.data());
+    }
+
+    // One multi-draw through the material table, array fallback first
+    const char* modeNames[] = { "Texture array", "Bindless" };
+    for (int bindless = 0; bindless < 2; ++bindless) {
+        if (bindless && !GLAD_GL_ARB_bindless_texture)
+            break;
+        MaterialTextures materials;
+        materials.create(bindless != 0);
+        for (const std::vector<uint8_t>& image : images)
+            materials.add(image.data(), TEXTURE_SIZE, TEXTURE_SIZE);
+        if (!materials.build())
+            continue;
+        std::string fragmentSource = std::string("#version 450 core\n") +
+            materials.glsl() + materialFragmentMain;
+        unsigned int program = buildProgram(vertexShaderSource,
+                                            fragmentSource.c_str());
+        if (!program) {
+            materials.destroy();
+            continue;
+        }
+
+        GpuTimer gpuTimer;
+        double cpuMs = 0.0, gpuMs = 0.0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            glClear(GL_COLOR_BUFFER_BIT);
+            CpuTimer cpuTimer;
+            gpuTimer.begin();
+            glUseProgram(program);
+            vertexArray.bind();
+            materials.bind();
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect.ID);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0,
+                                        MATERIAL_COUNT, 0);
+            gpuTimer.end();
+            cpuMs += cpuTimer.elapsedMs();
+            gpuMs += gpuTimer.resultMs();
+        }
+        // The array path binds the atlas, bindless binds no texture
+        printRow(modeNames[bindless], bindless ? 0 : 1, 1, cpuMs / FRAMES,
+                 gpuMs / FRAMES);
+        gpuTimer.destroy();
+        glDeleteProgram(program);
+        materials.destroy();
+    }
+
+    vertexArray.destroy();
+    vertices.destroy();
+    elements.destroy();
+    ids.destroy();
+    indirect.destroy();
+    target.destroy();
+    glDeleteProgram(bindProgram);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,152 @@
+/****************
+ * Title:   bench/bvh/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "bench/bench.hpp"
+#include "engine/bvh.hpp"
+#include "engine/culling.hpp"
+#include "engine/math.hpp"
+#include "engine/parallel.hpp"
+
+// Builds a BVH over 1M random boxes on one thread and on every hardware
+// thread, refits it after moving every box, then times frustum culling
+// against the linear SIMD cull, ray casts and box overlap queries. Query
+// results are checked against brute force.
+
+const size_t OBJECTS = 1000 * 1000;
+const size_t RAYS = 100 * 1000;
+const size_t CHECKED_RAYS = 200;
+const size_t BOX_QUERIES = 100 * 1000;
+const float WORLD_SIZE = 1000.0f;
+
+
+Vec3 randomPoint(uint32_t& state) {
+    Vec3 unit(randomFloat(state), randomFloat(state), randomFloat(state));
+    return (unit * 2.0f - Vec3(1.0f)) * WORLD_SIZE;
+}
+
+// Closest box hit by testing every object
+RayHit bruteForceRay(const BoundsSoA& bounds, const Ray& ray) {
+    Vec3 inverseDirection(1.0f / ray.direction.x, 1.0f / ray.direction.y,
+                          1.0f / ray.direction.z);
+    RayHit hit;
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        Vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+        Vec3 extent(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+        float distance = rayBoxDistance(ray, inverseDirection,
+                                        center - extent, center + extent,
+                                        ray.maxDistance);
+        if (distance < hit.distance) {
+            hit.distance = distance;
+            hit.object = uint32_t(i);
+        }
+    }
+    return hit;
+}
+
+
+int main()
+{
+    unsigned int threads = resolveThreadCount(0);
+    std::printf("SIMD backend: %s, %u threads, %zu objects\n\n",
+                simdBackendName(), threads, OBJECTS);
+
+    BoundsSoA bounds;
+    bounds.reserve(OBJECTS);
+    uint32_t state = 5;
+    for (size_t i = 0; i < OBJECTS; ++i)
+        bounds.add(randomPoint(state),
+                   Vec3(0.2f + randomFloat(state) * 1.8f,
+                        0.2f + randomFloat(state) * 1.8f,
+                        0.2f + randomFloat(state) * 1.8f));
+
+    // Build
+    Bvh bvh;
+    BvhBuildOptions options;
+    options.threads = 1;
+    CpuTimer timer;
+    bvh.build(bounds, options);
+    double serialMs = timer.elapsedMs();
+    options.threads = threads;
+    timer.reset();
+    bvh.build(bounds, options);
+    double parallelMs = timer.elapsedMs();
+    std::printf("Build:   %.1fms on 1 thread, %.1fms on %u (%.2fx), "
+                "%zu nodes, SAH cost %.1f\n", serialMs, parallelMs, threads,
+                serialMs / parallelMs, bvh.nodes.size(), bvh.sahCost());
+
+    // Refit after moving everything a little
+    for (size_t i = 0; i < OBJECTS; ++i) {
+        bounds.centerX[i] += (randomFloat(state) - 0.5f) * 4.0f;
+        bounds.centerY[i] += (randomFloat(state) - 0.5f) * 4.0f;
+    }
+    timer.reset();
+    bvh.refit(bounds);
+    double refitMs = timer.elapsedMs();
+    std::printf("Refit:   %.1fms, SAH cost %.1f\n", refitMs, bvh.sahCost());
+    bvh.build(bounds, options);
+
+    // Frustum culling, BVH against the linear SIMD kernel
+    Mat4 viewProjection =
+        perspective(radians(60.0f), 16.0f / 9.0f, 0.1f, WORLD_SIZE) *
+        lookAt(Vec3(0, 0, 0), Vec3(1, 0.2f, -1), Vec3(0, 1, 0));
+    Frustum frustum = extractFrustum(viewProjection);
+    std::vector<uint32_t> linearVisible(OBJECTS), bvhVisible(OBJECTS);
+    timer.reset();
+    size_t linearCount = cullBounds(frustum, bounds, 0, OBJECTS,
+                                    linearVisible.data());
+    double linearMs = timer.elapsedMs();
+    timer.reset();
+    size_t bvhCount = bvh.cullFrustum(frustum, bvhVisible.data());
+    double cullMs = timer.elapsedMs();
+    std::sort(bvhVisible.begin(), bvhVisible.begin() + bvhCount);
+    bool cullMatch = linearCount == bvhCount &&
+        std::equal(linearVisible.begin(), linearVisible.begin() + bvhCount,
+                   bvhVisible.begin());
+    std::printf("Frustum: %.2fms linear, %.2fms BVH, %zu visible%s\n",
+                linearMs, cullMs, bvhCount, cullMatch ? "" : "  MISMATCH");
+
+    // Ray casts from inside the scene in random directions
+    std::vector<Ray> rays(RAYS);
+    for (Ray& ray : rays) {
+        ray.origin = randomPoint(state);
+        ray.direction = normalize(randomPoint(state));
+    }
+    size_t hits = 0;
+    timer.reset();
+    for (const Ray& ray : rays)
+        hits += bvh.intersectRay(ray).object != BVH_NO_HIT;
+    double rayMs = timer.elapsedMs();
+    size_t rayMismatches = 0;
+    for (size_t r = 0; r < CHECKED_RAYS; ++r) {
+        RayHit expected = bruteForceRay(bounds, rays[r]);
+        RayHit actual = bvh.intersectRay(rays[r]);
+        if (expected.distance != actual.distance)
+            ++rayMismatches;
+    }
+    std::printf("Rays:    %.0f rays/ms, %zu of %zu hit, %zu of %zu checked "
+                "differ\n", RAYS / rayMs, hits, RAYS, rayMismatches,
+                CHECKED_RAYS);
+
+    // Box overlap queries (collision broad phase)
+    std::vector<uint32_t> overlaps;
+    size_t overlapCount = 0;
+    timer.reset();
+    for (size_t q = 0; q < BOX_QUERIES; ++q) {
+        Vec3 center = randomPoint(state);
+        overlaps.clear();
+        overlapCount += bvh.overlapBox(center - Vec3(5.0f),
+                                       center + Vec3(5.0f), overlaps);
+    }
+    double overlapMs = timer.elapsedMs();
+    std::printf("Overlap: %.0f queries/ms, %.2f objects per query\n",
+                BOX_QUERIES / overlapMs,
+                double(overlapCount) / double(BOX_QUERIES));
+    return 0;
+}
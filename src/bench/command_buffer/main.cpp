@@ -0,0 +1,303 @@
+/****************
+ * Title:   bench/command_buffer/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/buffer.hpp"
+#include "engine/command_buffer.hpp"
+#include "engine/job_system.hpp"
+#include "engine/vertex_array.hpp"
+#include "engine/vertex_layout.hpp"
+
+// Draws 100k small shapes with a vertex array, texture and uniform change
+// each, first issuing GL directly and then recording into a CommandQueue
+// with a JobSystem of 1 to 64 threads and replaying on the main thread.
+// Reports record and replay time per frame. Exits with an error if the
+// replayed command stream or image differs between thread counts or from
+// the direct path.
+
+const uint32_t DRAW_COUNT = 100000;
+const int SHAPE_COUNT = 8;
+const int VERTEX_ARRAY_COUNT = 4;
+const int TEXTURE_COUNT = 16;
+const int FRAMES = 10;
+const size_t GRAIN = 1024;
+const unsigned int THREAD_COUNTS[] = { 1, 2, 4, 8, 16, 32, 64 };
+const GLsizei TARGET_WIDTH = 1280;
+const GLsizei TARGET_HEIGHT = 720;
+
+const char* vertexShaderSource =
+    "#version 450 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "uniform vec4 placement;\n"
+    "void main() {\n"
+    "    float c = cos(placement.w), s = sin(placement.w);\n"
+    "    vec2 p = mat2(c, s, -s, c) * aPos * placement.z;\n"
+    "    gl_Position = vec4(p + placement.xy, 0.0, 1.0);\n"
+    "}\0";
+const char* fragmentShaderSource =
+    "#version 450 core\n"
+    "layout (binding = 0) uniform sampler2D colour;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "    FragColor = texture(colour, vec2(0.5));\n"
+    "}\0";
+
+using ShapeVertex = VertexLayout<Pos2f>;
+
+struct Shape {
+    GLsizei count;
+    GLuint firstIndex;
+    GLint baseVertex;
+};
+
+struct Object {
+    float x, y, scale;
+    uint32_t shape;
+    uint32_t texture;
+    uint32_t vertexArray;
+};
+
+struct Scene {
+    unsigned int program;
+    GLint placement;
+    Shape shapes[SHAPE_COUNT];
+    unsigned int vertexArrays[VERTEX_ARRAY_COUNT];
+    unsigned int textures[TEXTURE_COUNT];
+    std::vector<Object> objects;
+};
+
+
+// Spins each object a little every frame, the per draw CPU work
+void placement(const Object& object, uint32_t index, int frame,
+               float* values) {
+    float angle = float(frame) * 0.05f + float(index % 628) * 0.01f;
+    values[0] = object.x + std::cos(angle) * 0.01f;
+    values[1] = object.y + std::sin(angle) * 0.01f;
+    values[2] = object.scale;
+    values[3] = angle;
+}
+
+// Issues every draw straight to GL, dropping redundant binds as replay does
+void drawDirect(const Scene& scene, int frame) {
+    glUseProgram(scene.program);
+    GLuint vertexArray = 0, texture = 0;
+    for (uint32_t i = 0; i < scene.objects.size(); ++i) {
+        const Object& object = scene.objects[i];
+        if (scene.vertexArrays[object.vertexArray] != vertexArray) {
+            vertexArray = scene.vertexArrays[object.vertexArray];
+            glBindVertexArray(vertexArray);
+        }
+        if (scene.textures[object.texture] != texture) {
+            texture = scene.textures[object.texture];
+            glBindTextureUnit(0, texture);
+        }
+        float values[4];
+        placement(object, i, frame, values);
+        glUniform4f(scene.placement, values[0], values[1], values[2],
+                    values[3]);
+        const Shape& shape = scene.shapes[object.shape];
+        glDrawElementsInstancedBaseVertexBaseInstance(
+            GL_TRIANGLES, shape.count, GL_UNSIGNED_INT,
+            reinterpret_cast<const void*>(size_t(shape.firstIndex) *
+                                          sizeof(uint32_t)),
+            1, shape.baseVertex, 0);
+    }
+}
+
+// Records draws [first, last) as one segment
+void record(const Scene& scene, CommandBuffer& commands, uint32_t first,
+            uint32_t last, int frame) {
+    commands.beginSegment(first);
+    commands.bindProgram(scene.program);
+    for (uint32_t i = first; i < last; ++i) {
+        const Object& object = scene.objects[i];
+        commands.bindVertexArray(scene.vertexArrays[object.vertexArray]);
+        commands.bindTexture(0, scene.textures[object.texture]);
+        float values[4];
+        placement(object, i, frame, values);
+        commands.uniform4f(scene.placement, values[0], values[1], values[2],
+                           values[3]);
+        const Shape& shape = scene.shapes[object.shape];
+        commands.drawElements(GL_TRIANGLES, shape.count, shape.firstIndex,
+                              shape.baseVertex);
+    }
+}
+
+uint64_t readbackChecksum() {
+    std::vector<uint8_t> pixels(size_t(TARGET_WIDTH) * TARGET_HEIGHT * 4);
+    glReadPixels(0, 0, TARGET_WIDTH, TARGET_HEIGHT, GL_RGBA,
+                 GL_UNSIGNED_BYTE, pixels.data());
+    uint64_t sum = 0;
+    for (size_t i = 0; i < pixels.size(); ++i)
+        sum = sum * 31 + pixels[i];
+    return sum;
+}
+
+
+int main()
+{
+    GLFWwindow* window = createBenchContext("bench_command_buffer");
+    if (window == NULL)
+        return -1;
+    Scene scene;
+    scene.program = buildProgram(vertexShaderSource, fragmentShaderSource);
+    if (!scene.program) {
+        glfwTerminate();
+        return -1;
+    }
+    scene.placement = glGetUniformLocation(scene.program, "placement");
+
+    // Regular polygons with 3 to 10 sides as triangle fans
+    uint32_t seed = 17u;
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    for (int s = 0; s < SHAPE_COUNT; ++s) {
+        int sides = 3 + s;
+        scene.shapes[s] = { GLsizei((sides - 2) * 3),
+                            GLuint(indices.size()),
+                            GLint(vertices.size() / 2) };
+        for (int v = 0; v < sides; ++v) {
+            float angle = float(v) / float(sides) * 6.2831853f;
+            vertices.push_back(std::cos(angle));
+            vertices.push_back(std::sin(angle));
+        }
+        for (int t = 1; t + 1 < sides; ++t) {
+            indices.push_back(0);
+            indices.push_back(uint32_t(t));
+            indices.push_back(uint32_t(t + 1));
+        }
+    }
+    Buffer vertexBuffer(GLsizeiptr(vertices.size() * sizeof(float)),
+                        vertices.data(), 0);
+    Buffer indexBuffer(GLsizeiptr(indices.size() * sizeof(uint32_t)),
+                       indices.data(), 0);
+    // Identical vertex arrays, so draws also switch vertex arrays
+    std::vector<VertexArray> vertexArrays(VERTEX_ARRAY_COUNT);
+    for (int v = 0; v < VERTEX_ARRAY_COUNT; ++v) {
+        vertexArrays[size_t(v)].setVertexBuffer(0, vertexBuffer, 0,
+                                                ShapeVertex::stride);
+        vertexArrays[size_t(v)].setElementBuffer(indexBuffer);
+        ShapeVertex::apply(vertexArrays[size_t(v)]);
+        scene.vertexArrays[v] = vertexArrays[size_t(v)].ID;
+    }
+    glCreateTextures(GL_TEXTURE_2D, TEXTURE_COUNT, scene.textures);
+    for (int t = 0; t < TEXTURE_COUNT; ++t) {
+        uint8_t texel[4] = { uint8_t(randomFloat(seed) * 255.0f),
+                             uint8_t(randomFloat(seed) * 255.0f),
+                             uint8_t(randomFloat(seed) * 255.0f), 255 };
+        glTextureStorage2D(scene.textures[t], 1, GL_RGBA8, 1, 1);
+        glTextureSubImage2D(scene.textures[t], 0, 0, 0, 1, 1, GL_RGBA,
+                            GL_UNSIGNED_BYTE, texel);
+    }
+    for (uint32_t i = 0; i < DRAW_COUNT; ++i) {
+        Object object;
+        object.x = randomFloat(seed) * 2.0f - 1.0f;
+        object.y = randomFloat(seed) * 2.0f - 1.0f;
+        object.scale = 0.005f + randomFloat(seed) * 0.02f;
+        object.shape = uint32_t(randomFloat(seed) * SHAPE_COUNT);
+        object.texture = uint32_t(randomFloat(seed) * TEXTURE_COUNT);
+        object.vertexArray = uint32_t(randomFloat(seed) *
+                                      VERTEX_ARRAY_COUNT);
+        scene.objects.push_back(object);
+    }
+
+    BenchTarget target;
+    if (!createBenchTarget(TARGET_WIDTH, TARGET_HEIGHT, false, target)) {
+        glfwTerminate();
+        return -1;
+    }
+
+    std::printf("%u draws, %d frames, %zu draws per job\n\n", DRAW_COUNT,
+                FRAMES, GRAIN);
+    std::printf("%-10s %11s %11s %11s %9s %10s\n", "Threads", "Record",
+                "Replay", "Total", "Scaling", "Commands");
+
+    // Direct: the main thread computes and issues every draw itself
+    double directMs = 0.0;
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        CpuTimer timer;
+        drawDirect(scene, frame);
+        directMs += timer.elapsedMs();
+    }
+    glFinish();
+    uint64_t expectedImage = readbackChecksum();
+    std::printf("%-10s %11s %9.3fms %9.3fms %9s %10s\n", "Direct", "-",
+                directMs / FRAMES, directMs / FRAMES, "-", "-");
+
+    bool matched = true;
+    uint64_t expectedStream = 0;
+    double singleRecordMs = 0.0;
+    for (unsigned int threads : THREAD_COUNTS) {
+        JobSystem jobs;
+        jobs.create(threads);
+        CommandQueue queue;
+        queue.create(jobs.threadCount());
+        double recordMs = 0.0, replayMs = 0.0;
+        uint64_t stream = 0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            queue.reset();
+            CpuTimer recordTimer;
+            jobs.parallelFor(DRAW_COUNT, GRAIN,
+                             [&](size_t first, size_t last) {
+                                 record(scene, queue.buffer(size_t(
+                                            jobs.currentSlot())),
+                                        uint32_t(first), uint32_t(last),
+                                        frame);
+                             });
+            recordMs += recordTimer.elapsedMs();
+
+            glClear(GL_COLOR_BUFFER_BIT);
+            CpuTimer replayTimer;
+            queue.replay();
+            replayMs += replayTimer.elapsedMs();
+            if (frame == FRAMES - 1)
+                stream = queue.hash();
+        }
+        glFinish();
+        if (threads == THREAD_COUNTS[0]) {
+            expectedStream = stream;
+            singleRecordMs = recordMs;
+        }
+        bool same = stream == expectedStream &&
+            readbackChecksum() == expectedImage;
+        matched = matched && same;
+
+        size_t commands = 0;
+        for (size_t t = 0; t < queue.threadCount(); ++t)
+            commands += queue.buffer(t).commandCount();
+        std::printf("%-10u %9.3fms %9.3fms %9.3fms %8.2fx %10zu%s\n",
+                    threads, recordMs / FRAMES, replayMs / FRAMES,
+                    (recordMs + replayMs) / FRAMES,
+                    singleRecordMs / recordMs, commands,
+                    same ? "" : "  MISMATCH");
+        jobs.destroy();
+    }
+
+    for (VertexArray& vertexArray : vertexArrays)
+        vertexArray.destroy();
+    vertexBuffer.destroy();
+    indexBuffer.destroy();
+    glDeleteTextures(TEXTURE_COUNT, scene.textures);
+    target.destroy();
+    glDeleteProgram(scene.program);
+    glfwTerminate();
+
+    if (!matched) {
+        std::printf("FAILED: replay differs between thread counts or from "
+                    "direct drawing\n");
+        return 1;
+    }
+    return 0;
+}
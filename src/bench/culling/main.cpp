@@ -0,0 +1,86 @@
+/****************
+ * Title:   bench/culling/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "bench/bench.hpp"
+#include "engine/culling.hpp"
+#include "engine/math.hpp"
+#include "engine/parallel.hpp"
+
+// Frustum culls 100k to 10M random boxes with the scalar reference, the
+// SIMD kernel on one thread and the SIMD kernel on every hardware thread,
+// reporting objects culled per millisecond.
+
+const size_t OBJECT_COUNTS[] = { 100 * 1000, 1000 * 1000, 10 * 1000 * 1000 };
+const int REPEATS = 5;
+const float WORLD_SIZE = 1000.0f;
+
+
+// Runs a cull REPEATS times, returns the average time in milliseconds
+template <typename Cull>
+double timeCull(const Cull& cull, size_t& visibleCount) {
+    CpuTimer timer;
+    for (int r = 0; r < REPEATS; ++r)
+        visibleCount = cull();
+    return timer.elapsedMs() / REPEATS;
+}
+
+
+int main()
+{
+    unsigned int threads = resolveThreadCount(0);
+    std::printf("SIMD backend: %s (%zu lanes), %u threads\n\n",
+                simdBackendName(), SIMD_WIDTH, threads);
+    std::printf("%10s %9s %14s %14s %14s\n", "Objects", "Visible",
+                "Scalar obj/ms", "SIMD obj/ms", "Threads obj/ms");
+
+    Mat4 viewProjection =
+        perspective(radians(60.0f), 16.0f / 9.0f, 0.1f, WORLD_SIZE) *
+        lookAt(Vec3(0, 0, 0), Vec3(1, 0.2f, -1), Vec3(0, 1, 0));
+    Frustum frustum = extractFrustum(viewProjection);
+
+    for (size_t objects : OBJECT_COUNTS) {
+        BoundsSoA bounds;
+        bounds.reserve(objects);
+        uint32_t state = 7;
+        for (size_t i = 0; i < objects; ++i) {
+            Vec3 center(randomFloat(state), randomFloat(state),
+                        randomFloat(state));
+            float size = 0.5f + randomFloat(state) * 4.5f;
+            bounds.add((center * 2.0f - Vec3(1.0f)) * WORLD_SIZE,
+                       Vec3(size));
+        }
+
+        std::vector<uint32_t> scalarVisible(objects), simdVisible(objects),
+            parallelVisible(objects);
+        size_t scalarCount = 0, simdCount = 0, parallelCount = 0;
+        double scalarMs = timeCull([&]() {
+            return cullBoundsScalar(frustum, bounds, 0, objects,
+                                    scalarVisible.data());
+        }, scalarCount);
+        double simdMs = timeCull([&]() {
+            return cullBounds(frustum, bounds, 0, objects, simdVisible.data());
+        }, simdCount);
+        double parallelMs = timeCull([&]() {
+            return cullBoundsParallel(frustum, bounds, parallelVisible.data(),
+                                      threads);
+        }, parallelCount);
+
+        bool match = scalarCount == simdCount &&
+            scalarCount == parallelCount &&
+            std::memcmp(scalarVisible.data(), simdVisible.data(),
+                        scalarCount * sizeof(uint32_t)) == 0 &&
+            std::memcmp(scalarVisible.data(), parallelVisible.data(),
+                        scalarCount * sizeof(uint32_t)) == 0;
+        std::printf("%10zu %9zu %14.0f %14.0f %14.0f%s\n", objects,
+                    scalarCount, objects / scalarMs, objects / simdMs,
+                    objects / parallelMs, match ? "" : "  MISMATCH");
+    }
+    return 0;
+}
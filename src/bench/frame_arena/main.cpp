@@ -0,0 +1,186 @@
+/****************
+ * Title:   bench/frame_arena/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#define HEAP_COUNTER_IMPLEMENTATION
+#include "bench/bench.hpp"
+#include "engine/frame_arena.hpp"
+
+// Builds a typical frame's transient data, a visible list, sorted draw
+// packets and debug labels for 20k objects, first in std containers on
+// the global heap and then in std::pmr containers on FrameArenas. Reports
+// heap allocations and time per frame. Exits with an error if the arena
+// path makes any heap allocation once warmed up.
+
+const size_t OBJECT_COUNT = 20000;
+const int FRAMES = 300;
+// One loop of the moving view, every arena has seen the heaviest frame
+const int WARMUP_FRAMES = 100;
+const size_t ARENA_BYTES = 64 * 1024;
+
+struct DrawPacket {
+    uint64_t sortKey;
+    uint32_t mesh;
+    uint32_t material;
+    uint32_t object;
+    uint32_t instanceCount;
+};
+
+struct Object {
+    float x, y, radius;
+    uint32_t mesh;
+    uint32_t material;
+};
+
+
+// Visible if inside a view window that moves each frame
+bool visible(const Object& object, int frame) {
+    float centre = float(frame % 100) * 0.01f;
+    return object.x + object.radius > centre - 0.3f &&
+        object.x - object.radius < centre + 0.3f;
+}
+
+uint64_t sortKey(const Object& object) {
+    return uint64_t(object.material) << 32 | object.mesh;
+}
+
+// The frame with std containers, returns a checksum so nothing is elided
+size_t heapFrame(const std::vector<Object>& objects, int frame) {
+    std::vector<uint32_t> visibleList;
+    for (uint32_t i = 0; i < objects.size(); ++i)
+        if (visible(objects[i], frame))
+            visibleList.push_back(i);
+    std::vector<DrawPacket> packets;
+    for (uint32_t i : visibleList)
+        packets.push_back({ sortKey(objects[i]), objects[i].mesh,
+                            objects[i].material, i, 1 });
+    std::sort(packets.begin(), packets.end(),
+              [](const DrawPacket& a, const DrawPacket& b) {
+                  return a.sortKey < b.sortKey;
+              });
+    std::vector<std::string> labels;
+    for (size_t i = 0; i < packets.size(); i += 64)
+        labels.push_back("draw " + std::to_string(packets[i].object) +
+                         " material " + std::to_string(packets[i].material));
+    size_t checksum = packets.size();
+    for (const std::string& label : labels)
+        checksum += label.size();
+    return checksum;
+}
+
+// The same frame on the arena
+size_t arenaFrame(const std::vector<Object>& objects, int frame,
+                  LinearArena& arena) {
+    std::pmr::vector<uint32_t> visibleList(&arena);
+    visibleList.reserve(objects.size());
+    for (uint32_t i = 0; i < objects.size(); ++i)
+        if (visible(objects[i], frame))
+            visibleList.push_back(i);
+    std::pmr::vector<DrawPacket> packets(&arena);
+    packets.reserve(visibleList.size());
+    for (uint32_t i : visibleList)
+        packets.push_back({ sortKey(objects[i]), objects[i].mesh,
+                            objects[i].material, i, 1 });
+    std::sort(packets.begin(), packets.end(),
+              [](const DrawPacket& a, const DrawPacket& b) {
+                  return a.sortKey < b.sortKey;
+              });
+    std::pmr::vector<const char*> labels(&arena);
+    labels.reserve(packets.size() / 64 + 1);
+    for (size_t i = 0; i < packets.size(); i += 64)
+        labels.push_back(arena.format("draw %u material %u",
+                                      packets[i].object,
+                                      packets[i].material));
+    size_t checksum = packets.size();
+    for (const char* label : labels)
+        checksum += std::char_traits<char>::length(label);
+    return checksum;
+}
+
+
+int main()
+{
+    uint32_t seed = 13u;
+    std::vector<Object> objects(OBJECT_COUNT);
+    for (Object& object : objects) {
+        object.x = randomFloat(seed);
+        object.y = randomFloat(seed);
+        object.radius = 0.001f + randomFloat(seed) * 0.01f;
+        object.mesh = uint32_t(randomFloat(seed) * 64.0f);
+        object.material = uint32_t(randomFloat(seed) * 256.0f);
+    }
+
+    std::printf("%zu objects, %d frames (%d warm-up)\n\n", OBJECT_COUNT,
+                FRAMES, WARMUP_FRAMES);
+    std::printf("%-14s %14s %14s %12s\n", "Path", "Allocs/frame",
+                "Steady worst", "Frame");
+
+    size_t checksum = 0;
+    {
+        uint64_t steadyAllocations = 0, worst = 0;
+        double totalMs = 0.0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            uint64_t before = heapAllocationCount();
+            CpuTimer timer;
+            checksum += heapFrame(objects, frame);
+            totalMs += timer.elapsedMs();
+            uint64_t allocations = heapAllocationCount() - before;
+            if (frame >= WARMUP_FRAMES) {
+                steadyAllocations += allocations;
+                worst = std::max(worst, allocations);
+            }
+        }
+        std::printf("%-14s %14.1f %14llu %10.3fms\n", "Global heap",
+                    double(steadyAllocations) / (FRAMES - WARMUP_FRAMES),
+                    (unsigned long long)worst, totalMs / FRAMES);
+    }
+
+    uint64_t arenaSteadyAllocations = 0;
+    {
+        FrameArenas<> arenas;
+        // Deliberately small so the first frames overflow and grow it
+        arenas.create(ARENA_BYTES);
+        uint64_t worst = 0;
+        double totalMs = 0.0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            uint64_t before = heapAllocationCount();
+            CpuTimer timer;
+            LinearArena& arena = arenas.beginFrame();
+            checksum += arenaFrame(objects, frame, arena);
+            arenas.endFrame();
+            totalMs += timer.elapsedMs();
+            uint64_t allocations = heapAllocationCount() - before;
+            if (frame >= WARMUP_FRAMES) {
+                arenaSteadyAllocations += allocations;
+                worst = std::max(worst, allocations);
+            }
+        }
+        std::printf("%-14s %14.1f %14llu %10.3fms\n", "Frame arena",
+                    double(arenaSteadyAllocations) /
+                    (FRAMES - WARMUP_FRAMES),
+                    (unsigned long long)worst, totalMs / FRAMES);
+        std::printf("  arena grew from %zuKB to %zuKB, high water %zuKB\n",
+                    ARENA_BYTES / 1024, arenas.current().size() / 1024,
+                    arenas.current().highWaterMark() / 1024);
+        arenas.destroy();
+    }
+    std::printf("\nchecksum %zu\n", checksum);
+
+    if (arenaSteadyAllocations != 0) {
+        std::printf("FAILED: the arena path made %llu heap allocations "
+                    "after warm-up\n",
+                    (unsigned long long)arenaSteadyAllocations);
+        return 1;
+    }
+    std::printf("Arena path made no heap allocations after warm-up\n");
+    return 0;
+}
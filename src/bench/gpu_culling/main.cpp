@@ -0,0 +1,141 @@
+/****************
+ * Title:   bench/gpu_culling/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cstdio>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/buffer.hpp"
+#include "engine/culling.hpp"
+#include "engine/gpu_culling.hpp"
+#include "engine/indirect_draw.hpp"
+#include "engine/math.hpp"
+
+// Compares CPU culling (SIMD + threads, then uploading the compacted draw
+// commands) against the GPU compute pass for scenes of cubes. Both paths
+// submit the visible cubes with a single multi-draw-indirect call.
+
+const GLsizei OBJECT_COUNTS[] = { 10000, 100000, 1000000 };
+const int FRAMES = 20;
+const float WORLD_SIZE = 1000.0f;
+
+
+int main(void)
+{
+    GLFWwindow* window = createBenchContext("bench_gpu_culling");
+    if (window == NULL)
+        return -1;
+    unsigned int program = buildProgram(BENCH_CUBE_VERTEX_GLSL,
+                                        BENCH_CUBE_FRAGMENT_GLSL);
+    if (!program) {
+        glfwTerminate();
+        return -1;
+    }
+
+    BenchCube cube;
+
+    Mat4 viewProjection =
+        perspective(radians(60.0f), 1.0f, 0.1f, WORLD_SIZE) *
+        lookAt(Vec3(0, 0, 0), Vec3(1, 0.2f, -1), Vec3(0, 1, 0));
+    Frustum frustum = extractFrustum(viewProjection);
+    glProgramUniformMatrix4fv(program,
+                              glGetUniformLocation(program,
+                                                   "uViewProjection"),
+                              1, GL_FALSE, viewProjection.data());
+
+    std::printf("Indirect count: %s\n\n", GLAD_GL_VERSION_4_6 ?
+                "glMultiDrawElementsIndirectCount" :
+                "unavailable, cleared glMultiDrawElementsIndirect");
+    std::printf("%9s %8s | %10s %10s %10s | %10s %10s %10s\n", "Objects",
+                "Visible", "CPU cull", "CPU draw", "CPU submit", "GPU cull",
+                "GPU draw", "GPU submit");
+
+    for (GLsizei objects : OBJECT_COUNTS) {
+        BoundsSoA bounds;
+        bounds.reserve(size_t(objects));
+        std::vector<DrawElementsIndirectCommand> objectDraws(
+            size_t(objects), { 36, 1, 0, 0, 0 });
+        uint32_t state = 11;
+        for (GLsizei i = 0; i < objects; ++i) {
+            Vec3 center(randomFloat(state), randomFloat(state),
+                        randomFloat(state));
+            bounds.add((center * 2.0f - Vec3(1.0f)) * WORLD_SIZE,
+                       Vec3(0.5f + randomFloat(state) * 2.0f));
+        }
+
+        GpuCuller culler;
+        if (!culler.create(objects))
+            break;
+        culler.setObjects(bounds, objectDraws.data());
+        culler.attachObjectIds(cube.vertexArray, 1, 1);
+        Buffer cpuCommands(GLsizeiptr(objects) *
+                           sizeof(DrawElementsIndirectCommand), NULL);
+        std::vector<uint32_t> visible(static_cast<size_t>(objects));
+        std::vector<DrawElementsIndirectCommand> commands(
+            static_cast<size_t>(objects));
+
+        glUseProgram(program);
+        cube.vertexArray.bind();
+        culler.bindStorage();
+        GpuTimer cullTimer, drawTimer;
+        double cpuCullMs = 0, cpuDrawMs = 0, cpuSubmitMs = 0;
+        double gpuCullMs = 0, gpuDrawMs = 0, gpuSubmitMs = 0;
+        size_t cpuVisible = 0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            // CPU: cull, compact commands, upload, draw
+            CpuTimer timer;
+            cpuVisible = cullBoundsParallel(frustum, bounds, visible.data());
+            buildDrawCommands(visible.data(), cpuVisible, objectDraws.data(),
+                              commands.data());
+            cpuCommands.update(0, GLsizeiptr(cpuVisible *
+                               sizeof(DrawElementsIndirectCommand)),
+                               commands.data());
+            cpuCullMs += timer.elapsedMs();
+            timer.reset();
+            drawTimer.begin();
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, cpuCommands.ID);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, 0,
+                                        GLsizei(cpuVisible), 0);
+            drawTimer.end();
+            cpuSubmitMs += timer.elapsedMs();
+            cpuDrawMs += drawTimer.resultMs();
+
+            // GPU: dispatch cull, draw from its output
+            timer.reset();
+            cullTimer.begin();
+            culler.cull(frustum);
+            cullTimer.end();
+            glUseProgram(program);
+            drawTimer.begin();
+            culler.draw(GL_UNSIGNED_SHORT);
+            drawTimer.end();
+            gpuSubmitMs += timer.elapsedMs();
+            gpuCullMs += cullTimer.resultMs();
+            gpuDrawMs += drawTimer.resultMs();
+        }
+        GLuint gpuVisible = culler.readVisibleCount();
+
+        std::printf("%9d %8zu | %8.3fms %8.3fms %8.3fms | %8.3fms %8.3fms "
+                    "%8.3fms%s\n", objects, cpuVisible, cpuCullMs / FRAMES,
+                    cpuDrawMs / FRAMES, cpuSubmitMs / FRAMES,
+                    gpuCullMs / FRAMES, gpuDrawMs / FRAMES,
+                    gpuSubmitMs / FRAMES,
+                    gpuVisible == cpuVisible ? "" : "  COUNT MISMATCH");
+
+        cullTimer.destroy();
+        drawTimer.destroy();
+        cpuCommands.destroy();
+        culler.destroy();
+    }
+
+    cube.destroy();
+    glDeleteProgram(program);
+    glfwTerminate();
+    return 0;
+}
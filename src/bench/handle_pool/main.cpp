@@ -0,0 +1,234 @@
+/****************
+ * Title:   bench/handle_pool/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/handle_pool.hpp"
+#include "engine/vertex_layout.hpp"
+
+// Fills a HandlePool with 100k records, churns half of them and compares
+// random lookups and full iteration against a plain array indexed by raw
+// IDs (with holes where records were freed). Checks that every handle to
+// a destroyed record stops resolving even after its slot is reused. Then
+// streams a buffer and vertex array per frame through GlResources,
+// releasing them right after the draw, and reports how many deletions wait
+// on fences. Exits with an error if a stale handle resolves or GL reports
+// an error.
+
+const uint32_t RECORD_COUNT = 100000;
+const uint32_t LOOKUPS = 4000000;
+const int ITERATIONS = 50;
+const int FRAMES = 240;
+const uint32_t STREAM_TRIANGLES = 4096;
+const GLsizei TARGET_WIDTH = 1280;
+const GLsizei TARGET_HEIGHT = 720;
+
+const char* vertexShaderSource =
+    "#version 450 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "void main() {\n"
+    "    gl_Position = vec4(aPos, 0.0, 1.0);\n"
+    "}\0";
+const char* fragmentShaderSource =
+    "#version 450 core\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "    FragColor = vec4(0.2, 0.6, 0.9, 1.0);\n"
+    "}\0";
+
+using StreamVertex = VertexLayout<Pos2f>;
+
+struct Record {
+    float bounds[4];
+    uint32_t mesh;
+    uint32_t material;
+};
+
+// Raw ID storage, freed entries stay in place as holes
+struct RawRecord {
+    Record record;
+    bool alive;
+};
+
+struct RecordTag;
+
+
+Record makeRecord(uint32_t& seed) {
+    Record record;
+    for (float& value : record.bounds)
+        value = randomFloat(seed);
+    record.mesh = uint32_t(randomFloat(seed) * 64.0f);
+    record.material = uint32_t(randomFloat(seed) * 256.0f);
+    return record;
+}
+
+// Returns the number of stale handles that still resolved
+size_t benchPool() {
+    uint32_t seed = 5u;
+    HandlePool<Record, RecordTag> pool;
+    std::vector<RawRecord> raw;
+    std::vector<Handle<RecordTag>> handles;
+    for (uint32_t i = 0; i < RECORD_COUNT; ++i) {
+        Record record = makeRecord(seed);
+        handles.push_back(pool.create(record));
+        raw.push_back({ record, true });
+    }
+
+    // Free every other record, then refill so slots get reused
+    std::vector<Handle<RecordTag>> stale;
+    for (uint32_t i = 0; i < RECORD_COUNT; i += 2) {
+        stale.push_back(handles[i]);
+        pool.destroy(handles[i]);
+        raw[i].alive = false;
+    }
+    std::vector<Handle<RecordTag>> live;
+    for (uint32_t i = 1; i < RECORD_COUNT; i += 2)
+        live.push_back(handles[i]);
+    for (uint32_t i = 0; i < RECORD_COUNT / 4; ++i) {
+        Record record = makeRecord(seed);
+        live.push_back(pool.create(record));
+        raw.push_back({ record, true });
+    }
+
+    std::vector<uint32_t> order(LOOKUPS);
+    for (uint32_t& index : order)
+        index = uint32_t(randomFloat(seed) * float(live.size())) %
+            uint32_t(live.size());
+
+    std::printf("%u records, %zu live after churn, %u random lookups\n\n",
+                RECORD_COUNT, pool.size(), LOOKUPS);
+    std::printf("%-22s %12s %14s\n", "Path", "Lookup", "Iterate");
+
+    // Raw IDs: unchecked index, iteration skips holes
+    uint64_t checksum = 0;
+    std::vector<uint32_t> rawIds;
+    for (uint32_t i = 0; i < raw.size(); ++i)
+        if (raw[i].alive)
+            rawIds.push_back(i);
+    CpuTimer timer;
+    for (uint32_t index : order)
+        checksum += raw[rawIds[index % rawIds.size()]].record.mesh;
+    double rawLookupNs = timer.elapsedMs() * 1e6 / LOOKUPS;
+    timer.reset();
+    for (int pass = 0; pass < ITERATIONS; ++pass)
+        for (const RawRecord& entry : raw)
+            if (entry.alive)
+                checksum += entry.record.material;
+    double rawIterateMs = timer.elapsedMs() / ITERATIONS;
+    std::printf("%-22s %10.2fns %12.3fms\n", "Raw IDs", rawLookupNs,
+                rawIterateMs);
+
+    // Handles: generation checked on every lookup, dense iteration
+    timer.reset();
+    for (uint32_t index : order)
+        checksum += pool.get(live[index])->mesh;
+    double poolLookupNs = timer.elapsedMs() * 1e6 / LOOKUPS;
+    timer.reset();
+    for (int pass = 0; pass < ITERATIONS; ++pass)
+        for (const Record& record : pool)
+            checksum += record.material;
+    double poolIterateMs = timer.elapsedMs() / ITERATIONS;
+    std::printf("%-22s %10.2fns %12.3fms\n", "Generational handles",
+                poolLookupNs, poolIterateMs);
+
+    size_t resolved = 0;
+    for (Handle<RecordTag> handle : stale)
+        if (pool.get(handle) != NULL)
+            ++resolved;
+    std::printf("\n%zu/%zu stale handles caught (slots reused), "
+                "checksum %llu\n", stale.size() - resolved, stale.size(),
+                (unsigned long long)checksum);
+    return resolved;
+}
+
+
+int main()
+{
+    size_t staleResolved = benchPool();
+
+    GLFWwindow* window = createBenchContext("bench_handle_pool");
+    if (window == NULL)
+        return -1;
+
+    GlResources resources;
+    ProgramHandle program = resources.adoptProgram(
+        buildProgram(vertexShaderSource, fragmentShaderSource));
+    if (!resources.program(program)) {
+        glfwTerminate();
+        return -1;
+    }
+
+    BenchTarget target;
+    if (!createBenchTarget(TARGET_WIDTH, TARGET_HEIGHT, false, target)) {
+        glfwTerminate();
+        return -1;
+    }
+
+    // Per frame geometry, released as soon as it has been drawn
+    uint32_t seed = 7u;
+    std::vector<float> vertices(STREAM_TRIANGLES * 3 * 2);
+    size_t worstPending = 0, deleted = 0;
+    BufferHandle lastBuffer;
+    CpuTimer timer;
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        resources.beginFrame();
+        deleted += resources.stats().deleted;
+        for (float& value : vertices)
+            value = randomFloat(seed) * 2.0f - 1.0f;
+        BufferHandle buffer = resources.createBuffer(
+            GLsizeiptr(vertices.size() * sizeof(float)), vertices.data(), 0);
+        VertexArrayHandle vertexArray = resources.createVertexArray();
+        const VertexArray* vao = resources.vertexArray(vertexArray);
+        vao->setVertexBuffer(0, *resources.buffer(buffer), 0,
+                             StreamVertex::stride);
+        StreamVertex::apply(*vao);
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        glUseProgram(resources.program(program));
+        vao->bind();
+        glDrawArrays(GL_TRIANGLES, 0, GLsizei(STREAM_TRIANGLES * 3));
+
+        // The GPU may not have run the draw yet, deletion waits on a fence
+        resources.release(vertexArray);
+        resources.release(buffer);
+        resources.endFrame();
+        worstPending = std::max(worstPending,
+                                resources.stats().pendingDeletes);
+        lastBuffer = buffer;
+    }
+    glFinish();
+    double frameMs = timer.elapsedMs() / FRAMES;
+
+    std::printf("\n%d frames streaming %u triangles, %.3fms per frame\n",
+                FRAMES, STREAM_TRIANGLES, frameMs);
+    std::printf("  %zu objects deleted behind fences, at most %zu waiting\n",
+                deleted, worstPending);
+    std::printf("  Lookup of a released buffer: ");
+    bool staleBuffer = resources.buffer(lastBuffer) != NULL;
+
+    GLenum error = glGetError();
+    resources.release(program);
+    resources.destroy();
+    target.destroy();
+    glfwTerminate();
+
+    if (staleResolved != 0 || staleBuffer) {
+        std::printf("FAILED: a stale handle resolved\n");
+        return 1;
+    }
+    if (error != GL_NO_ERROR) {
+        std::printf("FAILED: GL error 0x%x\n", error);
+        return 1;
+    }
+    return 0;
+}
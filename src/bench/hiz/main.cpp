@@ -0,0 +1,166 @@
+/****************
+ * Title:   bench/hiz/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/culling.hpp"
+#include "engine/gpu_culling.hpp"
+#include "engine/hiz.hpp"
+#include "engine/indirect_draw.hpp"
+#include "engine/math.hpp"
+
+// Renders a field of cubes behind two rows of walls with depth testing,
+// culling with the frustum only and then with the Hi-Z pyramid of the
+// previous frame. Reports the frame stats of both: objects rejected by each
+// test, draw time and pyramid build time.
+
+const GLsizei OBJECT_COUNTS[] = { 100000, 1000000 };
+const int FRAMES = 30;
+const GLsizei TARGET_WIDTH = 1280;
+const GLsizei TARGET_HEIGHT = 720;
+const float FIELD_DEPTH = 900.0f;
+
+
+// Walls with gaps close to the camera, then small cubes spread behind them
+void buildScene(BoundsSoA& bounds, GLsizei objects) {
+    bounds.clear();
+    bounds.reserve(size_t(objects));
+    for (int row = 0; row < 2; ++row)
+        for (int wall = -12; wall <= 12; ++wall)
+            bounds.add(Vec3(float(wall) * 8.0f + float(row) * 4.0f, 0.0f,
+                            -30.0f - float(row) * 15.0f),
+                       Vec3(3.0f, 40.0f, 1.0f));
+    uint32_t state = 23;
+    while (bounds.size() < size_t(objects)) {
+        float z = -60.0f - randomFloat(state) * FIELD_DEPTH;
+        float spread = -z * 0.7f;
+        bounds.add(Vec3((randomFloat(state) * 2.0f - 1.0f) * spread,
+                        (randomFloat(state) * 2.0f - 1.0f) * spread * 0.5f,
+                        z),
+                   Vec3(0.5f + randomFloat(state) * 1.5f));
+    }
+}
+
+
+int main(void)
+{
+    GLFWwindow* window = createBenchContext("bench_hiz");
+    if (window == NULL)
+        return -1;
+    unsigned int program = buildProgram(BENCH_CUBE_VERTEX_GLSL,
+                                        BENCH_CUBE_FRAGMENT_GLSL);
+    if (!program) {
+        glfwTerminate();
+        return -1;
+    }
+    GLint viewProjectionLocation = glGetUniformLocation(program,
+                                                        "uViewProjection");
+
+    // Offscreen target, the depth texture feeds the pyramid
+    unsigned int colour, depth, framebuffer;
+    glCreateRenderbuffers(1, &colour);
+    glNamedRenderbufferStorage(colour, GL_RGBA8, TARGET_WIDTH,
+                               TARGET_HEIGHT);
+    glCreateTextures(GL_TEXTURE_2D, 1, &depth);
+    glTextureStorage2D(depth, 1, GL_DEPTH_COMPONENT32F, TARGET_WIDTH,
+                       TARGET_HEIGHT);
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferRenderbuffer(framebuffer, GL_COLOR_ATTACHMENT0,
+                                   GL_RENDERBUFFER, colour);
+    glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, depth, 0);
+    if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) !=
+        GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+
+    BenchCube cube;
+
+    DepthPyramid pyramid;
+    if (!pyramid.create(TARGET_WIDTH, TARGET_HEIGHT)) {
+        glfwTerminate();
+        return -1;
+    }
+    std::printf("Pyramid: %dx%d, %d levels\n\n", pyramid.width,
+                pyramid.height, pyramid.levels);
+    std::printf("%9s %8s | %8s %9s %9s | %10s %10s\n", "Objects", "Culling",
+                "Visible", "Frustum", "Occluded", "Draw", "Pyramid");
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, TARGET_WIDTH, TARGET_HEIGHT);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    for (GLsizei objects : OBJECT_COUNTS) {
+        BoundsSoA bounds;
+        buildScene(bounds, objects);
+        std::vector<DrawElementsIndirectCommand> objectDraws(
+            bounds.size(), { 36, 1, 0, 0, 0 });
+
+        GpuCuller culler;
+        if (!culler.create(GLsizei(bounds.size())))
+            break;
+        culler.setObjects(bounds, objectDraws.data());
+        culler.attachObjectIds(cube.vertexArray, 1, 1);
+
+        for (int useOcclusion = 0; useOcclusion < 2; ++useOcclusion) {
+            GpuTimer drawTimer;
+            double drawMs = 0;
+            pyramid.reset();
+            GpuCullStats stats;
+            for (int frame = 0; frame < FRAMES; ++frame) {
+                // Slow pan so the pyramid always lags the camera a little
+                float yaw = radians(float(frame) * 0.2f);
+                Mat4 viewProjection =
+                    perspective(radians(60.0f), float(TARGET_WIDTH) /
+                                float(TARGET_HEIGHT), 0.1f, 1000.0f) *
+                    lookAt(Vec3(0, 0, 0),
+                           Vec3(std::sin(yaw), 0, -std::cos(yaw)),
+                           Vec3(0, 1, 0));
+                glProgramUniformMatrix4fv(program, viewProjectionLocation, 1,
+                                          GL_FALSE, viewProjection.data());
+
+                culler.cull(extractFrustum(viewProjection),
+                            useOcclusion ? &pyramid : NULL);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                glUseProgram(program);
+                cube.vertexArray.bind();
+                culler.bindStorage();
+                drawTimer.begin();
+                culler.draw(GL_UNSIGNED_SHORT);
+                drawTimer.end();
+                if (useOcclusion)
+                    pyramid.build(depth, viewProjection);
+
+                stats = culler.readStats(useOcclusion ? &pyramid : NULL);
+                drawMs += drawTimer.resultMs();
+            }
+            std::printf("%9zu %8s | %8u %9u %9u | %8.3fms %8.3fms\n",
+                        bounds.size(), useOcclusion ? "Hi-Z" : "frustum",
+                        stats.visible, stats.frustumCulled,
+                        stats.occlusionCulled, drawMs / FRAMES,
+                        stats.pyramidBuildMs);
+            drawTimer.destroy();
+        }
+        culler.destroy();
+    }
+
+    pyramid.destroy();
+    cube.destroy();
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &depth);
+    glDeleteRenderbuffers(1, &colour);
+    glDeleteProgram(program);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,188 @@
+/****************
+ * Title:   bench/index_optimizer/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/buffer.hpp"
+#include "engine/gl_extensions.hpp"
+#include "engine/index_optimizer.hpp"
+#include "engine/vertex_array.hpp"
+
+const char* vertexShaderSource = "#version 450 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "void main() {\n"
+    "    gl_Position = vec4(aPos, 1.0);\n"
+    "}\0";
+
+
+struct Mesh {
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+};
+
+/**
+ * Builds a grid mesh with triangles and vertices in random order, which is
+ * roughly what an exporter that doesn't care about caches produces
+ *
+ * @param size  vertices along each side of the grid
+ */
+Mesh buildShuffledGrid(uint32_t size) {
+    Mesh mesh;
+    std::mt19937 random(size);
+
+    std::vector<uint32_t> vertexOrder(size_t(size) * size);
+    for (size_t i = 0; i < vertexOrder.size(); ++i)
+        vertexOrder[i] = uint32_t(i);
+    std::shuffle(vertexOrder.begin(), vertexOrder.end(), random);
+    mesh.vertices.resize(vertexOrder.size() * 3);
+    for (uint32_t y = 0; y < size; ++y)
+        for (uint32_t x = 0; x < size; ++x) {
+            uint32_t v = vertexOrder[size_t(y) * size + x];
+            mesh.vertices[v * 3] = float(x) / (size - 1) * 2.0f - 1.0f;
+            mesh.vertices[v * 3 + 1] = float(y) / (size - 1) * 2.0f - 1.0f;
+            mesh.vertices[v * 3 + 2] = 0.0f;
+        }
+
+    std::vector<uint32_t> quads(size_t(size - 1) * (size - 1));
+    for (size_t i = 0; i < quads.size(); ++i)
+        quads[i] = uint32_t(i);
+    std::shuffle(quads.begin(), quads.end(), random);
+    for (uint32_t quad : quads) {
+        uint32_t x = quad % (size - 1);
+        uint32_t y = quad / (size - 1);
+        uint32_t a = vertexOrder[size_t(y) * size + x];
+        uint32_t b = vertexOrder[size_t(y) * size + x + 1];
+        uint32_t c = vertexOrder[size_t(y + 1) * size + x];
+        uint32_t d = vertexOrder[size_t(y + 1) * size + x + 1];
+        mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+    }
+    return mesh;
+}
+
+
+// GL_VERTEX_SHADER_INVOCATIONS is core in 4.6, the 4.5 fallback context
+// needs the extension
+bool hasPipelineStatistics() {
+    return GLAD_GL_VERSION_4_6 ||
+        hasGlExtension("GL_ARB_pipeline_statistics_query");
+}
+
+/**
+ * Counts vertex shader invocations for drawing a mesh once
+ *
+ * @return invocations reported by the pipeline statistics query
+ */
+GLuint64 countInvocations(unsigned int program, const Mesh& mesh,
+                          const IndexData& indexData) {
+    Buffer vertices(GLsizeiptr(mesh.vertices.size() * sizeof(float)),
+                    mesh.vertices.data(), 0);
+    Buffer elements(GLsizeiptr(indexData.bytes.size()),
+                    indexData.bytes.data(), 0);
+    VertexArray vertexArray;
+    vertexArray.setVertexBuffer(0, vertices, 0, 3 * sizeof(float));
+    vertexArray.setElementBuffer(elements);
+    vertexArray.setAttribute(0, 0, 3, GL_FLOAT, GL_FALSE, 0);
+
+    unsigned int query;
+    glCreateQueries(GL_VERTEX_SHADER_INVOCATIONS, 1, &query);
+    glUseProgram(program);
+    vertexArray.bind();
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS, query);
+    glDrawElements(GL_TRIANGLES, GLsizei(indexData.count), indexData.type, 0);
+    glEndQuery(GL_VERTEX_SHADER_INVOCATIONS);
+    glDisable(GL_RASTERIZER_DISCARD);
+    GLuint64 invocations = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &invocations);
+
+    glDeleteQueries(1, &query);
+    vertexArray.destroy();
+    vertices.destroy();
+    elements.destroy();
+    return invocations;
+}
+
+
+void runBenchmark(unsigned int program, uint32_t gridSize) {
+    Mesh mesh = buildShuffledGrid(gridSize);
+    size_t vertexCount = mesh.vertices.size() / 3;
+    size_t indexCount = mesh.indices.size();
+
+    VertexCacheStats before = analyzeVertexCache(
+        mesh.indices.data(), indexCount, vertexCount);
+    IndexData unoptimized;
+    unoptimized.count = indexCount;
+    unoptimized.bytes.resize(indexCount * sizeof(uint32_t));
+    std::copy_n(reinterpret_cast<unsigned char*>(mesh.indices.data()),
+                unoptimized.bytes.size(), unoptimized.bytes.begin());
+    bool statistics = hasPipelineStatistics();
+    GLuint64 invocationsBefore = statistics ?
+        countInvocations(program, mesh, unoptimized) : 0;
+
+    CpuTimer timer;
+    optimizeVertexCache(mesh.indices.data(), indexCount, vertexCount);
+    double cacheMs = timer.elapsedMs();
+    timer.reset();
+    vertexCount = optimizeVertexFetch(mesh.indices.data(), indexCount,
+                                      mesh.vertices.data(), vertexCount,
+                                      3 * sizeof(float));
+    double fetchMs = timer.elapsedMs();
+    IndexData optimized = narrowIndices(mesh.indices.data(), indexCount,
+                                        vertexCount);
+
+    VertexCacheStats after = analyzeVertexCache(
+        mesh.indices.data(), indexCount, vertexCount);
+    GLuint64 invocationsAfter = statistics ?
+        countInvocations(program, mesh, optimized) : 0;
+
+    std::cout << "Grid " << gridSize << "x" << gridSize << ": " <<
+        vertexCount << " vertices, " << indexCount / 3 << " triangles\n";
+    std::cout << "  ACMR:               " << before.acmr << " -> " <<
+        after.acmr << "\n";
+    std::cout << "  ATVR:               " << before.atvr << " -> " <<
+        after.atvr << "\n";
+    if (statistics)
+        std::cout << "  VS invocations:     " << invocationsBefore <<
+            " -> " << invocationsAfter << "\n";
+    else
+        std::cout << "  VS invocations:     unavailable (needs GL 4.6 or "
+            "ARB_pipeline_statistics_query)\n";
+    std::cout << "  Index memory:       " << unoptimized.bytes.size() <<
+        " -> " << optimized.bytes.size() << " bytes (" <<
+        (optimized.type == GL_UNSIGNED_SHORT ? "16" : "32") << "-bit)\n";
+    std::cout << "  Cache optimization: " << cacheMs << " ms\n";
+    std::cout << "  Fetch optimization: " << fetchMs << " ms" << std::endl;
+}
+
+
+int main(void)
+{
+    GLFWwindow* window = createBenchContext("bench_index_optimizer");
+    if (window == NULL)
+        return -1;
+
+    unsigned int program = buildProgram(vertexShaderSource, NULL);
+    if (!program) {
+        glfwTerminate();
+        return -1;
+    }
+
+    // Small enough for 16-bit indices, then a 1M vertex mesh
+    runBenchmark(program, 256);
+    runBenchmark(program, 1024);
+
+    glDeleteProgram(program);
+    glfwTerminate();
+    return 0;
+}
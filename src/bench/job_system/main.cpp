@@ -0,0 +1,205 @@
+/****************
+ * Title:   bench/job_system/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "bench/bench.hpp"
+#include "engine/culling.hpp"
+#include "engine/indirect_draw.hpp"
+#include "engine/job_system.hpp"
+#include "engine/math.hpp"
+#include "engine/texture_compression.hpp"
+
+// Runs a frame of CPU work for 200k objects, animation, then frustum
+// culling, then recording an indirect draw command per visible object,
+// while texture decode jobs (mip chain builds) run alongside, first on one
+// thread and then as dependent jobs on a JobSystem with 1 to 64 threads.
+// Also reports the scheduling cost of an empty job. Exits with an error
+// if any thread count produces different results from the serial frame.
+
+const size_t OBJECT_COUNT = 200000;
+const int FRAMES = 30;
+const int DECODES_PER_FRAME = 8;
+const int IMAGE_SIZE = 256;
+const size_t EMPTY_JOBS = 1 << 20;
+const size_t GRAIN = 2048;
+const unsigned int THREAD_COUNTS[] = { 1, 2, 4, 8, 16, 32, 64 };
+const float FOV_Y = radians(60.0f);
+
+struct Scene {
+    std::vector<Vec3> origins;
+    std::vector<Vec3> axes;
+    std::vector<float> phases;
+    std::vector<uint32_t> meshes;
+    std::vector<Mat4> models;
+    BoundsSoA bounds;
+    std::vector<uint32_t> visible;
+    size_t visibleCount = 0;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<std::vector<uint8_t>> images;
+    std::vector<size_t> decodedBytes;
+    Frustum frustum;
+};
+
+
+void createScene(Scene& scene) {
+    uint32_t seed = 3u;
+    for (size_t i = 0; i < OBJECT_COUNT; ++i) {
+        scene.origins.push_back(Vec3(randomFloat(seed) * 400.0f - 200.0f,
+                                     randomFloat(seed) * 40.0f - 20.0f,
+                                     randomFloat(seed) * 400.0f - 200.0f));
+        scene.axes.push_back(Vec3(randomFloat(seed) - 0.5f, 1.0f,
+                                  randomFloat(seed) - 0.5f));
+        scene.phases.push_back(randomFloat(seed) * 6.2831853f);
+        scene.meshes.push_back(uint32_t(randomFloat(seed) * 64.0f));
+        scene.bounds.add(scene.origins.back(), Vec3(1.0f, 1.0f, 1.0f));
+    }
+    scene.models.resize(OBJECT_COUNT);
+    scene.visible.resize(OBJECT_COUNT);
+    scene.commands.resize(OBJECT_COUNT);
+    for (int i = 0; i < DECODES_PER_FRAME; ++i) {
+        std::vector<uint8_t> image(size_t(IMAGE_SIZE) * IMAGE_SIZE * 4);
+        for (uint8_t& value : image)
+            value = uint8_t(randomFloat(seed) * 255.0f);
+        scene.images.push_back(image);
+    }
+    scene.decodedBytes.resize(DECODES_PER_FRAME);
+    Mat4 projection = perspective(FOV_Y, 16.0f / 9.0f, 0.1f, 500.0f);
+    Mat4 view = lookAt(Vec3(0.0f, 30.0f, -220.0f), Vec3(0.0f, 0.0f, 0.0f),
+                       Vec3(0.0f, 1.0f, 0.0f));
+    scene.frustum = extractFrustum(projection * view);
+}
+
+// Orbits and spins objects [first, last), updating their bounds
+void animate(Scene& scene, int frame, size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+        float angle = float(frame) * 0.05f + scene.phases[i];
+        Vec3 position = scene.origins[i] +
+            Vec3(std::sin(angle), 0.0f, std::cos(angle)) * 4.0f;
+        Quat rotation = Quat::fromAxisAngle(scene.axes[i], angle);
+        scene.models[i] = translate(position) * toMat4(rotation);
+        scene.bounds.set(i, position, Vec3(1.0f, 1.0f, 1.0f));
+    }
+}
+
+// Commands for visible objects [first, last), one per object
+void record(Scene& scene, size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+        uint32_t object = scene.visible[i];
+        uint32_t mesh = scene.meshes[object];
+        scene.commands[i] = { 36 + mesh * 12, 1, mesh * 1024, 0, object };
+    }
+}
+
+void decode(Scene& scene, int image) {
+    std::vector<ImageLevel> levels = buildMipChain(
+        scene.images[size_t(image)].data(), IMAGE_SIZE, IMAGE_SIZE, true);
+    size_t bytes = 0;
+    for (const ImageLevel& level : levels)
+        bytes += level.rgba.size();
+    scene.decodedBytes[size_t(image)] = bytes;
+}
+
+uint64_t checksum(const Scene& scene) {
+    uint64_t sum = scene.visibleCount;
+    for (size_t i = 0; i < scene.visibleCount; ++i)
+        sum = sum * 31 + scene.commands[i].baseInstance +
+            scene.commands[i].count;
+    for (size_t bytes : scene.decodedBytes)
+        sum += bytes;
+    return sum;
+}
+
+void serialFrame(Scene& scene, int frame) {
+    animate(scene, frame, 0, OBJECT_COUNT);
+    scene.visibleCount = cullBounds(scene.frustum, scene.bounds, 0,
+                                    OBJECT_COUNT, scene.visible.data());
+    record(scene, 0, scene.visibleCount);
+    for (int i = 0; i < DECODES_PER_FRAME; ++i)
+        decode(scene, i);
+}
+
+// The same frame as a job graph, the caller would go on to submit GL
+void jobFrame(Scene& scene, int frame, JobSystem& jobs) {
+    JobCounter animated, culled, recorded, decoded;
+    Scene* target = &scene;
+    JobSystem* system = &jobs;
+    for (int i = 0; i < DECODES_PER_FRAME; ++i)
+        jobs.run(decoded, [target, i]() { decode(*target, i); });
+    for (size_t first = 0; first < OBJECT_COUNT; first += GRAIN)
+        jobs.run(animated, [target, frame, first]() {
+            animate(*target, frame, first,
+                    std::min(first + GRAIN, OBJECT_COUNT));
+        });
+    jobs.runAfter(animated, culled, [target, system]() {
+        target->visibleCount = cullBoundsParallel(
+            target->frustum, target->bounds, target->visible.data(),
+            *system);
+    });
+    jobs.runAfter(culled, recorded, [target, system]() {
+        system->parallelFor(target->visibleCount, GRAIN,
+                            [target](size_t first, size_t last) {
+                                record(*target, first, last);
+                            });
+    });
+    jobs.wait(recorded);
+    jobs.wait(decoded);
+}
+
+
+int main()
+{
+    Scene scene;
+    createScene(scene);
+    unsigned int hardware = resolveThreadCount(0);
+    std::printf("%zu objects, %d decodes of %dx%d per frame, %u hardware "
+                "threads\n\n", OBJECT_COUNT, DECODES_PER_FRAME, IMAGE_SIZE,
+                IMAGE_SIZE, hardware);
+    std::printf("%-10s %12s %12s %10s\n", "Threads", "Empty job", "Frame",
+                "Speedup");
+
+    CpuTimer timer;
+    for (int frame = 0; frame < FRAMES; ++frame)
+        serialFrame(scene, frame);
+    double serialMs = timer.elapsedMs() / FRAMES;
+    uint64_t expected = checksum(scene);
+    std::printf("%-10s %12s %10.3fms %9.2fx\n", "Serial", "-", serialMs,
+                1.0);
+
+    bool matched = true;
+    for (unsigned int threads : THREAD_COUNTS) {
+        JobSystem jobs;
+        // Pinning only helps while every thread has a core of its own
+        jobs.create(threads, threads <= hardware);
+
+        timer.reset();
+        jobs.parallelFor(EMPTY_JOBS, 1, [](size_t, size_t) {});
+        double emptyNs = timer.elapsedMs() * 1e6 / EMPTY_JOBS;
+
+        timer.reset();
+        for (int frame = 0; frame < FRAMES; ++frame)
+            jobFrame(scene, frame, jobs);
+        double frameMs = timer.elapsedMs() / FRAMES;
+        if (checksum(scene) != expected) {
+            std::printf("%u threads: result differs from the serial frame\n",
+                        threads);
+            matched = false;
+        }
+        std::printf("%-10u %10.1fns %10.3fms %9.2fx\n", threads, emptyNs,
+                    frameMs, serialMs / frameMs);
+        jobs.destroy();
+    }
+
+    if (!matched) {
+        std::printf("FAILED: job frames differ from the serial frame\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,250 @@
+/****************
+ * Title:   bench/lod/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/buffer.hpp"
+#include "engine/indirect_draw.hpp"
+#include "engine/lod.hpp"
+#include "engine/math.hpp"
+#include "engine/vertex_array.hpp"
+
+// Renders a field of bumpy spheres headless, once at full detail and then
+// with per object LOD selection (with and without cross-fading), and
+// reports the triangles submitted and GPU draw time of each. Every LOD
+// lives in one vertex/index buffer and each frame is one multi-draw.
+
+const size_t MAX_LODS = 6;
+const size_t OBJECTS = 20000;
+const int FRAMES = 30;
+const GLsizei TARGET_WIDTH = 1280;
+const GLsizei TARGET_HEIGHT = 720;
+const float FIELD_SIZE = 1500.0f;
+const float FOV_Y = radians(60.0f);
+const float MAX_PIXEL_ERROR = 1.0f;
+const float FADE_BAND = 0.25f;
+
+// One per draw, read through the instanced draw id (std430)
+struct DrawInfo {
+    float placement[4];     // position xyz, scale w
+    float fade;
+    uint32_t incoming;
+    uint32_t padding[2];
+};
+
+const char* vertexShaderSource =
+    "#version 450 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in uint aDraw;\n"
+    "struct DrawInfo {\n"
+    "    vec4 placement;\n"
+    "    float fade;\n"
+    "    uint incoming;\n"
+    "    uint padding[2];\n"
+    "};\n"
+    "layout (std430, binding = 0) readonly buffer DrawBuffer {\n"
+    "    DrawInfo draws[];\n"
+    "};\n"
+    "uniform mat4 uViewProjection;\n"
+    "flat out float vFade;\n"
+    "flat out uint vIncoming;\n"
+    "void main() {\n"
+    "    vec4 placement = draws[aDraw].placement;\n"
+    "    vFade = draws[aDraw].fade;\n"
+    "    vIncoming = draws[aDraw].incoming;\n"
+    "    gl_Position = uViewProjection *\n"
+    "        vec4(placement.xyz + aPos * placement.w, 1.0);\n"
+    "}\0";
+const char* fragmentShaderMain =
+    "flat in float vFade;\n"
+    "flat in uint vIncoming;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "    if (lodFadeDiscard(vFade, vIncoming != 0))\n"
+    "        discard;\n"
+    "    FragColor = vec4(1.0, 0.5, 0.2, 1.0);\n"
+    "}\n";
+
+
+// Appends one draw of a LOD for an object
+void addDraw(const MeshLod& lod, const Vec4& placement, float fade,
+             bool incoming, std::vector<DrawElementsIndirectCommand>& commands,
+             std::vector<DrawInfo>& draws, size_t& triangles) {
+    DrawElementsIndirectCommand command = { lod.indexCount, 1,
+                                            lod.firstIndex, 0,
+                                            uint32_t(draws.size()) };
+    commands.push_back(command);
+    DrawInfo draw = { { placement.x, placement.y, placement.z, placement.w },
+                      fade, incoming ? 1u : 0u, { 0, 0 } };
+    draws.push_back(draw);
+    triangles += lod.indexCount / 3;
+}
+
+
+int main(void)
+{
+    GLFWwindow* window = createBenchContext("bench_lod");
+    if (window == NULL)
+        return -1;
+    std::string fragmentShaderSource = std::string("#version 450 core\n") +
+        LOD_FADE_GLSL + fragmentShaderMain;
+    unsigned int program = buildProgram(vertexShaderSource,
+                                        fragmentShaderSource.c_str());
+    if (!program) {
+        glfwTerminate();
+        return -1;
+    }
+    GLint viewProjectionLocation = glGetUniformLocation(program,
+                                                        "uViewProjection");
+
+    // Offline step: simplify into a LOD chain sharing the vertices
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    buildBenchSphere(positions, indices);
+    size_t vertexCount = positions.size() / 3;
+    // Bounds diagonal of the unit sphere
+    const float meshSize = 2.0f * std::sqrt(3.0f);
+    CpuTimer timer;
+    LodChain chain = buildLodChain(indices.data(), indices.size(),
+                                   positions.data(), vertexCount,
+                                   3 * sizeof(float), MAX_LODS, 0.5f,
+                                   meshSize);
+    std::printf("LOD chain built in %.0fms:\n", timer.elapsedMs());
+    for (size_t lod = 0; lod < chain.lods.size(); ++lod)
+        std::printf("  LOD %zu: %6u triangles, error %.5f\n", lod,
+                    chain.lods[lod].indexCount / 3, chain.lods[lod].error);
+
+    BenchTarget target;
+    if (!createBenchTarget(TARGET_WIDTH, TARGET_HEIGHT, true, target)) {
+        glfwTerminate();
+        return -1;
+    }
+    glEnable(GL_DEPTH_TEST);
+
+    // One vertex/index buffer for every LOD, draw ids as an instanced
+    // attribute selected by baseInstance
+    Buffer vertices(GLsizeiptr(positions.size() * sizeof(float)),
+                    positions.data(), 0);
+    Buffer indexBuffer(GLsizeiptr(chain.indices.size() * sizeof(uint32_t)),
+                       chain.indices.data(), 0);
+    std::vector<uint32_t> drawIds(OBJECTS * 2);
+    for (size_t i = 0; i < drawIds.size(); ++i)
+        drawIds[i] = uint32_t(i);
+    Buffer drawIdBuffer(GLsizeiptr(drawIds.size() * sizeof(uint32_t)),
+                        drawIds.data(), 0);
+    VertexArray vertexArray;
+    vertexArray.setVertexBuffer(0, vertices, 0, 3 * sizeof(float));
+    vertexArray.setElementBuffer(indexBuffer);
+    vertexArray.setAttribute(0, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    vertexArray.setVertexBuffer(1, drawIdBuffer, 0, sizeof(uint32_t));
+    vertexArray.setBindingDivisor(1, 1);
+    vertexArray.setIntegerAttribute(1, 1, 1, GL_UNSIGNED_INT, 0);
+    Buffer commandBuffer(GLsizeiptr(OBJECTS * 2 *
+                                    sizeof(DrawElementsIndirectCommand)),
+                         NULL);
+    Buffer drawBuffer(GLsizeiptr(OBJECTS * 2 * sizeof(DrawInfo)), NULL);
+
+    std::vector<Vec4> placements(OBJECTS);
+    uint32_t state = 17;
+    for (Vec4& placement : placements)
+        placement = Vec4((randomFloat(state) * 2.0f - 1.0f) * FIELD_SIZE,
+                         (randomFloat(state) * 2.0f - 1.0f) * 20.0f,
+                         -randomFloat(state) * FIELD_SIZE * 2.0f,
+                         1.0f + randomFloat(state) * 4.0f);
+
+    glUseProgram(program);
+    vertexArray.bind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawBuffer.ID);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.ID);
+    float projectionScale = lodProjectionScale(FOV_Y, float(TARGET_HEIGHT));
+    Mat4 projection = perspective(FOV_Y, float(TARGET_WIDTH) /
+                                  float(TARGET_HEIGHT), 0.5f, 5000.0f);
+
+    std::printf("\n%-12s %14s %10s %10s %12s\n", "Mode", "Triangles",
+                "Saved", "Draw", "Selection");
+    const char* modeNames[] = { "Full detail", "LOD", "LOD + fade" };
+    size_t fullTriangles = 0;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<DrawInfo> draws;
+    for (int mode = 0; mode < 3; ++mode) {
+        GpuTimer drawTimer;
+        double drawMs = 0.0, selectMs = 0.0;
+        size_t triangles = 0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            // Fly forward through the field
+            Vec3 eye(0.0f, 10.0f, 100.0f - float(frame) * 20.0f);
+            Mat4 viewProjection = projection *
+                lookAt(eye, eye + Vec3(0.0f, -0.05f, -1.0f),
+                       Vec3(0.0f, 1.0f, 0.0f));
+            glProgramUniformMatrix4fv(program, viewProjectionLocation, 1,
+                                      GL_FALSE, viewProjection.data());
+
+            CpuTimer selectTimer;
+            commands.clear();
+            draws.clear();
+            size_t frameTriangles = 0;
+            for (const Vec4& placement : placements) {
+                if (mode == 0) {
+                    addDraw(chain.lods[0], placement, 0.0f, false, commands,
+                            draws, frameTriangles);
+                    continue;
+                }
+                float distance = length(placement.xyz() - eye);
+                LodSelection selection = selectLod(
+                    chain.lods.data(), chain.lods.size(),
+                    meshSize * placement.w, distance, projectionScale,
+                    MAX_PIXEL_ERROR, mode == 2 ? FADE_BAND : 0.0f);
+                addDraw(chain.lods[selection.lod], placement, selection.fade,
+                        false, commands, draws, frameTriangles);
+                if (selection.fade > 0.0f)
+                    addDraw(chain.lods[selection.fadeLod], placement,
+                            selection.fade, true, commands, draws,
+                            frameTriangles);
+            }
+            commandBuffer.update(0, GLsizeiptr(commands.size() *
+                                 sizeof(DrawElementsIndirectCommand)),
+                                 commands.data());
+            drawBuffer.update(0, GLsizeiptr(draws.size() * sizeof(DrawInfo)),
+                              draws.data());
+            selectMs += selectTimer.elapsedMs();
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawTimer.begin();
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0,
+                                        GLsizei(commands.size()), 0);
+            drawTimer.end();
+            drawMs += drawTimer.resultMs();
+            triangles += frameTriangles;
+        }
+        if (mode == 0)
+            fullTriangles = triangles;
+        std::printf("%-12s %14zu %9.1f%% %8.3fms %10.3fms\n",
+                    modeNames[mode], triangles / FRAMES,
+                    100.0 * (1.0 - double(triangles) /
+                             double(fullTriangles)),
+                    drawMs / FRAMES, selectMs / FRAMES);
+        drawTimer.destroy();
+    }
+
+    vertexArray.destroy();
+    vertices.destroy();
+    indexBuffer.destroy();
+    drawIdBuffer.destroy();
+    commandBuffer.destroy();
+    drawBuffer.destroy();
+    target.destroy();
+    glDeleteProgram(program);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,200 @@
+/****************
+ * Title:   bench/math/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench/bench.hpp"
+#include "engine/math.hpp"
+#include "engine/math_batch.hpp"
+
+// Compares the SIMD math library against a naive scalar implementation for
+// the two batched workloads: transforming points and multiplying matrices.
+
+const size_t POINT_COUNT = 4 * 1024 * 1024;
+const size_t MATRIX_COUNT = 1024 * 1024;
+const int REPEATS = 10;
+
+// Compile time checks that the constexpr parts stay constexpr
+static_assert(Mat4::identity().at(2, 2) == 1.0f, "");
+static_assert(translate(Vec3(1, 2, 3)).at(1, 3) == 2.0f, "");
+static_assert(transpose(translate(Vec3(1, 2, 3))).at(3, 0) == 1.0f, "");
+static_assert(cross(Vec3(1, 0, 0), Vec3(0, 1, 0)).z == 1.0f, "");
+static_assert(rotate(Quat(0, 0, 0, 1), Vec3(1, 2, 3)).y == 2.0f, "");
+
+
+/****************
+ * NAIVE SCALAR
+ ****************/
+
+struct NaivePoint {
+    float x, y, z;
+};
+
+// Row-major m[row][column], the textbook layout
+struct NaiveMatrix {
+    float m[4][4];
+};
+
+void naiveTransform(const NaiveMatrix& matrix, const NaivePoint* points,
+                    NaivePoint* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const float in[4] = { points[i].x, points[i].y, points[i].z, 1.0f };
+        float result[3];
+        for (int r = 0; r < 3; ++r) {
+            result[r] = 0.0f;
+            for (int c = 0; c < 4; ++c)
+                result[r] += matrix.m[r][c] * in[c];
+        }
+        out[i] = { result[0], result[1], result[2] };
+    }
+}
+
+void naiveMultiply(const NaiveMatrix* a, const NaiveMatrix* b,
+                   NaiveMatrix* out, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        for (int r = 0; r < 4; ++r)
+            for (int c = 0; c < 4; ++c) {
+                float sum = 0.0f;
+                for (int k = 0; k < 4; ++k)
+                    sum += a[i].m[r][k] * b[i].m[k][c];
+                out[i].m[r][c] = sum;
+            }
+}
+
+NaiveMatrix toNaive(const Mat4& m) {
+    NaiveMatrix naive;
+    for (int r = 0; r < 4; ++r)
+        for (int c = 0; c < 4; ++c)
+            naive.m[r][c] = m.at(r, c);
+    return naive;
+}
+
+// Deterministic pseudo random float in [-1, 1)
+float randomSigned(uint32_t& state) {
+    return randomFloat(state) * 2.0f - 1.0f;
+}
+
+Mat4 randomTransform(uint32_t& state) {
+    Vec3 axis(randomSigned(state), randomSigned(state),
+              randomSigned(state) + 2);
+    return translate(Vec3(randomSigned(state), randomSigned(state),
+                          randomSigned(state)) * 10.0f) *
+        rotate(randomSigned(state) * PI, axis) *
+        scale(Vec3(1.0f + randomSigned(state) * 0.5f));
+}
+
+
+int main()
+{
+    std::printf("SIMD backend: %s (%zu lanes)\n\n", simdBackendName(),
+                SIMD_WIDTH);
+    uint32_t state = 1;
+
+    /*******************
+     * POINTS
+     *******************/
+
+    Mat4 transform = perspective(radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f) *
+        lookAt(Vec3(0, 5, 10), Vec3(0, 0, 0), Vec3(0, 1, 0));
+    NaiveMatrix naiveTransformMatrix = toNaive(transform);
+
+    std::vector<NaivePoint> points(POINT_COUNT), naiveOut(POINT_COUNT);
+    std::vector<float> xs(POINT_COUNT), ys(POINT_COUNT), zs(POINT_COUNT);
+    std::vector<float> outX(POINT_COUNT), outY(POINT_COUNT),
+        outZ(POINT_COUNT);
+    for (size_t i = 0; i < POINT_COUNT; ++i) {
+        points[i] = { randomSigned(state), randomSigned(state),
+                      randomSigned(state) };
+        xs[i] = points[i].x;
+        ys[i] = points[i].y;
+        zs[i] = points[i].z;
+    }
+
+    CpuTimer timer;
+    for (int r = 0; r < REPEATS; ++r)
+        naiveTransform(naiveTransformMatrix, points.data(), naiveOut.data(),
+                       POINT_COUNT);
+    double naivePointsMs = timer.elapsedMs() / REPEATS;
+
+    timer.reset();
+    for (int r = 0; r < REPEATS; ++r)
+        transformPoints(transform, xs.data(), ys.data(), zs.data(),
+                        outX.data(), outY.data(), outZ.data(), POINT_COUNT);
+    double simdPointsMs = timer.elapsedMs() / REPEATS;
+
+    float pointError = 0.0f;
+    for (size_t i = 0; i < POINT_COUNT; ++i)
+        pointError = std::fmax(pointError, std::fabs(outX[i] - naiveOut[i].x) +
+                               std::fabs(outY[i] - naiveOut[i].y) +
+                               std::fabs(outZ[i] - naiveOut[i].z));
+
+    /*******************
+     * MATRICES
+     *******************/
+
+    std::vector<NaiveMatrix> naiveA(MATRIX_COUNT), naiveB(MATRIX_COUNT),
+        naiveProduct(MATRIX_COUNT);
+    std::vector<Mat4> aosA(MATRIX_COUNT), aosB(MATRIX_COUNT),
+        aosProduct(MATRIX_COUNT);
+    Mat4Batch batchA(MATRIX_COUNT), batchB(MATRIX_COUNT), batchProduct;
+    for (size_t i = 0; i < MATRIX_COUNT; ++i) {
+        aosA[i] = randomTransform(state);
+        aosB[i] = randomTransform(state);
+        naiveA[i] = toNaive(aosA[i]);
+        naiveB[i] = toNaive(aosB[i]);
+        batchA.set(i, aosA[i]);
+        batchB.set(i, aosB[i]);
+    }
+
+    timer.reset();
+    for (int r = 0; r < REPEATS; ++r)
+        naiveMultiply(naiveA.data(), naiveB.data(), naiveProduct.data(),
+                      MATRIX_COUNT);
+    double naiveMatrixMs = timer.elapsedMs() / REPEATS;
+
+    timer.reset();
+    for (int r = 0; r < REPEATS; ++r)
+        multiplyMatrices(aosA.data(), aosB.data(), aosProduct.data(),
+                         MATRIX_COUNT);
+    double aosMatrixMs = timer.elapsedMs() / REPEATS;
+
+    timer.reset();
+    for (int r = 0; r < REPEATS; ++r)
+        multiplyMatrices(batchA, batchB, batchProduct);
+    double soaMatrixMs = timer.elapsedMs() / REPEATS;
+
+    float matrixError = 0.0f;
+    for (size_t i = 0; i < MATRIX_COUNT; ++i) {
+        Mat4 soa = batchProduct.get(i);
+        for (int r = 0; r < 4; ++r)
+            for (int c = 0; c < 4; ++c)
+                matrixError = std::fmax(matrixError, std::fmax(
+                    std::fabs(soa.at(r, c) - naiveProduct[i].m[r][c]),
+                    std::fabs(aosProduct[i].at(r, c) -
+                              naiveProduct[i].m[r][c])));
+    }
+
+    std::printf("Transform %zu points:\n", POINT_COUNT);
+    std::printf("  naive scalar AoS: %8.2f ms  %7.1f Mpoints/s\n",
+                naivePointsMs, POINT_COUNT / naivePointsMs / 1000.0);
+    std::printf("  SIMD SoA:         %8.2f ms  %7.1f Mpoints/s  (%.2fx)\n",
+                simdPointsMs, POINT_COUNT / simdPointsMs / 1000.0,
+                naivePointsMs / simdPointsMs);
+    std::printf("  max error:        %g\n\n", pointError);
+    std::printf("Multiply %zu matrix pairs:\n", MATRIX_COUNT);
+    std::printf("  naive scalar:     %8.2f ms  %7.1f Mmatrices/s\n",
+                naiveMatrixMs, MATRIX_COUNT / naiveMatrixMs / 1000.0);
+    std::printf("  SIMD Float4 AoS:  %8.2f ms  %7.1f Mmatrices/s  (%.2fx)\n",
+                aosMatrixMs, MATRIX_COUNT / aosMatrixMs / 1000.0,
+                naiveMatrixMs / aosMatrixMs);
+    std::printf("  SIMD SoA batch:   %8.2f ms  %7.1f Mmatrices/s  (%.2fx)\n",
+                soaMatrixMs, MATRIX_COUNT / soaMatrixMs / 1000.0,
+                naiveMatrixMs / soaMatrixMs);
+    std::printf("  max error:        %g\n", matrixError);
+    return 0;
+}
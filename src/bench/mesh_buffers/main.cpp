@@ -0,0 +1,302 @@
+/****************
+ * Title:   bench/mesh_buffers/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/buffer.hpp"
+#include "engine/buffer_allocator.hpp"
+#include "engine/indirect_draw.hpp"
+#include "engine/vertex_array.hpp"
+#include "engine/vertex_layout.hpp"
+
+// Uploads 4096 small meshes of varied size, first as a vertex buffer,
+// index buffer and vertex array each, then suballocated from MeshBuffers
+// arenas, and draws them with a bind per mesh and with one multi-draw per
+// arena. Then frees and replaces half the meshes with differently sized
+// ones to fragment the arenas, and compacts them with defragment().
+// Reports GL objects, allocation latency, draw times and fragmentation.
+
+const int MESH_COUNT = 4096;
+const int MIN_SEGMENTS = 8;
+const int MAX_SEGMENTS = 512;
+const int FRAMES = 60;
+const GLsizei TARGET_WIDTH = 1280;
+const GLsizei TARGET_HEIGHT = 720;
+
+const char* vertexShaderSource =
+    "#version 450 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec4 aColor;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    color = aColor;\n"
+    "    gl_Position = vec4(aPos, 0.0, 1.0);\n"
+    "}\0";
+const char* fragmentShaderSource =
+    "#version 450 core\n"
+    "in vec4 color;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "    FragColor = color;\n"
+    "}\0";
+
+using DiscVertex = VertexLayout<Pos2f, Color4u8>;
+
+struct Vertex {
+    float position[2];
+    uint8_t color[4];
+};
+static_assert(sizeof(Vertex) == DiscVertex::stride, "");
+
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+
+// Triangle fan disc somewhere on screen, indices relative to its centre
+MeshData generateDisc(uint32_t& seed) {
+    MeshData mesh;
+    int segments = MIN_SEGMENTS + int(randomFloat(seed) *
+                                      (MAX_SEGMENTS - MIN_SEGMENTS));
+    float x = randomFloat(seed) * 2.0f - 1.0f;
+    float y = randomFloat(seed) * 2.0f - 1.0f;
+    float radius = 0.01f + randomFloat(seed) * 0.03f;
+    Vertex centre = { { x, y }, { uint8_t(randomFloat(seed) * 255.0f),
+                                  uint8_t(randomFloat(seed) * 255.0f),
+                                  uint8_t(randomFloat(seed) * 255.0f),
+                                  255 } };
+    mesh.vertices.push_back(centre);
+    for (int i = 0; i < segments; ++i) {
+        float angle = float(i) / float(segments) * 6.2831853f;
+        Vertex rim = centre;
+        rim.position[0] = x + std::cos(angle) * radius;
+        rim.position[1] = y + std::sin(angle) * radius;
+        mesh.vertices.push_back(rim);
+        mesh.indices.push_back(0);
+        mesh.indices.push_back(uint32_t(i + 1));
+        mesh.indices.push_back(uint32_t((i + 1) % segments + 1));
+    }
+    return mesh;
+}
+
+void printRow(const char* name, size_t objects, double allocateUs,
+              double worstUs, double cpuMs, double gpuMs) {
+    std::printf("%-16s %9zu %10.2fus %10.2fus %9.3fms %9.3fms\n", name,
+                objects, allocateUs, worstUs, cpuMs, gpuMs);
+}
+
+void printFragmentation(const char* when, const MeshBufferStats& stats) {
+    std::printf("  %-20s %zu arenas, %.1f/%.1fMB vertices, %.1f/%.1fMB "
+                "indices, fragmentation %.2f\n", when, stats.arenas,
+                double(stats.vertexBytesUsed) / (1024.0 * 1024.0),
+                double(stats.vertexBytes) / (1024.0 * 1024.0),
+                double(stats.indexBytesUsed) / (1024.0 * 1024.0),
+                double(stats.indexBytes) / (1024.0 * 1024.0),
+                stats.fragmentation);
+}
+
+
+int main()
+{
+    GLFWwindow* window = createBenchContext("bench_mesh_buffers");
+    if (window == NULL)
+        return -1;
+    unsigned int program = buildProgram(vertexShaderSource,
+                                        fragmentShaderSource);
+    if (!program) {
+        glfwTerminate();
+        return -1;
+    }
+
+    uint32_t seed = 11u;
+    std::vector<MeshData> meshes;
+    for (int i = 0; i < MESH_COUNT; ++i)
+        meshes.push_back(generateDisc(seed));
+
+    BenchTarget target;
+    if (!createBenchTarget(TARGET_WIDTH, TARGET_HEIGHT, false, target)) {
+        glfwTerminate();
+        return -1;
+    }
+
+    std::printf("%d meshes of %d-%d triangles\n\n", MESH_COUNT, MIN_SEGMENTS,
+                MAX_SEGMENTS);
+    std::printf("%-16s %9s %12s %12s %11s %11s\n", "Path", "GL objects",
+                "Allocate", "Worst", "CPU", "GPU");
+
+    // Buffers and a vertex array per mesh, a bind and a draw each
+    {
+        std::vector<Buffer> vertexBuffers, indexBuffers;
+        std::vector<VertexArray> vertexArrays;
+        double totalUs = 0.0, worstUs = 0.0;
+        for (const MeshData& mesh : meshes) {
+            CpuTimer timer;
+            vertexBuffers.push_back(Buffer(GLsizeiptr(mesh.vertices.size() *
+                                                      sizeof(Vertex)),
+                                           mesh.vertices.data(), 0));
+            indexBuffers.push_back(Buffer(GLsizeiptr(mesh.indices.size() *
+                                                     sizeof(uint32_t)),
+                                          mesh.indices.data(), 0));
+            vertexArrays.push_back(VertexArray());
+            vertexArrays.back().setVertexBuffer(0, vertexBuffers.back(), 0,
+                                                DiscVertex::stride);
+            vertexArrays.back().setElementBuffer(indexBuffers.back());
+            DiscVertex::apply(vertexArrays.back());
+            double us = timer.elapsedMs() * 1000.0;
+            totalUs += us;
+            worstUs = std::max(worstUs, us);
+        }
+
+        GpuTimer gpuTimer;
+        double cpuMs = 0.0, gpuMs = 0.0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            glClear(GL_COLOR_BUFFER_BIT);
+            CpuTimer cpuTimer;
+            gpuTimer.begin();
+            glUseProgram(program);
+            for (int i = 0; i < MESH_COUNT; ++i) {
+                vertexArrays[size_t(i)].bind();
+                glDrawElements(GL_TRIANGLES,
+                               GLsizei(meshes[size_t(i)].indices.size()),
+                               GL_UNSIGNED_INT, 0);
+            }
+            gpuTimer.end();
+            cpuMs += cpuTimer.elapsedMs();
+            gpuMs += gpuTimer.resultMs();
+        }
+        printRow("Per mesh", size_t(MESH_COUNT) * 3, totalUs / MESH_COUNT,
+                 worstUs, cpuMs / FRAMES, gpuMs / FRAMES);
+        gpuTimer.destroy();
+        for (int i = 0; i < MESH_COUNT; ++i) {
+            vertexArrays[size_t(i)].destroy();
+            vertexBuffers[size_t(i)].destroy();
+            indexBuffers[size_t(i)].destroy();
+        }
+    }
+
+    // Suballocated, one bind and one multi-draw per arena. Small arenas so
+    // the set needs a few of them.
+    MeshBuffers buffers;
+    buffers.create<DiscVertex>(1u << 18, 1u << 20);
+    std::vector<MeshHandle> handles;
+    double totalUs = 0.0, worstUs = 0.0;
+    for (const MeshData& mesh : meshes) {
+        CpuTimer timer;
+        handles.push_back(buffers.allocate(
+            uint32_t(mesh.vertices.size()), uint32_t(mesh.indices.size()),
+            mesh.vertices.data(), mesh.indices.data()));
+        double us = timer.elapsedMs() * 1000.0;
+        totalUs += us;
+        worstUs = std::max(worstUs, us);
+    }
+
+    std::vector<std::vector<DrawElementsIndirectCommand>> commands;
+    Buffer indirect;
+    // One command list per arena, packed into one indirect buffer
+    auto buildCommands = [&]() {
+        commands.assign(buffers.arenaCount(), {});
+        for (MeshHandle handle : handles)
+            commands[buffers.range(handle).arena].push_back(
+                buffers.drawCommand(handle));
+        std::vector<DrawElementsIndirectCommand> packed;
+        for (const std::vector<DrawElementsIndirectCommand>& list : commands)
+            packed.insert(packed.end(), list.begin(), list.end());
+        indirect.destroy();
+        indirect = Buffer(GLsizeiptr(packed.size() *
+                                     sizeof(DrawElementsIndirectCommand)),
+                          packed.data(), 0);
+    };
+    auto drawAll = [&](double& cpuMs, double& gpuMs) {
+        GpuTimer gpuTimer;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            glClear(GL_COLOR_BUFFER_BIT);
+            CpuTimer cpuTimer;
+            gpuTimer.begin();
+            glUseProgram(program);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect.ID);
+            size_t first = 0;
+            for (size_t a = 0; a < commands.size(); ++a) {
+                buffers.bind(uint32_t(a));
+                glMultiDrawElementsIndirect(
+                    GL_TRIANGLES, GL_UNSIGNED_INT,
+                    reinterpret_cast<const void*>(
+                        first * sizeof(DrawElementsIndirectCommand)),
+                    GLsizei(commands[a].size()), 0);
+                first += commands[a].size();
+            }
+            gpuTimer.end();
+            cpuMs += cpuTimer.elapsedMs();
+            gpuMs += gpuTimer.resultMs();
+        }
+        gpuTimer.destroy();
+    };
+
+    buildCommands();
+    double cpuMs = 0.0, gpuMs = 0.0;
+    drawAll(cpuMs, gpuMs);
+    printRow("Suballocated", buffers.arenaCount() * 3, totalUs / MESH_COUNT,
+             worstUs, cpuMs / FRAMES, gpuMs / FRAMES);
+
+    // Replace every other mesh with a new one of a different size
+    std::printf("\nChurn and compaction\n");
+    printFragmentation("Loaded", buffers.stats());
+    for (int i = 0; i < MESH_COUNT; i += 2)
+        buffers.free(handles[size_t(i)]);
+    printFragmentation("Half freed", buffers.stats());
+    totalUs = worstUs = 0.0;
+    for (int i = 0; i < MESH_COUNT; i += 2) {
+        MeshData mesh = generateDisc(seed);
+        CpuTimer timer;
+        handles[size_t(i)] = buffers.allocate(
+            uint32_t(mesh.vertices.size()), uint32_t(mesh.indices.size()),
+            mesh.vertices.data(), mesh.indices.data());
+        double us = timer.elapsedMs() * 1000.0;
+        totalUs += us;
+        worstUs = std::max(worstUs, us);
+    }
+    std::printf("  Reallocated %d meshes, %.2fus average, %.2fus worst\n",
+                MESH_COUNT / 2, totalUs / (MESH_COUNT / 2), worstUs);
+    printFragmentation("Refilled", buffers.stats());
+
+    // Half the meshes gone for good leaves holes to compact
+    for (int i = 1; i < MESH_COUNT; i += 4)
+        buffers.free(handles[size_t(i)]);
+    std::vector<MeshHandle> kept;
+    for (int i = 0; i < MESH_COUNT; ++i)
+        if (i % 4 != 1)
+            kept.push_back(handles[size_t(i)]);
+    handles = kept;
+    printFragmentation("Quarter freed", buffers.stats());
+    CpuTimer defragmentTimer;
+    uint64_t moved = buffers.defragment();
+    glFinish();
+    double defragmentMs = defragmentTimer.elapsedMs();
+    printFragmentation("Defragmented", buffers.stats());
+    std::printf("  Moved %.1fMB in %.2fms\n",
+                double(moved) / (1024.0 * 1024.0), defragmentMs);
+
+    buildCommands();
+    cpuMs = gpuMs = 0.0;
+    drawAll(cpuMs, gpuMs);
+    std::printf("  Draw after compaction %.3fms CPU, %.3fms GPU\n",
+                cpuMs / FRAMES, gpuMs / FRAMES);
+
+    indirect.destroy();
+    buffers.destroy();
+    target.destroy();
+    glDeleteProgram(program);
+    glfwTerminate();
+    return 0;
+}
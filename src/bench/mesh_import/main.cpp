@@ -0,0 +1,120 @@
+/****************
+ * Title:   bench/mesh_import/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/bench.hpp"
+#include "engine/mesh_file.hpp"
+#include "engine/mesh_importer.hpp"
+
+// Usage: bench_mesh_import [file.obj|.gltf|.glb] [--size-mb N]
+//
+// Without a file a grid OBJ of about N MiB (default 2048) is generated.
+// The import is repeated with 1, 2, 4, ... hardware threads and the
+// throughput in MB/s of input text is reported for each.
+
+const size_t DEFAULT_SIZE_MB = 2048;
+// Rough OBJ bytes written per grid vertex (v, vt, vn and one quad)
+const size_t BYTES_PER_GRID_VERTEX = 150;
+
+
+// Writes an N x N vertex grid with texcoords, normals and quad faces
+bool generateObj(const std::string& path, size_t sizeMb) {
+    size_t side = 2;
+    while ((side + 1) * (side + 1) * BYTES_PER_GRID_VERTEX <
+           sizeMb * 1024 * 1024)
+        ++side;
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "Failed to create " << path << std::endl;
+        return false;
+    }
+    std::vector<char> buffer(size_t(1) << 20);
+    std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+    for (size_t y = 0; y < side; ++y) {
+        for (size_t x = 0; x < side; ++x) {
+            float u = float(x) / float(side - 1);
+            float v = float(y) / float(side - 1);
+            std::fprintf(file, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn 0 0 1\n",
+                         u * 100.0f - 50.0f, v * 100.0f - 50.0f,
+                         float((x * 7 + y * 13) % 17) * 0.01f, u, v);
+        }
+    }
+    for (size_t y = 0; y + 1 < side; ++y) {
+        for (size_t x = 0; x + 1 < side; ++x) {
+            size_t a = y * side + x + 1;
+            size_t b = a + 1;
+            size_t c = a + side + 1;
+            size_t d = a + side;
+            std::fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu "
+                         "%zu/%zu/%zu\n", a, a, a, b, b, b, c, c, c, d, d, d);
+        }
+    }
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+}
+
+
+int main(int argc, char** argv)
+{
+    std::string path;
+    size_t sizeMb = DEFAULT_SIZE_MB;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--size-mb") == 0 && i + 1 < argc)
+            sizeMb = size_t(std::strtoul(argv[++i], NULL, 10));
+        else
+            path = argv[i];
+    }
+    if (path.empty()) {
+        path = "mesh_import.obj";
+        std::cout << "Generating " << path << " (~" << sizeMb << " MiB)..." <<
+            std::endl;
+        if (!generateObj(path, sizeMb))
+            return -1;
+    }
+
+    size_t fileBytes = 0;
+    {
+        MappedFile file;
+        if (!file.open(path.c_str()))
+            return -1;
+        fileBytes = file.size;
+    }
+
+    unsigned int hardware = resolveThreadCount(0);
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < hardware; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(hardware);
+
+    double mb = 1000.0 * 1000.0;
+    std::cout << "File:    " << path << ", " << fileBytes / mb << " MB\n";
+    std::cout << "Threads   Time (ms)   MB/s   Speedup" << std::endl;
+    double serialMs = 0.0;
+    for (unsigned int threads : threadCounts) {
+        ImportOptions options;
+        options.threads = threads;
+        ImportedMesh mesh;
+        CpuTimer timer;
+        if (!importMesh(path.c_str(), mesh, options))
+            return -1;
+        double ms = timer.elapsedMs();
+        if (threads == 1)
+            serialMs = ms;
+        std::printf("%7u %11.1f %6.0f %8.2fx    (%zu vertices, %zu "
+                    "triangles)\n", threads, ms, fileBytes / mb / (ms / 1000.0),
+                    serialMs / ms, mesh.vertices.size(),
+                    mesh.indices.size() / 3);
+    }
+    return 0;
+}
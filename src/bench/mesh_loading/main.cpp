@@ -0,0 +1,137 @@
+/****************
+ * Title:   bench/mesh_loading/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/mesh_file.hpp"
+#include "engine/mesh_format.hpp"
+#include "engine/vertex_compression.hpp"
+
+// Usage: bench_mesh_loading [file.mesh ...]
+//
+// Without arguments a synthetic mesh set is generated first. For cold
+// cache numbers drop the OS page cache between generating and loading
+// (e.g. `echo 3 > /proc/sys/vm/drop_caches` on Linux) and pass the files.
+
+const int GENERATED_FILES = 8;
+// Vertices per generated file, 8 files x 8M x 16 bytes = 1 GiB of vertices
+// (plus 96 MiB of indices per file)
+const uint32_t GENERATED_VERTICES = 8u * 1024 * 1024;
+
+
+// Writes a mesh of random compressed vertices, indices form a triangle strip
+bool generateMesh(const std::string& path, uint32_t seed) {
+    std::vector<CompressedVertex> vertices(GENERATED_VERTICES);
+    uint32_t state = seed * 2654435761u + 1;
+    for (CompressedVertex& vertex : vertices) {
+        for (uint16_t& component : vertex.position) {
+            state = state * 1664525u + 1013904223u;
+            component = uint16_t(state >> 16);
+        }
+        vertex.color = state;
+        vertex.normal[0] = vertex.normal[1] = 0;
+    }
+    std::vector<uint32_t> indices((GENERATED_VERTICES - 2) * 3);
+    for (uint32_t t = 0; t + 2 < GENERATED_VERTICES; ++t) {
+        indices[t * 3] = t;
+        indices[t * 3 + 1] = t + 1;
+        indices[t * 3 + 2] = t + 2;
+    }
+
+    MeshWriteInfo info;
+    info.attributes = MeshAttributesOf<CompressedVertexLayout>::get();
+    info.flags = MESH_FLAG_QUANTIZED;
+    info.vertexStride = CompressedVertexLayout::stride;
+    info.vertexCount = vertices.size();
+    info.vertices = vertices.data();
+    info.indexType = GL_UNSIGNED_INT;
+    info.indexCount = indices.size();
+    info.indices = indices.data();
+    for (int axis = 0; axis < 3; ++axis)
+        info.quantizeExtent[axis] = info.boundsMax[axis] = 1.0f;
+    return writeMeshFile(path.c_str(), info);
+}
+
+
+int main(int argc, char** argv)
+{
+    GLFWwindow* window = createBenchContext("bench_mesh_loading");
+    if (window == NULL)
+        return -1;
+
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+        paths.push_back(argv[i]);
+    if (paths.empty()) {
+        std::cout << "Generating " << GENERATED_FILES << " meshes..." <<
+            std::endl;
+        for (int i = 0; i < GENERATED_FILES; ++i) {
+            paths.push_back("mesh_loading_" + std::to_string(i) + ".mesh");
+            if (!generateMesh(paths.back(), uint32_t(i))) {
+                glfwTerminate();
+                return -1;
+            }
+        }
+    }
+
+    /*******************
+     * BASELINE: READ()
+     *******************/
+
+    // Plain buffered read of the same bytes approximates the disk/page cache
+    // bandwidth the loader should be bounded by
+    uint64_t totalBytes = 0;
+    std::vector<char> scratch(64 * 1024 * 1024);
+    CpuTimer timer;
+    for (const std::string& path : paths) {
+        std::ifstream file(path, std::ios::binary);
+        while (file.read(scratch.data(), std::streamsize(scratch.size())) ||
+               file.gcount() > 0)
+            totalBytes += uint64_t(file.gcount());
+    }
+    double readMs = timer.elapsedMs();
+
+    /*******************
+     * MMAP + UPLOAD
+     *******************/
+
+    std::vector<GpuMesh> meshes;
+    uint64_t uploadedBytes = 0;
+    timer.reset();
+    for (const std::string& path : paths) {
+        MeshFile mesh;
+        if (!mesh.open(path.c_str()))
+            continue;
+        meshes.push_back(uploadMesh(mesh));
+        uploadedBytes += mesh.vertexBytes() + mesh.indexBytes();
+    }
+    // Uploads are only complete once the driver has consumed the pages
+    glFinish();
+    double loadMs = timer.elapsedMs();
+
+    double mib = 1024.0 * 1024.0;
+    std::cout << "Files:              " << paths.size() << "\n";
+    std::cout << "File bytes:         " << totalBytes / mib << " MiB\n";
+    std::cout << "read() baseline:    " << readMs << " ms, " <<
+        totalBytes / mib / (readMs / 1000.0) << " MiB/s\n";
+    std::cout << "mmap + upload:      " << loadMs << " ms, " <<
+        uploadedBytes / mib / (loadMs / 1000.0) << " MiB/s\n";
+    std::cout << "Upload vs read():   " << readMs / loadMs << "x" <<
+        std::endl;
+
+    for (GpuMesh& mesh : meshes)
+        mesh.destroy();
+    glfwTerminate();
+    return 0;
+}
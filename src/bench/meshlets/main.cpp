@@ -0,0 +1,226 @@
+/****************
+ * Title:   bench/meshlets/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/buffer.hpp"
+#include "engine/culling.hpp"
+#include "engine/gpu_culling.hpp"
+#include "engine/index_optimizer.hpp"
+#include "engine/indirect_draw.hpp"
+#include "engine/math.hpp"
+#include "engine/meshlet.hpp"
+#include "engine/vertex_array.hpp"
+
+// Draws a grid of dense spheres through the GPU cull pass three ways: one
+// object per sphere, one object per meshlet with frustum culling, and one
+// per meshlet with frustum and normal cone culling. Reports the triangles
+// the GPU actually received (GL_PRIMITIVES_GENERATED) and pass times.
+
+const int INSTANCES_PER_SIDE = 10;
+const float SPACING = 4.0f;
+const int FRAMES = 30;
+const GLsizei TARGET_WIDTH = 1280;
+const GLsizei TARGET_HEIGHT = 720;
+// Instance placements, read by the draw shader only
+const GLuint PLACEMENTS_BINDING = 5;
+
+const char* vertexShaderSource =
+    "#version 450 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in uint aObject;\n"
+    "layout (std430, binding = 5) readonly buffer PlacementBuffer {\n"
+    "    vec4 placements[];\n"
+    "};\n"
+    "uniform mat4 uViewProjection;\n"
+    "uniform uint uObjectsPerInstance;\n"
+    "void main() {\n"
+    "    vec4 placement = placements[aObject / uObjectsPerInstance];\n"
+    "    gl_Position = uViewProjection *\n"
+    "        vec4(placement.xyz + aPos * placement.w, 1.0);\n"
+    "}\0";
+const char* fragmentShaderSource =
+    "#version 450 core\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "    FragColor = vec4(1.0, 0.5, 0.2, 1.0);\n"
+    "}\0";
+
+
+
+int main(void)
+{
+    GLFWwindow* window = createBenchContext("bench_meshlets");
+    if (window == NULL)
+        return -1;
+    unsigned int program = buildProgram(vertexShaderSource,
+                                        fragmentShaderSource);
+    if (!program) {
+        glfwTerminate();
+        return -1;
+    }
+    GLint viewProjectionLocation = glGetUniformLocation(program,
+                                                        "uViewProjection");
+    GLint objectsPerInstanceLocation =
+        glGetUniformLocation(program, "uObjectsPerInstance");
+
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    buildBenchSphere(positions, indices);
+    size_t vertexCount = positions.size() / 3;
+    optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    CpuTimer timer;
+    MeshletData meshlets = buildMeshlets(indices.data(), indices.size(),
+                                         positions.data(), vertexCount,
+                                         3 * sizeof(float));
+    double buildMs = timer.elapsedMs();
+    size_t meshletCount = meshlets.meshlets.size();
+    std::printf("%zu triangles in %zu meshlets (%.1f triangles each), "
+                "built in %.0fms\n", indices.size() / 3, meshletCount,
+                double(indices.size() / 3) / double(meshletCount), buildMs);
+
+    BenchTarget target;
+    if (!createBenchTarget(TARGET_WIDTH, TARGET_HEIGHT, true, target)) {
+        glfwTerminate();
+        return -1;
+    }
+    glEnable(GL_DEPTH_TEST);
+
+    // The meshlet index order draws the whole mesh too, so both paths
+    // share one vertex/element buffer pair
+    Buffer vertices(GLsizeiptr(positions.size() * sizeof(float)),
+                    positions.data(), 0);
+    Buffer elements(GLsizeiptr(meshlets.indices.size() * sizeof(uint32_t)),
+                    meshlets.indices.data(), 0);
+    VertexArray vertexArray;
+    vertexArray.setVertexBuffer(0, vertices, 0, 3 * sizeof(float));
+    vertexArray.setElementBuffer(elements);
+    vertexArray.setAttribute(0, 0, 3, GL_FLOAT, GL_FALSE, 0);
+
+    // Instances, then their bounds and commands per sphere and per meshlet
+    size_t instances = size_t(INSTANCES_PER_SIDE * INSTANCES_PER_SIDE);
+    std::vector<Vec4> placements;
+    BoundsSoA instanceBounds, meshletBounds;
+    std::vector<MeshletBounds> meshletCones;
+    std::vector<DrawElementsIndirectCommand> instanceDraws, meshletDraws;
+    for (int z = 0; z < INSTANCES_PER_SIDE; ++z) {
+        for (int x = 0; x < INSTANCES_PER_SIDE; ++x) {
+            Vec3 center(float(x) * SPACING, 0.0f, -float(z) * SPACING);
+            float scale = 1.0f + 0.1f * float((x + z) % 3);
+            placements.push_back(Vec4(center, scale));
+            instanceBounds.add(center, Vec3(1.05f * scale));
+            instanceDraws.push_back({ uint32_t(meshlets.indices.size()), 1,
+                                      0, 0, 0 });
+            for (size_t m = 0; m < meshletCount; ++m) {
+                MeshletBounds world = meshlets.bounds[m];
+                world.center = center + world.center * scale;
+                world.radius *= scale;
+                meshletBounds.add(world.center, Vec3(world.radius));
+                meshletCones.push_back(world);
+                const Meshlet& meshlet = meshlets.meshlets[m];
+                meshletDraws.push_back({ meshlet.indexCount, 1,
+                                         meshlet.firstIndex, 0, 0 });
+            }
+        }
+    }
+    Buffer placementBuffer(GLsizeiptr(placements.size() * sizeof(Vec4)),
+                           placements.data(), 0);
+
+    GpuCuller instanceCuller, meshletCuller;
+    if (!instanceCuller.create(GLsizei(instances)) ||
+        !meshletCuller.create(GLsizei(instances * meshletCount))) {
+        glfwTerminate();
+        return -1;
+    }
+    instanceCuller.setObjects(instanceBounds, instanceDraws.data());
+    meshletCuller.setObjects(meshletBounds, meshletDraws.data());
+    meshletCuller.setCones(meshletCones.data());
+
+    Mat4 projection = perspective(radians(60.0f), float(TARGET_WIDTH) /
+                                  float(TARGET_HEIGHT), 0.1f, 200.0f);
+    unsigned int primitivesQuery;
+    glCreateQueries(GL_PRIMITIVES_GENERATED, 1, &primitivesQuery);
+
+    std::printf("\n%-22s %9s %12s %10s %10s\n", "Mode", "Draws",
+                "Triangles", "Cull", "Draw");
+    const char* modeNames[] = { "Per sphere", "Meshlets, frustum",
+                                "Meshlets, frustum+cone" };
+    for (int mode = 0; mode < 3; ++mode) {
+        GpuCuller& culler = mode == 0 ? instanceCuller : meshletCuller;
+        culler.attachObjectIds(vertexArray, 1, 1);
+        glProgramUniform1ui(program, objectsPerInstanceLocation,
+                            mode == 0 ? 1u : GLuint(meshletCount));
+        GpuTimer cullTimer, drawTimer;
+        double cullMs = 0.0, drawMs = 0.0;
+        GLuint64 triangles = 0;
+        GpuCullStats stats;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            // Orbit just above the grid looking across it
+            float angle = float(frame) / float(FRAMES) * 0.5f * PI;
+            Vec3 middle(SPACING * INSTANCES_PER_SIDE * 0.5f, 0.0f,
+                        -SPACING * INSTANCES_PER_SIDE * 0.5f);
+            Vec3 eye = middle + Vec3(std::cos(angle), 0.3f,
+                                     std::sin(angle)) * 25.0f;
+            Mat4 viewProjection = projection *
+                lookAt(eye, middle, Vec3(0.0f, 1.0f, 0.0f));
+            Frustum frustum = extractFrustum(viewProjection);
+            glProgramUniformMatrix4fv(program, viewProjectionLocation, 1,
+                                      GL_FALSE, viewProjection.data());
+
+            cullTimer.begin();
+            culler.cull(frustum, NULL, mode == 2 ? &eye : NULL);
+            cullTimer.end();
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glUseProgram(program);
+            vertexArray.bind();
+            culler.bindStorage();
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PLACEMENTS_BINDING,
+                             placementBuffer.ID);
+            glBeginQuery(GL_PRIMITIVES_GENERATED, primitivesQuery);
+            drawTimer.begin();
+            culler.draw(GL_UNSIGNED_INT);
+            drawTimer.end();
+            glEndQuery(GL_PRIMITIVES_GENERATED);
+
+            cullMs += cullTimer.resultMs();
+            drawMs += drawTimer.resultMs();
+            GLuint64 generated = 0;
+            glGetQueryObjectui64v(primitivesQuery, GL_QUERY_RESULT,
+                                  &generated);
+            triangles += generated;
+            stats = culler.readStats();
+        }
+        std::printf("%-22s %9u %12llu %8.3fms %8.3fms\n", modeNames[mode],
+                    stats.visible,
+                    static_cast<unsigned long long>(triangles / FRAMES),
+                    cullMs / FRAMES, drawMs / FRAMES);
+        if (mode == 2)
+            std::printf("  last frame: %u frustum culled, %u cone culled\n",
+                        stats.frustumCulled, stats.coneCulled);
+        cullTimer.destroy();
+        drawTimer.destroy();
+    }
+
+    glDeleteQueries(1, &primitivesQuery);
+    instanceCuller.destroy();
+    meshletCuller.destroy();
+    placementBuffer.destroy();
+    vertexArray.destroy();
+    vertices.destroy();
+    elements.destroy();
+    target.destroy();
+    glDeleteProgram(program);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,217 @@
+/****************
+ * Title:   bench/render_thread/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/buffer.hpp"
+#include "engine/render_thread.hpp"
+
+// Runs a loop with 4ms of simulation and a GPU heavy frame (instanced
+// quads with an expensive fragment shader, swapped and finished) for a few
+// seconds each: all on one thread as the samples do, then with a
+// RenderThread taking frame packets from the main thread, blocking on the
+// handoff and with the latest packet winning. Reports simulation ticks and
+// presented frames per second and input-to-present latency.
+
+const double RUN_MS = 3000.0;
+const double SIMULATION_MS = 4.0;
+const int OBJECT_COUNT = 1024;
+const int SHADER_ITERATIONS = 64;
+const GLsizei TARGET_WIDTH = 1280;
+const GLsizei TARGET_HEIGHT = 720;
+const GLuint PLACEMENT_BINDING = 5;
+
+const char* vertexShaderSource =
+    "#version 450 core\n"
+    "layout (std430, binding = 5) readonly buffer Placements {\n"
+    "    vec2 offsets[];\n"
+    "};\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+    "    uv = corner;\n"
+    "    vec2 position = offsets[gl_InstanceID] + (corner - 0.5) * 0.4;\n"
+    "    gl_Position = vec4(position, 0.0, 1.0);\n"
+    "}\0";
+const char* fragmentShaderSource =
+    "#version 450 core\n"
+    "uniform int iterations;\n"
+    "in vec2 uv;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "    float value = 0.0;\n"
+    "    for (int i = 0; i < iterations; ++i)\n"
+    "        value += sin(uv.x * float(i) + cos(uv.y * float(i)));\n"
+    "    FragColor = vec4(fract(value), uv, 0.05);\n"
+    "}\0";
+
+struct FramePacket {
+    uint64_t tick;
+    float offsets[OBJECT_COUNT * 2];
+};
+
+struct Renderer {
+    unsigned int program;
+    Buffer placements;
+    unsigned int vertexArray;
+    BenchTarget target;
+    // Window framebuffer size, GLFW only reports it on the main thread
+    int windowWidth;
+    int windowHeight;
+};
+
+struct LoopResult {
+    double ticksPerSecond;
+    double framesPerSecond;
+    double averageLatencyMs;
+    double worstLatencyMs;
+    uint64_t dropped;
+};
+
+
+// Moves the objects and burns the rest of the simulation budget
+void simulate(FramePacket& packet, uint64_t tick) {
+    CpuTimer timer;
+    packet.tick = tick;
+    float time = float(tick) * 0.016f;
+    for (int i = 0; i < OBJECT_COUNT; ++i) {
+        float angle = time + float(i) * 0.37f;
+        float radius = 0.2f + 0.7f * float(i) / float(OBJECT_COUNT);
+        packet.offsets[i * 2] = std::cos(angle) * radius;
+        packet.offsets[i * 2 + 1] = std::sin(angle) * radius;
+    }
+    volatile float sink = 0.0f;
+    while (timer.elapsedMs() < SIMULATION_MS)
+        sink = sink + std::sqrt(float(tick));
+}
+
+void render(const Renderer& renderer, const FramePacket& packet) {
+    renderer.placements.update(0, sizeof(packet.offsets), packet.offsets);
+    renderer.target.bind();
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(renderer.program);
+    glBindVertexArray(renderer.vertexArray);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PLACEMENT_BINDING,
+                     renderer.placements.ID);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, OBJECT_COUNT);
+    glBlitNamedFramebuffer(renderer.target.framebuffer, 0, 0, 0, TARGET_WIDTH,
+                           TARGET_HEIGHT, 0, 0, renderer.windowWidth,
+                           renderer.windowHeight, GL_COLOR_BUFFER_BIT,
+                           GL_LINEAR);
+}
+
+// The samples' loop: input, simulate, render, swap on one thread
+LoopResult runSingleThreaded(GLFWwindow* window, const Renderer& renderer) {
+    static FramePacket packet;
+    uint64_t ticks = 0;
+    double totalLatencyMs = 0.0, worstLatencyMs = 0.0;
+    CpuTimer run;
+    while (run.elapsedMs() < RUN_MS) {
+        CpuTimer latency;
+        glfwPollEvents();
+        simulate(packet, ticks++);
+        render(renderer, packet);
+        glfwSwapBuffers(window);
+        glFinish();
+        double ms = latency.elapsedMs();
+        totalLatencyMs += ms;
+        worstLatencyMs = std::max(worstLatencyMs, ms);
+    }
+    double seconds = run.elapsedMs() / 1000.0;
+    return { double(ticks) / seconds, double(ticks) / seconds,
+             totalLatencyMs / double(ticks), worstLatencyMs, 0 };
+}
+
+// Main thread polls and simulates, the render thread draws and swaps
+LoopResult runRenderThread(GLFWwindow* window, const Renderer& renderer,
+                           HandoffMode mode) {
+    RenderThread<FramePacket> renderThread;
+    RenderThread<FramePacket>::Callbacks callbacks;
+    callbacks.render = [&](const FramePacket& packet) {
+        render(renderer, packet);
+    };
+    renderThread.create(window, callbacks, mode);
+    uint64_t ticks = 0;
+    CpuTimer run;
+    while (run.elapsedMs() < RUN_MS) {
+        FramePacket& packet = renderThread.beginFrame();
+        glfwPollEvents();
+        simulate(packet, ticks++);
+        renderThread.submit();
+    }
+    double seconds = run.elapsedMs() / 1000.0;
+    renderThread.destroy();
+    RenderThreadStats stats = renderThread.stats();
+    return { double(ticks) / seconds,
+             double(stats.framesPresented) / seconds,
+             stats.averageLatencyMs, stats.worstLatencyMs,
+             stats.packetsDropped };
+}
+
+void printRow(const char* name, const LoopResult& result) {
+    std::printf("%-22s %10.1f %10.1f %10.2fms %10.2fms %9llu\n", name,
+                result.ticksPerSecond, result.framesPerSecond,
+                result.averageLatencyMs, result.worstLatencyMs,
+                (unsigned long long)result.dropped);
+}
+
+
+int main()
+{
+    GLFWwindow* window = createBenchContext("bench_render_thread");
+    if (window == NULL)
+        return -1;
+    glfwSwapInterval(1);
+
+    // GL objects are shared by every loop, made while the main thread
+    // still has the context
+    Renderer renderer;
+    renderer.program = buildProgram(vertexShaderSource, fragmentShaderSource);
+    if (!renderer.program) {
+        glfwTerminate();
+        return -1;
+    }
+    glProgramUniform1i(renderer.program,
+                       glGetUniformLocation(renderer.program, "iterations"),
+                       SHADER_ITERATIONS);
+    renderer.placements = Buffer(GLsizeiptr(sizeof(float) * 2 *
+                                            OBJECT_COUNT), NULL);
+    glCreateVertexArrays(1, &renderer.vertexArray);
+    if (!createBenchTarget(TARGET_WIDTH, TARGET_HEIGHT, false,
+                           renderer.target)) {
+        glfwTerminate();
+        return -1;
+    }
+    glfwGetFramebufferSize(window, &renderer.windowWidth,
+                           &renderer.windowHeight);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    std::printf("%.0fms simulation per tick, %d quads with %d shader "
+                "iterations, %.0fs per loop\n\n", SIMULATION_MS,
+                OBJECT_COUNT, SHADER_ITERATIONS, RUN_MS / 1000.0);
+    std::printf("%-22s %10s %10s %12s %12s %9s\n", "Loop", "Ticks/s",
+                "Frames/s", "Latency", "Worst", "Dropped");
+    printRow("Single thread", runSingleThreaded(window, renderer));
+    printRow("Render thread, block",
+             runRenderThread(window, renderer, HANDOFF_BLOCKING));
+    printRow("Render thread, latest",
+             runRenderThread(window, renderer, HANDOFF_LATEST));
+
+    renderer.placements.destroy();
+    glDeleteVertexArrays(1, &renderer.vertexArray);
+    renderer.target.destroy();
+    glDeleteProgram(renderer.program);
+    glfwTerminate();
+    return 0;
+}
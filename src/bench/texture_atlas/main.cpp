@@ -0,0 +1,258 @@
+/****************
+ * Title:   bench/texture_atlas/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/buffer.hpp"
+#include "engine/texture_atlas.hpp"
+#include "engine/vertex_layout.hpp"
+
+// Draws a grid of quads that each use a different small texture: first
+// with one texture object per quad (a bind and a draw each), then from a
+// skyline packed atlas and from a one-image-per-layer texture array, where
+// the texture coordinates were rewritten ahead of time and the whole grid
+// is one bind and one draw. Reports packing efficiency, binds and draws
+// per frame and frame times.
+
+const int TEXTURE_COUNT = 1024;
+const int GRID = 32;
+const int MIN_SIZE = 16;
+const int MAX_SIZE = 128;
+const int FRAMES = 60;
+const GLsizei TARGET_WIDTH = 1280;
+const GLsizei TARGET_HEIGHT = 720;
+
+const char* vertexShaderSource =
+    "#version 450 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec3 aTexCoord;\n"
+    "out vec3 texCoord;\n"
+    "void main() {\n"
+    "    texCoord = aTexCoord;\n"
+    "    gl_Position = vec4(aPos, 0.0, 1.0);\n"
+    "}\0";
+const char* textureFragmentSource =
+    "#version 450 core\n"
+    "in vec3 texCoord;\n"
+    "out vec4 FragColor;\n"
+    "layout (binding = 0) uniform sampler2D image;\n"
+    "void main() {\n"
+    "    FragColor = texture(image, texCoord.xy);\n"
+    "}\0";
+const char* arrayFragmentSource =
+    "#version 450 core\n"
+    "in vec3 texCoord;\n"
+    "out vec4 FragColor;\n"
+    "layout (binding = 0) uniform sampler2DArray image;\n"
+    "void main() {\n"
+    "    FragColor = texture(image, texCoord);\n"
+    "}\0";
+
+using QuadVertex = VertexLayout<Pos2f, TexCoord3f>;
+
+struct Vertex {
+    float position[2];
+    float texCoord[3];
+};
+static_assert(sizeof(Vertex) == QuadVertex::stride, "");
+
+
+struct Image {
+    int width;
+    int height;
+    std::vector<uint8_t> rgba;
+};
+
+// Two-colour stripes so every image looks different
+Image generateImage(uint32_t& seed) {
+    Image image;
+    image.width = MIN_SIZE + int(randomFloat(seed) * (MAX_SIZE - MIN_SIZE));
+    image.height = MIN_SIZE + int(randomFloat(seed) * (MAX_SIZE - MIN_SIZE));
+    uint8_t colours[2][4];
+    for (int c = 0; c < 4; ++c) {
+        colours[0][c] = uint8_t(randomFloat(seed) * 255.0f);
+        colours[1][c] = uint8_t(randomFloat(seed) * 255.0f);
+    }
+    colours[0][3] = colours[1][3] = 255;
+    image.rgba.resize(size_t(image.width) * image.height * 4);
+    for (int y = 0; y < image.height; ++y)
+        for (int x = 0; x < image.width; ++x)
+            std::memcpy(&image.rgba[(size_t(y) * image.width + x) * 4],
+                        colours[((x + y) / 8) & 1], 4);
+    return image;
+}
+
+// Layer count and occupancy are left out for separate textures (layers 0)
+void printRow(const char* name, int layers, float occupancy, int binds,
+              int draws, double cpuMs, double gpuMs) {
+    char layerText[16] = "-", occupancyText[16] = "-";
+    if (layers > 0) {
+        std::snprintf(layerText, sizeof(layerText), "%d", layers);
+        std::snprintf(occupancyText, sizeof(occupancyText), "%.1f%%",
+                      occupancy * 100.0f);
+    }
+    std::printf("%-14s %7s %11s %7d %7d %9.3fms %9.3fms\n", name, layerText,
+                occupancyText, binds, draws, cpuMs, gpuMs);
+}
+
+
+int main()
+{
+    GLFWwindow* window = createBenchContext("bench_texture_atlas");
+    if (window == NULL)
+        return -1;
+    unsigned int textureProgram = buildProgram(vertexShaderSource,
+                                               textureFragmentSource);
+    unsigned int arrayProgram = buildProgram(vertexShaderSource,
+                                             arrayFragmentSource);
+    if (!textureProgram || !arrayProgram) {
+        glfwTerminate();
+        return -1;
+    }
+
+    uint32_t seed = 1u;
+    std::vector<Image> images;
+    for (int i = 0; i < TEXTURE_COUNT; ++i)
+        images.push_back(generateImage(seed));
+
+    // One quad per image, texture coordinates cover the whole image
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    float cell = 2.0f / float(GRID);
+    for (int i = 0; i < TEXTURE_COUNT; ++i) {
+        float x = -1.0f + float(i % GRID) * cell;
+        float y = -1.0f + float(i / GRID) * cell;
+        uint32_t first = uint32_t(vertices.size());
+        vertices.push_back({ { x, y }, { 0.0f, 0.0f, 0.0f } });
+        vertices.push_back({ { x + cell, y }, { 1.0f, 0.0f, 0.0f } });
+        vertices.push_back({ { x + cell, y + cell }, { 1.0f, 1.0f, 0.0f } });
+        vertices.push_back({ { x, y + cell }, { 0.0f, 1.0f, 0.0f } });
+        for (uint32_t index : { 0u, 1u, 2u, 0u, 2u, 3u })
+            indices.push_back(first + index);
+    }
+    Buffer elements(GLsizeiptr(indices.size() * sizeof(uint32_t)),
+                    indices.data(), 0);
+
+    BenchTarget target;
+    if (!createBenchTarget(TARGET_WIDTH, TARGET_HEIGHT, false, target)) {
+        glfwTerminate();
+        return -1;
+    }
+
+    std::printf("%d textures of %d-%d texels a side\n\n", TEXTURE_COUNT,
+                MIN_SIZE, MAX_SIZE);
+    std::printf("%-14s %7s %11s %7s %7s %11s %11s\n", "Path", "Layers",
+                "Occupancy", "Binds", "Draws", "CPU", "GPU");
+
+    // Separate textures, a bind and a draw per quad
+    {
+        std::vector<GLuint> textures(TEXTURE_COUNT);
+        glCreateTextures(GL_TEXTURE_2D, TEXTURE_COUNT, textures.data());
+        for (int i = 0; i < TEXTURE_COUNT; ++i) {
+            glTextureStorage2D(textures[i], 1, GL_SRGB8_ALPHA8,
+                               images[i].width, images[i].height);
+            glTextureSubImage2D(textures[i], 0, 0, 0, images[i].width,
+                                images[i].height, GL_RGBA, GL_UNSIGNED_BYTE,
+                                images[i].rgba.data());
+        }
+        Buffer vertexBuffer(GLsizeiptr(vertices.size() * sizeof(Vertex)),
+                            vertices.data(), 0);
+        VertexArrayCache vertexArrays;
+        const VertexArray& vertexArray =
+            vertexArrays.get<QuadVertex>(vertexBuffer, &elements);
+
+        GpuTimer gpuTimer;
+        double cpuMs = 0.0, gpuMs = 0.0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            glClear(GL_COLOR_BUFFER_BIT);
+            CpuTimer cpuTimer;
+            gpuTimer.begin();
+            glUseProgram(textureProgram);
+            vertexArray.bind();
+            for (int i = 0; i < TEXTURE_COUNT; ++i) {
+                glBindTextureUnit(0, textures[i]);
+                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT,
+                               reinterpret_cast<const void*>(
+                                   size_t(i) * 6 * sizeof(uint32_t)));
+            }
+            gpuTimer.end();
+            cpuMs += cpuTimer.elapsedMs();
+            gpuMs += gpuTimer.resultMs();
+        }
+        printRow("Per texture", 0, 0.0f, TEXTURE_COUNT, TEXTURE_COUNT,
+                 cpuMs / FRAMES, gpuMs / FRAMES);
+        gpuTimer.destroy();
+        vertexArrays.destroy();
+        vertexBuffer.destroy();
+        glDeleteTextures(TEXTURE_COUNT, textures.data());
+    }
+
+    // Atlases, one bind and one draw per frame
+    const AtlasMode modes[] = { ATLAS_SKYLINE, ATLAS_ARRAY };
+    const char* modeNames[] = { "Skyline atlas", "Texture array" };
+    for (int m = 0; m < 2; ++m) {
+        TextureAtlas atlas;
+        for (const Image& image : images)
+            atlas.add(image.rgba.data(), image.width, image.height);
+        CpuTimer buildTimer;
+        if (!atlas.build(modes[m]))
+            continue;
+        glFinish();
+        double buildMs = buildTimer.elapsedMs();
+        atlas.releaseImages();
+
+        std::vector<Vertex> rewritten = vertices;
+        for (int i = 0; i < TEXTURE_COUNT; ++i)
+            rewriteTexCoords(&rewritten[size_t(i) * 4], 4, sizeof(Vertex),
+                             offsetof(Vertex, texCoord),
+                             offsetof(Vertex, texCoord) + 2 * sizeof(float),
+                             atlas.regions[size_t(i)]);
+        Buffer vertexBuffer(GLsizeiptr(rewritten.size() * sizeof(Vertex)),
+                            rewritten.data(), 0);
+        VertexArrayCache vertexArrays;
+        const VertexArray& vertexArray =
+            vertexArrays.get<QuadVertex>(vertexBuffer, &elements);
+
+        GpuTimer gpuTimer;
+        double cpuMs = 0.0, gpuMs = 0.0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            glClear(GL_COLOR_BUFFER_BIT);
+            CpuTimer cpuTimer;
+            gpuTimer.begin();
+            glUseProgram(arrayProgram);
+            vertexArray.bind();
+            glBindTextureUnit(0, atlas.texture);
+            glDrawElements(GL_TRIANGLES, GLsizei(indices.size()),
+                           GL_UNSIGNED_INT, 0);
+            gpuTimer.end();
+            cpuMs += cpuTimer.elapsedMs();
+            gpuMs += gpuTimer.resultMs();
+        }
+        printRow(modeNames[m], atlas.layerCount, atlas.occupancy(), 1, 1,
+                 cpuMs / FRAMES, gpuMs / FRAMES);
+        std::printf("  %dx%d layers, built in %.1fms\n", atlas.layerWidth,
+                    atlas.layerHeight, buildMs);
+        gpuTimer.destroy();
+        vertexArrays.destroy();
+        vertexBuffer.destroy();
+        atlas.destroy();
+    }
+
+    elements.destroy();
+    target.destroy();
+    glDeleteProgram(textureProgram);
+    glDeleteProgram(arrayProgram);
+    glfwTerminate();
+    return 0;
+}
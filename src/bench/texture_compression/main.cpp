@@ -0,0 +1,181 @@
+/****************
+ * Title:   bench/texture_compression/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/ktx2.hpp"
+#include "engine/mesh_file.hpp"
+#include "engine/texture_compression.hpp"
+
+// Compresses a generated 2048x2048 sRGB image with its mip chain to BC1,
+// BC3 and BC7, writes each as KTX2 and uploads it from the mapped file.
+// Reports encode time, level 0 PSNR, GPU memory (as reported by the driver
+// for compressed formats) and upload time, against plain RGBA8.
+
+const int IMAGE_SIZE = 2048;
+const int UPLOADS = 16;
+
+
+// Smooth colour fields with hard edges and some noise, alpha is a gradient
+std::vector<uint8_t> generateImage(int size) {
+    std::vector<uint8_t> rgba(size_t(size) * size * 4);
+    uint32_t seed = 7u;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            float u = float(x) / float(size), v = float(y) / float(size);
+            float noise = randomFloat(seed) * 0.06f;
+            float band = ((x / 128 + y / 128) & 1) ? 0.15f : 0.0f;
+            float r = 0.5f + 0.4f * std::sin(u * 9.0f + v * 3.0f) + noise;
+            float g = 0.5f + 0.4f * std::sin(v * 7.0f - u * 2.0f) + band;
+            float b = 0.5f + 0.4f * std::cos((u + v) * 5.0f) - noise;
+            float channels[4] = { r, g, b, u };
+            uint8_t* target = &rgba[(size_t(y) * size + x) * 4];
+            for (int c = 0; c < 4; ++c)
+                target[c] = uint8_t(std::fmin(std::fmax(channels[c], 0.0f),
+                                              1.0f) * 255.0f + 0.5f);
+        }
+    }
+    return rgba;
+}
+
+// Bytes the driver reports for every level of a texture
+size_t textureBytes(GLuint texture, GLsizei levels, bool compressed) {
+    size_t total = 0;
+    for (GLint level = 0; level < levels; ++level) {
+        if (compressed) {
+            GLint bytes = 0;
+            glGetTextureLevelParameteriv(texture, level,
+                                         GL_TEXTURE_COMPRESSED_IMAGE_SIZE,
+                                         &bytes);
+            total += size_t(bytes);
+        } else {
+            GLint width = 0, height = 0;
+            glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_WIDTH,
+                                         &width);
+            glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_HEIGHT,
+                                         &height);
+            total += size_t(width) * size_t(height) * 4;
+        }
+    }
+    return total;
+}
+
+
+int main()
+{
+    GLFWwindow* window = createBenchContext("bench_texture_compression");
+    if (window == NULL)
+        return -1;
+
+    std::vector<uint8_t> image = generateImage(IMAGE_SIZE);
+    std::vector<ImageLevel> levels = buildMipChain(image.data(), IMAGE_SIZE,
+                                                   IMAGE_SIZE, true);
+    std::filesystem::path directory =
+        std::filesystem::temp_directory_path() /
+        "gl_graphics_texture_compression_bench";
+    std::filesystem::create_directories(directory);
+    std::printf("%dx%d sRGB image, %zu levels, average of %d uploads\n\n",
+                IMAGE_SIZE, IMAGE_SIZE, levels.size(), UPLOADS);
+    std::printf("%-8s %10s %9s %12s %8s %11s %11s\n", "Format", "Encode",
+                "PSNR", "GPU memory", "Saved", "Upload CPU", "Upload GPU");
+
+    struct Case {
+        const char* name;
+        uint32_t vkFormat;
+        BlockFormat format;
+        bool compressed;
+    };
+    const Case cases[] = {
+        { "RGBA8", KTX2_VK_FORMAT_R8G8B8A8_SRGB, BLOCK_BC7, false },
+        { "BC1", KTX2_VK_FORMAT_BC1_RGB_SRGB, BLOCK_BC1, true },
+        { "BC3", KTX2_VK_FORMAT_BC3_SRGB, BLOCK_BC3, true },
+        { "BC7", KTX2_VK_FORMAT_BC7_SRGB, BLOCK_BC7, true }
+    };
+    size_t rgbaBytes = 0;
+    for (const Case& test : cases) {
+        Ktx2WriteInfo info;
+        info.vkFormat = test.vkFormat;
+        info.width = IMAGE_SIZE;
+        info.height = IMAGE_SIZE;
+        CpuTimer encodeTimer;
+        for (const ImageLevel& level : levels) {
+            if (test.compressed)
+                info.levels.push_back(compressImage(level.rgba.data(),
+                                                    level.width, level.height,
+                                                    test.format));
+            else
+                info.levels.push_back(level.rgba);
+        }
+        double encodeMs = encodeTimer.elapsedMs();
+        double psnr = 99.0;
+        if (test.compressed) {
+            std::vector<uint8_t> decoded(image.size());
+            decompressImage(info.levels[0].data(), IMAGE_SIZE, IMAGE_SIZE,
+                            test.format, decoded.data());
+            psnr = imagePsnr(image.data(), decoded.data(), IMAGE_SIZE,
+                             IMAGE_SIZE, test.format == BLOCK_BC1 ? 3 : 4);
+        }
+
+        std::string path = (directory / (std::string(test.name) +
+                                         ".ktx2")).string();
+        MappedFile file;
+        Ktx2Image ktx2;
+        if (!writeKtx2File(path.c_str(), info) || !file.open(path.c_str()) ||
+            !parseKtx2(file.data, file.size, ktx2))
+            continue;
+        if (!isKtx2FormatSupported(*ktx2.format)) {
+            std::printf("%-8s not supported by this context\n", test.name);
+            continue;
+        }
+
+        // Warm up the driver's format paths before timing
+        GLuint warmup = createKtx2Texture(ktx2);
+        size_t bytes = textureBytes(warmup, GLsizei(ktx2.levels.size()),
+                                    test.compressed);
+        glDeleteTextures(1, &warmup);
+        if (!test.compressed)
+            rgbaBytes = bytes;
+        glFinish();
+
+        GpuTimer gpuTimer;
+        double cpuMs = 0.0, gpuMs = 0.0;
+        for (int i = 0; i < UPLOADS; ++i) {
+            CpuTimer cpuTimer;
+            gpuTimer.begin();
+            GLuint texture = createKtx2Texture(ktx2);
+            gpuTimer.end();
+            glFinish();
+            cpuMs += cpuTimer.elapsedMs();
+            gpuMs += gpuTimer.resultMs();
+            glDeleteTextures(1, &texture);
+        }
+        gpuTimer.destroy();
+
+        char encode[32] = "-", quality[32] = "-";
+        if (test.compressed) {
+            std::snprintf(encode, sizeof(encode), "%.0fms", encodeMs);
+            std::snprintf(quality, sizeof(quality), "%.1fdB", psnr);
+        }
+        double saved = rgbaBytes ?
+            100.0 * (1.0 - double(bytes) / double(rgbaBytes)) : 0.0;
+        std::printf("%-8s %10s %9s %10.2fMB %7.1f%% %9.2fms %9.2fms\n",
+                    test.name, encode, quality, double(bytes) / 1048576.0,
+                    saved, cpuMs / UPLOADS, gpuMs / UPLOADS);
+    }
+
+    std::filesystem::remove_all(directory);
+    glfwTerminate();
+    return 0;
+}
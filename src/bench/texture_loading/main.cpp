@@ -0,0 +1,227 @@
+/****************
+ * Title:   bench/texture_loading/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#define STB_IMAGE_IMPLEMENTATION
+#include "engine/texture_loader.hpp"
+
+// Loads a batch of images into mipmapped textures, first synchronously on
+// the render thread (decode, glTextureSubImage2D from client memory) and
+// then through TextureLoader with one and with every hardware thread.
+// Reports textures per second and the longest the render thread was
+// blocked in one call.
+//
+// Usage: bench_texture_loading [image ...]
+//
+// Without arguments a batch of generated 1024x1024 PNGs is used. They are
+// stored uncompressed (PNG deflate "stored" blocks) but Paeth filtered, so
+// pass real PNG/JPEG files for representative decode costs.
+
+const size_t BATCH = 256;
+const int GENERATED_SIZE = 1024;
+const size_t GENERATED_FILES = 32;
+// Staging limit per TextureLoader::update(), one frame's worth
+const GLsizeiptr UPLOAD_BUDGET = 16 * 1024 * 1024;
+
+
+uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+void appendBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back((unsigned char)(value >> shift));
+}
+
+void appendChunk(std::vector<unsigned char>& out, const char* type,
+                 const std::vector<unsigned char>& data) {
+    appendBigEndian(out, uint32_t(data.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    appendBigEndian(out, crc32(&out[start], out.size() - start));
+}
+
+unsigned char paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    return (unsigned char)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+// Writes a smooth RGBA gradient as a Paeth filtered, stored-deflate PNG
+bool writeTestPng(const std::string& path, int size, int seed) {
+    size_t rowBytes = size_t(size) * 4;
+    std::vector<unsigned char> raw(rowBytes * size_t(size));
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            unsigned char* pixel = &raw[size_t(y) * rowBytes + size_t(x) * 4];
+            pixel[0] = (unsigned char)(x + seed * 16);
+            pixel[1] = (unsigned char)(y + seed * 8);
+            pixel[2] = (unsigned char)((x ^ y) + seed);
+            pixel[3] = 255;
+        }
+    }
+    std::vector<unsigned char> filtered;
+    filtered.reserve((rowBytes + 1) * size_t(size));
+    for (int y = 0; y < size; ++y) {
+        filtered.push_back(4);
+        const unsigned char* row = &raw[size_t(y) * rowBytes];
+        const unsigned char* up = y ? row - rowBytes : NULL;
+        for (size_t i = 0; i < rowBytes; ++i) {
+            int a = i >= 4 ? row[i - 4] : 0;
+            int b = up ? up[i] : 0;
+            int c = up && i >= 4 ? up[i - 4] : 0;
+            filtered.push_back((unsigned char)(row[i] - paeth(a, b, c)));
+        }
+    }
+
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    for (size_t offset = 0; offset < filtered.size(); offset += 65535) {
+        size_t length = std::min<size_t>(65535, filtered.size() - offset);
+        zlib.push_back(offset + length == filtered.size() ? 1 : 0);
+        zlib.push_back((unsigned char)length);
+        zlib.push_back((unsigned char)(length >> 8));
+        zlib.push_back((unsigned char)~length);
+        zlib.push_back((unsigned char)(~length >> 8));
+        zlib.insert(zlib.end(), filtered.begin() + long(offset),
+                    filtered.begin() + long(offset + length));
+    }
+    uint32_t a = 1, b = 0;
+    for (unsigned char byte : filtered) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+
+    std::vector<unsigned char> header;
+    appendBigEndian(header, uint32_t(size));
+    appendBigEndian(header, uint32_t(size));
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });
+    std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n',
+                                       0x1A, '\n' };
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(png.data()),
+               std::streamsize(png.size()));
+    return bool(file);
+}
+
+void printRow(const char* name, double totalMs, double worstMs) {
+    std::printf("%-18s %10.1fms %12.1f %12.2fms\n", name, totalMs,
+                double(BATCH) / (totalMs / 1000.0), worstMs);
+}
+
+// Loads the batch through a TextureLoader, one update() per frame
+void runLoader(const char* name, unsigned int threads,
+               const std::vector<std::string>& files) {
+    TextureLoader loader;
+    if (!loader.create(threads))
+        return;
+    CpuTimer timer;
+    double worstMs = 0.0;
+    std::vector<TextureHandle> handles;
+    for (size_t i = 0; i < BATCH; ++i)
+        handles.push_back(loader.load(files[i % files.size()].c_str()));
+    while (loader.pendingCount() > 0) {
+        CpuTimer frameTimer;
+        loader.update(UPLOAD_BUDGET);
+        worstMs = std::max(worstMs, frameTimer.elapsedMs());
+    }
+    double totalMs = timer.elapsedMs();
+    size_t failed = 0;
+    for (TextureHandle handle : handles)
+        failed += loader.state(handle) == TEXTURE_FAILED;
+    printRow(name, totalMs, worstMs);
+    if (failed)
+        std::printf("  %zu textures failed\n", failed);
+    loader.destroy();
+}
+
+
+int main(int argc, char** argv)
+{
+    GLFWwindow* window = createBenchContext("bench_texture_loading");
+    if (window == NULL)
+        return -1;
+
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+        files.push_back(argv[i]);
+    std::filesystem::path directory;
+    if (files.empty()) {
+        directory = std::filesystem::temp_directory_path() /
+            "gl_graphics_texture_bench";
+        std::filesystem::create_directories(directory);
+        for (size_t i = 0; i < GENERATED_FILES; ++i) {
+            std::string path = (directory / ("image" + std::to_string(i) +
+                                             ".png")).string();
+            if (!writeTestPng(path, GENERATED_SIZE, int(i))) {
+                std::printf("Could not write %s\n", path.c_str());
+                glfwTerminate();
+                return -1;
+            }
+            files.push_back(path);
+        }
+    }
+    std::printf("%zu textures from %zu files, %u hardware threads\n\n", BATCH,
+                files.size(), resolveThreadCount(0));
+    std::printf("%-18s %12s %12s %14s\n", "Path", "Total", "Textures/s",
+                "Worst stall");
+
+    // Everything on the render thread
+    {
+        CpuTimer timer;
+        double worstMs = 0.0;
+        std::vector<GLuint> textures(BATCH);
+        for (size_t i = 0; i < BATCH; ++i) {
+            CpuTimer stallTimer;
+            int width, height, channels;
+            unsigned char* pixels = stbi_load(files[i % files.size()].c_str(),
+                                              &width, &height, &channels, 4);
+            if (pixels == NULL)
+                continue;
+            glCreateTextures(GL_TEXTURE_2D, 1, &textures[i]);
+            glTextureStorage2D(textures[i], mipLevelCount(width, height),
+                               GL_SRGB8_ALPHA8, width, height);
+            glTextureSubImage2D(textures[i], 0, 0, 0, width, height, GL_RGBA,
+                                GL_UNSIGNED_BYTE, pixels);
+            glGenerateTextureMipmap(textures[i]);
+            stbi_image_free(pixels);
+            worstMs = std::max(worstMs, stallTimer.elapsedMs());
+        }
+        glFinish();
+        printRow("Synchronous", timer.elapsedMs(), worstMs);
+        glDeleteTextures(GLsizei(BATCH), textures.data());
+    }
+
+    runLoader("Loader, 1 thread", 1, files);
+    runLoader("Loader, all", 0, files);
+
+    if (!directory.empty())
+        std::filesystem::remove_all(directory);
+    glfwTerminate();
+    return 0;
+}
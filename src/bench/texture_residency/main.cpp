@@ -0,0 +1,210 @@
+/****************
+ * Title:   bench/texture_residency/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/lod.hpp"
+#include "engine/math.hpp"
+#include "engine/texture_residency.hpp"
+
+// Lines a corridor with 512 textured panels of 1024x1024 (about 2.7GB
+// with mips) and walks a camera down it under a 128MB budget. Each frame
+// asks TextureResidency for the mip level each panel's screen size needs,
+// streams and evicts accordingly and draws the panels. Prints the
+// residency stats over the walk, then repeats with the budget halved
+// halfway through to show the eviction spike.
+
+const int PANEL_COUNT = 512;
+const int TEXTURE_SIZE = 1024;
+const int IMAGE_COUNT = 8;
+const int FRAMES = 400;
+const float PANEL_SPACING = 6.0f;
+const float PANEL_SIZE = 4.0f;
+const uint64_t BUDGET_BYTES = 128ull * 1024 * 1024;
+const GLsizei TARGET_WIDTH = 1280;
+const GLsizei TARGET_HEIGHT = 720;
+const float FOV_Y = radians(60.0f);
+
+const char* vertexShaderSource =
+    "#version 450 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "uniform mat4 uViewProjection;\n"
+    "uniform vec4 uPanel;\n"
+    "out vec2 texCoord;\n"
+    "void main() {\n"
+    "    texCoord = aPos + 0.5;\n"
+    "    vec3 position = vec3(uPanel.x, aPos.y * uPanel.w + uPanel.y,\n"
+    "                         aPos.x * uPanel.w + uPanel.z);\n"
+    "    gl_Position = uViewProjection * vec4(position, 1.0);\n"
+    "}\0";
+const char* fragmentShaderSource =
+    "#version 450 core\n"
+    "in vec2 texCoord;\n"
+    "out vec4 FragColor;\n"
+    "layout (binding = 0) uniform sampler2D image;\n"
+    "void main() {\n"
+    "    FragColor = texture(image, texCoord);\n"
+    "}\0";
+
+
+// Concentric rings in two random colours
+std::shared_ptr<const std::vector<ImageLevel>> generateChain(uint32_t& seed) {
+    uint8_t colours[2][4];
+    for (int c = 0; c < 4; ++c) {
+        colours[0][c] = uint8_t(randomFloat(seed) * 255.0f);
+        colours[1][c] = uint8_t(randomFloat(seed) * 255.0f);
+    }
+    colours[0][3] = colours[1][3] = 255;
+    std::vector<uint8_t> rgba(size_t(TEXTURE_SIZE) * TEXTURE_SIZE * 4);
+    for (int y = 0; y < TEXTURE_SIZE; ++y) {
+        for (int x = 0; x < TEXTURE_SIZE; ++x) {
+            int dx = x - TEXTURE_SIZE / 2, dy = y - TEXTURE_SIZE / 2;
+            int ring = int(std::sqrt(float(dx * dx + dy * dy))) / 16;
+            std::memcpy(&rgba[(size_t(y) * TEXTURE_SIZE + x) * 4],
+                        colours[ring & 1], 4);
+        }
+    }
+    return std::make_shared<const std::vector<ImageLevel>>(
+        buildMipChain(rgba.data(), TEXTURE_SIZE, TEXTURE_SIZE, true));
+}
+
+// Panels alternate walls, 1.5 units either side of the corridor
+Vec3 panelCentre(int panel) {
+    return Vec3(panel % 2 ? 1.5f : -1.5f, 2.0f,
+                -float(panel / 2) * PANEL_SPACING);
+}
+
+
+int main()
+{
+    GLFWwindow* window = createBenchContext("bench_texture_residency");
+    if (window == NULL)
+        return -1;
+    unsigned int program = buildProgram(vertexShaderSource,
+                                        fragmentShaderSource);
+    if (!program) {
+        glfwTerminate();
+        return -1;
+    }
+    int viewProjectionLocation = glGetUniformLocation(program,
+                                                      "uViewProjection");
+    int panelLocation = glGetUniformLocation(program, "uPanel");
+
+    uint32_t seed = 9u;
+    std::vector<std::shared_ptr<const std::vector<ImageLevel>>> chains;
+    for (int i = 0; i < IMAGE_COUNT; ++i)
+        chains.push_back(generateChain(seed));
+
+    BenchQuad quad(0.5f);
+
+    BenchTarget target;
+    if (!createBenchTarget(TARGET_WIDTH, TARGET_HEIGHT, false, target)) {
+        glfwTerminate();
+        return -1;
+    }
+    Mat4 projection = perspective(FOV_Y, float(TARGET_WIDTH) /
+                                  float(TARGET_HEIGHT), 0.1f, 2000.0f);
+    float projectionScale = lodProjectionScale(FOV_Y, float(TARGET_HEIGHT));
+
+    const char* runNames[] = { "Fixed budget", "Budget halved" };
+    for (int run = 0; run < 2; ++run) {
+        TextureResidency residency;
+        residency.create(BUDGET_BYTES);
+        std::vector<ResidencyHandle> handles;
+        uint64_t fullBytes = 0;
+        for (int i = 0; i < PANEL_COUNT; ++i) {
+            handles.push_back(residency.add(
+                mipChainSource(chains[size_t(i % IMAGE_COUNT)])));
+            for (int level = 0; level < int(chains[0]->size()); ++level)
+                fullBytes += residency.levelBytes(handles.back(), level);
+        }
+        std::printf("\n%s: %d textures, %.0fMB fully resident, %.0fMB "
+                    "budget\n", runNames[run], PANEL_COUNT,
+                    double(fullBytes) / (1024.0 * 1024.0),
+                    double(BUDGET_BYTES) / (1024.0 * 1024.0));
+        std::printf("%6s %10s %10s %9s %9s %9s %9s %9s\n", "Frame",
+                    "Resident", "Wanted", "Pressure", "Streamed",
+                    "Evicted", "Deferred", "Update");
+
+        double updateMs = 0.0, worstUpdateMs = 0.0;
+        size_t streamed = 0, evicted = 0, deferred = 0, throttled = 0;
+        GpuTimer drawTimer;
+        double drawMs = 0.0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            if (run == 1 && frame == FRAMES / 2)
+                residency.setBudget(BUDGET_BYTES / 2);
+            Vec3 eye(0.0f, 2.0f, 5.0f - float(frame) * 0.35f);
+            Mat4 viewProjection = projection *
+                lookAt(eye, eye + Vec3(0.0f, 0.0f, -1.0f),
+                       Vec3(0.0f, 1.0f, 0.0f));
+            glProgramUniformMatrix4fv(program, viewProjectionLocation, 1,
+                                      GL_FALSE, viewProjection.data());
+
+            glClear(GL_COLOR_BUFFER_BIT);
+            drawTimer.begin();
+            glUseProgram(program);
+            quad.vertexArray.bind();
+            for (int i = 0; i < PANEL_COUNT; ++i) {
+                Vec3 centre = panelCentre(i);
+                // Panels behind the camera aren't drawn or wanted
+                if (centre.z > eye.z + PANEL_SIZE)
+                    continue;
+                float distance = std::max(length(centre - eye), 0.1f);
+                float pixels = PANEL_SIZE * projectionScale / distance;
+                residency.use(handles[size_t(i)],
+                              mipLevelForCoverage(TEXTURE_SIZE,
+                                                  TEXTURE_SIZE, pixels));
+                glProgramUniform4f(program, panelLocation, centre.x,
+                                   centre.y, centre.z, PANEL_SIZE);
+                glBindTextureUnit(0, residency.texture(handles[size_t(i)]));
+                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            }
+            drawTimer.end();
+            drawMs += drawTimer.resultMs();
+
+            CpuTimer updateTimer;
+            residency.update();
+            double ms = updateTimer.elapsedMs();
+            updateMs += ms;
+            worstUpdateMs = std::max(worstUpdateMs, ms);
+
+            ResidencyStats stats = residency.stats();
+            streamed += stats.streamedLevels;
+            evicted += stats.evictedLevels;
+            deferred += stats.deferredLevels;
+            throttled += stats.throttledLevels;
+            if (frame % 50 == 0 || frame == FRAMES / 2)
+                std::printf("%6d %8.1fMB %8.1fMB %9.2f %9zu %9zu %9zu "
+                            "%7.3fms\n", frame,
+                            double(stats.residentBytes) / (1024.0 * 1024.0),
+                            double(stats.wantedBytes) / (1024.0 * 1024.0),
+                            stats.pressure, stats.streamedLevels,
+                            stats.evictedLevels, stats.deferredLevels, ms);
+        }
+        std::printf("Total: %zu levels streamed, %zu evicted, %zu deferred, "
+                    "%zu throttled, update %.3fms avg %.3fms worst, draw "
+                    "%.3fms\n", streamed, evicted, deferred, throttled,
+                    updateMs / FRAMES, worstUpdateMs, drawMs / FRAMES);
+        drawTimer.destroy();
+        residency.destroy();
+    }
+
+    quad.destroy();
+    target.destroy();
+    glDeleteProgram(program);
+    glfwTerminate();
+    return 0;
+}
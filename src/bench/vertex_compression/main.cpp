@@ -0,0 +1,208 @@
+/****************
+ * Title:   bench/vertex_compression/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/buffer.hpp"
+#include "engine/vertex_compression.hpp"
+#include "engine/vertex_layout.hpp"
+
+// Sphere tessellation, SEGMENTS^2 vertices (just over 1M)
+const unsigned int SEGMENTS = 1025;
+const int ITERATIONS = 20;
+const float PI = 3.14159265358979f;
+
+// Uncompressed reference vertex: position, normal, colour (36 bytes)
+using FloatVertexLayout = VertexLayout<Pos3f, Normal3f, Color3f>;
+
+const char* floatVertexSource = "#version 460 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in vec3 aNormal;\n"
+    "layout (location = 2) in vec3 aColor;\n"
+    "void main() {\n"
+    "    gl_Position = vec4(aPos + 0.001 * (aNormal + aColor), 1.0);\n"
+    "}\0";
+// The decode snippet is inserted after the header
+const char* compressedVertexHeader = "#version 460 core\n";
+const char* compressedVertexBody =
+    "layout (location = 0) in vec4 aPos;\n"
+    "layout (location = 1) in vec4 aColor;\n"
+    "layout (location = 2) in vec2 aNormal;\n"
+    "void main() {\n"
+    "    vec3 position = decodePosition(aPos.xyz);\n"
+    "    vec3 normal = decodeNormal(aNormal);\n"
+    "    gl_Position = vec4(position + 0.001 * (normal + aColor.rgb), 1.0);\n"
+    "}\0";
+
+
+/**
+ * Times drawing every vertex as a point with rasterization discarded, so
+ * the cost is dominated by vertex fetch
+ *
+ * @return average milliseconds per draw
+ */
+double timeVertexFetch(unsigned int program, const VertexArray& vertexArray,
+                       GLsizei count) {
+    GpuTimer timer;
+    glUseProgram(program);
+    vertexArray.bind();
+    glEnable(GL_RASTERIZER_DISCARD);
+    // Warm up caches and let the driver finish lazy state validation
+    glDrawArrays(GL_POINTS, 0, count);
+    timer.begin();
+    for (int i = 0; i < ITERATIONS; ++i)
+        glDrawArrays(GL_POINTS, 0, count);
+    timer.end();
+    double ms = timer.resultMs() / ITERATIONS;
+    glDisable(GL_RASTERIZER_DISCARD);
+    timer.destroy();
+    return ms;
+}
+
+
+int main(void)
+{
+    GLFWwindow* window = createBenchContext("bench_vertex_compression");
+    if (window == NULL)
+        return -1;
+
+    /*******************
+     * GENERATE MESH
+     *******************/
+
+    size_t count = size_t(SEGMENTS) * SEGMENTS;
+    std::vector<float> positions(count * 3);
+    std::vector<float> normals(count * 3);
+    std::vector<float> colors(count * 3);
+    for (unsigned int ring = 0; ring < SEGMENTS; ++ring) {
+        float theta = PI * ring / (SEGMENTS - 1);
+        for (unsigned int segment = 0; segment < SEGMENTS; ++segment) {
+            float phi = 2.0f * PI * segment / (SEGMENTS - 1);
+            size_t i = (size_t(ring) * SEGMENTS + segment) * 3;
+            normals[i] = std::sin(theta) * std::cos(phi);
+            normals[i + 1] = std::cos(theta);
+            normals[i + 2] = std::sin(theta) * std::sin(phi);
+            for (int axis = 0; axis < 3; ++axis) {
+                positions[i + axis] = 25.0f * normals[i + axis];
+                colors[i + axis] = normals[i + axis] * 0.5f + 0.5f;
+            }
+        }
+    }
+
+    /*******************
+     * COMPRESS (CPU)
+     *******************/
+
+    CpuTimer cpuTimer;
+    QuantizationBounds bounds;
+    std::vector<CompressedVertex> compressed = compressVertices(
+        positions.data(), normals.data(), colors.data(), count, bounds);
+    double compressMs = cpuTimer.elapsedMs();
+
+    // Measure the worst case decode error
+    float maxPositionError = 0.0f;
+    float maxNormalErrorDegrees = 0.0f;
+    for (size_t v = 0; v < count; ++v) {
+        for (int axis = 0; axis < 3; ++axis) {
+            float decoded = bounds.min[axis] + bounds.extent[axis] *
+                (compressed[v].position[axis] / 65535.0f);
+            maxPositionError = std::fmax(maxPositionError,
+                std::fabs(decoded - positions[v * 3 + axis]));
+        }
+        float encoded[2] = {
+            std::fmax(compressed[v].normal[0] / 32767.0f, -1.0f),
+            std::fmax(compressed[v].normal[1] / 32767.0f, -1.0f)
+        };
+        float decoded[3];
+        octDecode(encoded, decoded);
+        float cosine = decoded[0] * normals[v * 3] +
+            decoded[1] * normals[v * 3 + 1] + decoded[2] * normals[v * 3 + 2];
+        cosine = std::fmin(1.0f, std::fmax(-1.0f, cosine));
+        maxNormalErrorDegrees = std::fmax(maxNormalErrorDegrees,
+            std::acos(cosine) * 180.0f / PI);
+    }
+
+    /*******************
+     * UPLOAD
+     *******************/
+
+    std::vector<float> interleaved(count * 9);
+    for (size_t v = 0; v < count; ++v)
+        for (int axis = 0; axis < 3; ++axis) {
+            interleaved[v * 9 + axis] = positions[v * 3 + axis];
+            interleaved[v * 9 + 3 + axis] = normals[v * 3 + axis];
+            interleaved[v * 9 + 6 + axis] = colors[v * 3 + axis];
+        }
+    GLsizeiptr floatBytes = GLsizeiptr(count) * FloatVertexLayout::stride;
+    GLsizeiptr compressedBytes =
+        GLsizeiptr(count) * CompressedVertexLayout::stride;
+    Buffer floatBuffer(floatBytes, interleaved.data(), 0);
+    Buffer compressedBuffer(compressedBytes, compressed.data(), 0);
+
+    VertexArrayCache vertexArrays;
+    const VertexArray& floatVAO =
+        vertexArrays.get<FloatVertexLayout>(floatBuffer);
+    const VertexArray& compressedVAO =
+        vertexArrays.get<CompressedVertexLayout>(compressedBuffer);
+
+    std::string compressedSource = std::string(compressedVertexHeader) +
+        VERTEX_DECODE_GLSL + compressedVertexBody;
+    unsigned int floatProgram = buildProgram(floatVertexSource, NULL);
+    unsigned int compressedProgram =
+        buildProgram(compressedSource.c_str(), NULL);
+    if (!floatProgram || !compressedProgram) {
+        glfwTerminate();
+        return -1;
+    }
+    setQuantizationUniforms(compressedProgram, bounds);
+
+    /*******************
+     * VERTEX FETCH
+     *******************/
+
+    double floatMs = timeVertexFetch(floatProgram, floatVAO, GLsizei(count));
+    double compressedMs = timeVertexFetch(compressedProgram, compressedVAO,
+                                          GLsizei(count));
+
+    double mib = 1024.0 * 1024.0;
+    std::cout << "Vertices:              " << count << "\n";
+    std::cout << "Float vertex:          " << FloatVertexLayout::stride <<
+        " bytes, " << floatBytes / mib << " MiB per mesh\n";
+    std::cout << "Compressed vertex:     " << CompressedVertexLayout::stride <<
+        " bytes, " << compressedBytes / mib << " MiB per mesh\n";
+    std::cout << "Memory saved:          " <<
+        100.0 * (1.0 - double(compressedBytes) / floatBytes) << "%\n";
+    std::cout << "Compression (CPU):     " << compressMs << " ms, " <<
+        count / (compressMs * 1000.0) << " Mverts/s\n";
+    std::cout << "Max position error:    " << maxPositionError <<
+        " (extent " << bounds.extent[0] << ")\n";
+    std::cout << "Max normal error:      " << maxNormalErrorDegrees <<
+        " degrees\n";
+    std::cout << "Fetch float:           " << floatMs << " ms/draw, " <<
+        floatBytes / (floatMs * 1.0e6) << " GB/s\n";
+    std::cout << "Fetch compressed:      " << compressedMs << " ms/draw, " <<
+        compressedBytes / (compressedMs * 1.0e6) << " GB/s\n";
+    std::cout << "Fetch speedup:         " << floatMs / compressedMs << "x" <<
+        std::endl;
+
+    // Deallocated no longer needed resources
+    vertexArrays.destroy();
+    floatBuffer.destroy();
+    compressedBuffer.destroy();
+    glDeleteProgram(floatProgram);
+    glDeleteProgram(compressedProgram);
+
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,215 @@
+/****************
+ * Title:   bench/virtual_texture/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "bench/bench.hpp"
+#include "engine/math.hpp"
+#include "engine/virtual_texture.hpp"
+
+// Writes a procedural 8192x8192 texture as a tiled .vtex file, then flies
+// a camera low over a plane mapped with it. Each frame renders the page
+// feedback pass, streams pages through VirtualTexture::update() and draws
+// the plane through the page table, in the software cache path and (with
+// ARB_sparse_texture) the sparse path. Reports resident against virtual
+// memory, page traffic and the per frame cost of each step.
+
+const int VIRTUAL_SIZE = 8192;
+const int FRAMES = 240;
+const GLsizei TARGET_WIDTH = 1280;
+const GLsizei TARGET_HEIGHT = 720;
+const float FOV_Y = radians(60.0f);
+
+const char* vertexShaderSource =
+    "#version 450 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "uniform mat4 uViewProjection;\n"
+    "out vec2 texCoord;\n"
+    "void main() {\n"
+    "    texCoord = aPos * 0.5 + 0.5;\n"
+    "    gl_Position = uViewProjection *\n"
+    "        vec4(aPos.x * 500.0, 0.0, aPos.y * 500.0, 1.0);\n"
+    "}\0";
+const char* feedbackFragmentMain =
+    "in vec2 texCoord;\n"
+    "layout (location = 0) out uint FragPage;\n"
+    "void main() {\n"
+    "    FragPage = virtualFeedback(texCoord);\n"
+    "}\n";
+const char* sampleFragmentMain =
+    "in vec2 texCoord;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "    FragColor = sampleVirtual(texCoord);\n"
+    "}\n";
+
+
+// Large coloured cells with a fine grid and noise, so every page differs
+std::vector<uint8_t> generateImage() {
+    std::vector<uint8_t> rgba(size_t(VIRTUAL_SIZE) * VIRTUAL_SIZE * 4);
+    uint32_t seed = 5u;
+    uint8_t cells[64][3];
+    for (int i = 0; i < 64; ++i)
+        for (int c = 0; c < 3; ++c)
+            cells[i][c] = uint8_t(64.0f + randomFloat(seed) * 191.0f);
+    for (int y = 0; y < VIRTUAL_SIZE; ++y) {
+        for (int x = 0; x < VIRTUAL_SIZE; ++x) {
+            uint8_t* texel = &rgba[(size_t(y) * VIRTUAL_SIZE + x) * 4];
+            const uint8_t* cell = cells[((x >> 9) + (y >> 9) * 7) & 63];
+            bool line = (x & 31) == 0 || (y & 31) == 0;
+            uint8_t noise = uint8_t(randomFloat(seed) * 32.0f);
+            for (int c = 0; c < 3; ++c)
+                texel[c] = line ? 20 : uint8_t(cell[c] - noise / 2);
+            texel[3] = 255;
+        }
+    }
+    return rgba;
+}
+
+unsigned int buildVirtualProgram(const std::string& glsl, const char* main) {
+    std::string fragmentSource = std::string("#version 450 core\n") + glsl +
+        main;
+    return buildProgram(vertexShaderSource, fragmentSource.c_str());
+}
+
+
+int main()
+{
+    GLFWwindow* window = createBenchContext("bench_virtual_texture");
+    if (window == NULL)
+        return -1;
+
+    std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / "gl_graphics_virtual_bench";
+    std::filesystem::create_directories(directory);
+    std::string path = (directory / "terrain.vtex").string();
+    {
+        CpuTimer writeTimer;
+        std::vector<uint8_t> image = generateImage();
+        if (!writeVirtualTextureFile(path.c_str(), image.data(), VIRTUAL_SIZE,
+                                     VIRTUAL_SIZE)) {
+            glfwTerminate();
+            return -1;
+        }
+        std::printf("Wrote %dx%d virtual texture in %.0fms\n", VIRTUAL_SIZE,
+                    VIRTUAL_SIZE, writeTimer.elapsedMs());
+    }
+
+    BenchQuad quad(1.0f);
+
+    BenchTarget target;
+    if (!createBenchTarget(TARGET_WIDTH, TARGET_HEIGHT, true, target)) {
+        glfwTerminate();
+        return -1;
+    }
+    glEnable(GL_DEPTH_TEST);
+    Mat4 projection = perspective(FOV_Y, float(TARGET_WIDTH) /
+                                  float(TARGET_HEIGHT), 0.1f, 2000.0f);
+
+    std::printf("\n%-10s %10s %10s %8s %8s %10s %10s %10s\n", "Mode",
+                "Virtual", "Resident", "Loads", "Evicted", "Feedback",
+                "Update", "Draw");
+    const char* modeNames[] = { "Software", "Sparse" };
+    for (int sparse = 0; sparse < 2; ++sparse) {
+        VirtualTextureOptions options;
+        options.allowSparse = sparse != 0;
+        VirtualTexture texture;
+        if (!texture.create(path.c_str(), TARGET_WIDTH, TARGET_HEIGHT,
+                            options))
+            break;
+        if (sparse && texture.mode() != VIRTUAL_TEXTURE_SPARSE) {
+            std::printf("%-10s unavailable\n", modeNames[sparse]);
+            texture.destroy();
+            break;
+        }
+        unsigned int feedbackProgram = buildVirtualProgram(
+            VirtualTexture::feedbackGlsl(), feedbackFragmentMain);
+        unsigned int sampleProgram = buildVirtualProgram(
+            texture.samplingGlsl(), sampleFragmentMain);
+        if (!feedbackProgram || !sampleProgram) {
+            texture.destroy();
+            break;
+        }
+        texture.setUniforms(feedbackProgram, 0);
+        texture.setUniforms(sampleProgram, 0);
+        int feedbackLocation = glGetUniformLocation(feedbackProgram,
+                                                    "uViewProjection");
+        int sampleLocation = glGetUniformLocation(sampleProgram,
+                                                  "uViewProjection");
+
+        GpuTimer feedbackTimer, drawTimer;
+        double feedbackMs = 0.0, updateMs = 0.0, drawMs = 0.0;
+        size_t loads = 0, evicted = 0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            // Low over the plane, weaving so new pages keep coming in
+            float t = float(frame) / float(FRAMES);
+            Vec3 eye(std::sin(t * 12.0f) * 200.0f, 4.0f,
+                     450.0f - t * 900.0f);
+            Mat4 viewProjection = projection *
+                lookAt(eye, eye + Vec3(std::cos(t * 12.0f) * 0.5f, -0.15f,
+                                       -1.0f),
+                       Vec3(0.0f, 1.0f, 0.0f));
+            glProgramUniformMatrix4fv(feedbackProgram, feedbackLocation, 1,
+                                      GL_FALSE, viewProjection.data());
+            glProgramUniformMatrix4fv(sampleProgram, sampleLocation, 1,
+                                      GL_FALSE, viewProjection.data());
+            quad.vertexArray.bind();
+
+            feedbackTimer.begin();
+            texture.beginFeedback();
+            glUseProgram(feedbackProgram);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            texture.endFeedback();
+            feedbackTimer.end();
+
+            CpuTimer updateTimer;
+            texture.update();
+            updateMs += updateTimer.elapsedMs();
+            VirtualTextureStats stats = texture.stats();
+            loads += stats.uploadedPages;
+            evicted += stats.evictedPages;
+
+            target.bind();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawTimer.begin();
+            glUseProgram(sampleProgram);
+            texture.bind(0);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            drawTimer.end();
+            feedbackMs += feedbackTimer.resultMs();
+            drawMs += drawTimer.resultMs();
+        }
+        VirtualTextureStats stats = texture.stats();
+        std::printf("%-10s %8.1fMB %8.1fMB %8zu %8zu %8.3fms %8.3fms "
+                    "%8.3fms\n", modeNames[sparse],
+                    double(stats.virtualBytes) / (1024.0 * 1024.0),
+                    double(stats.residentBytes) / (1024.0 * 1024.0), loads,
+                    evicted, feedbackMs / FRAMES, updateMs / FRAMES,
+                    drawMs / FRAMES);
+        std::printf("  %zu pages resident, %zu requested, %zu loading\n",
+                    stats.residentPages, stats.requestedPages,
+                    stats.loadingPages);
+        feedbackTimer.destroy();
+        drawTimer.destroy();
+        glDeleteProgram(feedbackProgram);
+        glDeleteProgram(sampleProgram);
+        texture.destroy();
+    }
+
+    quad.destroy();
+    target.destroy();
+    std::filesystem::remove_all(directory);
+    glfwTerminate();
+    return 0;
+}
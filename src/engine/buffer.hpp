@@ -0,0 +1,71 @@
+#ifndef BUFFER_HPP
+#define BUFFER_HPP
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+/**
+ * GPU buffer created and written through Direct State Access (GL 4.5).
+ *
+ * None of the member functions touch GL_ARRAY_BUFFER or any other binding
+ * point, so buffers can be created and updated anywhere without disturbing
+ * whatever the draw code currently has bound.
+ */
+class Buffer {
+public:
+    // Contains buffer object ID (0 if not yet created)
+    unsigned int ID = 0;
+    // Size of the immutable storage in bytes
+    GLsizeiptr size = 0;
+
+    Buffer() = default;
+
+    /**
+     * Creates immutable buffer storage and optionally fills it
+     *
+     * @param size   size of the storage in bytes
+     * @param data   initial contents (may be NULL)
+     * @param flags  glNamedBufferStorage flags, dynamic by default so that
+     *               update() can be used
+     */
+    Buffer(GLsizeiptr size, const void* data,
+           GLbitfield flags = GL_DYNAMIC_STORAGE_BIT) : size(size) {
+        glCreateBuffers(1, &ID);
+        if (ID == 0) {
+            std::cout << "ERROR::BUFFER::CREATION_FAILED" << std::endl;
+            return;
+        }
+        glNamedBufferStorage(ID, size, data, flags);
+    }
+
+    // Convenience constructor for arrays with a size known at compile time
+    template <typename T, size_t N>
+    explicit Buffer(const T (&data)[N],
+                    GLbitfield flags = GL_DYNAMIC_STORAGE_BIT)
+        : Buffer(sizeof(data), data, flags) {}
+
+    /**
+     * Overwrites part of the buffer, requires GL_DYNAMIC_STORAGE_BIT
+     *
+     * @param offset  byte offset into the buffer
+     * @param bytes   number of bytes to write
+     * @param data    source of the new contents
+     */
+    void update(GLintptr offset, GLsizeiptr bytes, const void* data) const {
+        if (offset + bytes > size) {
+            std::cout << "ERROR::BUFFER::UPDATE_OUT_OF_RANGE" << std::endl;
+            return;
+        }
+        glNamedBufferSubData(ID, offset, bytes, data);
+    }
+
+    // Deletes the buffer object, the GL context must still be current
+    void destroy() {
+        glDeleteBuffers(1, &ID);
+        ID = 0;
+        size = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,651 @@
+#ifndef BUFFER_ALLOCATOR_HPP
+#define BUFFER_ALLOCATOR_HPP
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "buffer.hpp"
+#include "indirect_draw.hpp"
+#include "vertex_array.hpp"
+
+/**
+ * Suballocation of large GPU buffers, so many meshes share a few buffer
+ * objects and one vertex array per buffer instead of owning their own.
+ *
+ * TlsfAllocator manages offsets only (no GL), in units chosen by the
+ * caller. MeshBuffers uses one per arena buffer with vertices and indices
+ * as units: every range is then aligned to the vertex stride / index size
+ * by construction and is drawn with baseVertex/firstIndex, e.g. from
+ * drawCommand() in a multi-draw.
+ */
+
+/****************
+ * TLSF ALLOCATOR
+ ****************/
+
+/**
+ * Two-level segregated fit allocator (Masmano et al.): free blocks are
+ * kept in lists by size class, a first level per power of two split into
+ * 16 linear second level classes, with a bitmap per level so allocate()
+ * and free() are O(1). Neighbouring free blocks merge on free().
+ *
+ * allocate() rounds the request up to the next class boundary before the
+ * search, so any block in the list found is large enough (good fit, worst
+ * case waste below 1/16 of the size).
+ */
+class TlsfAllocator {
+public:
+    static const uint32_t NONE = UINT32_MAX;
+
+    /**
+     * Resets the allocator to one free block
+     *
+     * @param units  size of the managed range
+     */
+    void create(uint32_t units) {
+        capacity = units;
+        blocks.clear();
+        unusedBlocks.clear();
+        firstLevelBitmap = 0;
+        std::fill(std::begin(secondLevelBitmaps),
+                  std::end(secondLevelBitmaps), 0u);
+        std::fill(&heads[0][0], &heads[0][0] + FIRST_LEVELS * SECOND_LEVELS,
+                  NONE);
+        freeUnits = 0;
+        allocationCount = 0;
+        if (units == 0)
+            return;
+        uint32_t block = newBlock();
+        blocks[block].offset = 0;
+        blocks[block].size = units;
+        insertFree(block);
+    }
+
+    /**
+     * Allocates a range
+     *
+     * @param units   size of the range, at least 1
+     * @param offset  receives the start of the range
+     * @return block to pass to free(), NONE when nothing fits
+     */
+    uint32_t allocate(uint32_t units, uint32_t& offset) {
+        units = std::max(units, 1u);
+        // Round up to the class boundary so the class found always fits
+        uint32_t search = units;
+        if (search >= SMALL_SIZE) {
+            uint32_t round = (1u << (highestBit(search) - SECOND_LEVEL_LOG2))
+                - 1;
+            if (search > UINT32_MAX - round)
+                return NONE;
+            search += round;
+        }
+        uint32_t firstLevel, secondLevel;
+        mapping(search, firstLevel, secondLevel);
+        if (firstLevel >= FIRST_LEVELS)
+            return NONE;
+        uint32_t secondMap = secondLevelBitmaps[firstLevel] &
+            (~0u << secondLevel);
+        if (secondMap == 0) {
+            uint32_t firstMap = firstLevel + 1 < FIRST_LEVELS ?
+                firstLevelBitmap & (~0u << (firstLevel + 1)) : 0;
+            if (firstMap == 0)
+                return NONE;
+            firstLevel = lowestBit(firstMap);
+            secondMap = secondLevelBitmaps[firstLevel];
+        }
+        secondLevel = lowestBit(secondMap);
+        uint32_t block = heads[firstLevel][secondLevel];
+        removeFree(block);
+
+        // Return the tail end to the free lists
+        if (blocks[block].size > units) {
+            uint32_t rest = newBlock();
+            Block& used = blocks[block];
+            blocks[rest].offset = used.offset + units;
+            blocks[rest].size = used.size - units;
+            blocks[rest].previous = block;
+            blocks[rest].next = used.next;
+            if (used.next != NONE)
+                blocks[used.next].previous = rest;
+            used.next = rest;
+            used.size = units;
+            insertFree(rest);
+        }
+        ++allocationCount;
+        offset = blocks[block].offset;
+        return block;
+    }
+
+    // Frees a block from allocate(), merging it with free neighbours
+    void free(uint32_t block) {
+        --allocationCount;
+        uint32_t previous = blocks[block].previous;
+        if (previous != NONE && blocks[previous].free) {
+            removeFree(previous);
+            merge(previous, block);
+            block = previous;
+        }
+        uint32_t next = blocks[block].next;
+        if (next != NONE && blocks[next].free) {
+            removeFree(next);
+            merge(block, next);
+        }
+        insertFree(block);
+    }
+
+    uint32_t offset(uint32_t block) const {
+        return blocks[block].offset;
+    }
+
+    uint32_t size(uint32_t block) const {
+        return blocks[block].size;
+    }
+
+    uint32_t capacityUnits() const {
+        return capacity;
+    }
+
+    uint32_t freeUnitCount() const {
+        return freeUnits;
+    }
+
+    size_t allocations() const {
+        return allocationCount;
+    }
+
+    // Largest range allocate() can still return
+    uint32_t largestFree() const {
+        if (firstLevelBitmap == 0)
+            return 0;
+        uint32_t firstLevel = highestBit(firstLevelBitmap);
+        uint32_t secondLevel = highestBit(secondLevelBitmaps[firstLevel]);
+        uint32_t largest = 0;
+        for (uint32_t block = heads[firstLevel][secondLevel]; block != NONE;
+             block = blocks[block].nextFree)
+            largest = std::max(largest, blocks[block].size);
+        return largest;
+    }
+
+    // 1 - largest free / total free: 0 when the free space is one block
+    float fragmentation() const {
+        if (freeUnits == 0)
+            return 0.0f;
+        return 1.0f - float(largestFree()) / float(freeUnits);
+    }
+
+private:
+    // Sizes below 16 units map linearly into first level 0
+    static const uint32_t SECOND_LEVEL_LOG2 = 4;
+    static const uint32_t SECOND_LEVELS = 1u << SECOND_LEVEL_LOG2;
+    static const uint32_t SMALL_SIZE = SECOND_LEVELS;
+    static const uint32_t FIRST_LEVELS = 32 - SECOND_LEVEL_LOG2 + 1;
+
+    struct Block {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        // Neighbours in the range, NONE at the ends
+        uint32_t previous = NONE;
+        uint32_t next = NONE;
+        // Links of the free list of the block's size class
+        uint32_t previousFree = NONE;
+        uint32_t nextFree = NONE;
+        bool free = false;
+    };
+
+    std::vector<Block> blocks;
+    // Entries of blocks not in use, reused before growing
+    std::vector<uint32_t> unusedBlocks;
+    uint32_t firstLevelBitmap = 0;
+    uint32_t secondLevelBitmaps[FIRST_LEVELS] = {};
+    uint32_t heads[FIRST_LEVELS][SECOND_LEVELS];
+    uint32_t capacity = 0;
+    uint32_t freeUnits = 0;
+    size_t allocationCount = 0;
+
+    static uint32_t highestBit(uint32_t value) {
+        uint32_t bit = 0;
+        while (value >>= 1)
+            ++bit;
+        return bit;
+    }
+
+    static uint32_t lowestBit(uint32_t value) {
+        uint32_t bit = 0;
+        while (!(value & 1u)) {
+            value >>= 1;
+            ++bit;
+        }
+        return bit;
+    }
+
+    static void mapping(uint32_t size, uint32_t& firstLevel,
+                        uint32_t& secondLevel) {
+        if (size < SMALL_SIZE) {
+            firstLevel = 0;
+            secondLevel = size;
+            return;
+        }
+        uint32_t bit = highestBit(size);
+        firstLevel = bit - SECOND_LEVEL_LOG2 + 1;
+        secondLevel = (size >> (bit - SECOND_LEVEL_LOG2)) - SECOND_LEVELS;
+    }
+
+    uint32_t newBlock() {
+        if (!unusedBlocks.empty()) {
+            uint32_t block = unusedBlocks.back();
+            unusedBlocks.pop_back();
+            blocks[block] = Block();
+            return block;
+        }
+        blocks.push_back(Block());
+        return uint32_t(blocks.size() - 1);
+    }
+
+    void insertFree(uint32_t block) {
+        uint32_t firstLevel, secondLevel;
+        mapping(blocks[block].size, firstLevel, secondLevel);
+        uint32_t head = heads[firstLevel][secondLevel];
+        blocks[block].free = true;
+        blocks[block].previousFree = NONE;
+        blocks[block].nextFree = head;
+        if (head != NONE)
+            blocks[head].previousFree = block;
+        heads[firstLevel][secondLevel] = block;
+        firstLevelBitmap |= 1u << firstLevel;
+        secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+        freeUnits += blocks[block].size;
+    }
+
+    void removeFree(uint32_t block) {
+        Block& entry = blocks[block];
+        uint32_t firstLevel, secondLevel;
+        mapping(entry.size, firstLevel, secondLevel);
+        if (entry.previousFree != NONE)
+            blocks[entry.previousFree].nextFree = entry.nextFree;
+        else
+            heads[firstLevel][secondLevel] = entry.nextFree;
+        if (entry.nextFree != NONE)
+            blocks[entry.nextFree].previousFree = entry.previousFree;
+        if (heads[firstLevel][secondLevel] == NONE) {
+            secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+            if (secondLevelBitmaps[firstLevel] == 0)
+                firstLevelBitmap &= ~(1u << firstLevel);
+        }
+        entry.free = false;
+        freeUnits -= entry.size;
+    }
+
+    // Absorbs block into the one before it in the range
+    void merge(uint32_t previous, uint32_t block) {
+        blocks[previous].size += blocks[block].size;
+        blocks[previous].next = blocks[block].next;
+        if (blocks[block].next != NONE)
+            blocks[blocks[block].next].previous = previous;
+        unusedBlocks.push_back(block);
+    }
+};
+
+
+/****************
+ * MESH BUFFERS
+ ****************/
+
+// Where a mesh lives, for glDrawElementsBaseVertex or a DrawElements
+// indirect command
+struct MeshRange {
+    uint32_t arena = 0;
+    uint32_t firstVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+// index into MeshBuffers' entries, generation tells a freed and reused
+// entry's old handles apart
+struct MeshHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool valid() const {
+        return index != UINT32_MAX;
+    }
+};
+
+struct MeshBufferStats {
+    size_t arenas = 0;
+    size_t meshes = 0;
+    uint64_t vertexBytes = 0;
+    uint64_t vertexBytesUsed = 0;
+    uint64_t indexBytes = 0;
+    uint64_t indexBytesUsed = 0;
+    // Worst TlsfAllocator::fragmentation() over the arenas' buffers
+    float fragmentation = 0.0f;
+};
+
+/**
+ * Vertex and index arenas for meshes of one vertex layout. Arenas are
+ * immutable glNamedBufferStorage buffers (dynamic so ranges can be
+ * written), added when a mesh does not fit in the existing ones; each
+ * has one vertex array. Indices are 32-bit and relative to the mesh's
+ * first vertex.
+ *
+ * Draw every mesh of an arena with one bind() and a multi-draw of
+ * drawCommand()s. defragment() moves ranges, so ranges and commands taken
+ * before it (see version()) must be refreshed after.
+ */
+class MeshBuffers {
+public:
+    MeshBuffers() = default;
+    MeshBuffers(const MeshBuffers&) = delete;
+    MeshBuffers& operator=(const MeshBuffers&) = delete;
+
+    /**
+     * Sets the layout and arena sizes, no buffers are created yet
+     *
+     * @param arenaVertices  vertices per vertex arena
+     * @param arenaIndices   indices per index arena
+     */
+    template <typename Layout>
+    void create(uint32_t arenaVertices = 1u << 22,
+                uint32_t arenaIndices = 1u << 24) {
+        stride = Layout::stride;
+        applyLayout = [](const VertexArray& vertexArray) {
+            Layout::apply(vertexArray);
+        };
+        this->arenaVertices = arenaVertices;
+        this->arenaIndices = arenaIndices;
+    }
+
+    /**
+     * Reserves ranges for a mesh and optionally uploads it
+     *
+     * @param vertices     vertexCount vertices in the layout (may be NULL)
+     * @param indices      indexCount indices relative to the first vertex
+     *                     (may be NULL)
+     * @return handle, invalid if the mesh is larger than an arena can be
+     */
+    MeshHandle allocate(uint32_t vertexCount, uint32_t indexCount,
+                        const void* vertices = NULL,
+                        const uint32_t* indices = NULL) {
+        Mesh mesh;
+        bool placed = false;
+        for (uint32_t i = 0; i < arenas.size() && !placed; ++i)
+            placed = place(i, vertexCount, indexCount, mesh);
+        if (!placed) {
+            if (!addArena(std::max(arenaVertices, vertexCount),
+                          std::max(arenaIndices, indexCount)) ||
+                !place(uint32_t(arenas.size() - 1), vertexCount, indexCount,
+                       mesh)) {
+                std::cout << "ERROR::MESH_BUFFERS::ALLOCATION_FAILED" <<
+                    std::endl;
+                return MeshHandle();
+            }
+        }
+        MeshHandle handle;
+        if (freeMeshes.empty()) {
+            handle.index = uint32_t(meshes.size());
+            meshes.push_back(mesh);
+        } else {
+            handle.index = freeMeshes.back();
+            freeMeshes.pop_back();
+            mesh.generation = meshes[handle.index].generation;
+            meshes[handle.index] = mesh;
+        }
+        handle.generation = mesh.generation;
+        const Arena& arena = arenas[mesh.range.arena];
+        if (vertices != NULL)
+            arena.vertices.update(GLintptr(mesh.range.firstVertex) * stride,
+                                  GLsizeiptr(vertexCount) * stride, vertices);
+        if (indices != NULL)
+            arena.indices.update(GLintptr(mesh.range.firstIndex) *
+                                 sizeof(uint32_t),
+                                 GLsizeiptr(indexCount) * sizeof(uint32_t),
+                                 indices);
+        return handle;
+    }
+
+    // Whether a handle refers to a mesh that has not been freed
+    bool alive(MeshHandle handle) const {
+        return handle.valid() && handle.index < meshes.size() &&
+            meshes[handle.index].generation == handle.generation &&
+            meshes[handle.index].vertexBlock != TlsfAllocator::NONE;
+    }
+
+    // Releases a mesh's ranges, the buffers stay allocated. Stale and
+    // already freed handles are ignored
+    void free(MeshHandle handle) {
+        if (!alive(handle)) {
+            std::cout << "ERROR::MESH_BUFFERS::INVALID_HANDLE" << std::endl;
+            return;
+        }
+        Mesh& mesh = meshes[handle.index];
+        Arena& arena = arenas[mesh.range.arena];
+        arena.vertexAllocator.free(mesh.vertexBlock);
+        if (mesh.indexBlock != TlsfAllocator::NONE)
+            arena.indexAllocator.free(mesh.indexBlock);
+        uint32_t generation = mesh.generation + 1;
+        mesh = Mesh();
+        mesh.generation = generation;
+        freeMeshes.push_back(handle.index);
+    }
+
+    // Empty range for a handle that is not alive()
+    const MeshRange& range(MeshHandle handle) const {
+        static const MeshRange empty;
+        return alive(handle) ? meshes[handle.index].range : empty;
+    }
+
+    // Indirect command drawing a mesh, bind() its arena first
+    DrawElementsIndirectCommand drawCommand(MeshHandle handle,
+                                            uint32_t instanceCount = 1,
+                                            uint32_t baseInstance = 0) const {
+        const MeshRange& mesh = range(handle);
+        return { mesh.indexCount, instanceCount, mesh.firstIndex,
+                 int32_t(mesh.firstVertex), baseInstance };
+    }
+
+    // Binds an arena's vertex array
+    void bind(uint32_t arena) const {
+        arenas[arena].vertexArray.bind();
+    }
+
+    size_t arenaCount() const {
+        return arenas.size();
+    }
+
+    // Changes every time defragment() moves ranges
+    uint32_t version() const {
+        return currentVersion;
+    }
+
+    /**
+     * Compacts arenas whose vertex or index fragmentation is above a
+     * threshold: the live ranges are copied to fresh buffers in offset
+     * order on the GPU (glCopyNamedBufferSubData), then the old buffers
+     * are deleted
+     *
+     * @param threshold  fragmentation at which an arena is compacted
+     * @return bytes moved
+     */
+    uint64_t defragment(float threshold = 0.25f) {
+        uint64_t moved = 0;
+        for (uint32_t a = 0; a < arenas.size(); ++a) {
+            Arena& arena = arenas[a];
+            if (arena.vertexAllocator.fragmentation() <= threshold &&
+                arena.indexAllocator.fragmentation() <= threshold)
+                continue;
+            std::vector<uint32_t> vertexOrder, indexOrder;
+            for (uint32_t m = 0; m < meshes.size(); ++m) {
+                if (meshes[m].vertexBlock == TlsfAllocator::NONE ||
+                    meshes[m].range.arena != a)
+                    continue;
+                vertexOrder.push_back(m);
+                if (meshes[m].indexBlock != TlsfAllocator::NONE)
+                    indexOrder.push_back(m);
+            }
+            std::sort(vertexOrder.begin(), vertexOrder.end(),
+                      [this](uint32_t x, uint32_t y) {
+                          return meshes[x].range.firstVertex <
+                              meshes[y].range.firstVertex;
+                      });
+            std::sort(indexOrder.begin(), indexOrder.end(),
+                      [this](uint32_t x, uint32_t y) {
+                          return meshes[x].range.firstIndex <
+                              meshes[y].range.firstIndex;
+                      });
+
+            Buffer vertices(arena.vertices.size, NULL);
+            Buffer indices(arena.indices.size, NULL);
+            arena.vertexAllocator.create(arena.vertexAllocator
+                                         .capacityUnits());
+            arena.indexAllocator.create(arena.indexAllocator
+                                        .capacityUnits());
+            for (uint32_t m : vertexOrder) {
+                MeshRange& range = meshes[m].range;
+                uint32_t offset = 0;
+                meshes[m].vertexBlock = arena.vertexAllocator.allocate(
+                    range.vertexCount, offset);
+                GLsizeiptr bytes = GLsizeiptr(range.vertexCount) * stride;
+                glCopyNamedBufferSubData(arena.vertices.ID, vertices.ID,
+                                         GLintptr(range.firstVertex) *
+                                         stride, GLintptr(offset) * stride,
+                                         bytes);
+                range.firstVertex = offset;
+                moved += uint64_t(bytes);
+            }
+            for (uint32_t m : indexOrder) {
+                MeshRange& range = meshes[m].range;
+                uint32_t offset = 0;
+                meshes[m].indexBlock = arena.indexAllocator.allocate(
+                    range.indexCount, offset);
+                GLsizeiptr bytes = GLsizeiptr(range.indexCount) *
+                    GLsizeiptr(sizeof(uint32_t));
+                glCopyNamedBufferSubData(arena.indices.ID, indices.ID,
+                                         GLintptr(range.firstIndex) *
+                                         GLintptr(sizeof(uint32_t)),
+                                         GLintptr(offset) *
+                                         GLintptr(sizeof(uint32_t)), bytes);
+                range.firstIndex = offset;
+                moved += uint64_t(bytes);
+            }
+            arena.vertices.destroy();
+            arena.indices.destroy();
+            arena.vertices = vertices;
+            arena.indices = indices;
+            arena.vertexArray.setVertexBuffer(0, arena.vertices, 0, stride);
+            arena.vertexArray.setElementBuffer(arena.indices);
+        }
+        if (moved > 0)
+            ++currentVersion;
+        return moved;
+    }
+
+    MeshBufferStats stats() const {
+        MeshBufferStats result;
+        result.arenas = arenas.size();
+        result.meshes = meshes.size() - freeMeshes.size();
+        for (const Arena& arena : arenas) {
+            const TlsfAllocator& vertex = arena.vertexAllocator;
+            const TlsfAllocator& index = arena.indexAllocator;
+            result.vertexBytes += uint64_t(arena.vertices.size);
+            result.vertexBytesUsed += uint64_t(vertex.capacityUnits() -
+                                               vertex.freeUnitCount()) *
+                uint64_t(stride);
+            result.indexBytes += uint64_t(arena.indices.size);
+            result.indexBytesUsed += uint64_t(index.capacityUnits() -
+                                              index.freeUnitCount()) *
+                sizeof(uint32_t);
+            result.fragmentation = std::max({ result.fragmentation,
+                                              vertex.fragmentation(),
+                                              index.fragmentation() });
+        }
+        return result;
+    }
+
+    void destroy() {
+        for (Arena& arena : arenas) {
+            arena.vertexArray.destroy();
+            arena.vertices.destroy();
+            arena.indices.destroy();
+        }
+        arenas.clear();
+        meshes.clear();
+        freeMeshes.clear();
+    }
+
+private:
+    struct Arena {
+        Buffer vertices;
+        Buffer indices;
+        VertexArray vertexArray;
+        TlsfAllocator vertexAllocator;
+        TlsfAllocator indexAllocator;
+    };
+
+    struct Mesh {
+        MeshRange range;
+        // NONE for a free entry (vertex) or a mesh without indices
+        uint32_t vertexBlock = TlsfAllocator::NONE;
+        uint32_t indexBlock = TlsfAllocator::NONE;
+        // Bumped by free(), kept when the entry is reused
+        uint32_t generation = 0;
+    };
+
+    GLsizei stride = 0;
+    void (*applyLayout)(const VertexArray&) = NULL;
+    uint32_t arenaVertices = 0;
+    uint32_t arenaIndices = 0;
+    std::vector<Arena> arenas;
+    std::vector<Mesh> meshes;
+    std::vector<uint32_t> freeMeshes;
+    uint32_t currentVersion = 0;
+
+    bool addArena(uint32_t vertexCount, uint32_t indexCount) {
+        if (applyLayout == NULL) {
+            std::cout << "ERROR::MESH_BUFFERS::NOT_CREATED" << std::endl;
+            return false;
+        }
+        arenas.emplace_back();
+        Arena& arena = arenas.back();
+        arena.vertices = Buffer(GLsizeiptr(vertexCount) * stride, NULL);
+        arena.indices = Buffer(GLsizeiptr(indexCount) *
+                               GLsizeiptr(sizeof(uint32_t)), NULL);
+        arena.vertexArray.setVertexBuffer(0, arena.vertices, 0, stride);
+        arena.vertexArray.setElementBuffer(arena.indices);
+        applyLayout(arena.vertexArray);
+        arena.vertexAllocator.create(vertexCount);
+        arena.indexAllocator.create(indexCount);
+        return true;
+    }
+
+    // Both ranges in one arena, or neither
+    bool place(uint32_t index, uint32_t vertexCount, uint32_t indexCount,
+               Mesh& mesh) {
+        Arena& arena = arenas[index];
+        uint32_t firstVertex = 0, firstIndex = 0;
+        uint32_t vertexBlock = arena.vertexAllocator.allocate(vertexCount,
+                                                              firstVertex);
+        if (vertexBlock == TlsfAllocator::NONE)
+            return false;
+        uint32_t indexBlock = TlsfAllocator::NONE;
+        if (indexCount > 0) {
+            indexBlock = arena.indexAllocator.allocate(indexCount,
+                                                       firstIndex);
+            if (indexBlock == TlsfAllocator::NONE) {
+                arena.vertexAllocator.free(vertexBlock);
+                return false;
+            }
+        }
+        mesh.range = { index, firstVertex, vertexCount, firstIndex,
+                       indexCount };
+        mesh.vertexBlock = vertexBlock;
+        mesh.indexBlock = indexBlock;
+        return true;
+    }
+};
+
+#endif
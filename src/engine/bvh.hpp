@@ -0,0 +1,740 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "culling.hpp"
+#include "math.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+/**
+ * Bounding volume hierarchy over scene object boxes.
+ *
+ * The tree is built top down with a binned surface area heuristic (SAH).
+ * Large sets are split on the calling thread until there are enough
+ * independent subtrees, which are then built on worker threads. Every
+ * subtree owns a fixed range of a scratch array, so the result does not
+ * depend on the thread count.
+ *
+ * Nodes are 32 bytes and stored depth first: the left child of an internal
+ * node is the next node, so only the right child index is kept, and the
+ * primitives of a subtree are contiguous. Moving objects are handled with
+ * refit(), which keeps the topology and recomputes the boxes.
+ *
+ * Queries (frustum culling, ray casts for picking, box and sphere overlap
+ * for collision) walk the tree with a small stack, testing node boxes with
+ * Float4 (see simd.hpp).
+ */
+
+struct BvhNode {
+    float boundsMin[3];
+    // Internal: index of the right child, leaf: first primitive
+    uint32_t leftOrFirst;
+    float boundsMax[3];
+    // Primitives in a leaf, 0 for internal nodes
+    uint32_t count;
+
+    bool isLeaf() const { return count != 0; }
+};
+static_assert(sizeof(BvhNode) == 32, "BvhNode must stay 32 bytes");
+
+// Object box in leaf order
+struct BvhPrimitive {
+    Vec3 center;
+    uint32_t object;
+    Vec3 extent;
+};
+
+// Deepest tree build() produces, bounds the traversal stacks
+const int BVH_MAX_DEPTH = 64;
+// SAH cost of visiting a node relative to testing one primitive
+const float BVH_TRAVERSAL_COST = 1.0f;
+const uint32_t BVH_NO_HIT = ~0u;
+
+struct BvhBuildOptions {
+    // Worker threads, 0 uses every hardware thread
+    unsigned int threads = 0;
+    // Leaves are split beyond this even if SAH prefers a leaf
+    uint32_t maxLeafSize = 4;
+    // Subtrees below this size are never split up further between threads
+    uint32_t minTaskSize = 4096;
+};
+
+/**
+ * Ray for BVH queries. Distances are measured in multiples of direction,
+ * which therefore should be normalized for world unit results.
+ */
+struct Ray {
+    Vec3 origin;
+    Vec3 direction;
+    float maxDistance = FLT_MAX;
+};
+
+struct RayHit {
+    uint32_t object = BVH_NO_HIT;
+    float distance = FLT_MAX;
+};
+
+/**
+ * Ray through a cursor position, e.g. from glfwGetCursorPos
+ *
+ * @param cursorX         cursor x in window coordinates (origin top left)
+ * @param cursorY         cursor y in window coordinates
+ * @param width           window width
+ * @param height          window height
+ * @param viewProjection  camera projection * view
+ * @return ray from the near plane to the far plane, normalized direction
+ */
+inline Ray screenRay(double cursorX, double cursorY, int width, int height,
+                     const Mat4& viewProjection) {
+    float x = float(2.0 * cursorX / width - 1.0);
+    float y = float(1.0 - 2.0 * cursorY / height);
+    Mat4 inverseViewProjection = inverse(viewProjection);
+    Vec4 nearPoint = inverseViewProjection * Vec4(x, y, -1.0f, 1.0f);
+    Vec4 farPoint = inverseViewProjection * Vec4(x, y, 1.0f, 1.0f);
+    Vec3 origin = nearPoint.xyz() / nearPoint.w;
+    Vec3 span = farPoint.xyz() / farPoint.w - origin;
+    Ray ray;
+    ray.origin = origin;
+    ray.direction = normalize(span);
+    ray.maxDistance = length(span);
+    return ray;
+}
+
+/**
+ * Slab test of a ray against one box
+ *
+ * @return entry distance, FLT_MAX when the box is missed within
+ *         [0, maxDistance]
+ */
+inline float rayBoxDistance(const Ray& ray, Vec3 inverseDirection,
+                            Vec3 boxMin, Vec3 boxMax, float maxDistance) {
+    Vec3 t0 = (boxMin - ray.origin) * inverseDirection;
+    Vec3 t1 = (boxMax - ray.origin) * inverseDirection;
+    Vec3 tNear = minimum(t0, t1);
+    Vec3 tFar = maximum(t0, t1);
+    float entry = std::max(std::max(tNear.x, tNear.y),
+                           std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y),
+                          std::min(tFar.z, maxDistance));
+    return entry <= exit ? entry : FLT_MAX;
+}
+
+class Bvh {
+public:
+    std::vector<BvhNode> nodes;
+    std::vector<BvhPrimitive> primitives;
+
+    /**
+     * Builds the tree over every box, replacing the previous tree
+     *
+     * @param bounds   object boxes, primitive ids are indices into these
+     * @param options  leaf size and threading
+     */
+    void build(const BoundsSoA& bounds,
+               const BvhBuildOptions& options = BvhBuildOptions()) {
+        nodes.clear();
+        size_t count = bounds.size();
+        primitives.resize(count);
+        if (count == 0)
+            return;
+        unsigned int threads = resolveThreadCount(options.threads);
+        loadPrimitives(bounds, threads, true);
+
+        // Subtree of n primitives owns 2n - 1 scratch slots: itself, then
+        // its left subtree, then its right subtree
+        std::vector<BvhNode> scratch(2 * count - 1);
+        std::vector<BuildTask> pending, tasks;
+        pending.push_back({ 0, 0, uint32_t(count), 0 });
+        size_t taskSize = std::max<size_t>(options.minTaskSize,
+                                           count / (size_t(threads) * 8));
+        while (!pending.empty()) {
+            BuildTask task = pending.back();
+            pending.pop_back();
+            if (threads == 1 || task.last - task.first <= taskSize) {
+                tasks.push_back(task);
+                continue;
+            }
+            splitNode(scratch, task, options, pending);
+        }
+        parallelFor(tasks.size(), threads, [&](size_t i) {
+            std::vector<BuildTask> stack(1, tasks[i]);
+            while (!stack.empty()) {
+                BuildTask task = stack.back();
+                stack.pop_back();
+                splitNode(scratch, task, options, stack);
+            }
+        });
+        flatten(scratch);
+    }
+
+    /**
+     * Updates the boxes after objects moved, keeping the topology. Quality
+     * degrades as objects drift from where they were at build time, so
+     * rebuild once queries slow down.
+     *
+     * @param bounds   same objects as passed to build()
+     * @param threads  worker threads, 0 uses every hardware thread
+     */
+    void refit(const BoundsSoA& bounds, unsigned int threads = 0) {
+        if (nodes.empty())
+            return;
+        loadPrimitives(bounds, resolveThreadCount(threads), false);
+        // Children always follow their parent
+        for (size_t i = nodes.size(); i-- > 0;) {
+            BvhNode& node = nodes[i];
+            if (node.isLeaf()) {
+                Box box = primitiveBounds(node.leftOrFirst,
+                                          node.leftOrFirst + node.count);
+                setBounds(node, box.lower, box.upper);
+            } else {
+                const BvhNode& left = nodes[i + 1];
+                const BvhNode& right = nodes[node.leftOrFirst];
+                for (int axis = 0; axis < 3; ++axis) {
+                    node.boundsMin[axis] = std::min(left.boundsMin[axis],
+                                                    right.boundsMin[axis]);
+                    node.boundsMax[axis] = std::max(left.boundsMax[axis],
+                                                    right.boundsMax[axis]);
+                }
+            }
+        }
+    }
+
+    /**
+     * Frustum culls the objects. Subtrees entirely inside the frustum are
+     * accepted without testing their objects. Gives the same set as
+     * cullBounds() but not in object order.
+     *
+     * @param visible  receives visible object indices, needs room for every
+     *                 object
+     * @return number of visible objects
+     */
+    size_t cullFrustum(const Frustum& frustum, uint32_t* visible) const {
+        if (nodes.empty())
+            return 0;
+        PlaneSet planes(frustum);
+        size_t count = 0;
+        uint32_t stack[BVH_MAX_DEPTH];
+        int top = 0;
+        uint32_t index = 0;
+        while (true) {
+            const BvhNode& node = nodes[index];
+            Vec3 boundsMin(node.boundsMin[0], node.boundsMin[1],
+                           node.boundsMin[2]);
+            Vec3 boundsMax(node.boundsMax[0], node.boundsMax[1],
+                           node.boundsMax[2]);
+            int test = planes.classify((boundsMin + boundsMax) * 0.5f,
+                                       (boundsMax - boundsMin) * 0.5f);
+            if (test == PlaneSet::INSIDE) {
+                uint32_t first, last;
+                subtreePrimitives(index, first, last);
+                for (uint32_t p = first; p < last; ++p)
+                    visible[count++] = primitives[p].object;
+            } else if (test == PlaneSet::INTERSECTING) {
+                if (node.isLeaf()) {
+                    uint32_t last = node.leftOrFirst + node.count;
+                    for (uint32_t p = node.leftOrFirst; p < last; ++p) {
+                        const BvhPrimitive& primitive = primitives[p];
+                        visible[count] = primitive.object;
+                        count += planes.classify(primitive.center,
+                                                 primitive.extent) !=
+                            PlaneSet::OUTSIDE;
+                    }
+                } else {
+                    stack[top++] = node.leftOrFirst;
+                    index = index + 1;
+                    continue;
+                }
+            }
+            if (top == 0)
+                break;
+            index = stack[--top];
+        }
+        return count;
+    }
+
+    /**
+     * Finds the closest object hit by a ray
+     *
+     * @param test  float(uint32_t object, float boxDistance,
+     *              float maxDistance) returning the hit distance, or FLT_MAX
+     *              for a miss. Called for objects whose box the ray enters
+     *              (at boxDistance), e.g. to test the actual triangles.
+     */
+    template <typename Test>
+    RayHit intersectRay(const Ray& ray, const Test& test) const {
+        RayHit hit;
+        hit.distance = ray.maxDistance;
+        if (nodes.empty())
+            return hit;
+        Vec3 inverseDirection(safeInverse(ray.direction.x),
+                              safeInverse(ray.direction.y),
+                              safeInverse(ray.direction.z));
+        float origin[4] = { ray.origin.x, ray.origin.y, ray.origin.z, 0.0f };
+        float inverse[4] = { inverseDirection.x, inverseDirection.y,
+                             inverseDirection.z, 0.0f };
+        Float4 rayOrigin = Float4::load(origin);
+        Float4 rayInverse = Float4::load(inverse);
+
+        struct Entry {
+            uint32_t node;
+            float distance;
+        };
+        Entry stack[BVH_MAX_DEPTH];
+        int top = 0;
+        uint32_t index = 0;
+        if (nodeDistance(nodes[0], rayOrigin, rayInverse, hit.distance) ==
+            FLT_MAX)
+            return hit;
+        while (true) {
+            const BvhNode& node = nodes[index];
+            if (node.isLeaf()) {
+                uint32_t last = node.leftOrFirst + node.count;
+                for (uint32_t p = node.leftOrFirst; p < last; ++p) {
+                    const BvhPrimitive& primitive = primitives[p];
+                    float boxDistance = rayBoxDistance(
+                        ray, inverseDirection,
+                        primitive.center - primitive.extent,
+                        primitive.center + primitive.extent, hit.distance);
+                    if (boxDistance == FLT_MAX)
+                        continue;
+                    float distance = test(primitive.object, boxDistance,
+                                          hit.distance);
+                    if (distance < hit.distance) {
+                        hit.distance = distance;
+                        hit.object = primitive.object;
+                    }
+                }
+            } else {
+                // Visit the nearer child first, the other may be skipped
+                // once a closer hit is known
+                uint32_t nearChild = index + 1, farChild = node.leftOrFirst;
+                float nearDistance = nodeDistance(nodes[nearChild], rayOrigin,
+                                                  rayInverse, hit.distance);
+                float farDistance = nodeDistance(nodes[farChild], rayOrigin,
+                                                 rayInverse, hit.distance);
+                if (farDistance < nearDistance) {
+                    std::swap(nearChild, farChild);
+                    std::swap(nearDistance, farDistance);
+                }
+                if (nearDistance != FLT_MAX) {
+                    if (farDistance != FLT_MAX)
+                        stack[top++] = { farChild, farDistance };
+                    index = nearChild;
+                    continue;
+                }
+            }
+            bool found = false;
+            while (top > 0 && !found) {
+                Entry entry = stack[--top];
+                if (entry.distance < hit.distance) {
+                    index = entry.node;
+                    found = true;
+                }
+            }
+            if (!found)
+                break;
+        }
+        if (hit.object == BVH_NO_HIT)
+            hit.distance = FLT_MAX;
+        return hit;
+    }
+
+    // Finds the closest object box hit by a ray (picking by bounds)
+    RayHit intersectRay(const Ray& ray) const {
+        return intersectRay(ray, [](uint32_t, float boxDistance, float) {
+            return boxDistance;
+        });
+    }
+
+    /**
+     * Collects the objects whose box overlaps a box (collision broad phase)
+     *
+     * @param objects  overlapping object indices are appended
+     * @return number of objects appended
+     */
+    size_t overlapBox(Vec3 boxMin, Vec3 boxMax,
+                      std::vector<uint32_t>& objects) const {
+        float queryMin[4] = { boxMin.x, boxMin.y, boxMin.z, 0.0f };
+        float queryMax[4] = { boxMax.x, boxMax.y, boxMax.z, 0.0f };
+        Float4 minimumCorner = Float4::load(queryMin);
+        Float4 maximumCorner = Float4::load(queryMax);
+        Vec3 center = (boxMin + boxMax) * 0.5f;
+        Vec3 extent = (boxMax - boxMin) * 0.5f;
+        return collect(objects, [&](const BvhNode& node) {
+            // Separated on an axis (lane 3 holds leftOrFirst/count)
+            Float4 separated =
+                lessThan(Float4::load(node.boundsMax), minimumCorner) |
+                lessThan(maximumCorner, Float4::load(node.boundsMin));
+            return (separated.bitmask() & 7) == 0;
+        }, [&](const BvhPrimitive& primitive) {
+            Vec3 distance = primitive.center - center;
+            Vec3 reach = primitive.extent + extent;
+            return std::fabs(distance.x) <= reach.x &&
+                std::fabs(distance.y) <= reach.y &&
+                std::fabs(distance.z) <= reach.z;
+        });
+    }
+
+    /**
+     * Collects the objects whose box overlaps a sphere
+     *
+     * @param objects  overlapping object indices are appended
+     * @return number of objects appended
+     */
+    size_t overlapSphere(Vec3 center, float radius,
+                         std::vector<uint32_t>& objects) const {
+        float radiusSquared = radius * radius;
+        auto overlaps = [&](Vec3 boxMin, Vec3 boxMax) {
+            Vec3 closest = minimum(maximum(center, boxMin), boxMax);
+            Vec3 offset = closest - center;
+            return dot(offset, offset) <= radiusSquared;
+        };
+        return collect(objects, [&](const BvhNode& node) {
+            return overlaps(Vec3(node.boundsMin[0], node.boundsMin[1],
+                                 node.boundsMin[2]),
+                            Vec3(node.boundsMax[0], node.boundsMax[1],
+                                 node.boundsMax[2]));
+        }, [&](const BvhPrimitive& primitive) {
+            return overlaps(primitive.center - primitive.extent,
+                            primitive.center + primitive.extent);
+        });
+    }
+
+    /**
+     * SAH cost of the tree relative to its root area, lower is better.
+     * Useful to decide when refitted trees should be rebuilt.
+     */
+    float sahCost() const {
+        if (nodes.empty())
+            return 0.0f;
+        float cost = 0.0f;
+        for (const BvhNode& node : nodes) {
+            float area = halfArea(node);
+            cost += node.isLeaf() ? area * float(node.count) :
+                area * BVH_TRAVERSAL_COST;
+        }
+        return cost / halfArea(nodes[0]);
+    }
+
+private:
+    static const int BIN_COUNT = 16;
+
+    struct BuildTask {
+        uint32_t slot;
+        uint32_t first;
+        uint32_t last;
+        int depth;
+    };
+
+    struct Box {
+        Vec3 lower = Vec3(FLT_MAX);
+        Vec3 upper = Vec3(-FLT_MAX);
+
+        void grow(Vec3 boxMin, Vec3 boxMax) {
+            lower = minimum(lower, boxMin);
+            upper = maximum(upper, boxMax);
+        }
+        float halfArea() const {
+            Vec3 size = upper - lower;
+            return size.x * size.y + size.y * size.z + size.z * size.x;
+        }
+    };
+
+    // Frustum planes in lanes (5 and 6 repeated in the padding lanes)
+    struct PlaneSet {
+        static const int OUTSIDE = 0;
+        static const int INTERSECTING = 1;
+        static const int INSIDE = 2;
+
+        Float4 nx[2], ny[2], nz[2], nw[2], ax[2], ay[2], az[2];
+
+        explicit PlaneSet(const Frustum& frustum) {
+            for (int group = 0; group < 2; ++group) {
+                float x[4], y[4], z[4], w[4], absX[4], absY[4], absZ[4];
+                for (int lane = 0; lane < 4; ++lane) {
+                    int p = std::min(group * 4 + lane, 4 + lane % 2);
+                    const Vec4& plane = frustum.planes[p];
+                    x[lane] = plane.x;
+                    y[lane] = plane.y;
+                    z[lane] = plane.z;
+                    w[lane] = plane.w;
+                    absX[lane] = std::fabs(plane.x);
+                    absY[lane] = std::fabs(plane.y);
+                    absZ[lane] = std::fabs(plane.z);
+                }
+                nx[group] = Float4::load(x);
+                ny[group] = Float4::load(y);
+                nz[group] = Float4::load(z);
+                nw[group] = Float4::load(w);
+                ax[group] = Float4::load(absX);
+                ay[group] = Float4::load(absY);
+                az[group] = Float4::load(absZ);
+            }
+        }
+
+        // Same arithmetic as cullBounds() so leaf results match it exactly
+        int classify(Vec3 center, Vec3 extent) const {
+            Float4 cx = Float4::splat(center.x);
+            Float4 cy = Float4::splat(center.y);
+            Float4 cz = Float4::splat(center.z);
+            Float4 ex = Float4::splat(extent.x);
+            Float4 ey = Float4::splat(extent.y);
+            Float4 ez = Float4::splat(extent.z);
+            Float4 zero = Float4::splat(0.0f);
+            Float4 outside = lessThan(zero, zero);
+            Float4 crossing = outside;
+            for (int group = 0; group < 2; ++group) {
+                Float4 distance = madd(nz[group], cz,
+                                       madd(ny[group], cy,
+                                            madd(nx[group], cx, nw[group])));
+                Float4 radius = madd(az[group], ez,
+                                     madd(ay[group], ey, ax[group] * ex));
+                outside = outside | lessThan(distance + radius, zero);
+                crossing = crossing | lessThan(distance - radius, zero);
+            }
+            if (outside.bitmask())
+                return OUTSIDE;
+            return crossing.bitmask() ? INTERSECTING : INSIDE;
+        }
+    };
+
+    static float safeInverse(float value) {
+        const float tiny = 1e-20f;
+        if (std::fabs(value) < tiny)
+            value = value < 0.0f ? -tiny : tiny;
+        return 1.0f / value;
+    }
+
+    static float halfArea(const BvhNode& node) {
+        float x = node.boundsMax[0] - node.boundsMin[0];
+        float y = node.boundsMax[1] - node.boundsMin[1];
+        float z = node.boundsMax[2] - node.boundsMin[2];
+        return x * y + y * z + z * x;
+    }
+
+    static void setBounds(BvhNode& node, Vec3 boundsMin, Vec3 boundsMax) {
+        node.boundsMin[0] = boundsMin.x;
+        node.boundsMin[1] = boundsMin.y;
+        node.boundsMin[2] = boundsMin.z;
+        node.boundsMax[0] = boundsMax.x;
+        node.boundsMax[1] = boundsMax.y;
+        node.boundsMax[2] = boundsMax.z;
+    }
+
+    // Entry distance of a ray into a node box, lane 3 is ignored
+    static float nodeDistance(const BvhNode& node, Float4 origin,
+                              Float4 inverseDirection, float maxDistance) {
+        Float4 t0 = (Float4::load(node.boundsMin) - origin) *
+            inverseDirection;
+        Float4 t1 = (Float4::load(node.boundsMax) - origin) *
+            inverseDirection;
+        float tNear[4], tFar[4];
+        minimum(t0, t1).store(tNear);
+        maximum(t0, t1).store(tFar);
+        float entry = std::max(std::max(tNear[0], tNear[1]),
+                               std::max(tNear[2], 0.0f));
+        float exit = std::min(std::min(tFar[0], tFar[1]),
+                              std::min(tFar[2], maxDistance));
+        return entry <= exit ? entry : FLT_MAX;
+    }
+
+    // Copies boxes into the primitives, in object order on build and in
+    // leaf order on refit
+    void loadPrimitives(const BoundsSoA& bounds, unsigned int threads,
+                        bool initial) {
+        const size_t batch = 64 * 1024;
+        size_t count = primitives.size();
+        parallelFor((count + batch - 1) / batch, threads, [&](size_t b) {
+            size_t last = std::min(count, (b + 1) * batch);
+            for (size_t p = b * batch; p < last; ++p) {
+                BvhPrimitive& primitive = primitives[p];
+                size_t i = initial ? p : primitive.object;
+                primitive.center = Vec3(bounds.centerX[i], bounds.centerY[i],
+                                        bounds.centerZ[i]);
+                primitive.extent = Vec3(bounds.extentX[i], bounds.extentY[i],
+                                        bounds.extentZ[i]);
+                primitive.object = uint32_t(i);
+            }
+        });
+    }
+
+    Box primitiveBounds(uint32_t first, uint32_t last) const {
+        Box box;
+        for (uint32_t p = first; p < last; ++p)
+            box.grow(primitives[p].center - primitives[p].extent,
+                     primitives[p].center + primitives[p].extent);
+        return box;
+    }
+
+    /**
+     * Makes the task's slot a leaf, or partitions its primitives with the
+     * best binned SAH split and pushes both children
+     */
+    void splitNode(std::vector<BvhNode>& scratch, const BuildTask& task,
+                   const BvhBuildOptions& options,
+                   std::vector<BuildTask>& children) {
+        BvhNode& node = scratch[task.slot];
+        uint32_t count = task.last - task.first;
+        Box box = primitiveBounds(task.first, task.last);
+        Box centroids;
+        for (uint32_t p = task.first; p < task.last; ++p)
+            centroids.grow(primitives[p].center, primitives[p].center);
+        setBounds(node, box.lower, box.upper);
+        node.leftOrFirst = task.first;
+        node.count = count;
+        if (count == 1 || task.depth >= BVH_MAX_DEPTH - 1)
+            return;
+
+        float bestCost = FLT_MAX;
+        int bestAxis = -1, bestBin = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            float low = (&centroids.lower.x)[axis];
+            float high = (&centroids.upper.x)[axis];
+            if (high <= low)
+                continue;
+            float binScale = float(BIN_COUNT) / (high - low);
+            Box bins[BIN_COUNT];
+            uint32_t binCounts[BIN_COUNT] = {};
+            for (uint32_t p = task.first; p < task.last; ++p) {
+                const BvhPrimitive& primitive = primitives[p];
+                int bin = binOf((&primitive.center.x)[axis], low, binScale);
+                bins[bin].grow(primitive.center - primitive.extent,
+                               primitive.center + primitive.extent);
+                ++binCounts[bin];
+            }
+            // Sweep from the right, then from the left evaluating splits
+            float rightCost[BIN_COUNT];
+            Box right;
+            uint32_t rightCount = 0;
+            for (int bin = BIN_COUNT - 1; bin > 0; --bin) {
+                right.grow(bins[bin].lower, bins[bin].upper);
+                rightCount += binCounts[bin];
+                rightCost[bin] = rightCount ?
+                    right.halfArea() * float(rightCount) : 0.0f;
+            }
+            Box left;
+            uint32_t leftCount = 0;
+            for (int bin = 1; bin < BIN_COUNT; ++bin) {
+                left.grow(bins[bin - 1].lower, bins[bin - 1].upper);
+                leftCount += binCounts[bin - 1];
+                if (leftCount == 0 || leftCount == count)
+                    continue;
+                float cost = left.halfArea() * float(leftCount) +
+                    rightCost[bin];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = bin;
+                }
+            }
+        }
+
+        float leafCost = box.halfArea() * float(count);
+        float splitCost = box.halfArea() * BVH_TRAVERSAL_COST + bestCost;
+        if (count <= options.maxLeafSize &&
+            (bestAxis < 0 || splitCost >= leafCost))
+            return;
+
+        uint32_t middle;
+        if (bestAxis < 0) {
+            // Every centroid in one spot, any split is as good
+            middle = task.first + count / 2;
+        } else {
+            float low = (&centroids.lower.x)[bestAxis];
+            float binScale = float(BIN_COUNT) /
+                ((&centroids.upper.x)[bestAxis] - low);
+            BvhPrimitive* split = std::partition(
+                primitives.data() + task.first, primitives.data() + task.last,
+                [&](const BvhPrimitive& primitive) {
+                    return binOf((&primitive.center.x)[bestAxis], low,
+                                 binScale) < bestBin;
+                });
+            middle = uint32_t(split - primitives.data());
+        }
+        node.leftOrFirst = task.slot + 2 * (middle - task.first);
+        node.count = 0;
+        children.push_back({ node.leftOrFirst, middle, task.last,
+                             task.depth + 1 });
+        children.push_back({ task.slot + 1, task.first, middle,
+                             task.depth + 1 });
+    }
+
+    static int binOf(float centroid, float low, float binScale) {
+        int bin = int((centroid - low) * binScale);
+        return std::min(std::max(bin, 0), BIN_COUNT - 1);
+    }
+
+    // Copies the reachable scratch slots into nodes in depth first order
+    void flatten(const std::vector<BvhNode>& scratch) {
+        const uint32_t NO_PARENT = ~0u;
+        struct Entry {
+            uint32_t slot;
+            uint32_t parent;
+        };
+        std::vector<Entry> stack(1, Entry { 0, NO_PARENT });
+        nodes.reserve(scratch.size());
+        while (!stack.empty()) {
+            Entry entry = stack.back();
+            stack.pop_back();
+            uint32_t index = uint32_t(nodes.size());
+            if (entry.parent != NO_PARENT)
+                nodes[entry.parent].leftOrFirst = index;
+            nodes.push_back(scratch[entry.slot]);
+            if (!nodes.back().isLeaf()) {
+                stack.push_back({ scratch[entry.slot].leftOrFirst, index });
+                stack.push_back({ entry.slot + 1, NO_PARENT });
+            }
+        }
+        nodes.shrink_to_fit();
+    }
+
+    // Primitive range of the subtree rooted at a node
+    void subtreePrimitives(uint32_t index, uint32_t& first,
+                           uint32_t& last) const {
+        uint32_t leftmost = index, rightmost = index;
+        while (!nodes[leftmost].isLeaf())
+            ++leftmost;
+        while (!nodes[rightmost].isLeaf())
+            rightmost = nodes[rightmost].leftOrFirst;
+        first = nodes[leftmost].leftOrFirst;
+        last = nodes[rightmost].leftOrFirst + nodes[rightmost].count;
+    }
+
+    // Depth first walk appending the objects accepted by both tests
+    template <typename NodeTest, typename PrimitiveTest>
+    size_t collect(std::vector<uint32_t>& objects, const NodeTest& nodeTest,
+                   const PrimitiveTest& primitiveTest) const {
+        size_t start = objects.size();
+        if (nodes.empty())
+            return 0;
+        uint32_t stack[BVH_MAX_DEPTH];
+        int top = 0;
+        uint32_t index = 0;
+        while (true) {
+            const BvhNode& node = nodes[index];
+            if (nodeTest(node)) {
+                if (!node.isLeaf()) {
+                    stack[top++] = node.leftOrFirst;
+                    index = index + 1;
+                    continue;
+                }
+                uint32_t last = node.leftOrFirst + node.count;
+                for (uint32_t p = node.leftOrFirst; p < last; ++p)
+                    if (primitiveTest(primitives[p]))
+                        objects.push_back(primitives[p].object);
+            }
+            if (top == 0)
+                break;
+            index = stack[--top];
+        }
+        return objects.size() - start;
+    }
+};
+
+#endif
@@ -0,0 +1,424 @@
+#ifndef COMMAND_BUFFER_HPP
+#define COMMAND_BUFFER_HPP
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+/**
+ * Deferred GL command recording.
+ *
+ * GL calls have to come from the thread owning the context, but deciding
+ * what to draw does not. Worker threads record commands (binds, uniforms,
+ * draws) into a CommandBuffer each, as a compact stream of 32-bit words,
+ * and the render thread replays every buffer of a CommandQueue.
+ *
+ * Recording is split into segments with a sort key (e.g. the index of the
+ * first object a job handled); replay runs segments in key order whatever
+ * thread recorded them, so the GL stream is the same for any thread count
+ * or scheduling. Binds that don't change state are dropped while recording
+ * a segment and again across segments on replay.
+ */
+
+enum CommandOpcode {
+    COMMAND_BIND_PROGRAM,
+    COMMAND_BIND_VERTEX_ARRAY,
+    COMMAND_BIND_TEXTURE,
+    COMMAND_BIND_BUFFER_BASE,
+    COMMAND_UNIFORM_1I,
+    COMMAND_UNIFORM_1F,
+    COMMAND_UNIFORM_4F,
+    COMMAND_UNIFORM_MATRIX_4F,
+    COMMAND_DRAW_ARRAYS,
+    COMMAND_DRAW_ELEMENTS
+};
+
+// Texture units whose bindings are tracked to drop redundant binds
+const GLuint COMMAND_TRACKED_TEXTURE_UNITS = 16;
+
+struct CommandReplayStats {
+    size_t segments = 0;
+    size_t commands = 0;
+    size_t draws = 0;
+    // Binds dropped on replay because the state was already set
+    size_t skippedBinds = 0;
+};
+
+/****************
+ * COMMAND BUFFER
+ ****************/
+
+// Commands recorded by one thread, aligned so buffers don't share lines
+class alignas(64) CommandBuffer {
+public:
+    CommandBuffer() {
+        forgetState();
+    }
+
+    /**
+     * Starts a segment, commands up to the next segment replay together
+     *
+     * @param key  replay position, lower first (keys should be unique, ties
+     *             fall back to recording thread and order)
+     */
+    void beginSegment(uint64_t key) {
+        endSegment();
+        segments.push_back({ key, words.size(), words.size() });
+        // State at the start of a segment is unknown until replay
+        forgetState();
+    }
+
+    void bindProgram(GLuint id) {
+        openSegment();
+        if (program == id)
+            return;
+        program = id;
+        emit(COMMAND_BIND_PROGRAM, 1);
+        words.push_back(id);
+    }
+
+    void bindVertexArray(GLuint id) {
+        openSegment();
+        if (vertexArray == id)
+            return;
+        vertexArray = id;
+        emit(COMMAND_BIND_VERTEX_ARRAY, 1);
+        words.push_back(id);
+    }
+
+    void bindTexture(GLuint unit, GLuint texture) {
+        openSegment();
+        if (unit < COMMAND_TRACKED_TEXTURE_UNITS) {
+            if (textures[unit] == texture)
+                return;
+            textures[unit] = texture;
+        }
+        emit(COMMAND_BIND_TEXTURE, 2);
+        words.push_back(unit);
+        words.push_back(texture);
+    }
+
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+        emit(COMMAND_BIND_BUFFER_BASE, 3);
+        words.push_back(target);
+        words.push_back(index);
+        words.push_back(buffer);
+    }
+
+    // Uniforms apply to the program bound at replay
+    void uniform1i(GLint location, GLint value) {
+        emit(COMMAND_UNIFORM_1I, 2);
+        words.push_back(uint32_t(location));
+        words.push_back(uint32_t(value));
+    }
+
+    void uniform1f(GLint location, float value) {
+        emit(COMMAND_UNIFORM_1F, 2);
+        words.push_back(uint32_t(location));
+        pushFloats(&value, 1);
+    }
+
+    void uniform4f(GLint location, float x, float y, float z, float w) {
+        const float values[4] = { x, y, z, w };
+        emit(COMMAND_UNIFORM_4F, 5);
+        words.push_back(uint32_t(location));
+        pushFloats(values, 4);
+    }
+
+    // Column major, as Mat4::data()
+    void uniformMatrix4(GLint location, const float* matrix) {
+        emit(COMMAND_UNIFORM_MATRIX_4F, 17);
+        words.push_back(uint32_t(location));
+        pushFloats(matrix, 16);
+    }
+
+    void drawArrays(GLenum mode, GLint first, GLsizei count,
+                    GLsizei instanceCount = 1, GLuint baseInstance = 0) {
+        emit(COMMAND_DRAW_ARRAYS, 5);
+        words.push_back(mode);
+        words.push_back(uint32_t(first));
+        words.push_back(uint32_t(count));
+        words.push_back(uint32_t(instanceCount));
+        words.push_back(baseInstance);
+    }
+
+    // 32-bit indices from the bound vertex array's element buffer
+    void drawElements(GLenum mode, GLsizei count, GLuint firstIndex,
+                      GLint baseVertex = 0, GLsizei instanceCount = 1,
+                      GLuint baseInstance = 0) {
+        emit(COMMAND_DRAW_ELEMENTS, 6);
+        words.push_back(mode);
+        words.push_back(uint32_t(count));
+        words.push_back(firstIndex);
+        words.push_back(uint32_t(baseVertex));
+        words.push_back(uint32_t(instanceCount));
+        words.push_back(baseInstance);
+    }
+
+    // Drops every command, keeps the memory
+    void reset() {
+        words.clear();
+        segments.clear();
+        commands = 0;
+        forgetState();
+    }
+
+    size_t sizeBytes() const {
+        return words.size() * sizeof(uint32_t);
+    }
+
+    size_t commandCount() const {
+        return commands;
+    }
+
+private:
+    friend class CommandQueue;
+
+    static constexpr GLuint UNKNOWN = 0xffffffffu;
+
+    struct Segment {
+        uint64_t key;
+        size_t first;
+        size_t end;
+    };
+
+    std::vector<uint32_t> words;
+    std::vector<Segment> segments;
+    size_t commands = 0;
+    // Recorded state in the current segment
+    GLuint program = UNKNOWN;
+    GLuint vertexArray = UNKNOWN;
+    GLuint textures[COMMAND_TRACKED_TEXTURE_UNITS];
+
+    void forgetState() {
+        program = vertexArray = UNKNOWN;
+        std::fill(textures, textures + COMMAND_TRACKED_TEXTURE_UNITS,
+                  UNKNOWN);
+    }
+
+    // Commands before the first beginSegment() go in segment 0, opened
+    // before any redundancy check so it can't see the last segment's state
+    void openSegment() {
+        if (segments.empty())
+            beginSegment(0);
+    }
+
+    // Header word: opcode in the low byte, payload words above
+    void emit(CommandOpcode opcode, uint32_t payloadWords) {
+        openSegment();
+        words.push_back(uint32_t(opcode) | payloadWords << 8);
+        ++commands;
+    }
+
+    void pushFloats(const float* values, size_t count) {
+        size_t first = words.size();
+        words.resize(first + count);
+        std::memcpy(&words[first], values, count * sizeof(float));
+    }
+
+    void endSegment() {
+        if (!segments.empty())
+            segments.back().end = words.size();
+    }
+};
+
+
+/****************
+ * COMMAND QUEUE
+ ****************/
+
+/**
+ * One CommandBuffer per recording thread (e.g. per JobSystem thread, see
+ * JobSystem::currentSlot()) and the replay of all of them.
+ */
+class CommandQueue {
+public:
+    CommandQueue() = default;
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    /**
+     * @param threads  number of recording threads
+     */
+    void create(size_t threads) {
+        buffers.assign(threads, CommandBuffer());
+    }
+
+    // Buffer of one thread, only that thread may record into it
+    CommandBuffer& buffer(size_t thread) {
+        return buffers[thread];
+    }
+
+    size_t threadCount() const {
+        return buffers.size();
+    }
+
+    // Clears every buffer for the next frame
+    void reset() {
+        for (CommandBuffer& buffer : buffers)
+            buffer.reset();
+    }
+
+    size_t sizeBytes() const {
+        size_t bytes = 0;
+        for (const CommandBuffer& buffer : buffers)
+            bytes += buffer.sizeBytes();
+        return bytes;
+    }
+
+    /**
+     * Render thread: issues every recorded command, segments in key order.
+     * Recording must have finished.
+     */
+    CommandReplayStats replay() {
+        CommandReplayStats stats;
+        sortSegments();
+
+        // GL state is unknown before the first command
+        GLuint program = CommandBuffer::UNKNOWN;
+        GLuint vertexArray = CommandBuffer::UNKNOWN;
+        GLuint textures[COMMAND_TRACKED_TEXTURE_UNITS];
+        std::fill(textures, textures + COMMAND_TRACKED_TEXTURE_UNITS,
+                  CommandBuffer::UNKNOWN);
+        for (const SegmentRef& ref : order) {
+            const CommandBuffer& buffer = buffers[ref.buffer];
+            const CommandBuffer::Segment& segment =
+                buffer.segments[ref.segment];
+            const uint32_t* word = buffer.words.data() + segment.first;
+            const uint32_t* end = buffer.words.data() + segment.end;
+            ++stats.segments;
+            while (word < end) {
+                CommandOpcode opcode = CommandOpcode(*word & 0xff);
+                uint32_t size = *word >> 8;
+                const uint32_t* p = word + 1;
+                word = p + size;
+                ++stats.commands;
+                switch (opcode) {
+                case COMMAND_BIND_PROGRAM:
+                    if (program == p[0]) {
+                        ++stats.skippedBinds;
+                        break;
+                    }
+                    program = p[0];
+                    glUseProgram(p[0]);
+                    break;
+                case COMMAND_BIND_VERTEX_ARRAY:
+                    if (vertexArray == p[0]) {
+                        ++stats.skippedBinds;
+                        break;
+                    }
+                    vertexArray = p[0];
+                    glBindVertexArray(p[0]);
+                    break;
+                case COMMAND_BIND_TEXTURE:
+                    if (p[0] < COMMAND_TRACKED_TEXTURE_UNITS) {
+                        if (textures[p[0]] == p[1]) {
+                            ++stats.skippedBinds;
+                            break;
+                        }
+                        textures[p[0]] = p[1];
+                    }
+                    glBindTextureUnit(p[0], p[1]);
+                    break;
+                case COMMAND_BIND_BUFFER_BASE:
+                    glBindBufferBase(p[0], p[1], p[2]);
+                    break;
+                case COMMAND_UNIFORM_1I:
+                    glUniform1i(GLint(p[0]), GLint(p[1]));
+                    break;
+                case COMMAND_UNIFORM_1F:
+                    glUniform1f(GLint(p[0]), readFloat(p + 1));
+                    break;
+                case COMMAND_UNIFORM_4F:
+                    glUniform4f(GLint(p[0]), readFloat(p + 1),
+                                readFloat(p + 2), readFloat(p + 3),
+                                readFloat(p + 4));
+                    break;
+                case COMMAND_UNIFORM_MATRIX_4F: {
+                    float matrix[16];
+                    std::memcpy(matrix, p + 1, sizeof(matrix));
+                    glUniformMatrix4fv(GLint(p[0]), 1, GL_FALSE, matrix);
+                    break;
+                }
+                case COMMAND_DRAW_ARRAYS:
+                    glDrawArraysInstancedBaseInstance(
+                        p[0], GLint(p[1]), GLsizei(p[2]), GLsizei(p[3]),
+                        p[4]);
+                    ++stats.draws;
+                    break;
+                case COMMAND_DRAW_ELEMENTS:
+                    glDrawElementsInstancedBaseVertexBaseInstance(
+                        p[0], GLsizei(p[1]), GL_UNSIGNED_INT,
+                        reinterpret_cast<const void*>(
+                            size_t(p[2]) * sizeof(uint32_t)),
+                        GLsizei(p[4]), GLint(p[3]), p[5]);
+                    ++stats.draws;
+                    break;
+                default:
+                    std::cout << "ERROR::COMMAND_QUEUE::BAD_OPCODE " <<
+                        opcode << std::endl;
+                    return stats;
+                }
+            }
+        }
+        return stats;
+    }
+
+    /**
+     * Hash of the command stream in replay order, equal streams give equal
+     * hashes whatever threads recorded them (for checking determinism)
+     */
+    uint64_t hash() {
+        // FNV-1a over the words
+        uint64_t value = 14695981039346656037ull;
+        sortSegments();
+        for (const SegmentRef& ref : order) {
+            const CommandBuffer& buffer = buffers[ref.buffer];
+            const CommandBuffer::Segment& segment =
+                buffer.segments[ref.segment];
+            for (size_t w = segment.first; w < segment.end; ++w)
+                value = (value ^ buffer.words[w]) * 1099511628211ull;
+        }
+        return value;
+    }
+
+private:
+    struct SegmentRef {
+        uint64_t key;
+        size_t buffer;
+        size_t segment;
+    };
+
+    std::vector<CommandBuffer> buffers;
+    std::vector<SegmentRef> order;
+
+    // Every segment of every buffer, in replay order
+    void sortSegments() {
+        order.clear();
+        for (size_t b = 0; b < buffers.size(); ++b) {
+            buffers[b].endSegment();
+            for (size_t s = 0; s < buffers[b].segments.size(); ++s)
+                order.push_back({ buffers[b].segments[s].key, b, s });
+        }
+        std::sort(order.begin(), order.end(),
+                  [](const SegmentRef& a, const SegmentRef& c) {
+                      if (a.key != c.key)
+                          return a.key < c.key;
+                      if (a.buffer != c.buffer)
+                          return a.buffer < c.buffer;
+                      return a.segment < c.segment;
+                  });
+    }
+
+    static float readFloat(const uint32_t* word) {
+        float value;
+        std::memcpy(&value, word, sizeof(value));
+        return value;
+    }
+};
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef CULLING_HPP
+#define CULLING_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "job_system.hpp"
+#include "math.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+/**
+ * Frustum culling over structure-of-arrays bounding boxes.
+ *
+ * Boxes are stored as centre and half extent arrays so SIMD_WIDTH objects
+ * (8 with AVX2) are tested against a plane with a handful of multiply-adds.
+ * Visible objects are compacted into a list of object indices in their
+ * original order, which the renderer then walks to submit draws. Large
+ * sets can be split over worker threads with cullBoundsParallel(), started
+ * per call or taken from a JobSystem.
+ */
+
+// Six planes (left, right, bottom, top, near, far), inside is dot >= 0
+struct Frustum {
+    Vec4 planes[6];
+};
+
+/**
+ * Extracts the frustum planes of a projection * view matrix (Gribb and
+ * Hartmann). Planes are normalized so distances are in world units.
+ */
+inline Frustum extractFrustum(const Mat4& viewProjection) {
+    Vec4 rows[4];
+    for (int r = 0; r < 4; ++r)
+        rows[r] = Vec4(viewProjection.at(r, 0), viewProjection.at(r, 1),
+                       viewProjection.at(r, 2), viewProjection.at(r, 3));
+    Frustum frustum;
+    for (int axis = 0; axis < 3; ++axis) {
+        frustum.planes[axis * 2] = rows[3] + rows[axis];
+        frustum.planes[axis * 2 + 1] = rows[3] - rows[axis];
+    }
+    for (Vec4& plane : frustum.planes) {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y +
+                                 plane.z * plane.z);
+        if (length > 0.0f)
+            plane = plane * (1.0f / length);
+    }
+    return frustum;
+}
+
+// Axis aligned bounding boxes, one array per component
+class BoundsSoA {
+public:
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    size_t size() const {
+        return centerX.size();
+    }
+
+    void reserve(size_t count) {
+        for (std::vector<float>* array : arrays())
+            array->reserve(count);
+    }
+
+    /**
+     * Appends a box
+     *
+     * @param center  box centre
+     * @param extent  half size on each axis (use the radius for spheres)
+     * @return index of the new object
+     */
+    size_t add(Vec3 center, Vec3 extent) {
+        centerX.push_back(center.x);
+        centerY.push_back(center.y);
+        centerZ.push_back(center.z);
+        extentX.push_back(extent.x);
+        extentY.push_back(extent.y);
+        extentZ.push_back(extent.z);
+        return size() - 1;
+    }
+
+    void set(size_t i, Vec3 center, Vec3 extent) {
+        centerX[i] = center.x;
+        centerY[i] = center.y;
+        centerZ[i] = center.z;
+        extentX[i] = extent.x;
+        extentY[i] = extent.y;
+        extentZ[i] = extent.z;
+    }
+
+    void clear() {
+        for (std::vector<float>* array : arrays())
+            array->clear();
+    }
+
+private:
+    std::vector<std::vector<float>*> arrays() {
+        return { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ };
+    }
+};
+
+// Returns whether one box is at least partly inside the frustum
+inline bool boxInFrustum(const Frustum& frustum, Vec3 center, Vec3 extent) {
+    for (const Vec4& plane : frustum.planes) {
+        float distance = plane.x * center.x + plane.y * center.y +
+            plane.z * center.z + plane.w;
+        float radius = std::fabs(plane.x) * extent.x +
+            std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+        if (distance + radius < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Scalar reference version of cullBounds(), one object at a time
+ */
+inline size_t cullBoundsScalar(const Frustum& frustum,
+                               const BoundsSoA& bounds, size_t first,
+                               size_t last, uint32_t* visible) {
+    size_t count = 0;
+    for (size_t i = first; i < last; ++i) {
+        Vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+        Vec3 extent(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+        if (boxInFrustum(frustum, center, extent))
+            visible[count++] = uint32_t(i);
+    }
+    return count;
+}
+
+/**
+ * Culls the objects in [first, last) SIMD_WIDTH at a time
+ *
+ * @param frustum  planes from extractFrustum()
+ * @param bounds   object bounds
+ * @param visible  receives the indices of visible objects in order, needs
+ *                 room for last - first entries
+ * @return number of visible objects written
+ */
+inline size_t cullBounds(const Frustum& frustum, const BoundsSoA& bounds,
+                         size_t first, size_t last, uint32_t* visible) {
+    FloatWide nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; ++p) {
+        const Vec4& plane = frustum.planes[p];
+        nx[p] = FloatWide::splat(plane.x);
+        ny[p] = FloatWide::splat(plane.y);
+        nz[p] = FloatWide::splat(plane.z);
+        nw[p] = FloatWide::splat(plane.w);
+        ax[p] = FloatWide::splat(std::fabs(plane.x));
+        ay[p] = FloatWide::splat(std::fabs(plane.y));
+        az[p] = FloatWide::splat(std::fabs(plane.z));
+    }
+    const FloatWide zero = FloatWide::splat(0.0f);
+    const int allLanes = (1 << SIMD_WIDTH) - 1;
+
+    size_t count = 0;
+    size_t i = first;
+    size_t vectorLast = last - (last - first) % SIMD_WIDTH;
+    for (; i < vectorLast; i += SIMD_WIDTH) {
+        FloatWide cx = FloatWide::load(&bounds.centerX[i]);
+        FloatWide cy = FloatWide::load(&bounds.centerY[i]);
+        FloatWide cz = FloatWide::load(&bounds.centerZ[i]);
+        FloatWide ex = FloatWide::load(&bounds.extentX[i]);
+        FloatWide ey = FloatWide::load(&bounds.extentY[i]);
+        FloatWide ez = FloatWide::load(&bounds.extentZ[i]);
+        FloatWide outside = lessThan(zero, zero);
+        for (int p = 0; p < 6; ++p) {
+            FloatWide distance = madd(nz[p], cz,
+                                      madd(ny[p], cy, madd(nx[p], cx, nw[p])));
+            FloatWide radius = madd(az[p], ez, madd(ay[p], ey, ax[p] * ex));
+            outside = outside | lessThan(distance + radius, zero);
+        }
+        int mask = ~outside.bitmask() & allLanes;
+        // Branchless compaction: always write, only advance when visible
+        for (size_t lane = 0; lane < SIMD_WIDTH; ++lane) {
+            visible[count] = uint32_t(i + lane);
+            count += size_t(mask >> lane) & 1;
+        }
+    }
+    return count + cullBoundsScalar(frustum, bounds, i, last,
+                                    visible + count);
+}
+
+/**
+ * Culls every object, splitting the work into batches over worker threads.
+ * The result is identical to cullBounds() over the whole range.
+ *
+ * @param visible  receives the visible indices, needs room for every object
+ * @param threads  worker threads, 0 uses every hardware thread
+ * @param batch    objects per task, rounded to a multiple of SIMD_WIDTH
+ * @return number of visible objects
+ */
+inline size_t cullBoundsParallel(const Frustum& frustum,
+                                 const BoundsSoA& bounds, uint32_t* visible,
+                                 unsigned int threads = 0,
+                                 size_t batch = 64 * 1024) {
+    size_t objects = bounds.size();
+    batch = (batch + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    size_t batches = (objects + batch - 1) / batch;
+    if (batches <= 1 || resolveThreadCount(threads) == 1)
+        return cullBounds(frustum, bounds, 0, objects, visible);
+
+    // Each batch culls into its own slice, then the slices are packed
+    std::vector<size_t> counts(batches);
+    parallelFor(batches, threads, [&](size_t b) {
+        size_t first = b * batch;
+        size_t last = first + batch < objects ? first + batch : objects;
+        counts[b] = cullBounds(frustum, bounds, first, last, visible + first);
+    });
+    size_t count = counts[0];
+    for (size_t b = 1; b < batches; ++b) {
+        std::memmove(visible + count, visible + b * batch,
+                     counts[b] * sizeof(uint32_t));
+        count += counts[b];
+    }
+    return count;
+}
+
+/**
+ * cullBoundsParallel() with the batches run as jobs, callable from a job
+ *
+ * @param jobs   job system the calling thread belongs to
+ * @param batch  objects per job, rounded to a multiple of SIMD_WIDTH
+ */
+inline size_t cullBoundsParallel(const Frustum& frustum,
+                                 const BoundsSoA& bounds, uint32_t* visible,
+                                 JobSystem& jobs, size_t batch = 16 * 1024) {
+    size_t objects = bounds.size();
+    batch = (batch + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    size_t batches = (objects + batch - 1) / batch;
+    if (batches <= 1 || jobs.threadCount() <= 1)
+        return cullBounds(frustum, bounds, 0, objects, visible);
+
+    std::vector<size_t> counts(batches);
+    jobs.parallelFor(batches, 1, [&](size_t b, size_t) {
+        size_t first = b * batch;
+        size_t last = first + batch < objects ? first + batch : objects;
+        counts[b] = cullBounds(frustum, bounds, first, last, visible + first);
+    });
+    size_t count = counts[0];
+    for (size_t b = 1; b < batches; ++b) {
+        std::memmove(visible + count, visible + b * batch,
+                     counts[b] * sizeof(uint32_t));
+        count += counts[b];
+    }
+    return count;
+}
+
+#endif
@@ -0,0 +1,322 @@
+#ifndef FRAME_ARENA_HPP
+#define FRAME_ARENA_HPP
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+/**
+ * Per-frame linear allocation for transient CPU data (command packets,
+ * visible lists, formatted strings).
+ *
+ * LinearArena bumps a pointer through one block and frees everything at
+ * once in reset(). It is a std::pmr::memory_resource, so std::pmr
+ * containers allocate from it directly:
+ *
+ *   std::pmr::vector<uint32_t> visible(&frameArenas.current());
+ *
+ * Individual deallocations are ignored, reserve() containers up front so
+ * growth doesn't leave dead copies behind. When a frame needs more than
+ * the block, overflow chunks come from the heap and the next reset() grows
+ * the block past the high water mark, so once the heaviest frame has been
+ * seen the hot path makes no heap allocations at all (see
+ * heapAllocationCount()).
+ */
+
+/****************
+ * HEAP COUNTER
+ ****************/
+
+// Global operator new calls made by the program, maintained only when one
+// source file defines HEAP_COUNTER_IMPLEMENTATION before including this
+inline std::atomic<uint64_t> heapAllocations { 0 };
+
+inline uint64_t heapAllocationCount() {
+    return heapAllocations.load(std::memory_order_relaxed);
+}
+
+#ifdef HEAP_COUNTER_IMPLEMENTATION
+// Replacements count and forward to malloc, the other forms (nothrow,
+// arrays) are defined by the library in terms of these
+void* operator new(std::size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+// MSVC has no std::aligned_alloc, its aligned blocks come from
+// _aligned_malloc and must go back through _aligned_free
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    std::size_t align = std::max(std::size_t(alignment), sizeof(void*));
+    std::size_t bytes = std::max(size, std::size_t(1));
+#ifdef _WIN32
+    if (void* pointer = _aligned_malloc(bytes, align))
+        return pointer;
+#else
+    if (void* pointer = std::aligned_alloc(align, (bytes + align - 1) /
+                                           align * align))
+        return pointer;
+#endif
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void operator delete(void* pointer, std::size_t,
+                     std::align_val_t alignment) noexcept {
+    operator delete(pointer, alignment);
+}
+#endif
+
+
+/****************
+ * LINEAR ARENA
+ ****************/
+
+class LinearArena : public std::pmr::memory_resource {
+public:
+    LinearArena() = default;
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    /**
+     * Allocates the block
+     *
+     * @param bytes  starting size, grows to the high water mark on reset()
+     */
+    void create(size_t bytes) {
+        capacity = std::max(bytes, size_t(64));
+        block.reset(new unsigned char[capacity]);
+        head = 0;
+        highWater = 0;
+        overflow.clear();
+        overflowBytes = 0;
+        spillHead = spillSize = 0;
+    }
+
+    /**
+     * Bump allocates, never returns NULL (overflows to the heap)
+     *
+     * @param bytes      size of the allocation
+     * @param alignment  power of two
+     */
+    void* allocate(size_t bytes,
+                   size_t alignment = alignof(std::max_align_t)) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+        size_t start = ((base + head + alignment - 1) & ~(alignment - 1)) -
+            base;
+        if (block && start + bytes <= capacity) {
+            head = start + bytes;
+            return block.get() + start;
+        }
+        // Rare: bump through heap chunks until reset() grows the block
+        if (overflow.empty() || spillHead + bytes + alignment > spillSize) {
+            spillSize = std::max(bytes + alignment, capacity);
+            overflow.emplace_back(new unsigned char[spillSize]);
+            spillHead = 0;
+        }
+        uintptr_t spill = reinterpret_cast<uintptr_t>(overflow.back().get());
+        size_t spillStart = ((spill + spillHead + alignment - 1) &
+                             ~(alignment - 1)) - spill;
+        overflowBytes += spillStart + bytes - spillHead;
+        spillHead = spillStart + bytes;
+        return overflow.back().get() + spillStart;
+    }
+
+    // Array of T, uninitialised
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // printf into the arena, the string lives until reset()
+    const char* format(const char* pattern, ...) {
+        va_list arguments, copy;
+        va_start(arguments, pattern);
+        va_copy(copy, arguments);
+        int length = std::vsnprintf(NULL, 0, pattern, copy);
+        va_end(copy);
+        char* text = allocateArray<char>(size_t(std::max(length, 0)) + 1);
+        std::vsnprintf(text, size_t(std::max(length, 0)) + 1, pattern,
+                       arguments);
+        va_end(arguments);
+        return text;
+    }
+
+    // Frees everything allocated since the last reset
+    void reset() {
+        size_t used = head + overflowBytes;
+        highWater = std::max(highWater, used);
+        if (!overflow.empty()) {
+            // Grow past the high water mark so the next frame fits
+            capacity = highWater + highWater / 2;
+            block.reset(new unsigned char[capacity]);
+            overflow.clear();
+        }
+        head = 0;
+        overflowBytes = 0;
+        spillHead = spillSize = 0;
+    }
+
+    /**
+     * Grows the block to at least a size, only between reset() and the
+     * first allocation of a frame
+     */
+    void reserve(size_t bytes) {
+        if (bytes <= capacity || head != 0)
+            return;
+        capacity = bytes;
+        block.reset(new unsigned char[capacity]);
+    }
+
+    size_t used() const {
+        return head + overflowBytes;
+    }
+
+    size_t size() const {
+        return capacity;
+    }
+
+    size_t highWaterMark() const {
+        return std::max(highWater, used());
+    }
+
+    void destroy() {
+        block.reset();
+        overflow.clear();
+        capacity = head = highWater = overflowBytes = 0;
+        spillHead = spillSize = 0;
+    }
+
+private:
+    std::unique_ptr<unsigned char[]> block;
+    size_t capacity = 0;
+    size_t head = 0;
+    size_t highWater = 0;
+    std::vector<std::unique_ptr<unsigned char[]>> overflow;
+    size_t overflowBytes = 0;
+    // Bump position in, and size of, the last overflow chunk
+    size_t spillHead = 0;
+    size_t spillSize = 0;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const
+        noexcept override {
+        return this == &other;
+    }
+};
+
+
+/****************
+ * FRAME ARENAS
+ ****************/
+
+// Frames the CPU may run ahead of the GPU
+const int FRAMES_IN_FLIGHT = 3;
+
+/**
+ * One arena per frame in flight. beginFrame() moves to the next arena and
+ * resets it; when the frame that last used it ended with a fence (e.g.
+ * because the GPU reads from memory it points into), it waits for the
+ * fence first.
+ */
+template <int Count = FRAMES_IN_FLIGHT>
+class FrameArenas {
+public:
+    FrameArenas() = default;
+    FrameArenas(const FrameArenas&) = delete;
+    FrameArenas& operator=(const FrameArenas&) = delete;
+
+    /**
+     * @param bytes  starting size of each arena
+     */
+    void create(size_t bytes) {
+        for (LinearArena& arena : arenas)
+            arena.create(bytes);
+        index = Count - 1;
+        highWater = 0;
+    }
+
+    // Starts a frame, returns its arena
+    LinearArena& beginFrame() {
+        index = (index + 1) % Count;
+        if (fences[index]) {
+            glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT,
+                             GL_TIMEOUT_IGNORED);
+            glDeleteSync(fences[index]);
+            fences[index] = NULL;
+        }
+        arenas[index].reset();
+        // Frames are alike, so every arena grows to the largest one seen
+        highWater = std::max(highWater, arenas[index].highWaterMark());
+        arenas[index].reserve(highWater + highWater / 2);
+        return arenas[index];
+    }
+
+    /**
+     * Ends the frame
+     *
+     * @param fence  signalled when the GPU is done with this frame's data,
+     *               owned by the arenas from now on (NULL for CPU only
+     *               data)
+     */
+    void endFrame(GLsync fence = NULL) {
+        fences[index] = fence;
+    }
+
+    LinearArena& current() {
+        return arenas[index];
+    }
+
+    void destroy() {
+        for (int i = 0; i < Count; ++i) {
+            if (fences[i])
+                glDeleteSync(fences[i]);
+            fences[i] = NULL;
+            arenas[i].destroy();
+        }
+    }
+
+private:
+    LinearArena arenas[Count];
+    GLsync fences[Count] = {};
+    int index = 0;
+    size_t highWater = 0;
+};
+
+#endif
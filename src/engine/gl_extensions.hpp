@@ -0,0 +1,107 @@
+#ifndef GL_EXTENSIONS_HPP
+#define GL_EXTENSIONS_HPP
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+/**
+ * Extensions used by the engine that the generated GLAD loader (core
+ * profile only) does not cover: enums are defined here and support is
+ * checked at runtime with hasGlExtension(). Extension functions follow
+ * GLAD's conventions (a GLAD_GL_* flag, glad_gl* pointers behind gl*
+ * macros) and are loaded by loadGlExtensions() after gladLoadGLLoader().
+ */
+
+// EXT_texture_compression_s3tc and EXT_texture_sRGB (BC1-BC3)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// ARB_bindless_texture
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(
+    GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(
+    GLuint64 handle);
+inline int GLAD_GL_ARB_bindless_texture = 0;
+inline PFNGLGETTEXTUREHANDLEARBPROC glad_glGetTextureHandleARB = NULL;
+inline PFNGLMAKETEXTUREHANDLERESIDENTARBPROC
+    glad_glMakeTextureHandleResidentARB = NULL;
+inline PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC
+    glad_glMakeTextureHandleNonResidentARB = NULL;
+#define glGetTextureHandleARB glad_glGetTextureHandleARB
+#define glMakeTextureHandleResidentARB glad_glMakeTextureHandleResidentARB
+#define glMakeTextureHandleNonResidentARB \
+    glad_glMakeTextureHandleNonResidentARB
+
+// ARB_sparse_texture
+#ifndef GL_TEXTURE_SPARSE_ARB
+#define GL_VIRTUAL_PAGE_SIZE_X_ARB 0x9195
+#define GL_VIRTUAL_PAGE_SIZE_Y_ARB 0x9196
+#define GL_TEXTURE_SPARSE_ARB 0x91A6
+#define GL_VIRTUAL_PAGE_SIZE_INDEX_ARB 0x91A7
+#define GL_NUM_VIRTUAL_PAGE_SIZES_ARB 0x91A8
+#define GL_NUM_SPARSE_LEVELS_ARB 0x91AA
+#endif
+typedef void (APIENTRYP PFNGLTEXPAGECOMMITMENTARBPROC)(
+    GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+    GLsizei width, GLsizei height, GLsizei depth, GLboolean commit);
+inline int GLAD_GL_ARB_sparse_texture = 0;
+inline PFNGLTEXPAGECOMMITMENTARBPROC glad_glTexPageCommitmentARB = NULL;
+#define glTexPageCommitmentARB glad_glTexPageCommitmentARB
+
+/**
+ * Whether the current context exposes an extension
+ *
+ * @param name  full name, e.g. "GL_EXT_texture_compression_s3tc"
+ */
+inline bool hasGlExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* extension = reinterpret_cast<const char*>(
+            glGetStringi(GL_EXTENSIONS, GLuint(i)));
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Sets the GLAD_GL_* flags above and loads the functions of the supported
+ * extensions, call once after gladLoadGLLoader()
+ *
+ * @param load  the loader given to GLAD, e.g. glfwGetProcAddress
+ */
+inline void loadGlExtensions(GLADloadproc load) {
+    GLAD_GL_ARB_bindless_texture = 0;
+    if (hasGlExtension("GL_ARB_bindless_texture")) {
+        glad_glGetTextureHandleARB = (PFNGLGETTEXTUREHANDLEARBPROC)
+            load("glGetTextureHandleARB");
+        glad_glMakeTextureHandleResidentARB =
+            (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)
+            load("glMakeTextureHandleResidentARB");
+        glad_glMakeTextureHandleNonResidentARB =
+            (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)
+            load("glMakeTextureHandleNonResidentARB");
+        GLAD_GL_ARB_bindless_texture = glad_glGetTextureHandleARB &&
+            glad_glMakeTextureHandleResidentARB &&
+            glad_glMakeTextureHandleNonResidentARB;
+    }
+    GLAD_GL_ARB_sparse_texture = 0;
+    if (hasGlExtension("GL_ARB_sparse_texture")) {
+        glad_glTexPageCommitmentARB = (PFNGLTEXPAGECOMMITMENTARBPROC)
+            load("glTexPageCommitmentARB");
+        GLAD_GL_ARB_sparse_texture = glad_glTexPageCommitmentARB != NULL;
+    }
+}
+
+#endif
@@ -0,0 +1,461 @@
+#ifndef GPU_CULLING_HPP
+#define GPU_CULLING_HPP
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "buffer.hpp"
+#include "culling.hpp"
+#include "hiz.hpp"
+#include "indirect_draw.hpp"
+#include "math.hpp"
+#include "meshlet.hpp"
+#include "program.hpp"
+#include "vertex_array.hpp"
+
+/**
+ * GPU driven culling.
+ *
+ * Object bounds and per-object draw commands live in SSBOs. Each frame a
+ * compute pass tests every object against the frustum and appends the
+ * commands of visible objects to a command buffer, counting them in a
+ * parameter buffer. The CPU then submits the whole scene with one
+ * glMultiDrawElementsIndirectCount call and never reads the result back.
+ *
+ * Without GL 4.6 (e.g. Mesa llvmpipe at 4.5) the command buffer is cleared
+ * to zero before culling and all slots are drawn with
+ * glMultiDrawElementsIndirect, empty commands drawing nothing.
+ *
+ * Given a DepthPyramid built from the previous frame, objects inside the
+ * frustum are also tested for occlusion (see hiz.hpp). Objects given a
+ * normal cone (e.g. meshlets, see meshlet.hpp) are first tested for facing
+ * away from the eye. The pass counts objects rejected by each test for
+ * frame stats.
+ */
+
+// std430 object bounds, matches ObjectBounds in GPU_CULL_GLSL
+struct GpuBounds {
+    float center[4];
+    float extent[4];
+};
+
+// std430 normal cone, matches ObjectCone in GPU_CULL_GLSL
+struct GpuCone {
+    float sphere[4];        // center xyz, radius w
+    float axis[4];          // axis xyz, cutoff w
+};
+
+// Compute pass work group size, matches local_size_x in GPU_CULL_GLSL
+const GLuint GPU_CULL_GROUP_SIZE = 64;
+
+// Shader storage bindings used by the cull pass and by draw shaders
+const GLuint GPU_CULL_BOUNDS_BINDING = 0;
+const GLuint GPU_CULL_DRAWS_BINDING = 1;
+const GLuint GPU_CULL_COMMANDS_BINDING = 2;
+const GLuint GPU_CULL_COUNT_BINDING = 3;
+const GLuint GPU_CULL_CONES_BINDING = 4;
+// Texture unit the depth pyramid is bound to during the cull pass
+const GLuint GPU_CULL_PYRAMID_UNIT = 0;
+
+// Contents of the count buffer, drawCount doubles as the indirect count
+struct GpuCullCounters {
+    GLuint drawCount;
+    GLuint frustumCulled;
+    GLuint occlusionCulled;
+    GLuint coneCulled;
+};
+
+// Per frame culling results
+struct GpuCullStats {
+    GLuint visible = 0;
+    GLuint frustumCulled = 0;
+    GLuint occlusionCulled = 0;
+    GLuint coneCulled = 0;
+    // GPU time of the latest depth pyramid build (see DepthPyramid)
+    double pyramidBuildMs = 0.0;
+};
+
+/**
+ * Culling compute shader. Visible objects reserve their command slots, and
+ * culled objects are counted, with one atomic per work group rather than
+ * one per object.
+ */
+const char* const GPU_CULL_GLSL =
+    "#version 450 core\n"
+    "layout (local_size_x = 64) in;\n"
+    "struct ObjectBounds { vec4 center; vec4 extent; };\n"
+    "struct ObjectCone { vec4 sphere; vec4 axis; };\n"
+    "struct DrawCommand {\n"
+    "    uint count;\n"
+    "    uint instanceCount;\n"
+    "    uint firstIndex;\n"
+    "    int baseVertex;\n"
+    "    uint baseInstance;\n"
+    "};\n"
+    "layout (std430, binding = 0) readonly buffer BoundsBuffer {\n"
+    "    ObjectBounds bounds[];\n"
+    "};\n"
+    "layout (std430, binding = 1) readonly buffer DrawBuffer {\n"
+    "    DrawCommand draws[];\n"
+    "};\n"
+    "layout (std430, binding = 2) writeonly buffer CommandBuffer {\n"
+    "    DrawCommand commands[];\n"
+    "};\n"
+    "layout (std430, binding = 3) buffer CountBuffer {\n"
+    "    uint drawCount;\n"
+    "    uint frustumCulled;\n"
+    "    uint occlusionCulled;\n"
+    "    uint coneCulled;\n"
+    "};\n"
+    "layout (std430, binding = 4) readonly buffer ConeBuffer {\n"
+    "    ObjectCone cones[];\n"
+    "};\n"
+    "layout (binding = 0) uniform sampler2D uPyramid;\n"
+    "uniform vec4 uPlanes[6];\n"
+    "uniform uint uObjectCount;\n"
+    "uniform bool uOcclusion;\n"
+    "uniform bool uConeCulling;\n"
+    "uniform vec3 uEye;\n"
+    "uniform mat4 uPyramidViewProjection;\n"
+    "uniform vec2 uPyramidSize;\n"
+    "uniform float uPyramidMaxLevel;\n"
+    "shared uint groupCount;\n"
+    "shared uint groupBase;\n"
+    "shared uint groupFrustumCulled;\n"
+    "shared uint groupOcclusionCulled;\n"
+    "shared uint groupConeCulled;\n"
+    "bool isBackfacing(uint object) {\n"
+    "    vec4 sphere = cones[object].sphere;\n"
+    "    vec4 axis = cones[object].axis;\n"
+    "    vec3 offset = sphere.xyz - uEye;\n"
+    "    return dot(offset, axis.xyz) >= axis.w * length(offset) + sphere.w;\n"
+    "}\n"
+    "bool inFrustum(vec3 center, vec3 extent) {\n"
+    "    for (int p = 0; p < 6; ++p) {\n"
+    "        float distance = dot(uPlanes[p].xyz, center) + uPlanes[p].w;\n"
+    "        float radius = dot(abs(uPlanes[p].xyz), extent);\n"
+    "        if (distance + radius < 0.0)\n"
+    "            return false;\n"
+    "    }\n"
+    "    return true;\n"
+    "}\n"
+    "bool isOccluded(vec3 center, vec3 extent) {\n"
+    "    vec2 rectMin = vec2(1.0);\n"
+    "    vec2 rectMax = vec2(0.0);\n"
+    "    float nearest = 1.0;\n"
+    "    for (int i = 0; i < 8; ++i) {\n"
+    "        vec3 corner = vec3((i & 1) != 0 ? 1.0 : -1.0,\n"
+    "                           (i & 2) != 0 ? 1.0 : -1.0,\n"
+    "                           (i & 4) != 0 ? 1.0 : -1.0);\n"
+    "        vec4 clip = uPyramidViewProjection *\n"
+    "            vec4(center + corner * extent, 1.0);\n"
+    "        if (clip.w <= 0.0)\n"
+    "            return false;\n"
+    "        vec3 ndc = clip.xyz / clip.w;\n"
+    "        rectMin = min(rectMin, ndc.xy * 0.5 + 0.5);\n"
+    "        rectMax = max(rectMax, ndc.xy * 0.5 + 0.5);\n"
+    "        nearest = min(nearest, ndc.z * 0.5 + 0.5);\n"
+    "    }\n"
+    "    rectMin = clamp(rectMin, 0.0, 1.0);\n"
+    "    rectMax = clamp(rectMax, 0.0, 1.0);\n"
+    "    vec2 size = (rectMax - rectMin) * uPyramidSize;\n"
+    "    float level = min(ceil(log2(max(max(size.x, size.y), 1.0))),\n"
+    "                      uPyramidMaxLevel);\n"
+    "    float farthest = max(\n"
+    "        max(textureLod(uPyramid, rectMin, level).r,\n"
+    "            textureLod(uPyramid, vec2(rectMax.x, rectMin.y), level).r),\n"
+    "        max(textureLod(uPyramid, vec2(rectMin.x, rectMax.y), level).r,\n"
+    "            textureLod(uPyramid, rectMax, level).r));\n"
+    "    return nearest > farthest;\n"
+    "}\n"
+    "void main() {\n"
+    "    if (gl_LocalInvocationIndex == 0) {\n"
+    "        groupCount = 0;\n"
+    "        groupFrustumCulled = 0;\n"
+    "        groupOcclusionCulled = 0;\n"
+    "        groupConeCulled = 0;\n"
+    "    }\n"
+    "    barrier();\n"
+    "    uint object = gl_GlobalInvocationID.x;\n"
+    "    bool visible = false;\n"
+    "    if (object < uObjectCount) {\n"
+    "        vec3 center = bounds[object].center.xyz;\n"
+    "        vec3 extent = bounds[object].extent.xyz;\n"
+    "        if (uConeCulling && isBackfacing(object))\n"
+    "            atomicAdd(groupConeCulled, 1);\n"
+    "        else if (!inFrustum(center, extent))\n"
+    "            atomicAdd(groupFrustumCulled, 1);\n"
+    "        else if (uOcclusion && isOccluded(center, extent))\n"
+    "            atomicAdd(groupOcclusionCulled, 1);\n"
+    "        else\n"
+    "            visible = true;\n"
+    "    }\n"
+    "    uint local = visible ? atomicAdd(groupCount, 1) : 0;\n"
+    "    barrier();\n"
+    "    if (gl_LocalInvocationIndex == 0) {\n"
+    "        groupBase = atomicAdd(drawCount, groupCount);\n"
+    "        atomicAdd(frustumCulled, groupFrustumCulled);\n"
+    "        atomicAdd(occlusionCulled, groupOcclusionCulled);\n"
+    "        atomicAdd(coneCulled, groupConeCulled);\n"
+    "    }\n"
+    "    barrier();\n"
+    "    if (visible) {\n"
+    "        DrawCommand command = draws[object];\n"
+    "        command.baseInstance = object;\n"
+    "        commands[groupBase + local] = command;\n"
+    "    }\n"
+    "}\n";
+
+class GpuCuller {
+public:
+    GLsizei maxObjects = 0;
+    GLsizei objectCount = 0;
+    Buffer bounds;
+    Buffer draws;
+    Buffer commands;
+    Buffer count;
+    // Normal cones, only read once setCones() was called
+    Buffer cones;
+    // 0 .. maxObjects-1, read through an instanced attribute so baseInstance
+    // selects the object (gl_BaseInstance needs GL 4.6)
+    Buffer objectIds;
+    unsigned int program = 0;
+
+    /**
+     * Compiles the cull pass and allocates buffers
+     *
+     * @param capacity  maximum number of objects
+     * @return whether the pass is ready
+     */
+    bool create(GLsizei capacity) {
+        program = buildComputeProgram(GPU_CULL_GLSL);
+        if (!program)
+            return false;
+        maxObjects = capacity;
+        bounds = Buffer(GLsizeiptr(capacity) * sizeof(GpuBounds), NULL);
+        draws = Buffer(GLsizeiptr(capacity) *
+                       sizeof(DrawElementsIndirectCommand), NULL);
+        commands = Buffer(GLsizeiptr(capacity) *
+                          sizeof(DrawElementsIndirectCommand), NULL, 0);
+        count = Buffer(sizeof(GpuCullCounters), NULL, 0);
+        cones = Buffer(GLsizeiptr(capacity) * sizeof(GpuCone), NULL);
+        std::vector<uint32_t> ids(static_cast<size_t>(capacity));
+        for (size_t i = 0; i < ids.size(); ++i)
+            ids[i] = uint32_t(i);
+        objectIds = Buffer(GLsizeiptr(ids.size() * sizeof(uint32_t)),
+                           ids.data(), 0);
+        planesLocation = glGetUniformLocation(program, "uPlanes");
+        objectCountLocation = glGetUniformLocation(program, "uObjectCount");
+        occlusionLocation = glGetUniformLocation(program, "uOcclusion");
+        coneCullingLocation = glGetUniformLocation(program, "uConeCulling");
+        eyeLocation = glGetUniformLocation(program, "uEye");
+        pyramidMatrixLocation = glGetUniformLocation(program,
+                                                     "uPyramidViewProjection");
+        pyramidSizeLocation = glGetUniformLocation(program, "uPyramidSize");
+        pyramidMaxLevelLocation = glGetUniformLocation(program,
+                                                       "uPyramidMaxLevel");
+        indirectCount = GLAD_GL_VERSION_4_6 != 0;
+        return true;
+    }
+
+    /**
+     * Uploads object bounds and draw commands, object i draws draws[i].
+     * Cone culling is off until setCones() is called for the new objects.
+     *
+     * @param objectBounds  bounds of every object
+     * @param objectDraws   one command per object (baseInstance is ignored)
+     */
+    void setObjects(const BoundsSoA& objectBounds,
+                    const DrawElementsIndirectCommand* objectDraws) {
+        objectCount = GLsizei(objectBounds.size());
+        if (objectCount > maxObjects) {
+            std::cout << "ERROR::GPU_CULLER::TOO_MANY_OBJECTS" << std::endl;
+            objectCount = maxObjects;
+        }
+        std::vector<GpuBounds> packed(static_cast<size_t>(objectCount));
+        for (size_t i = 0; i < packed.size(); ++i)
+            packed[i] = { { objectBounds.centerX[i], objectBounds.centerY[i],
+                            objectBounds.centerZ[i], 0.0f },
+                          { objectBounds.extentX[i], objectBounds.extentY[i],
+                            objectBounds.extentZ[i], 0.0f } };
+        bounds.update(0, GLsizeiptr(packed.size() * sizeof(GpuBounds)),
+                      packed.data());
+        draws.update(0, GLsizeiptr(objectCount) *
+                     sizeof(DrawElementsIndirectCommand), objectDraws);
+        // Cones uploaded for the previous objects don't describe these
+        hasCones = false;
+    }
+
+    /**
+     * Uploads a normal cone per object (in the space of the bounds) and
+     * enables the cone test for cull() calls given an eye position
+     *
+     * @param objectCones  one per object given to the last setObjects(),
+     *                     objects that should never be cone culled use a
+     *                     coneCutoff of 1
+     */
+    void setCones(const MeshletBounds* objectCones) {
+        std::vector<GpuCone> packed(static_cast<size_t>(objectCount));
+        for (size_t i = 0; i < packed.size(); ++i) {
+            const MeshletBounds& cone = objectCones[i];
+            packed[i] = { { cone.center.x, cone.center.y, cone.center.z,
+                            cone.radius },
+                          { cone.coneAxis.x, cone.coneAxis.y,
+                            cone.coneAxis.z, cone.coneCutoff } };
+        }
+        cones.update(0, GLsizeiptr(packed.size() * sizeof(GpuCone)),
+                     packed.data());
+        hasCones = true;
+    }
+
+    /**
+     * Feeds the object index to a vertex shader input
+     *
+     * @param vertexArray  VAO used to draw the scene
+     * @param location     attribute location of a `uint` input
+     * @param binding      unused vertex buffer binding point
+     */
+    void attachObjectIds(const VertexArray& vertexArray, GLuint location,
+                         GLuint binding) const {
+        vertexArray.setVertexBuffer(binding, objectIds, 0, sizeof(uint32_t));
+        vertexArray.setBindingDivisor(binding, 1);
+        vertexArray.setIntegerAttribute(location, binding, 1, GL_UNSIGNED_INT,
+                                        0);
+    }
+
+    /**
+     * Records the cull pass, nothing is read back
+     *
+     * @param frustum  frustum of the frame being drawn
+     * @param pyramid  depth pyramid of the previous frame, NULL (or not yet
+     *                 built) for no occlusion culling
+     * @param eye      eye position for the cone test (see setCones()), NULL
+     *                 for no cone culling
+     */
+    void cull(const Frustum& frustum, const DepthPyramid* pyramid = NULL,
+              const Vec3* eye = NULL) const {
+        GLuint zero = 0;
+        glClearNamedBufferData(count.ID, GL_R32UI, GL_RED_INTEGER,
+                               GL_UNSIGNED_INT, &zero);
+        if (!indirectCount)
+            glClearNamedBufferData(commands.ID, GL_R32UI, GL_RED_INTEGER,
+                                   GL_UNSIGNED_INT, &zero);
+        bindStorage();
+        glUseProgram(program);
+        glProgramUniform4fv(program, planesLocation, 6,
+                            &frustum.planes[0].x);
+        glProgramUniform1ui(program, objectCountLocation,
+                            GLuint(objectCount));
+        bool occlusion = pyramid != NULL && pyramid->isBuilt();
+        glProgramUniform1i(program, occlusionLocation, occlusion);
+        bool coneCulling = hasCones && eye != NULL;
+        glProgramUniform1i(program, coneCullingLocation, coneCulling);
+        if (coneCulling)
+            glProgramUniform3f(program, eyeLocation, eye->x, eye->y, eye->z);
+        if (occlusion) {
+            glProgramUniformMatrix4fv(program, pyramidMatrixLocation, 1,
+                                      GL_FALSE,
+                                      pyramid->viewProjection.data());
+            glProgramUniform2f(program, pyramidSizeLocation,
+                               float(pyramid->width), float(pyramid->height));
+            glProgramUniform1f(program, pyramidMaxLevelLocation,
+                               float(pyramid->levels - 1));
+            glBindTextureUnit(GPU_CULL_PYRAMID_UNIT, pyramid->texture);
+        }
+        glDispatchCompute((GLuint(objectCount) + GPU_CULL_GROUP_SIZE - 1) /
+                          GPU_CULL_GROUP_SIZE, 1, 1);
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT |
+                        GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    /**
+     * Draws the visible objects with one call. The scene VAO (with
+     * attachObjectIds) and draw program must be bound.
+     *
+     * @param indexType  GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+     */
+    void draw(GLenum indexType) const {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.ID);
+        if (indirectCount) {
+            glBindBuffer(GL_PARAMETER_BUFFER, count.ID);
+            glMultiDrawElementsIndirectCount(GL_TRIANGLES, indexType, 0, 0,
+                                             objectCount, 0);
+        } else {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, 0,
+                                        objectCount, 0);
+        }
+    }
+
+    // Binds the pass buffers, draw shaders can then read ObjectBounds at
+    // GPU_CULL_BOUNDS_BINDING
+    void bindStorage() const {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_BOUNDS_BINDING,
+                         bounds.ID);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_DRAWS_BINDING,
+                         draws.ID);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_COMMANDS_BINDING,
+                         commands.ID);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_COUNT_BINDING,
+                         count.ID);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_CONES_BINDING,
+                         cones.ID);
+    }
+
+    // Reads the visible count back, stalls until culling finished (stats)
+    GLuint readVisibleCount() const {
+        GLuint visible = 0;
+        glGetNamedBufferSubData(count.ID, 0, sizeof(visible), &visible);
+        return visible;
+    }
+
+    /**
+     * Reads the counters of the last cull pass back, stalls until culling
+     * finished
+     *
+     * @param pyramid  pyramid used for occlusion, supplies the build time
+     */
+    GpuCullStats readStats(const DepthPyramid* pyramid = NULL) const {
+        GpuCullCounters counters = {};
+        glGetNamedBufferSubData(count.ID, 0, sizeof(counters), &counters);
+        GpuCullStats stats;
+        stats.visible = counters.drawCount;
+        stats.frustumCulled = counters.frustumCulled;
+        stats.occlusionCulled = counters.occlusionCulled;
+        stats.coneCulled = counters.coneCulled;
+        if (pyramid != NULL)
+            stats.pyramidBuildMs = pyramid->buildMs();
+        return stats;
+    }
+
+    bool usesIndirectCount() const {
+        return indirectCount;
+    }
+
+    void destroy() {
+        bounds.destroy();
+        draws.destroy();
+        commands.destroy();
+        count.destroy();
+        cones.destroy();
+        objectIds.destroy();
+        glDeleteProgram(program);
+        program = 0;
+    }
+
+private:
+    GLint planesLocation = -1;
+    GLint objectCountLocation = -1;
+    GLint occlusionLocation = -1;
+    GLint pyramidMatrixLocation = -1;
+    GLint pyramidSizeLocation = -1;
+    GLint pyramidMaxLevelLocation = -1;
+    GLint coneCullingLocation = -1;
+    GLint eyeLocation = -1;
+    bool indirectCount = false;
+    bool hasCones = false;
+};
+
+#endif
@@ -0,0 +1,424 @@
+#ifndef HANDLE_POOL_HPP
+#define HANDLE_POOL_HPP
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "buffer.hpp"
+#include "vertex_array.hpp"
+
+/**
+ * Generational handles for engine resources.
+ *
+ * A handle is 32 bits: a slot index and the generation the slot had when
+ * the handle was made. Destroying a resource bumps its slot's generation,
+ * so an old handle stops resolving (get() returns NULL) instead of reaching
+ * whatever reuses the slot; the check is one compare. Records live packed
+ * in a dense array, iterating a pool touches only live records.
+ *
+ * GlResources wraps GL objects in pools and defers their deletion until
+ * the GPU has finished the frames that may still use them, tracked with a
+ * fence per frame.
+ */
+
+/****************
+ * HANDLES
+ ****************/
+
+const uint32_t HANDLE_INDEX_BITS = 20;
+const uint32_t HANDLE_INDEX_MASK = (1u << HANDLE_INDEX_BITS) - 1;
+// Generations wrap within the remaining bits and skip 0
+const uint32_t HANDLE_GENERATION_MASK = (1u << (32 - HANDLE_INDEX_BITS)) - 1;
+
+/**
+ * Typed handle, Tag keeps handles of different pools apart at compile
+ * time. The value 0 is never a valid handle.
+ */
+template <typename Tag>
+struct Handle {
+    uint32_t value = 0;
+
+    uint32_t index() const {
+        return value & HANDLE_INDEX_MASK;
+    }
+
+    uint32_t generation() const {
+        return value >> HANDLE_INDEX_BITS;
+    }
+
+    bool valid() const {
+        return value != 0;
+    }
+
+    bool operator==(Handle other) const {
+        return value == other.value;
+    }
+
+    bool operator!=(Handle other) const {
+        return value != other.value;
+    }
+};
+
+template <typename T, typename Tag>
+class HandlePool {
+public:
+    using HandleType = Handle<Tag>;
+
+    /**
+     * Stores a record
+     *
+     * @return handle, invalid when all 2^20 slots are in use
+     */
+    HandleType create(T record) {
+        uint32_t slot;
+        if (freeSlots.empty()) {
+            if (slots.size() > HANDLE_INDEX_MASK) {
+                std::cout << "ERROR::HANDLE_POOL::FULL" << std::endl;
+                return HandleType();
+            }
+            slot = uint32_t(slots.size());
+            slots.push_back(Slot());
+        } else {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        slots[slot].dense = uint32_t(records.size());
+        records.push_back(std::move(record));
+        owners.push_back(slot);
+        HandleType handle;
+        handle.value = slots[slot].generation << HANDLE_INDEX_BITS | slot;
+        return handle;
+    }
+
+    // Record of a live handle, NULL for a destroyed or foreign one
+    T* get(HandleType handle) {
+        uint32_t slot = handle.index();
+        if (slot >= slots.size() ||
+            slots[slot].generation != handle.generation() ||
+            slots[slot].dense == DEAD)
+            return NULL;
+        return &records[slots[slot].dense];
+    }
+
+    const T* get(HandleType handle) const {
+        return const_cast<HandlePool*>(this)->get(handle);
+    }
+
+    bool alive(HandleType handle) const {
+        return get(handle) != NULL;
+    }
+
+    /**
+     * Removes a record, the last record moves into its place. Handles to
+     * it stop resolving at once.
+     *
+     * @param removed  receives the record for the caller to release (may
+     *                 be NULL)
+     * @return false for a stale handle
+     */
+    bool destroy(HandleType handle, T* removed = NULL) {
+        T* record = get(handle);
+        if (record == NULL) {
+            std::cout << "ERROR::HANDLE_POOL::STALE_HANDLE" << std::endl;
+            return false;
+        }
+        uint32_t slot = handle.index();
+        uint32_t dense = slots[slot].dense;
+        if (removed)
+            *removed = std::move(*record);
+        if (dense + 1 != records.size()) {
+            records[dense] = std::move(records.back());
+            owners[dense] = owners.back();
+            slots[owners[dense]].dense = dense;
+        }
+        records.pop_back();
+        owners.pop_back();
+        slots[slot].dense = DEAD;
+        slots[slot].generation = (slots[slot].generation + 1) &
+            HANDLE_GENERATION_MASK;
+        if (slots[slot].generation == 0)
+            slots[slot].generation = 1;
+        freeSlots.push_back(slot);
+        return true;
+    }
+
+    size_t size() const {
+        return records.size();
+    }
+
+    // Live records, packed, in no particular order
+    T* begin() {
+        return records.data();
+    }
+
+    T* end() {
+        return records.data() + records.size();
+    }
+
+    const T* begin() const {
+        return records.data();
+    }
+
+    const T* end() const {
+        return records.data() + records.size();
+    }
+
+    // Handle of the record at a position in [begin(), end())
+    HandleType handleAt(size_t dense) const {
+        uint32_t slot = owners[dense];
+        HandleType handle;
+        handle.value = slots[slot].generation << HANDLE_INDEX_BITS | slot;
+        return handle;
+    }
+
+    void clear() {
+        while (!records.empty())
+            destroy(handleAt(records.size() - 1));
+    }
+
+private:
+    static constexpr uint32_t DEAD = UINT32_MAX;
+
+    struct Slot {
+        uint32_t generation = 1;
+        // Position in records, DEAD when free
+        uint32_t dense = DEAD;
+    };
+
+    std::vector<T> records;
+    // Slot owning each record, parallel to records
+    std::vector<uint32_t> owners;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+};
+
+
+/****************
+ * GL RESOURCES
+ ****************/
+
+using BufferHandle = Handle<struct BufferTag>;
+using TextureObjectHandle = Handle<struct TextureTag>;
+using VertexArrayHandle = Handle<struct VertexArrayTag>;
+using ProgramHandle = Handle<struct ProgramTag>;
+
+enum GlResourceType {
+    RESOURCE_BUFFER,
+    RESOURCE_TEXTURE,
+    RESOURCE_VERTEX_ARRAY,
+    RESOURCE_PROGRAM
+};
+
+struct GlResourceStats {
+    size_t buffers = 0;
+    size_t textures = 0;
+    size_t vertexArrays = 0;
+    size_t programs = 0;
+    // Released, waiting for the GPU to finish with them
+    size_t pendingDeletes = 0;
+    // Deleted by the last beginFrame()
+    size_t deleted = 0;
+};
+
+/**
+ * Pools of GL objects. release() invalidates the handle immediately but
+ * only queues the GL object: endFrame() fences the frame's commands and
+ * beginFrame() deletes objects whose fence has signalled, so a resource
+ * released while the GPU may still be reading it is never deleted early.
+ */
+class GlResources {
+public:
+    GlResources() = default;
+    GlResources(const GlResources&) = delete;
+    GlResources& operator=(const GlResources&) = delete;
+
+    BufferHandle createBuffer(GLsizeiptr size, const void* data,
+                              GLbitfield flags = GL_DYNAMIC_STORAGE_BIT) {
+        return buffers.create(Buffer(size, data, flags));
+    }
+
+    // Creates a texture object, set its storage through texture()
+    TextureObjectHandle createTexture(GLenum target = GL_TEXTURE_2D) {
+        GLuint texture;
+        glCreateTextures(target, 1, &texture);
+        return textures.create(texture);
+    }
+
+    VertexArrayHandle createVertexArray() {
+        return vertexArrays.create(VertexArray());
+    }
+
+    // Takes ownership of a linked program (e.g. from buildProgram())
+    ProgramHandle adoptProgram(GLuint program) {
+        return programs.create(program);
+    }
+
+    // NULL (and an error) for a released handle
+    const Buffer* buffer(BufferHandle handle) const {
+        return check(buffers.get(handle));
+    }
+
+    const VertexArray* vertexArray(VertexArrayHandle handle) const {
+        return check(vertexArrays.get(handle));
+    }
+
+    // 0 (and an error) for a released handle
+    GLuint texture(TextureObjectHandle handle) const {
+        const GLuint* texture = check(textures.get(handle));
+        return texture ? *texture : 0;
+    }
+
+    GLuint program(ProgramHandle handle) const {
+        const GLuint* program = check(programs.get(handle));
+        return program ? *program : 0;
+    }
+
+    void release(BufferHandle handle) {
+        Buffer buffer;
+        if (buffers.destroy(handle, &buffer))
+            retire(RESOURCE_BUFFER, buffer.ID);
+    }
+
+    void release(TextureObjectHandle handle) {
+        GLuint texture;
+        if (textures.destroy(handle, &texture))
+            retire(RESOURCE_TEXTURE, texture);
+    }
+
+    void release(VertexArrayHandle handle) {
+        VertexArray* vertexArray = vertexArrays.get(handle);
+        GLuint name = vertexArray ? vertexArray->ID : 0;
+        if (vertexArrays.destroy(handle))
+            retire(RESOURCE_VERTEX_ARRAY, name);
+    }
+
+    void release(ProgramHandle handle) {
+        GLuint program;
+        if (programs.destroy(handle, &program))
+            retire(RESOURCE_PROGRAM, program);
+    }
+
+    // Deletes released objects the GPU has finished with
+    void beginFrame() {
+        deletedLastFrame = 0;
+        while (!retiredFrames.empty()) {
+            RetiredFrame& frame = retiredFrames.front();
+            GLenum status = glClientWaitSync(frame.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED &&
+                status != GL_CONDITION_SATISFIED)
+                break;
+            deleteObjects(frame.objects);
+            glDeleteSync(frame.fence);
+            retiredFrames.pop_front();
+        }
+    }
+
+    // Fences the objects released during this frame
+    void endFrame() {
+        if (current.empty())
+            return;
+        RetiredFrame frame;
+        frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame.objects.swap(current);
+        retiredFrames.push_back(std::move(frame));
+    }
+
+    GlResourceStats stats() const {
+        GlResourceStats result;
+        result.buffers = buffers.size();
+        result.textures = textures.size();
+        result.vertexArrays = vertexArrays.size();
+        result.programs = programs.size();
+        result.pendingDeletes = current.size();
+        for (const RetiredFrame& frame : retiredFrames)
+            result.pendingDeletes += frame.objects.size();
+        result.deleted = deletedLastFrame;
+        return result;
+    }
+
+    /**
+     * Waits for the GPU and deletes every object, live or released. Live
+     * handles are reported as leaks.
+     */
+    void destroy() {
+        size_t leaked = buffers.size() + textures.size() +
+            vertexArrays.size() + programs.size();
+        if (leaked > 0)
+            std::cout << "ERROR::GL_RESOURCES::LEAKED " << leaked <<
+                std::endl;
+        while (buffers.size())
+            release(buffers.handleAt(0));
+        while (textures.size())
+            release(textures.handleAt(0));
+        while (vertexArrays.size())
+            release(vertexArrays.handleAt(0));
+        while (programs.size())
+            release(programs.handleAt(0));
+        glFinish();
+        deleteObjects(current);
+        current.clear();
+        for (RetiredFrame& frame : retiredFrames) {
+            deleteObjects(frame.objects);
+            glDeleteSync(frame.fence);
+        }
+        retiredFrames.clear();
+    }
+
+private:
+    struct RetiredObject {
+        GlResourceType type;
+        GLuint name;
+    };
+
+    struct RetiredFrame {
+        GLsync fence = NULL;
+        std::vector<RetiredObject> objects;
+    };
+
+    HandlePool<Buffer, BufferTag> buffers;
+    HandlePool<GLuint, TextureTag> textures;
+    HandlePool<VertexArray, VertexArrayTag> vertexArrays;
+    HandlePool<GLuint, ProgramTag> programs;
+    // Released this frame, not fenced yet
+    std::vector<RetiredObject> current;
+    std::deque<RetiredFrame> retiredFrames;
+    size_t deletedLastFrame = 0;
+
+    template <typename T>
+    static const T* check(const T* record) {
+        if (record == NULL)
+            std::cout << "ERROR::GL_RESOURCES::STALE_HANDLE" << std::endl;
+        return record;
+    }
+
+    void retire(GlResourceType type, GLuint name) {
+        current.push_back({ type, name });
+    }
+
+    void deleteObjects(const std::vector<RetiredObject>& objects) {
+        for (const RetiredObject& object : objects) {
+            switch (object.type) {
+            case RESOURCE_BUFFER:
+                glDeleteBuffers(1, &object.name);
+                break;
+            case RESOURCE_TEXTURE:
+                glDeleteTextures(1, &object.name);
+                break;
+            case RESOURCE_VERTEX_ARRAY:
+                glDeleteVertexArrays(1, &object.name);
+                break;
+            case RESOURCE_PROGRAM:
+                glDeleteProgram(object.name);
+                break;
+            }
+        }
+        deletedLastFrame += objects.size();
+    }
+};
+
+#endif
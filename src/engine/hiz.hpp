@@ -0,0 +1,224 @@
+#ifndef HIZ_HPP
+#define HIZ_HPP
+
+#include <glad/glad.h>
+
+#include "math.hpp"
+#include "program.hpp"
+
+/**
+ * Hierarchical-Z depth pyramid for occlusion culling.
+ *
+ * After a frame is rendered its depth buffer is reduced into a mip chain
+ * where every texel holds the farthest depth of the pixels it covers. The
+ * next frame's cull pass (see GpuCuller) projects each bounding box with the
+ * matrix the pyramid was built with, picks the level where the box covers at
+ * most 2x2 texels and skips the object when its nearest depth is behind all
+ * of them.
+ *
+ * Level 0 is the previous power of two of the depth size so every level
+ * halves exactly and texture coordinates map to the same texels on all
+ * levels. Depth is assumed to be the default [0, 1] range with GL_LESS.
+ *
+ * Occlusion uses last frame's depth, so an object uncovered by camera or
+ * occluder movement appears one frame late.
+ */
+
+// Work group size of both build passes, matches local_size_x/y below
+const GLuint HIZ_GROUP_SIZE = 8;
+
+/**
+ * Level 0: farthest depth over the block of depth pixels that each pyramid
+ * texel covers (1 to 3 pixels per axis as level 0 is rounded down)
+ */
+const char* const HIZ_COPY_GLSL =
+    "#version 450 core\n"
+    "layout (local_size_x = 8, local_size_y = 8) in;\n"
+    "layout (binding = 0) uniform sampler2D uDepth;\n"
+    "layout (r32f, binding = 0) writeonly uniform image2D uOutput;\n"
+    "void main() {\n"
+    "    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+    "    ivec2 outputSize = imageSize(uOutput);\n"
+    "    if (any(greaterThanEqual(texel, outputSize)))\n"
+    "        return;\n"
+    "    ivec2 depthSize = textureSize(uDepth, 0);\n"
+    "    ivec2 first = texel * depthSize / outputSize;\n"
+    "    ivec2 last = ((texel + 1) * depthSize + outputSize - 1) /\n"
+    "        outputSize - 1;\n"
+    "    float farthest = 0.0;\n"
+    "    for (int y = first.y; y <= last.y; ++y)\n"
+    "        for (int x = first.x; x <= last.x; ++x)\n"
+    "            farthest = max(farthest,\n"
+    "                           texelFetch(uDepth, ivec2(x, y), 0).r);\n"
+    "    imageStore(uOutput, texel, vec4(farthest));\n"
+    "}\n";
+
+// Level n: farthest depth of the 2x2 texels below in level n - 1
+const char* const HIZ_REDUCE_GLSL =
+    "#version 450 core\n"
+    "layout (local_size_x = 8, local_size_y = 8) in;\n"
+    "layout (r32f, binding = 0) readonly uniform image2D uInput;\n"
+    "layout (r32f, binding = 1) writeonly uniform image2D uOutput;\n"
+    "void main() {\n"
+    "    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+    "    if (any(greaterThanEqual(texel, imageSize(uOutput))))\n"
+    "        return;\n"
+    "    ivec2 last = imageSize(uInput) - 1;\n"
+    "    ivec2 source = texel * 2;\n"
+    "    float farthest = max(\n"
+    "        max(imageLoad(uInput, min(source, last)).r,\n"
+    "            imageLoad(uInput, min(source + ivec2(1, 0), last)).r),\n"
+    "        max(imageLoad(uInput, min(source + ivec2(0, 1), last)).r,\n"
+    "            imageLoad(uInput, min(source + ivec2(1, 1), last)).r));\n"
+    "    imageStore(uOutput, texel, vec4(farthest));\n"
+    "}\n";
+
+class DepthPyramid {
+public:
+    // R32F mip chain, 0 if not yet created
+    unsigned int texture = 0;
+    GLsizei width = 0;
+    GLsizei height = 0;
+    GLsizei levels = 0;
+    // Matrix of the frame the pyramid was last built from
+    Mat4 viewProjection;
+
+    /**
+     * Compiles the build passes and allocates the pyramid
+     *
+     * @param depthWidth   width of the depth buffer it will be built from
+     * @param depthHeight  height of the depth buffer
+     * @return whether the pyramid is ready
+     */
+    bool create(GLsizei depthWidth, GLsizei depthHeight) {
+        copyProgram = buildComputeProgram(HIZ_COPY_GLSL);
+        reduceProgram = buildComputeProgram(HIZ_REDUCE_GLSL);
+        if (!copyProgram || !reduceProgram)
+            return false;
+        width = previousPowerOfTwo(depthWidth);
+        height = previousPowerOfTwo(depthHeight);
+        levels = 1;
+        while ((width >> levels) > 0 || (height >> levels) > 0)
+            ++levels;
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, levels, GL_R32F, width, height);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER,
+                            GL_NEAREST_MIPMAP_NEAREST);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glCreateQueries(GL_TIME_ELAPSED, 1, &timeQuery);
+        built = false;
+        return true;
+    }
+
+    /**
+     * Reduces a depth texture into the pyramid, to be called after the
+     * frame that wrote it so the next frame can cull against it
+     *
+     * @param depthTexture       depth texture of the rendered frame
+     *                           (GL_TEXTURE_COMPARE_MODE must be GL_NONE)
+     * @param frameViewProjection  matrix the frame was rendered with
+     */
+    void build(unsigned int depthTexture, const Mat4& frameViewProjection) {
+        // Keep the previous result if the GPU has not finished timing it
+        bool timing = !queryPending;
+        if (queryPending) {
+            GLint available = 0;
+            glGetQueryObjectiv(timeQuery, GL_QUERY_RESULT_AVAILABLE,
+                               &available);
+            if (available) {
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT,
+                                      &nanoseconds);
+                lastBuildMs = double(nanoseconds) / 1.0e6;
+                queryPending = false;
+                timing = true;
+            }
+        }
+        if (timing)
+            glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+
+        glUseProgram(copyProgram);
+        glBindTextureUnit(0, depthTexture);
+        glBindImageTexture(0, texture, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                           GL_R32F);
+        dispatch(width, height);
+        glUseProgram(reduceProgram);
+        for (GLsizei level = 1; level < levels; ++level) {
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            glBindImageTexture(0, texture, level - 1, GL_FALSE, 0,
+                               GL_READ_ONLY, GL_R32F);
+            glBindImageTexture(1, texture, level, GL_FALSE, 0,
+                               GL_WRITE_ONLY, GL_R32F);
+            dispatch(levelSize(width, level), levelSize(height, level));
+        }
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        if (timing) {
+            glEndQuery(GL_TIME_ELAPSED);
+            queryPending = true;
+        }
+        viewProjection = frameViewProjection;
+        built = true;
+    }
+
+    // Whether build() has been called since create(), culling is skipped
+    // until then
+    bool isBuilt() const {
+        return built;
+    }
+
+    // Forgets the current contents (e.g. after a camera cut or a scene
+    // change), occlusion culling resumes after the next build()
+    void reset() {
+        built = false;
+    }
+
+    // GPU time of the most recent build whose result is available, in ms
+    // (lags a frame or two behind, never stalls)
+    double buildMs() const {
+        return lastBuildMs;
+    }
+
+    void destroy() {
+        glDeleteTextures(1, &texture);
+        glDeleteQueries(1, &timeQuery);
+        glDeleteProgram(copyProgram);
+        glDeleteProgram(reduceProgram);
+        texture = 0;
+        timeQuery = 0;
+        copyProgram = 0;
+        reduceProgram = 0;
+        built = false;
+        queryPending = false;
+    }
+
+private:
+    unsigned int copyProgram = 0;
+    unsigned int reduceProgram = 0;
+    unsigned int timeQuery = 0;
+    bool built = false;
+    bool queryPending = false;
+    double lastBuildMs = 0.0;
+
+    static GLsizei previousPowerOfTwo(GLsizei value) {
+        GLsizei power = 1;
+        while (power * 2 <= value)
+            power *= 2;
+        return power;
+    }
+
+    static GLsizei levelSize(GLsizei size, GLsizei level) {
+        return (size >> level) > 0 ? size >> level : 1;
+    }
+
+    static void dispatch(GLsizei levelWidth, GLsizei levelHeight) {
+        glDispatchCompute((GLuint(levelWidth) + HIZ_GROUP_SIZE - 1) /
+                          HIZ_GROUP_SIZE,
+                          (GLuint(levelHeight) + HIZ_GROUP_SIZE - 1) /
+                          HIZ_GROUP_SIZE, 1);
+    }
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef INDIRECT_DRAW_HPP
+#define INDIRECT_DRAW_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Indirect draw commands (GL 4.3 multi-draw indirect).
+ *
+ * Each object in a scene owns one command describing its index range. Culling
+ * passes copy the commands of visible objects into a compacted command
+ * buffer and set baseInstance to the object index, which reaches the vertex
+ * shader through an instanced attribute (see GpuCuller::attachObjectIds).
+ */
+
+// Layout fixed by GL for GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20,
+              "DrawElementsIndirectCommand must match the GL layout");
+
+/**
+ * Builds compacted commands for a list of visible objects on the CPU
+ *
+ * @param visible       indices of visible objects (see culling.hpp)
+ * @param visibleCount  number of visible objects
+ * @param objectDraws   per-object command, indexed by object
+ * @param commands      receives visibleCount commands
+ */
+inline void buildDrawCommands(const uint32_t* visible, size_t visibleCount,
+                              const DrawElementsIndirectCommand* objectDraws,
+                              DrawElementsIndirectCommand* commands) {
+    for (size_t i = 0; i < visibleCount; ++i) {
+        commands[i] = objectDraws[visible[i]];
+        commands[i].baseInstance = visible[i];
+    }
+}
+
+#endif
@@ -0,0 +1,526 @@
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "parallel.hpp"
+
+/**
+ * Work-stealing job scheduler for per-frame engine work (animation,
+ * culling, decoding, command recording) so the main thread is left to
+ * submit GL.
+ *
+ * Every thread of the system (the one that called create() is thread 0)
+ * has a Chase-Lev deque: it pushes and pops jobs at the bottom without
+ * locks while idle threads steal from the top of a random victim. Jobs are
+ * small closures (at most JOB_STORAGE_BYTES of captures) recycled through
+ * a free list per thread, so once warmed up running one allocates nothing.
+ *
+ * Completion is tracked with JobCounters: run() adds a job to a counter,
+ * wait() helps run jobs until the counter reaches zero and runAfter()
+ * holds a job back until another counter has. Jobs may only be submitted
+ * from the system's threads, i.e. the creating thread and jobs.
+ *
+ * Unlike ThreadPool, which suits long blocking tasks, jobs should be short
+ * and never block on anything but wait().
+ */
+
+// Capacity of each thread's deque, a power of two
+const size_t JOB_DEQUE_SIZE = 4096;
+// Jobs a thread allocates at once when its free list runs dry
+const size_t JOB_BLOCK_SIZE = 256;
+// Bytes of captures a job can hold, capture large state by pointer
+const size_t JOB_STORAGE_BYTES = 32;
+
+// One cache line
+struct alignas(64) Job {
+    void (*function)(Job&) = NULL;
+    class JobCounter* counter = NULL;
+    // Next in a free list
+    Job* next = NULL;
+    // Thread whose free list the job returns to
+    uint32_t owner = 0;
+    alignas(8) unsigned char storage[JOB_STORAGE_BYTES];
+};
+
+// Number of unfinished jobs, must outlive every job added to it
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool done() const {
+        return count.load(std::memory_order_acquire) == 0;
+    }
+
+    int pending() const {
+        return count.load(std::memory_order_relaxed);
+    }
+
+private:
+    friend class JobSystem;
+    std::atomic<int> count { 0 };
+};
+
+
+/****************
+ * WORK DEQUE
+ ****************/
+
+/**
+ * Chase-Lev deque (with the memory orderings of Le et al. 2013). Only the
+ * owning thread calls push() and pop(), any thread may steal().
+ */
+class WorkDeque {
+public:
+    WorkDeque() : buffer(new std::atomic<Job*>[JOB_DEQUE_SIZE]) {}
+    WorkDeque(const WorkDeque&) = delete;
+    WorkDeque& operator=(const WorkDeque&) = delete;
+
+    // Returns false when full, the caller should run the job itself
+    bool push(Job* job) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= int64_t(JOB_DEQUE_SIZE))
+            return false;
+        buffer[size_t(b) & (JOB_DEQUE_SIZE - 1)].store(
+            job, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Newest job, NULL if empty
+    Job* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        Job* job = NULL;
+        if (t <= b) {
+            job = buffer[size_t(b) & (JOB_DEQUE_SIZE - 1)].load(
+                std::memory_order_relaxed);
+            if (t == b) {
+                // Last job, race thieves for it
+                if (!top.compare_exchange_strong(
+                        t, t + 1, std::memory_order_seq_cst,
+                        std::memory_order_relaxed))
+                    job = NULL;
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    // Oldest job, NULL if empty or lost to another thief
+    Job* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return NULL;
+        Job* job = buffer[size_t(t) & (JOB_DEQUE_SIZE - 1)].load(
+            std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1,
+                                         std::memory_order_seq_cst,
+                                         std::memory_order_relaxed))
+            return NULL;
+        return job;
+    }
+
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <=
+            top.load(std::memory_order_relaxed);
+    }
+
+private:
+    // Thieves and the owner on separate cache lines
+    alignas(64) std::atomic<int64_t> top { 0 };
+    alignas(64) std::atomic<int64_t> bottom { 0 };
+    std::unique_ptr<std::atomic<Job*>[]> buffer;
+};
+
+
+/****************
+ * JOB SYSTEM
+ ****************/
+
+class JobSystem {
+public:
+    JobSystem() = default;
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    ~JobSystem() {
+        destroy();
+    }
+
+    /**
+     * Starts the workers, the calling thread becomes thread 0
+     *
+     * @param threads  thread count including the caller (see
+     *                 resolveThreadCount)
+     * @param pin      pins each worker to one hardware thread, leaving
+     *                 hardware thread 0 to the caller
+     */
+    void create(unsigned int threads = 0, bool pin = false) {
+        destroy();
+        stopping = false;
+        unsigned int count = resolveThreadCount(threads);
+        for (unsigned int t = 0; t < count; ++t)
+            slots.emplace_back(new Slot());
+        threadOwner = this;
+        threadSlot = 0;
+        for (unsigned int t = 1; t < count; ++t)
+            slots[t]->thread = std::thread([this, t, pin]() {
+                work(t, pin);
+            });
+    }
+
+    /**
+     * Queues a job
+     *
+     * @param counter   incremented now, decremented when the job is done
+     * @param function  callable taking no arguments, copied into the job
+     */
+    template <typename Function>
+    void run(JobCounter& counter, Function&& function) {
+        if (Job* job = allocate(counter, std::forward<Function>(function)))
+            schedule(job);
+    }
+
+    /**
+     * Queues a job once another counter has reached zero
+     *
+     * @param dependency  must outlive the wait for the job to be queued
+     */
+    template <typename Function>
+    void runAfter(const JobCounter& dependency, JobCounter& counter,
+                  Function&& function) {
+        Job* job = allocate(counter, std::forward<Function>(function));
+        if (job == NULL)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(waitingMutex);
+            // Pairs with the check in finish(), one of them sees the other
+            waitingCount.fetch_add(1, std::memory_order_seq_cst);
+            if (dependency.count.load(std::memory_order_seq_cst) != 0) {
+                waiting.push_back({ &dependency, job });
+                return;
+            }
+            waitingCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+        schedule(job);
+    }
+
+    // Runs queued jobs until the counter reaches zero
+    void wait(const JobCounter& counter) {
+        int slot = currentSlot();
+        while (!counter.done()) {
+            if (slot < 0 || !runOne(unsigned(slot)))
+                std::this_thread::yield();
+        }
+    }
+
+    /**
+     * Runs function(first, last) over [0, count) in ranges of at most
+     * grain indices and waits. Ranges are split in halves as they are
+     * stolen, so idle threads take large pieces first.
+     *
+     * @param grain  largest range handed to one call
+     */
+    template <typename Function>
+    void parallelFor(size_t count, size_t grain, const Function& function) {
+        if (count == 0)
+            return;
+        JobCounter counter;
+        SplitContext<Function> context = { this, &counter,
+                                           std::max<size_t>(grain, 1),
+                                           &function };
+        split(&context, 0, count);
+        wait(counter);
+    }
+
+    size_t threadCount() const {
+        return slots.size();
+    }
+
+    // Index of the calling thread in the system, -1 for other threads
+    int currentSlot() const {
+        return threadOwner == this ? threadSlot : -1;
+    }
+
+    /**
+     * Stops and joins the workers. Wait for outstanding counters first,
+     * queued jobs are dropped.
+     */
+    void destroy() {
+        if (slots.empty())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::unique_ptr<Slot>& slot : slots)
+            if (slot->thread.joinable())
+                slot->thread.join();
+        slots.clear();
+        waiting.clear();
+        waitingCount = 0;
+        if (threadOwner == this)
+            threadOwner = NULL;
+    }
+
+private:
+    struct Slot {
+        WorkDeque deque;
+        // Free jobs, only touched by the owning thread
+        Job* freeJobs = NULL;
+        // Jobs freed by other threads, taken all at once by the owner
+        std::atomic<Job*> returnedJobs { NULL };
+        std::vector<std::unique_ptr<Job[]>> blocks;
+        uint32_t seed = 0x9e3779b9u;
+        std::thread thread;
+    };
+
+    struct WaitingJob {
+        const JobCounter* dependency;
+        Job* job;
+    };
+
+    template <typename Function>
+    struct SplitContext {
+        JobSystem* system;
+        JobCounter* counter;
+        size_t grain;
+        const Function* function;
+    };
+
+    static inline thread_local JobSystem* threadOwner = NULL;
+    static inline thread_local int threadSlot = -1;
+
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::atomic<bool> stopping { false };
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<int> sleepers { 0 };
+    std::mutex waitingMutex;
+    std::vector<WaitingJob> waiting;
+    std::atomic<int> waitingCount { 0 };
+
+    template <typename Function>
+    Job* allocate(JobCounter& counter, Function&& function) {
+        using Stored = typename std::decay<Function>::type;
+        static_assert(sizeof(Stored) <= JOB_STORAGE_BYTES,
+                      "job captures too large, capture by pointer");
+        static_assert(alignof(Stored) <= 8, "job captures over-aligned");
+        int slot = currentSlot();
+        if (slot < 0) {
+            std::cout << "ERROR::JOB_SYSTEM::FOREIGN_THREAD" << std::endl;
+            function();
+            return NULL;
+        }
+        Slot& owner = *slots[size_t(slot)];
+        if (owner.freeJobs == NULL)
+            owner.freeJobs = owner.returnedJobs.exchange(
+                NULL, std::memory_order_acquire);
+        if (owner.freeJobs == NULL) {
+            owner.blocks.emplace_back(new Job[JOB_BLOCK_SIZE]);
+            Job* block = owner.blocks.back().get();
+            for (size_t i = 0; i < JOB_BLOCK_SIZE; ++i) {
+                block[i].owner = uint32_t(slot);
+                block[i].next = i + 1 < JOB_BLOCK_SIZE ? &block[i + 1]
+                                                       : NULL;
+            }
+            owner.freeJobs = block;
+        }
+        Job* job = owner.freeJobs;
+        owner.freeJobs = job->next;
+        new (job->storage) Stored(std::forward<Function>(function));
+        job->function = [](Job& job) {
+            Stored* stored = std::launder(
+                reinterpret_cast<Stored*>(job.storage));
+            (*stored)();
+            stored->~Stored();
+        };
+        job->counter = &counter;
+        counter.count.fetch_add(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    void schedule(Job* job) {
+        if (!slots[size_t(currentSlot())]->deque.push(job)) {
+            execute(*job);
+            return;
+        }
+        // Pairs with the fence in sleep()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wake.notify_one();
+        }
+    }
+
+    void execute(Job& job) {
+        job.function(job);
+        JobCounter* counter = job.counter;
+        release(job);
+        finish(*counter);
+    }
+
+    // Returns a job to its owner's free list
+    void release(Job& job) {
+        Slot& owner = *slots[job.owner];
+        if (currentSlot() == int(job.owner)) {
+            job.next = owner.freeJobs;
+            owner.freeJobs = &job;
+            return;
+        }
+        Job* head = owner.returnedJobs.load(std::memory_order_relaxed);
+        do {
+            job.next = head;
+        } while (!owner.returnedJobs.compare_exchange_weak(
+                     head, &job, std::memory_order_release,
+                     std::memory_order_relaxed));
+    }
+
+    // Counts a job done, queues jobs waiting on the counter if it is zero
+    void finish(JobCounter& counter) {
+        // The counter may be gone once it reaches zero, don't touch it
+        if (counter.count.fetch_sub(1, std::memory_order_seq_cst) != 1)
+            return;
+        if (waitingCount.load(std::memory_order_seq_cst) == 0)
+            return;
+        std::vector<Job*> ready;
+        {
+            std::lock_guard<std::mutex> lock(waitingMutex);
+            for (size_t i = 0; i < waiting.size();) {
+                if (waiting[i].dependency->done()) {
+                    ready.push_back(waiting[i].job);
+                    waiting[i] = waiting.back();
+                    waiting.pop_back();
+                    waitingCount.fetch_sub(1, std::memory_order_relaxed);
+                } else {
+                    ++i;
+                }
+            }
+        }
+        for (Job* job : ready)
+            schedule(job);
+    }
+
+    // Runs one job from the own deque or a victim's, false if none found
+    bool runOne(unsigned int slot) {
+        Job* job = slots[slot]->deque.pop();
+        if (job == NULL) {
+            size_t count = slots.size();
+            uint32_t& seed = slots[slot]->seed;
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            for (size_t i = 0; i < count && job == NULL; ++i) {
+                size_t victim = (seed + i) % count;
+                if (victim != slot)
+                    job = slots[victim]->deque.steal();
+            }
+        }
+        if (job == NULL)
+            return false;
+        execute(*job);
+        return true;
+    }
+
+    bool hasWork() const {
+        for (const std::unique_ptr<Slot>& slot : slots)
+            if (!slot->deque.empty())
+                return true;
+        return false;
+    }
+
+    void sleep() {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepers.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake.wait(lock, [this]() {
+            return stopping.load(std::memory_order_relaxed) || hasWork();
+        });
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void work(unsigned int slot, bool pin) {
+        threadOwner = this;
+        threadSlot = int(slot);
+        slots[slot]->seed ^= slot * 0x85ebca6bu;
+        if (pin)
+            pinThread(slot % resolveThreadCount(0));
+        int idle = 0;
+        while (!stopping.load(std::memory_order_acquire)) {
+            if (runOne(slot)) {
+                idle = 0;
+            } else if (++idle < 64) {
+                std::this_thread::yield();
+            } else {
+                sleep();
+                idle = 0;
+            }
+        }
+    }
+
+    template <typename Function>
+    static void split(SplitContext<Function>* context, size_t first,
+                      size_t last) {
+        // Queue the upper half until the rest fits in one grain
+        while (last - first > context->grain) {
+            size_t middle = first + (last - first) / 2;
+            context->system->run(*context->counter,
+                                 [context, middle, last]() {
+                                     split(context, middle, last);
+                                 });
+            last = middle;
+        }
+        (*context->function)(first, last);
+    }
+
+    static void pinThread(unsigned int cpu) {
+#if defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (cpu % 64));
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)cpu;
+#endif
+    }
+};
+
+#endif
@@ -0,0 +1,396 @@
+#ifndef KTX2_HPP
+#define KTX2_HPP
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "gl_extensions.hpp"
+
+/**
+ * KTX2 texture containers (Khronos KTX 2.0) holding 2D textures with their
+ * mip levels, block compressed (BC1/BC3/BC7/ETC2) or RGBA8.
+ *
+ * parseKtx2() validates a file already in memory (e.g. a MappedFile) and
+ * points at its levels, createKtx2Texture() uploads them unchanged with
+ * glCompressedTextureSubImage2D, and writeKtx2File() is the writer used by
+ * the offline texcompress tool. Supercompressed (Basis, zstd) files,
+ * arrays, cube maps and 3D textures are rejected.
+ */
+
+const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2',
+                                            '0', 0xBB, '\r', '\n', 0x1A,
+                                            '\n' };
+
+// Vulkan format numbers used in KTX2 headers
+const uint32_t KTX2_VK_FORMAT_R8G8B8A8_UNORM = 37;
+const uint32_t KTX2_VK_FORMAT_R8G8B8A8_SRGB = 43;
+const uint32_t KTX2_VK_FORMAT_BC1_RGB_UNORM = 131;
+const uint32_t KTX2_VK_FORMAT_BC1_RGB_SRGB = 132;
+const uint32_t KTX2_VK_FORMAT_BC3_UNORM = 137;
+const uint32_t KTX2_VK_FORMAT_BC3_SRGB = 138;
+const uint32_t KTX2_VK_FORMAT_BC7_UNORM = 145;
+const uint32_t KTX2_VK_FORMAT_BC7_SRGB = 146;
+
+struct Ktx2Header {
+    unsigned char identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header is 80 bytes");
+
+struct Ktx2LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+struct Ktx2Format {
+    uint32_t vkFormat;
+    GLenum internalFormat;
+    // Bytes per 4x4 block, or per texel when not compressed
+    uint32_t blockBytes;
+    bool compressed;
+    // Needs EXT_texture_compression_s3tc, the rest is core GL 4.3+
+    bool s3tc;
+};
+
+const Ktx2Format KTX2_FORMATS[] = {
+    { 37, GL_RGBA8, 4, false, false },
+    { 43, GL_SRGB8_ALPHA8, 4, false, false },
+    { 131, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8, true, true },
+    { 132, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 8, true, true },
+    { 133, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8, true, true },
+    { 134, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 8, true, true },
+    { 137, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16, true, true },
+    { 138, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 16, true, true },
+    { 145, GL_COMPRESSED_RGBA_BPTC_UNORM, 16, true, false },
+    { 146, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 16, true, false },
+    { 147, GL_COMPRESSED_RGB8_ETC2, 8, true, false },
+    { 148, GL_COMPRESSED_SRGB8_ETC2, 8, true, false },
+    { 149, GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, 8, true, false },
+    { 150, GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, 8, true, false },
+    { 151, GL_COMPRESSED_RGBA8_ETC2_EAC, 16, true, false },
+    { 152, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 16, true, false }
+};
+
+// Format description of a Vulkan format number, NULL when unsupported
+inline const Ktx2Format* findKtx2Format(uint32_t vkFormat) {
+    for (const Ktx2Format& format : KTX2_FORMATS)
+        if (format.vkFormat == vkFormat)
+            return &format;
+    return NULL;
+}
+
+// Bytes of one level of a format
+inline size_t ktx2LevelSize(const Ktx2Format& format, int width, int height) {
+    if (!format.compressed)
+        return size_t(width) * height * format.blockBytes;
+    return size_t((width + 3) / 4) * size_t((height + 3) / 4) *
+        format.blockBytes;
+}
+
+// Whether the current context can sample a format
+inline bool isKtx2FormatSupported(const Ktx2Format& format) {
+    return !format.s3tc ||
+        hasGlExtension("GL_EXT_texture_compression_s3tc");
+}
+
+
+/****************
+ * READING
+ ****************/
+
+struct Ktx2Level {
+    const unsigned char* data = NULL;
+    size_t size = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Parsed file, levels point into the caller's memory
+struct Ktx2Image {
+    const Ktx2Format* format = NULL;
+    int width = 0;
+    int height = 0;
+    // Level 0 (full size) first
+    std::vector<Ktx2Level> levels;
+};
+
+/**
+ * Validates a KTX2 file in memory and locates its levels
+ *
+ * @param data   file contents, must outlive the image
+ * @param size   file size in bytes
+ * @param image  receives the format and level pointers
+ * @return whether the file is a supported 2D texture
+ */
+inline bool parseKtx2(const unsigned char* data, size_t size,
+                      Ktx2Image& image) {
+    Ktx2Header header;
+    if (size < sizeof(header)) {
+        std::cout << "ERROR::KTX2::TRUNCATED" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.identifier, KTX2_IDENTIFIER,
+                    sizeof(KTX2_IDENTIFIER)) != 0) {
+        std::cout << "ERROR::KTX2::NOT_KTX2" << std::endl;
+        return false;
+    }
+    image.format = findKtx2Format(header.vkFormat);
+    if (image.format == NULL) {
+        std::cout << "ERROR::KTX2::UNSUPPORTED_FORMAT " << header.vkFormat <<
+            std::endl;
+        return false;
+    }
+    if (header.supercompressionScheme != 0) {
+        std::cout << "ERROR::KTX2::SUPERCOMPRESSED" << std::endl;
+        return false;
+    }
+    if (header.pixelHeight == 0 || header.pixelDepth > 1 ||
+        header.layerCount > 1 || header.faceCount != 1) {
+        std::cout << "ERROR::KTX2::NOT_2D" << std::endl;
+        return false;
+    }
+    if (header.pixelWidth == 0 || header.pixelWidth > uint32_t(INT_MAX) ||
+        header.pixelHeight > uint32_t(INT_MAX)) {
+        std::cout << "ERROR::KTX2::BAD_SIZE" << std::endl;
+        return false;
+    }
+
+    // levelCount 0 means only level 0 is stored, mips are not generated
+    uint32_t levelCount = std::max(header.levelCount, 1u);
+    uint32_t fullChain = 1;
+    while (std::max(header.pixelWidth, header.pixelHeight) >> fullChain)
+        ++fullChain;
+    if (levelCount > fullChain) {
+        std::cout << "ERROR::KTX2::TOO_MANY_LEVELS" << std::endl;
+        return false;
+    }
+    if (sizeof(header) + levelCount * sizeof(Ktx2LevelIndex) > size) {
+        std::cout << "ERROR::KTX2::TRUNCATED" << std::endl;
+        return false;
+    }
+    image.width = int(header.pixelWidth);
+    image.height = int(header.pixelHeight);
+    image.levels.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        Ktx2LevelIndex index;
+        std::memcpy(&index, data + sizeof(header) +
+                    level * sizeof(Ktx2LevelIndex), sizeof(index));
+        Ktx2Level& target = image.levels[level];
+        target.width = std::max(image.width >> level, 1);
+        target.height = std::max(image.height >> level, 1);
+        size_t expected = ktx2LevelSize(*image.format, target.width,
+                                        target.height);
+        if (index.byteLength < expected || index.byteOffset > size ||
+            index.byteLength > size - index.byteOffset) {
+            std::cout << "ERROR::KTX2::TRUNCATED" << std::endl;
+            return false;
+        }
+        target.data = data + index.byteOffset;
+        target.size = expected;
+    }
+    return true;
+}
+
+/**
+ * Creates an immutable texture holding every level of a parsed file,
+ * compressed data is uploaded as is
+ *
+ * @return texture, 0 when the format is not supported by the context
+ */
+inline GLuint createKtx2Texture(const Ktx2Image& image) {
+    if (!isKtx2FormatSupported(*image.format)) {
+        std::cout << "ERROR::KTX2::FORMAT_NOT_SUPPORTED_BY_CONTEXT" <<
+            std::endl;
+        return 0;
+    }
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    GLenum format = image.format->internalFormat;
+    glTextureStorage2D(texture, GLsizei(image.levels.size()), format,
+                       image.width, image.height);
+    for (size_t level = 0; level < image.levels.size(); ++level) {
+        const Ktx2Level& source = image.levels[level];
+        if (image.format->compressed)
+            glCompressedTextureSubImage2D(texture, GLint(level), 0, 0,
+                                          source.width, source.height,
+                                          format, GLsizei(source.size),
+                                          source.data);
+        else
+            glTextureSubImage2D(texture, GLint(level), 0, 0, source.width,
+                                source.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                                source.data);
+    }
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER,
+                        image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR :
+                        GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+
+/****************
+ * WRITING
+ ****************/
+
+struct Ktx2WriteInfo {
+    // One of the KTX2_VK_FORMAT_* values
+    uint32_t vkFormat = KTX2_VK_FORMAT_BC7_SRGB;
+    int width = 0;
+    int height = 0;
+    // Level payloads, level 0 first
+    std::vector<std::vector<uint8_t>> levels;
+    // Stored under the KTXwriter key
+    const char* writer = "GL-graphics";
+};
+
+// Appends the data format descriptor the spec requires for a format
+inline void appendKtx2Dfd(std::vector<uint8_t>& out, uint32_t vkFormat) {
+    // Colour models and sample channel ids from the Khronos Data Format
+    // specification
+    const uint8_t MODEL_RGBSDA = 1, MODEL_BC1A = 128, MODEL_BC3 = 130,
+        MODEL_BC7 = 135;
+    const uint8_t CHANNEL_ALPHA = 15, DATATYPE_LINEAR = 0x10;
+    struct Sample {
+        uint16_t bitOffset;
+        uint8_t bitLength;
+        uint8_t channel;
+    };
+    bool srgb = vkFormat == KTX2_VK_FORMAT_R8G8B8A8_SRGB ||
+        vkFormat == KTX2_VK_FORMAT_BC1_RGB_SRGB ||
+        vkFormat == KTX2_VK_FORMAT_BC3_SRGB ||
+        vkFormat == KTX2_VK_FORMAT_BC7_SRGB;
+    // Alpha is never sRGB encoded
+    uint8_t alpha = uint8_t(CHANNEL_ALPHA | (srgb ? DATATYPE_LINEAR : 0));
+    const Ktx2Format* format = findKtx2Format(vkFormat);
+    uint8_t model;
+    std::vector<Sample> samples;
+    if (!format->compressed) {
+        model = MODEL_RGBSDA;
+        samples = { { 0, 7, 0 }, { 8, 7, 1 }, { 16, 7, 2 }, { 24, 7, alpha } };
+    } else if (vkFormat == KTX2_VK_FORMAT_BC3_UNORM ||
+               vkFormat == KTX2_VK_FORMAT_BC3_SRGB) {
+        model = MODEL_BC3;
+        samples = { { 0, 63, alpha }, { 64, 63, 0 } };
+    } else if (format->blockBytes == 16) {
+        model = MODEL_BC7;
+        samples = { { 0, 127, 0 } };
+    } else {
+        model = MODEL_BC1A;
+        samples = { { 0, 63, 0 } };
+    }
+
+    auto put32 = [&](uint32_t value) {
+        for (int b = 0; b < 4; ++b)
+            out.push_back(uint8_t(value >> (b * 8)));
+    };
+    uint16_t blockSize = uint16_t(24 + 16 * samples.size());
+    put32(4u + blockSize);
+    put32(0);                                   // Khronos basic descriptor
+    put32(2u | uint32_t(blockSize) << 16);      // version 2
+    out.push_back(model);
+    out.push_back(1);                           // BT.709 primaries
+    out.push_back(srgb ? 2 : 1);                // sRGB or linear transfer
+    out.push_back(0);                           // straight alpha
+    uint8_t dimension = format->compressed ? 3 : 0;
+    const uint8_t texelBlock[4] = { dimension, dimension, 0, 0 };
+    out.insert(out.end(), texelBlock, texelBlock + 4);
+    out.push_back(uint8_t(format->blockBytes));
+    out.insert(out.end(), 7, 0);
+    for (const Sample& sample : samples) {
+        put32(sample.bitOffset | uint32_t(sample.bitLength) << 16 |
+              uint32_t(sample.channel) << 24);
+        put32(0);                               // sample position
+        put32(0);                               // lower
+        put32(sample.bitLength == 7 ? 255u : 0xFFFFFFFFu);
+    }
+}
+
+/**
+ * Writes a 2D texture with its levels as an uncompressed-container KTX2
+ *
+ * @return whether the file was written
+ */
+inline bool writeKtx2File(const char* path, const Ktx2WriteInfo& info) {
+    const Ktx2Format* format = findKtx2Format(info.vkFormat);
+    if (format == NULL || info.levels.empty()) {
+        std::cout << "ERROR::KTX2::UNSUPPORTED_FORMAT " << info.vkFormat <<
+            std::endl;
+        return false;
+    }
+    size_t levelCount = info.levels.size();
+    std::vector<uint8_t> out(sizeof(Ktx2Header) +
+                             levelCount * sizeof(Ktx2LevelIndex));
+    Ktx2Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat = info.vkFormat;
+    header.typeSize = 1;
+    header.pixelWidth = uint32_t(info.width);
+    header.pixelHeight = uint32_t(info.height);
+    header.faceCount = 1;
+    header.levelCount = uint32_t(levelCount);
+
+    header.dfdByteOffset = uint32_t(out.size());
+    appendKtx2Dfd(out, info.vkFormat);
+    header.dfdByteLength = uint32_t(out.size() - header.dfdByteOffset);
+
+    const char key[] = "KTXwriter";
+    header.kvdByteOffset = uint32_t(out.size());
+    size_t writerLength = std::strlen(info.writer) + 1;
+    uint32_t entryLength = uint32_t(sizeof(key) + writerLength);
+    for (int b = 0; b < 4; ++b)
+        out.push_back(uint8_t(entryLength >> (b * 8)));
+    out.insert(out.end(), key, key + sizeof(key));
+    out.insert(out.end(), info.writer, info.writer + writerLength);
+    while (out.size() % 4)
+        out.push_back(0);
+    header.kvdByteLength = uint32_t(out.size() - header.kvdByteOffset);
+
+    // Levels are stored smallest first, aligned to the block size
+    size_t alignment = std::max<size_t>(format->blockBytes, 4);
+    std::vector<Ktx2LevelIndex> index(levelCount);
+    for (size_t level = levelCount; level-- > 0;) {
+        while (out.size() % alignment)
+            out.push_back(0);
+        const std::vector<uint8_t>& payload = info.levels[level];
+        index[level] = { out.size(), payload.size(), payload.size() };
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+    std::memcpy(out.data(), &header, sizeof(header));
+    std::memcpy(out.data() + sizeof(header), index.data(),
+                levelCount * sizeof(Ktx2LevelIndex));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(out.data()),
+               std::streamsize(out.size()));
+    if (!file) {
+        std::cout << "ERROR::KTX2::WRITE_FAILED " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,477 @@
+#ifndef LOD_HPP
+#define LOD_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "index_optimizer.hpp"
+#include "math.hpp"
+#include "mesh_format.hpp"
+
+/**
+ * Level of detail for indexed triangle meshes.
+ *
+ * 1. simplifyMesh()  quadric error metric edge collapse, offline
+ * 2. buildLodChain() simplifies a mesh into LODs that all index the same
+ *                    vertices and packs them into one index list with a
+ *                    MeshLod range each (see mesh_format.hpp)
+ * 3. selectLod()     picks a LOD per object per frame from its projected
+ *                    error in pixels, optionally with a cross-fade band
+ *                    drawn with LOD_FADE_GLSL
+ */
+
+
+/****************
+ * SIMPLIFICATION
+ ****************/
+
+// Symmetric 4x4 plane quadric (Garland and Heckbert), upper triangle
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0, c = 0;
+    // Sum of the plane weights, normalizes evaluate() to a distance
+    double weight = 0;
+
+    // Quadric of the plane n.p + d = 0 (n normalized), scaled by weight
+    static Quadric plane(Vec3 n, float d, float weight) {
+        Quadric q;
+        double x = n.x, y = n.y, z = n.z, w = d;
+        q.a00 = x * x * weight;
+        q.a01 = x * y * weight;
+        q.a02 = x * z * weight;
+        q.a11 = y * y * weight;
+        q.a12 = y * z * weight;
+        q.a22 = z * z * weight;
+        q.b0 = x * w * weight;
+        q.b1 = y * w * weight;
+        q.b2 = z * w * weight;
+        q.c = w * w * weight;
+        q.weight = weight;
+        return q;
+    }
+
+    void add(const Quadric& q) {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02;
+        a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2;
+        c += q.c;
+        weight += q.weight;
+    }
+
+    // Mean squared distance of a point to the accumulated planes
+    double evaluate(Vec3 p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double sum = x * (a00 * x + 2.0 * (a01 * y + a02 * z + b0)) +
+            y * (a11 * y + 2.0 * (a12 * z + b1)) +
+            z * (a22 * z + 2.0 * b2) + c;
+        return weight > 0.0 ? std::fabs(sum) / weight : 0.0;
+    }
+};
+
+// Weight of the planes that keep open borders in place
+const float SIMPLIFY_BORDER_WEIGHT = 10.0f;
+// Collapses rotating a triangle normal by more than ~75 degrees are refused
+const float SIMPLIFY_MIN_NORMAL_DOT = 0.25f;
+
+/**
+ * Simplifies a triangle mesh by collapsing edges into one of their vertices
+ * (half edge collapse), cheapest quadric error first. Vertices never move,
+ * so the result indexes the original vertex buffer. Vertices sharing a
+ * position (UV or normal seams, flat shading) collapse together, each into
+ * the vertex it shares an edge with, so seams only collapse along
+ * themselves and keep their attributes on both sides. Open borders and
+ * seams are held by extra perpendicular planes.
+ *
+ * @param indices           triangle list indices
+ * @param indexCount        number of indices (multiple of 3)
+ * @param positions         first position component of vertex 0
+ * @param vertexCount       number of vertices
+ * @param positionStride    distance between positions in bytes
+ * @param targetIndexCount  stop once the mesh has at most this many indices
+ * @param maxError          stop before collapses that move the surface
+ *                          further than this, in position units
+ * @param resultError       receives the largest error introduced (may be
+ *                          NULL)
+ * @return simplified indices
+ */
+inline std::vector<uint32_t> simplifyMesh(
+    const uint32_t* indices, size_t indexCount, const float* positions,
+    size_t vertexCount, size_t positionStride, size_t targetIndexCount,
+    float maxError, float* resultError = NULL) {
+    std::vector<Vec3> points(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        const float* p = reinterpret_cast<const float*>(
+            reinterpret_cast<const char*>(positions) + v * positionStride);
+        points[v] = Vec3(p[0], p[1], p[2]);
+    }
+    std::vector<uint32_t> result(indices, indices + indexCount);
+
+    // Weld by position, collapses and quadrics work on positions (the
+    // first vertex at each) and the vertices there are linked in a list
+    std::vector<uint32_t> position(vertexCount);
+    std::vector<uint32_t> nextAtPosition(vertexCount, UINT32_MAX);
+    {
+        struct PositionHash {
+            size_t operator()(const Vec3& p) const {
+                // -0.0f equals 0.0f, so it must hash the same
+                float coords[3] = { p.x == 0.0f ? 0.0f : p.x,
+                                    p.y == 0.0f ? 0.0f : p.y,
+                                    p.z == 0.0f ? 0.0f : p.z };
+                uint32_t bits[3];
+                std::memcpy(bits, coords, sizeof(bits));
+                return size_t(bits[0] * 73856093u ^ bits[1] * 19349663u ^
+                              bits[2] * 83492791u);
+            }
+        };
+        struct PositionEqual {
+            bool operator()(const Vec3& a, const Vec3& b) const {
+                return a.x == b.x && a.y == b.y && a.z == b.z;
+            }
+        };
+        std::unordered_map<Vec3, uint32_t, PositionHash, PositionEqual>
+            firstVertex;
+        firstVertex.reserve(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            auto inserted = firstVertex.emplace(points[v], v);
+            uint32_t first = inserted.first->second;
+            position[v] = first;
+            if (!inserted.second) {
+                nextAtPosition[v] = nextAtPosition[first];
+                nextAtPosition[first] = v;
+            }
+        }
+    }
+
+    // Face quadrics weighted by area, border planes along open edges
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<uint64_t> edges;
+    edges.reserve(indexCount);
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        uint32_t corner[3] = { result[t], result[t + 1], result[t + 2] };
+        Vec3 normal = cross(points[corner[1]] - points[corner[0]],
+                            points[corner[2]] - points[corner[0]]);
+        float area = length(normal);
+        if (area == 0.0f)
+            continue;
+        normal = normal / area;
+        Quadric q = Quadric::plane(normal, -dot(normal, points[corner[0]]),
+                                   area);
+        for (uint32_t v : corner)
+            quadrics[position[v]].add(q);
+        for (int e = 0; e < 3; ++e) {
+            uint32_t a = corner[e], b = corner[(e + 1) % 3];
+            edges.push_back(uint64_t(std::min(a, b)) << 32 | std::max(a, b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        uint32_t corner[3] = { result[t], result[t + 1], result[t + 2] };
+        Vec3 normal = cross(points[corner[1]] - points[corner[0]],
+                            points[corner[2]] - points[corner[0]]);
+        if (length(normal) == 0.0f)
+            continue;
+        for (int e = 0; e < 3; ++e) {
+            uint32_t a = corner[e], b = corner[(e + 1) % 3];
+            uint64_t key = uint64_t(std::min(a, b)) << 32 | std::max(a, b);
+            auto range = std::equal_range(edges.begin(), edges.end(), key);
+            if (range.second - range.first != 1)
+                continue;
+            Vec3 edge = points[b] - points[a];
+            Vec3 side = cross(edge, normal);
+            float sideLength = length(side);
+            if (sideLength == 0.0f)
+                continue;
+            side = side / sideLength;
+            Quadric q = Quadric::plane(side, -dot(side, points[a]),
+                                       dot(edge, edge) *
+                                       SIMPLIFY_BORDER_WEIGHT);
+            quadrics[position[a]].add(q);
+            quadrics[position[b]].add(q);
+        }
+    }
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+    std::vector<uint32_t> remap(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        remap[v] = uint32_t(v);
+    std::vector<uint32_t> adjacencyStart(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<char> touched(vertexCount);
+    // Vertex each vertex of a collapsing position moves to
+    std::vector<uint32_t> targets(vertexCount, UINT32_MAX);
+    std::vector<Collapse> collapses;
+    double maxCost = double(maxError) * double(maxError);
+    double worstCost = 0.0;
+
+    // Each pass collapses a set of edges that share no vertices
+    while (result.size() > targetIndexCount) {
+        size_t triangleCount = result.size() / 3;
+
+        std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+        for (uint32_t v : result)
+            ++adjacencyStart[v + 1];
+        for (size_t v = 0; v < vertexCount; ++v)
+            adjacencyStart[v + 1] += adjacencyStart[v];
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(adjacencyStart.begin(),
+                                   adjacencyStart.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i)
+            adjacency[fill[result[i]]++] = uint32_t(i / 3);
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); ++i) {
+            uint32_t a = position[result[i]];
+            uint32_t b = position[result[i - i % 3 + (i + 1) % 3]];
+            if (a == b)
+                continue;
+            Quadric sum = quadrics[a];
+            sum.add(quadrics[b]);
+            collapses.push_back({ a, b, sum.evaluate(points[b]) });
+            collapses.push_back({ b, a, sum.evaluate(points[a]) });
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse& x, const Collapse& y) {
+                      return x.cost < y.cost;
+                  });
+
+        auto resolve = [&](uint32_t v) {
+            while (remap[v] != v)
+                v = remap[v];
+            return v;
+        };
+        // Each vertex at `from` moves to the vertex at `to` it shares an
+        // edge with. Refused when one has none but keeps triangles off the
+        // edge (they would take another vertex's attributes), or has
+        // several (the end of a seam).
+        auto findTargets = [&](uint32_t from, uint32_t to) {
+            for (uint32_t v = from; v != UINT32_MAX; v = nextAtPosition[v]) {
+                uint32_t target = UINT32_MAX;
+                bool needsTarget = false;
+                for (uint32_t a = adjacencyStart[v];
+                     a < adjacencyStart[v + 1]; ++a) {
+                    size_t t = size_t(adjacency[a]) * 3;
+                    uint32_t found = UINT32_MAX;
+                    for (int c = 0; c < 3; ++c) {
+                        uint32_t corner = resolve(result[t + c]);
+                        if (position[corner] == to)
+                            found = corner;
+                    }
+                    if (found == UINT32_MAX)
+                        needsTarget = true;
+                    else if (target == UINT32_MAX)
+                        target = found;
+                    else if (target != found)
+                        return false;
+                }
+                if (needsTarget && target == UINT32_MAX)
+                    return false;
+                targets[v] = target;
+            }
+            return true;
+        };
+        // Each collapse removes about two triangles
+        size_t budget = (triangleCount - targetIndexCount / 3 + 1) / 2;
+        size_t applied = 0;
+        std::fill(touched.begin(), touched.end(), 0);
+        for (const Collapse& collapse : collapses) {
+            if (collapse.cost > maxCost || applied >= budget)
+                break;
+            if (touched[collapse.from] || touched[collapse.to] ||
+                !findTargets(collapse.from, collapse.to))
+                continue;
+            bool flips = false;
+            for (uint32_t v = collapse.from; v != UINT32_MAX && !flips;
+                 v = nextAtPosition[v]) {
+                for (uint32_t a = adjacencyStart[v];
+                     a < adjacencyStart[v + 1] && !flips; ++a) {
+                    size_t t = size_t(adjacency[a]) * 3;
+                    uint32_t corner[3] = { resolve(result[t]),
+                                           resolve(result[t + 1]),
+                                           resolve(result[t + 2]) };
+                    if (position[corner[0]] == collapse.to ||
+                        position[corner[1]] == collapse.to ||
+                        position[corner[2]] == collapse.to)
+                        continue;
+                    Vec3 before = cross(points[corner[1]] - points[corner[0]],
+                                        points[corner[2]] - points[corner[0]]);
+                    for (uint32_t& c : corner)
+                        if (c == v)
+                            c = targets[v];
+                    Vec3 after = cross(points[corner[1]] - points[corner[0]],
+                                       points[corner[2]] - points[corner[0]]);
+                    flips = dot(before, after) < SIMPLIFY_MIN_NORMAL_DOT *
+                        length(before) * length(after);
+                }
+            }
+            if (flips)
+                continue;
+            for (uint32_t v = collapse.from; v != UINT32_MAX;
+                 v = nextAtPosition[v])
+                if (targets[v] != UINT32_MAX)
+                    remap[v] = targets[v];
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            touched[collapse.from] = touched[collapse.to] = 1;
+            worstCost = std::max(worstCost, collapse.cost);
+            ++applied;
+        }
+        if (applied == 0)
+            break;
+
+        // Apply the collapses and drop triangles that became degenerate
+        size_t write = 0;
+        for (size_t t = 0; t + 2 < result.size(); t += 3) {
+            uint32_t a = resolve(result[t]);
+            uint32_t b = resolve(result[t + 1]);
+            uint32_t c = resolve(result[t + 2]);
+            if (position[a] == position[b] || position[b] == position[c] ||
+                position[c] == position[a])
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+        for (size_t v = 0; v < vertexCount; ++v)
+            remap[v] = resolve(uint32_t(v));
+    }
+
+    if (resultError)
+        *resultError = float(std::sqrt(std::max(worstCost, 0.0)));
+    return result;
+}
+
+
+/****************
+ * LOD CHAIN
+ ****************/
+
+struct LodChain {
+    // Every LOD back to back, LOD 0 first
+    std::vector<uint32_t> indices;
+    std::vector<MeshLod> lods;
+};
+
+/**
+ * Simplifies a mesh into a chain of LODs sharing its vertices. Each LOD
+ * targets a fraction of the previous one's triangles and is cache optimized
+ * on its own. Generation stops early when a level no longer shrinks.
+ *
+ * @param maxLods    number of LODs including the full detail mesh
+ * @param ratio      triangle ratio between consecutive LODs
+ * @param meshSize   size errors are relative to, e.g. the bounds diagonal
+ */
+inline LodChain buildLodChain(const uint32_t* indices, size_t indexCount,
+                              const float* positions, size_t vertexCount,
+                              size_t positionStride, size_t maxLods,
+                              float ratio, float meshSize) {
+    LodChain chain;
+    chain.indices.assign(indices, indices + indexCount);
+    optimizeVertexCache(chain.indices.data(), indexCount, vertexCount);
+    chain.lods.push_back({ 0, uint32_t(indexCount), 0.0f, 0 });
+
+    size_t target = indexCount;
+    float previousError = 0.0f;
+    while (chain.lods.size() < maxLods) {
+        target = size_t(double(target / 3) * ratio) * 3;
+        if (target < 3)
+            break;
+        // Simplify from full detail so quadrics describe the real surface
+        float error = 0.0f;
+        std::vector<uint32_t> level = simplifyMesh(
+            indices, indexCount, positions, vertexCount, positionStride,
+            target, meshSize, &error);
+        const MeshLod& previous = chain.lods.back();
+        if (level.empty() || level.size() >= previous.indexCount)
+            break;
+        optimizeVertexCache(level.data(), level.size(), vertexCount);
+        previousError = std::max(previousError, error / meshSize);
+        chain.lods.push_back({ uint32_t(chain.indices.size()),
+                               uint32_t(level.size()), previousError, 0 });
+        chain.indices.insert(chain.indices.end(), level.begin(),
+                             level.end());
+    }
+    return chain;
+}
+
+
+/****************
+ * SELECTION
+ ****************/
+
+struct LodSelection {
+    uint32_t lod = 0;
+    // Coarser LOD being faded in and its weight, fade is 0 outside the band
+    uint32_t fadeLod = 0;
+    float fade = 0.0f;
+};
+
+/**
+ * Pixels per world unit at distance 1, projected errors are divided by the
+ * distance
+ *
+ * @param fovY            vertical field of view in radians
+ * @param viewportHeight  render target height in pixels
+ */
+inline float lodProjectionScale(float fovY, float viewportHeight) {
+    return viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+}
+
+/**
+ * Picks the coarsest LOD whose error projects to at most maxPixelError
+ *
+ * @param lods              LOD ranges, errors increasing
+ * @param lodCount          number of LODs
+ * @param meshSize          world size errors are relative to (the mesh
+ *                          size used for buildLodChain() times the scale)
+ * @param distance          distance from the camera to the object
+ * @param projectionScale   see lodProjectionScale()
+ * @param maxPixelError     tolerated screen space error
+ * @param fadeBand          fraction above maxPixelError in which the next
+ *                          LOD starts fading in, 0 disables cross-fading
+ */
+inline LodSelection selectLod(const MeshLod* lods, size_t lodCount,
+                              float meshSize, float distance,
+                              float projectionScale, float maxPixelError,
+                              float fadeBand = 0.0f) {
+    LodSelection selection;
+    float pixelsPerError = meshSize * projectionScale /
+        std::max(distance, 1e-6f);
+    while (selection.lod + 1 < lodCount &&
+           lods[selection.lod + 1].error * pixelsPerError <= maxPixelError)
+        ++selection.lod;
+    if (fadeBand > 0.0f && selection.lod + 1 < lodCount) {
+        float excess = lods[selection.lod + 1].error * pixelsPerError /
+            maxPixelError - 1.0f;
+        if (excess < fadeBand) {
+            selection.fadeLod = selection.lod + 1;
+            selection.fade = 1.0f - excess / fadeBand;
+        }
+    }
+    return selection;
+}
+
+/**
+ * Screen door cross-fade for fragment shaders. During a transition both
+ * LODs are drawn, the current one with lodFadeDiscard(fade, false) and the
+ * incoming one with lodFadeDiscard(fade, true), so every pixel shows exactly
+ * one of them and no blending or sorting is needed.
+ */
+const char* const LOD_FADE_GLSL =
+    "bool lodFadeDiscard(float fade, bool incoming) {\n"
+    "    const float bayer[16] = float[16](\n"
+    "        0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0,\n"
+    "        3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);\n"
+    "    ivec2 cell = ivec2(gl_FragCoord.xy) & 3;\n"
+    "    float threshold = (bayer[cell.y * 4 + cell.x] + 0.5) / 16.0;\n"
+    "    return incoming ? threshold >= fade : threshold < fade;\n"
+    "}\n";
+
+#endif
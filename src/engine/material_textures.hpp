@@ -0,0 +1,207 @@
+#ifndef MATERIAL_TEXTURES_HPP
+#define MATERIAL_TEXTURES_HPP
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "buffer.hpp"
+#include "gl_extensions.hpp"
+#include "texture_atlas.hpp"
+#include "texture_compression.hpp"
+
+/**
+ * Material textures sampled by index, so draws using different textures
+ * need no texture binds in between and can share one multi-draw.
+ *
+ * With ARB_bindless_texture every image is its own mipmapped texture and
+ * the SSBO holds its resident handle. Without it the images are packed
+ * into a TextureAtlas (skyline, see texture_atlas.hpp) and the SSBO holds
+ * their regions. Shaders include glsl() and call sampleMaterial(index, uv)
+ * in either mode; the array path emulates repeat addressing inside each
+ * region.
+ *
+ * Keep the index dynamically uniform (a per-draw value such as a
+ * baseInstance attribute), handles that diverge inside a draw are not
+ * portable.
+ */
+
+const GLuint MATERIAL_TEXTURES_BINDING = 6;
+// Texture unit of the atlas in the array fallback
+const GLuint MATERIAL_ATLAS_UNIT = 15;
+
+enum MaterialTextureMode {
+    MATERIAL_TEXTURES_BINDLESS,
+    MATERIAL_TEXTURES_ARRAY
+};
+
+// Fragment shader code for each mode, glsl() defines the bindings
+const char* const MATERIAL_TEXTURES_BINDLESS_GLSL =
+    "#extension GL_ARB_bindless_texture : require\n"
+    "layout (std430, binding = MATERIAL_TEXTURES_BINDING)\n"
+    "readonly buffer MaterialTextureBuffer {\n"
+    "    uvec2 materialHandles[];\n"
+    "};\n"
+    "vec4 sampleMaterial(uint index, vec2 uv) {\n"
+    "    return texture(sampler2D(materialHandles[index]), uv);\n"
+    "}\n";
+
+const char* const MATERIAL_TEXTURES_ARRAY_GLSL =
+    "struct AtlasRegion {\n"
+    "    vec2 offset;\n"
+    "    vec2 scale;\n"
+    "    uint layer;\n"
+    "    uint reserved[3];\n"
+    "};\n"
+    "layout (std430, binding = MATERIAL_TEXTURES_BINDING)\n"
+    "readonly buffer MaterialTextureBuffer {\n"
+    "    AtlasRegion materialRegions[];\n"
+    "};\n"
+    "layout (binding = MATERIAL_ATLAS_UNIT)\n"
+    "uniform sampler2DArray materialAtlas;\n"
+    "vec4 sampleMaterial(uint index, vec2 uv) {\n"
+    "    AtlasRegion region = materialRegions[index];\n"
+    "    // Wrap inside the region, gradients of the unwrapped coordinates\n"
+    "    // keep the mip selection continuous across the seam\n"
+    "    vec2 scaled = uv * region.scale;\n"
+    "    vec3 coord = vec3(region.offset + fract(uv) * region.scale,\n"
+    "                      float(region.layer));\n"
+    "    return textureGrad(materialAtlas, coord, dFdx(scaled),\n"
+    "                       dFdy(scaled));\n"
+    "}\n";
+
+class MaterialTextures {
+public:
+    MaterialTextures() = default;
+    MaterialTextures(const MaterialTextures&) = delete;
+    MaterialTextures& operator=(const MaterialTextures&) = delete;
+
+    /**
+     * Picks the mode, loadGlExtensions() must have run
+     *
+     * @param allowBindless  false forces the texture array path
+     */
+    void create(bool allowBindless = true) {
+        currentMode = allowBindless && GLAD_GL_ARB_bindless_texture ?
+            MATERIAL_TEXTURES_BINDLESS : MATERIAL_TEXTURES_ARRAY;
+    }
+
+    /**
+     * Queues an image, the pixels are copied
+     *
+     * @param rgba  tightly packed RGBA8, top row first
+     * @return material texture index used by sampleMaterial()
+     */
+    uint32_t add(const uint8_t* rgba, int width, int height) {
+        images.push_back(copyImage(rgba, width, height));
+        return uint32_t(images.size() - 1);
+    }
+
+    /**
+     * Creates the textures and the SSBO from the queued images
+     *
+     * @param srgb  store colour data as sRGB
+     * @return false if no images were queued or the atlas could not be
+     *         packed
+     */
+    bool build(bool srgb = true) {
+        if (images.empty())
+            return false;
+        // Rebuilding replaces the textures and table of the last build
+        release();
+        GLenum format = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        if (currentMode == MATERIAL_TEXTURES_BINDLESS) {
+            std::vector<GLuint64> handles;
+            textures.resize(images.size());
+            glCreateTextures(GL_TEXTURE_2D, GLsizei(textures.size()),
+                             textures.data());
+            for (size_t i = 0; i < images.size(); ++i) {
+                const ImageLevel& image = images[i];
+                GLsizei levels = 1;
+                while ((std::max(image.width, image.height) >> levels) > 0)
+                    ++levels;
+                glTextureStorage2D(textures[i], levels, format, image.width,
+                                   image.height);
+                glTextureSubImage2D(textures[i], 0, 0, 0, image.width,
+                                    image.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                                    image.rgba.data());
+                glGenerateTextureMipmap(textures[i]);
+                glTextureParameteri(textures[i], GL_TEXTURE_MIN_FILTER,
+                                    GL_LINEAR_MIPMAP_LINEAR);
+                // Sampler state is baked into the handle, set it first
+                GLuint64 handle = glGetTextureHandleARB(textures[i]);
+                glMakeTextureHandleResidentARB(handle);
+                handles.push_back(handle);
+            }
+            table = Buffer(GLsizeiptr(handles.size() * sizeof(GLuint64)),
+                           handles.data(), 0);
+        } else {
+            for (const ImageLevel& image : images)
+                atlas.add(image.rgba.data(), image.width, image.height);
+            if (!atlas.build(ATLAS_SKYLINE, 2048, 4, srgb))
+                return false;
+            atlas.releaseImages();
+            table = Buffer(GLsizeiptr(atlas.regions.size() *
+                                      sizeof(AtlasRegion)),
+                           atlas.regions.data(), 0);
+        }
+        images.clear();
+        images.shrink_to_fit();
+        return true;
+    }
+
+    // Binds the SSBO (and the atlas in the array fallback) for drawing
+    void bind() const {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_TEXTURES_BINDING,
+                         table.ID);
+        if (currentMode == MATERIAL_TEXTURES_ARRAY)
+            glBindTextureUnit(MATERIAL_ATLAS_UNIT, atlas.texture);
+    }
+
+    MaterialTextureMode mode() const {
+        return currentMode;
+    }
+
+    // GLSL defining sampleMaterial() for the current mode, inserted
+    // right after #version
+    std::string glsl() const {
+        return "#define MATERIAL_TEXTURES_BINDING " +
+            std::to_string(MATERIAL_TEXTURES_BINDING) +
+            "\n#define MATERIAL_ATLAS_UNIT " +
+            std::to_string(MATERIAL_ATLAS_UNIT) + "\n" +
+            (currentMode == MATERIAL_TEXTURES_BINDLESS ?
+             MATERIAL_TEXTURES_BINDLESS_GLSL : MATERIAL_TEXTURES_ARRAY_GLSL);
+    }
+
+    void destroy() {
+        release();
+        images.clear();
+    }
+
+private:
+    MaterialTextureMode currentMode = MATERIAL_TEXTURES_ARRAY;
+    std::vector<ImageLevel> images;
+    // Bindless mode
+    std::vector<GLuint> textures;
+    // Array mode
+    TextureAtlas atlas;
+    // Handles or atlas regions, indexed by material texture
+    Buffer table;
+
+    // Deletes what build() created, queued images are kept
+    void release() {
+        for (GLuint texture : textures)
+            glMakeTextureHandleNonResidentARB(
+                glGetTextureHandleARB(texture));
+        glDeleteTextures(GLsizei(textures.size()), textures.data());
+        textures.clear();
+        atlas.destroy();
+        table.destroy();
+    }
+};
+
+#endif
@@ -0,0 +1,393 @@
+#ifndef MATH_HPP
+#define MATH_HPP
+
+#include <cmath>
+
+#include "simd.hpp"
+
+/**
+ * Vector, matrix and quaternion maths for transforms.
+ *
+ * Conventions follow OpenGL and GLSL:
+ * - Mat4 is column-major, data() can go straight to glUniformMatrix4fv with
+ *   transpose GL_FALSE
+ * - vectors are columns, so `projection * view * model * point`
+ * - right-handed view space looking down -Z, clip space depth in [-1, 1]
+ *
+ * Constructors and element-wise operations are constexpr. Matrix products
+ * and transforms go through Float4 (see simd.hpp) and so are runtime only;
+ * batched versions over many points or matrices are in math_batch.hpp.
+ */
+
+constexpr float PI = 3.14159265358979323846f;
+
+constexpr float radians(float degrees) {
+    return degrees * (PI / 180.0f);
+}
+
+
+/****************
+ * VECTORS
+ ****************/
+
+struct Vec2 {
+    float x = 0.0f, y = 0.0f;
+
+    constexpr Vec2() = default;
+    constexpr Vec2(float x, float y) : x(x), y(y) {}
+};
+
+struct Vec3 {
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+
+    constexpr Vec3() = default;
+    constexpr Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+    constexpr explicit Vec3(float s) : x(s), y(s), z(s) {}
+};
+
+struct alignas(16) Vec4 {
+    float x = 0.0f, y = 0.0f, z = 0.0f, w = 0.0f;
+
+    constexpr Vec4() = default;
+    constexpr Vec4(float x, float y, float z, float w)
+        : x(x), y(y), z(z), w(w) {}
+    constexpr Vec4(const Vec3& v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+
+    constexpr Vec3 xyz() const { return { x, y, z }; }
+    Float4 load() const { return Float4::load(&x); }
+    static Vec4 from(Float4 f) {
+        Vec4 v;
+        f.store(&v.x);
+        return v;
+    }
+};
+
+constexpr Vec2 operator+(Vec2 a, Vec2 b) { return { a.x + b.x, a.y + b.y }; }
+constexpr Vec2 operator-(Vec2 a, Vec2 b) { return { a.x - b.x, a.y - b.y }; }
+constexpr Vec2 operator*(Vec2 a, float s) { return { a.x * s, a.y * s }; }
+constexpr float dot(Vec2 a, Vec2 b) { return a.x * b.x + a.y * b.y; }
+
+constexpr Vec3 operator+(Vec3 a, Vec3 b) {
+    return { a.x + b.x, a.y + b.y, a.z + b.z };
+}
+constexpr Vec3 operator-(Vec3 a, Vec3 b) {
+    return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+constexpr Vec3 operator-(Vec3 a) { return { -a.x, -a.y, -a.z }; }
+constexpr Vec3 operator*(Vec3 a, Vec3 b) {
+    return { a.x * b.x, a.y * b.y, a.z * b.z };
+}
+constexpr Vec3 operator*(Vec3 a, float s) {
+    return { a.x * s, a.y * s, a.z * s };
+}
+constexpr Vec3 operator*(float s, Vec3 a) { return a * s; }
+constexpr Vec3 operator/(Vec3 a, float s) {
+    return { a.x / s, a.y / s, a.z / s };
+}
+constexpr float dot(Vec3 a, Vec3 b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+constexpr Vec3 cross(Vec3 a, Vec3 b) {
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+             a.x * b.y - a.y * b.x };
+}
+constexpr Vec3 minimum(Vec3 a, Vec3 b) {
+    return { a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y,
+             a.z < b.z ? a.z : b.z };
+}
+constexpr Vec3 maximum(Vec3 a, Vec3 b) {
+    return { a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y,
+             a.z > b.z ? a.z : b.z };
+}
+inline float length(Vec3 a) { return std::sqrt(dot(a, a)); }
+inline Vec3 normalize(Vec3 a) {
+    float len = length(a);
+    return len > 0.0f ? a / len : a;
+}
+
+constexpr Vec4 operator+(const Vec4& a, const Vec4& b) {
+    return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+}
+constexpr Vec4 operator-(const Vec4& a, const Vec4& b) {
+    return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+}
+constexpr Vec4 operator*(const Vec4& a, float s) {
+    return { a.x * s, a.y * s, a.z * s, a.w * s };
+}
+constexpr float dot(const Vec4& a, const Vec4& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+
+/****************
+ * MAT4
+ ****************/
+
+struct Mat4 {
+    // Columns, GLSL style: columns[c] is mat[c]
+    Vec4 columns[4];
+
+    constexpr Mat4() = default;
+    constexpr Mat4(const Vec4& c0, const Vec4& c1, const Vec4& c2,
+                   const Vec4& c3)
+        : columns{ c0, c1, c2, c3 } {}
+
+    static constexpr Mat4 identity() {
+        return { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 },
+                 { 0, 0, 0, 1 } };
+    }
+
+    // Element at row r, column c
+    constexpr float at(int r, int c) const {
+        const Vec4& column = columns[c];
+        return r == 0 ? column.x : (r == 1 ? column.y :
+                                    (r == 2 ? column.z : column.w));
+    }
+
+    const float* data() const { return &columns[0].x; }
+    float* data() { return &columns[0].x; }
+};
+
+// Column combination: m * v = sum(m[i] * v[i])
+inline Float4 transform(const Mat4& m, Float4 x, Float4 y, Float4 z,
+                        Float4 w) {
+    Float4 r = m.columns[0].load() * x;
+    r = madd(m.columns[1].load(), y, r);
+    r = madd(m.columns[2].load(), z, r);
+    return madd(m.columns[3].load(), w, r);
+}
+
+inline Vec4 operator*(const Mat4& m, const Vec4& v) {
+    return Vec4::from(transform(m, Float4::splat(v.x), Float4::splat(v.y),
+                                Float4::splat(v.z), Float4::splat(v.w)));
+}
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b) {
+    Mat4 r;
+    for (int c = 0; c < 4; ++c)
+        r.columns[c] = a * b.columns[c];
+    return r;
+}
+
+// Transforms a point (w = 1), ignoring projection
+inline Vec3 transformPoint(const Mat4& m, Vec3 p) {
+    return (m * Vec4(p, 1.0f)).xyz();
+}
+
+// Transforms a direction (w = 0)
+inline Vec3 transformVector(const Mat4& m, Vec3 v) {
+    return (m * Vec4(v, 0.0f)).xyz();
+}
+
+constexpr Mat4 transpose(const Mat4& m) {
+    return { { m.at(0, 0), m.at(0, 1), m.at(0, 2), m.at(0, 3) },
+             { m.at(1, 0), m.at(1, 1), m.at(1, 2), m.at(1, 3) },
+             { m.at(2, 0), m.at(2, 1), m.at(2, 2), m.at(2, 3) },
+             { m.at(3, 0), m.at(3, 1), m.at(3, 2), m.at(3, 3) } };
+}
+
+constexpr Mat4 translate(Vec3 t) {
+    return { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 },
+             { t.x, t.y, t.z, 1 } };
+}
+
+constexpr Mat4 scale(Vec3 s) {
+    return { { s.x, 0, 0, 0 }, { 0, s.y, 0, 0 }, { 0, 0, s.z, 0 },
+             { 0, 0, 0, 1 } };
+}
+
+/**
+ * Rotation about an axis
+ *
+ * @param angle  radians, counter-clockwise looking down the axis
+ * @param axis   rotation axis, does not need to be normalized
+ */
+inline Mat4 rotate(float angle, Vec3 axis) {
+    Vec3 a = normalize(axis);
+    float c = std::cos(angle), s = std::sin(angle), t = 1.0f - c;
+    return { { t * a.x * a.x + c, t * a.x * a.y + s * a.z,
+               t * a.x * a.z - s * a.y, 0 },
+             { t * a.x * a.y - s * a.z, t * a.y * a.y + c,
+               t * a.y * a.z + s * a.x, 0 },
+             { t * a.x * a.z + s * a.y, t * a.y * a.z - s * a.x,
+               t * a.z * a.z + c, 0 },
+             { 0, 0, 0, 1 } };
+}
+
+constexpr Mat4 ortho(float left, float right, float bottom, float top,
+                     float zNear, float zFar) {
+    return { { 2.0f / (right - left), 0, 0, 0 },
+             { 0, 2.0f / (top - bottom), 0, 0 },
+             { 0, 0, -2.0f / (zFar - zNear), 0 },
+             { -(right + left) / (right - left),
+               -(top + bottom) / (top - bottom),
+               -(zFar + zNear) / (zFar - zNear), 1 } };
+}
+
+/**
+ * Perspective projection
+ *
+ * @param fovY    vertical field of view in radians
+ * @param aspect  width / height
+ */
+inline Mat4 perspective(float fovY, float aspect, float zNear, float zFar) {
+    float f = 1.0f / std::tan(fovY * 0.5f);
+    return { { f / aspect, 0, 0, 0 },
+             { 0, f, 0, 0 },
+             { 0, 0, (zFar + zNear) / (zNear - zFar), -1 },
+             { 0, 0, 2.0f * zFar * zNear / (zNear - zFar), 0 } };
+}
+
+inline Mat4 lookAt(Vec3 eye, Vec3 center, Vec3 up) {
+    Vec3 f = normalize(center - eye);
+    Vec3 s = normalize(cross(f, up));
+    Vec3 u = cross(s, f);
+    return { { s.x, u.x, -f.x, 0 },
+             { s.y, u.y, -f.y, 0 },
+             { s.z, u.z, -f.z, 0 },
+             { -dot(s, eye), -dot(u, eye), dot(f, eye), 1 } };
+}
+
+// Inverse through cofactors, returns identity for singular matrices
+inline Mat4 inverse(const Mat4& m) {
+    const float* a = m.data();
+    float inv[16];
+    inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] -
+        a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] -
+        a[13] * a[7] * a[10];
+    inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] +
+        a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] +
+        a[12] * a[7] * a[10];
+    inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] -
+        a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] -
+        a[12] * a[7] * a[9];
+    inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] +
+        a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] +
+        a[12] * a[6] * a[9];
+    inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] +
+        a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] +
+        a[13] * a[3] * a[10];
+    inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] -
+        a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] -
+        a[12] * a[3] * a[10];
+    inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] +
+        a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] +
+        a[12] * a[3] * a[9];
+    inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] -
+        a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] -
+        a[12] * a[2] * a[9];
+    inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] -
+        a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] -
+        a[13] * a[3] * a[6];
+    inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] +
+        a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] +
+        a[12] * a[3] * a[6];
+    inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] -
+        a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] -
+        a[12] * a[3] * a[5];
+    inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] +
+        a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] +
+        a[12] * a[2] * a[5];
+    inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] +
+        a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] +
+        a[9] * a[3] * a[6];
+    inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] -
+        a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] -
+        a[8] * a[3] * a[6];
+    inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] +
+        a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] +
+        a[8] * a[3] * a[5];
+    inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] -
+        a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] -
+        a[8] * a[2] * a[5];
+
+    float det = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] +
+        a[3] * inv[12];
+    if (det == 0.0f)
+        return Mat4::identity();
+    Mat4 result;
+    float* r = result.data();
+    for (int i = 0; i < 16; ++i)
+        r[i] = inv[i] / det;
+    return result;
+}
+
+
+/****************
+ * QUATERNIONS
+ ****************/
+
+// Rotation quaternion, (x, y, z) is the vector part
+struct Quat {
+    float x = 0.0f, y = 0.0f, z = 0.0f, w = 1.0f;
+
+    constexpr Quat() = default;
+    constexpr Quat(float x, float y, float z, float w)
+        : x(x), y(y), z(z), w(w) {}
+
+    static Quat fromAxisAngle(Vec3 axis, float angle) {
+        Vec3 a = normalize(axis) * std::sin(angle * 0.5f);
+        return { a.x, a.y, a.z, std::cos(angle * 0.5f) };
+    }
+};
+
+// Composition, (a * b) applies b first
+constexpr Quat operator*(const Quat& a, const Quat& b) {
+    return { a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+             a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+             a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+             a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z };
+}
+
+constexpr Quat conjugate(const Quat& q) { return { -q.x, -q.y, -q.z, q.w }; }
+
+constexpr float dot(const Quat& a, const Quat& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+inline Quat normalize(const Quat& q) {
+    float len = std::sqrt(dot(q, q));
+    return len > 0.0f ? Quat(q.x / len, q.y / len, q.z / len, q.w / len) : q;
+}
+
+// Rotates a vector by a unit quaternion
+constexpr Vec3 rotate(const Quat& q, Vec3 v) {
+    Vec3 u(q.x, q.y, q.z);
+    Vec3 t = cross(u, v) * 2.0f;
+    return v + t * q.w + cross(u, t);
+}
+
+// Rotation matrix of a unit quaternion
+constexpr Mat4 toMat4(const Quat& q) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    return { { 1 - 2 * (yy + zz), 2 * (xy + wz), 2 * (xz - wy), 0 },
+             { 2 * (xy - wz), 1 - 2 * (xx + zz), 2 * (yz + wx), 0 },
+             { 2 * (xz + wy), 2 * (yz - wx), 1 - 2 * (xx + yy), 0 },
+             { 0, 0, 0, 1 } };
+}
+
+// Spherical interpolation along the shortest arc
+inline Quat slerp(const Quat& a, Quat b, float t) {
+    float cosTheta = dot(a, b);
+    if (cosTheta < 0.0f) {
+        b = { -b.x, -b.y, -b.z, -b.w };
+        cosTheta = -cosTheta;
+    }
+    float wa, wb;
+    if (cosTheta > 0.9995f) {
+        // Nearly parallel, lerp avoids dividing by sin(~0)
+        wa = 1.0f - t;
+        wb = t;
+    } else {
+        float theta = std::acos(cosTheta);
+        float sinTheta = std::sin(theta);
+        wa = std::sin((1.0f - t) * theta) / sinTheta;
+        wb = std::sin(t * theta) / sinTheta;
+    }
+    return normalize(Quat(a.x * wa + b.x * wb, a.y * wa + b.y * wb,
+                          a.z * wa + b.z * wb, a.w * wa + b.w * wb));
+}
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef MATH_BATCH_HPP
+#define MATH_BATCH_HPP
+
+#include <vector>
+
+#include "math.hpp"
+#include "simd.hpp"
+
+/**
+ * Batched transform kernels over structure-of-arrays data.
+ *
+ * Each SIMD lane handles a different point or matrix, so every lane does the
+ * same scalar maths as the single versions in math.hpp and no shuffles are
+ * needed.
+ */
+
+/**
+ * Transforms points (w = 1) by one matrix, ignoring projection. Input and
+ * output arrays may alias.
+ *
+ * @param m      transform
+ * @param x      input x coordinates (y and z likewise)
+ * @param outX   output x coordinates (outY and outZ likewise)
+ * @param count  number of points
+ */
+inline void transformPoints(const Mat4& m, const float* x, const float* y,
+                            const float* z, float* outX, float* outY,
+                            float* outZ, size_t count) {
+    FloatWide m00 = FloatWide::splat(m.columns[0].x);
+    FloatWide m10 = FloatWide::splat(m.columns[0].y);
+    FloatWide m20 = FloatWide::splat(m.columns[0].z);
+    FloatWide m01 = FloatWide::splat(m.columns[1].x);
+    FloatWide m11 = FloatWide::splat(m.columns[1].y);
+    FloatWide m21 = FloatWide::splat(m.columns[1].z);
+    FloatWide m02 = FloatWide::splat(m.columns[2].x);
+    FloatWide m12 = FloatWide::splat(m.columns[2].y);
+    FloatWide m22 = FloatWide::splat(m.columns[2].z);
+    FloatWide m03 = FloatWide::splat(m.columns[3].x);
+    FloatWide m13 = FloatWide::splat(m.columns[3].y);
+    FloatWide m23 = FloatWide::splat(m.columns[3].z);
+
+    size_t i = 0;
+    size_t vectorCount = count - count % SIMD_WIDTH;
+    for (; i < vectorCount; i += SIMD_WIDTH) {
+        FloatWide px = FloatWide::load(x + i);
+        FloatWide py = FloatWide::load(y + i);
+        FloatWide pz = FloatWide::load(z + i);
+        madd(m02, pz, madd(m01, py, madd(m00, px, m03))).store(outX + i);
+        madd(m12, pz, madd(m11, py, madd(m10, px, m13))).store(outY + i);
+        madd(m22, pz, madd(m21, py, madd(m20, px, m23))).store(outZ + i);
+    }
+    for (; i < count; ++i) {
+        Vec3 p = transformPoint(m, Vec3(x[i], y[i], z[i]));
+        outX[i] = p.x;
+        outY[i] = p.y;
+        outZ[i] = p.z;
+    }
+}
+
+/**
+ * Many 4x4 matrices in blocks of SIMD_WIDTH. Within a block each element
+ * (column-major, e = column * 4 + row) is stored for every lane in turn,
+ * so one FloatWide load fetches the same element of SIMD_WIDTH matrices
+ * and a whole block is one contiguous run of memory. The last block is
+ * zero padded.
+ */
+class Mat4Batch {
+public:
+    Mat4Batch() = default;
+    explicit Mat4Batch(size_t count) {
+        resize(count);
+    }
+
+    void resize(size_t newCount) {
+        count = newCount;
+        elements.assign(blockCount() * 16 * SIMD_WIDTH, 0.0f);
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    size_t blockCount() const {
+        return (count + SIMD_WIDTH - 1) / SIMD_WIDTH;
+    }
+
+    // Element e of block b starts at block(b) + e * SIMD_WIDTH
+    float* block(size_t b) {
+        return elements.data() + b * 16 * SIMD_WIDTH;
+    }
+
+    const float* block(size_t b) const {
+        return elements.data() + b * 16 * SIMD_WIDTH;
+    }
+
+    void set(size_t i, const Mat4& m) {
+        float* target = block(i / SIMD_WIDTH) + i % SIMD_WIDTH;
+        for (int e = 0; e < 16; ++e)
+            target[e * SIMD_WIDTH] = m.data()[e];
+    }
+
+    Mat4 get(size_t i) const {
+        const float* source = block(i / SIMD_WIDTH) + i % SIMD_WIDTH;
+        Mat4 m;
+        for (int e = 0; e < 16; ++e)
+            m.data()[e] = source[e * SIMD_WIDTH];
+        return m;
+    }
+
+private:
+    size_t count = 0;
+    std::vector<float> elements;
+};
+
+/**
+ * Computes out[i] = a[i] * b[i] for every matrix in the batches
+ *
+ * @param out  resized to match, must not be a or b
+ */
+inline void multiplyMatrices(const Mat4Batch& a, const Mat4Batch& b,
+                             Mat4Batch& out) {
+    size_t count = a.size() < b.size() ? a.size() : b.size();
+    if (out.size() != count)
+        out.resize(count);
+
+    const size_t W = SIMD_WIDTH;
+    for (size_t block = 0; block < out.blockCount(); ++block) {
+        const float* pa = a.block(block);
+        const float* pb = b.block(block);
+        float* po = out.block(block);
+        for (int c = 0; c < 4; ++c) {
+            FloatWide b0 = FloatWide::load(pb + (c * 4 + 0) * W);
+            FloatWide b1 = FloatWide::load(pb + (c * 4 + 1) * W);
+            FloatWide b2 = FloatWide::load(pb + (c * 4 + 2) * W);
+            FloatWide b3 = FloatWide::load(pb + (c * 4 + 3) * W);
+            for (int r = 0; r < 4; ++r) {
+                FloatWide v = FloatWide::load(pa + r * W) * b0;
+                v = madd(FloatWide::load(pa + (4 + r) * W), b1, v);
+                v = madd(FloatWide::load(pa + (8 + r) * W), b2, v);
+                v = madd(FloatWide::load(pa + (12 + r) * W), b3, v);
+                v.store(po + (c * 4 + r) * W);
+            }
+        }
+    }
+}
+
+/**
+ * Computes out[i] = a[i] * b[i] for arrays of Mat4 (array-of-structures,
+ * one matrix per Float4 product). out may alias a or b.
+ */
+inline void multiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out,
+                             size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        out[i] = a[i] * b[i];
+}
+
+#endif
@@ -0,0 +1,366 @@
+#ifndef MESH_FILE_HPP
+#define MESH_FILE_HPP
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "buffer.hpp"
+#include "mesh_format.hpp"
+#include "vertex_array.hpp"
+
+/**
+ * Read-only memory mapping of a whole file. The pages are only read from
+ * disk when touched, and the kernel is told the access will be sequential
+ * so it reads ahead aggressively.
+ */
+class MappedFile {
+public:
+    const unsigned char* data = NULL;
+    size_t size = 0;
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    /**
+     * Maps a file into memory
+     *
+     * @param path  file to map
+     * @return whether the mapping succeeded
+     */
+    bool open(const char* path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            std::cout << "ERROR::MAPPED_FILE::OPEN_FAILED " << path <<
+                std::endl;
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+            std::cout << "ERROR::MAPPED_FILE::EMPTY_OR_UNREADABLE " <<
+                path << std::endl;
+            close();
+            return false;
+        }
+        size = size_t(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            std::cout << "ERROR::MAPPED_FILE::MAP_FAILED " << path <<
+                std::endl;
+            close();
+            return false;
+        }
+        data = static_cast<const unsigned char*>(
+            MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data == NULL) {
+            std::cout << "ERROR::MAPPED_FILE::MAP_FAILED " << path <<
+                std::endl;
+            close();
+            return false;
+        }
+#else
+        descriptor = ::open(path, O_RDONLY);
+        if (descriptor < 0) {
+            std::cout << "ERROR::MAPPED_FILE::OPEN_FAILED " << path <<
+                std::endl;
+            return false;
+        }
+        // mmap() rejects a zero length, report empty files up front
+        struct stat status;
+        if (fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+            std::cout << "ERROR::MAPPED_FILE::EMPTY_OR_UNREADABLE " <<
+                path << std::endl;
+            close();
+            return false;
+        }
+        size = size_t(status.st_size);
+        void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor,
+                            0);
+        if (mapped == MAP_FAILED) {
+            std::cout << "ERROR::MAPPED_FILE::MAP_FAILED " << path <<
+                std::endl;
+            close();
+            return false;
+        }
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<const unsigned char*>(mapped);
+#endif
+        return data != NULL;
+    }
+
+    // Hint that a range will be needed soon so reads start in the background
+    // (Windows relies on FILE_FLAG_SEQUENTIAL_SCAN read-ahead instead)
+    void prefetch(size_t offset, size_t bytes) const {
+#ifndef _WIN32
+        long page = sysconf(_SC_PAGESIZE);
+        size_t start = offset & ~size_t(page - 1);
+        madvise(const_cast<unsigned char*>(data) + start,
+                bytes + (offset - start), MADV_WILLNEED);
+#else
+        (void)offset;
+        (void)bytes;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data)
+            munmap(const_cast<unsigned char*>(data), size);
+        if (descriptor >= 0)
+            ::close(descriptor);
+        descriptor = -1;
+#endif
+        data = NULL;
+        size = 0;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int descriptor = -1;
+#endif
+};
+
+
+/**
+ * A memory mapped .mesh file (see mesh_format.hpp). All accessors point
+ * straight into the mapping, nothing is copied.
+ */
+class MeshFile {
+public:
+    /**
+     * Maps and validates a mesh file
+     *
+     * @param path  .mesh file to open
+     * @return whether the file is a valid mesh
+     */
+    bool open(const char* path) {
+        if (!file.open(path))
+            return false;
+        if (file.size < sizeof(MeshFileHeader) ||
+            std::memcmp(header().magic, MESH_MAGIC, sizeof(MESH_MAGIC))) {
+            std::cout << "ERROR::MESH::NOT_A_MESH_FILE " << path << std::endl;
+            file.close();
+            return false;
+        }
+        const MeshFileHeader& h = header();
+        uint64_t descriptorEnd = sizeof(MeshFileHeader) +
+            uint64_t(h.attributeCount) * sizeof(MeshAttribute) +
+            uint64_t(h.lodCount) * sizeof(MeshLod);
+        if (h.version != MESH_VERSION || descriptorEnd > file.size ||
+            (h.indexType != GL_UNSIGNED_SHORT &&
+             h.indexType != GL_UNSIGNED_INT) ||
+            !fits(h.vertexOffset, h.vertexCount, h.vertexStride) ||
+            !fits(h.indexOffset, h.indexCount, indexSize()) ||
+            !validAttributes() || !validLods()) {
+            std::cout << "ERROR::MESH::CORRUPT_OR_UNSUPPORTED " << path <<
+                std::endl;
+            file.close();
+            return false;
+        }
+        // Start reading both blobs from disk while the caller sets up GL
+        file.prefetch(size_t(h.vertexOffset), size_t(vertexBytes()));
+        file.prefetch(size_t(h.indexOffset), size_t(indexBytes()));
+        return true;
+    }
+
+    const MeshFileHeader& header() const {
+        return *reinterpret_cast<const MeshFileHeader*>(file.data);
+    }
+
+    const MeshAttribute* attributes() const {
+        return reinterpret_cast<const MeshAttribute*>(
+            file.data + sizeof(MeshFileHeader));
+    }
+
+    const MeshLod* lods() const {
+        return reinterpret_cast<const MeshLod*>(
+            attributes() + header().attributeCount);
+    }
+
+    const void* vertexData() const {
+        return file.data + header().vertexOffset;
+    }
+
+    const void* indexData() const {
+        return file.data + header().indexOffset;
+    }
+
+    uint64_t vertexBytes() const {
+        return header().vertexCount * header().vertexStride;
+    }
+
+    uint64_t indexBytes() const {
+        return header().indexCount * indexSize();
+    }
+
+    void close() {
+        file.close();
+    }
+
+private:
+    MappedFile file;
+
+    uint64_t indexSize() const {
+        return header().indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+
+    // Whether count elements at offset lie inside the file, without the
+    // end offset wrapping around
+    bool fits(uint64_t offset, uint64_t count, uint64_t elementSize) const {
+        return offset <= file.size && (elementSize == 0 ||
+                                       count <= (file.size - offset) /
+                                       elementSize);
+    }
+
+    // Bytes a vertex attribute reads, 0 if its format is not one GL
+    // accepts for the attribute kind
+    static uint32_t attributeBytes(const MeshAttribute& attribute) {
+        if (attribute.components < 1 || attribute.components > 4)
+            return 0;
+        switch (attribute.type) {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return attribute.components;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+            return attribute.components * 2;
+        case GL_INT:
+        case GL_UNSIGNED_INT:
+            return attribute.components * 4;
+        case GL_HALF_FLOAT:
+            return attribute.integer ? 0 : attribute.components * 2;
+        case GL_FLOAT:
+            return attribute.integer ? 0 : attribute.components * 4;
+        case GL_INT_2_10_10_10_REV:
+        case GL_UNSIGNED_INT_2_10_10_10_REV:
+            return attribute.integer || attribute.components != 4 ? 0 : 4;
+        default:
+            return 0;
+        }
+    }
+
+    // Every attribute has a valid format and lies inside the vertex
+    // stride, which is within the GL minimum limit
+    bool validAttributes() const {
+        uint32_t stride = header().vertexStride;
+        if (stride == 0 || stride > 2048)
+            return false;
+        for (uint32_t i = 0; i < header().attributeCount; ++i) {
+            const MeshAttribute& attribute = attributes()[i];
+            uint32_t bytes = attributeBytes(attribute);
+            // 16 is the minimum GL_MAX_VERTEX_ATTRIBS
+            if (bytes == 0 || attribute.location >= 16 ||
+                attribute.offset > stride || bytes > stride - attribute.offset)
+                return false;
+        }
+        return true;
+    }
+
+    // Every LOD's index range lies inside the index blob
+    bool validLods() const {
+        for (uint32_t i = 0; i < header().lodCount; ++i) {
+            const MeshLod& lod = lods()[i];
+            if (uint64_t(lod.firstIndex) + lod.indexCount >
+                header().indexCount)
+                return false;
+        }
+        return true;
+    }
+};
+
+
+// GL objects for a mesh loaded from a .mesh file
+struct GpuMesh {
+    Buffer vertices;
+    Buffer indices;
+    VertexArray vertexArray;
+    GLenum indexType = GL_UNSIGNED_INT;
+    std::vector<MeshLod> lods;
+
+    // Draws one LOD, the vertex array must be bound
+    void draw(size_t lod = 0) const {
+        const MeshLod& range = lods[lod];
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+        glDrawElements(GL_TRIANGLES, GLsizei(range.indexCount), indexType,
+                       (void*)(size_t(range.firstIndex) * indexSize));
+    }
+
+    void destroy() {
+        vertexArray.destroy();
+        vertices.destroy();
+        indices.destroy();
+    }
+};
+
+/**
+ * Uploads a mapped mesh. The mapped pages are handed to glNamedBufferStorage
+ * directly, so the only copy is the driver's transfer to GPU memory.
+ *
+ * @param mesh      opened mesh file, may be closed once this returns
+ * @param binding   vertex buffer binding point to use
+ */
+inline GpuMesh uploadMesh(const MeshFile& mesh, GLuint binding = 0) {
+    const MeshFileHeader& header = mesh.header();
+    GpuMesh gpuMesh;
+    gpuMesh.vertices = Buffer(GLsizeiptr(mesh.vertexBytes()),
+                              mesh.vertexData(), 0);
+    gpuMesh.indices = Buffer(GLsizeiptr(mesh.indexBytes()),
+                             mesh.indexData(), 0);
+    gpuMesh.indexType = header.indexType;
+    gpuMesh.lods.assign(mesh.lods(), mesh.lods() + header.lodCount);
+
+    gpuMesh.vertexArray.setVertexBuffer(binding, gpuMesh.vertices, 0,
+                                        GLsizei(header.vertexStride));
+    gpuMesh.vertexArray.setElementBuffer(gpuMesh.indices);
+    for (uint32_t i = 0; i < header.attributeCount; ++i) {
+        const MeshAttribute& attribute = mesh.attributes()[i];
+        if (attribute.integer) {
+            gpuMesh.vertexArray.setIntegerAttribute(
+                attribute.location, binding, GLint(attribute.components),
+                attribute.type, attribute.offset);
+        } else {
+            gpuMesh.vertexArray.setAttribute(
+                attribute.location, binding, GLint(attribute.components),
+                attribute.type, GLboolean(attribute.normalized),
+                attribute.offset);
+        }
+    }
+    return gpuMesh;
+}
+
+#endif
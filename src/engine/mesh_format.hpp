@@ -0,0 +1,184 @@
+#ifndef MESH_FORMAT_HPP
+#define MESH_FORMAT_HPP
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "vertex_layout.hpp"
+
+/**
+ * Binary mesh format (.mesh), designed to be memory mapped and handed to
+ * glNamedBufferStorage without any parsing or copying on the CPU.
+ *
+ *   MeshFileHeader                      fixed 128 bytes
+ *   MeshAttribute[attributeCount]       vertex layout descriptor
+ *   MeshLod[lodCount]                   index ranges, LOD 0 is full detail
+ *   padding to MESH_BLOB_ALIGNMENT
+ *   vertex blob                         vertexCount * vertexStride bytes
+ *   padding to MESH_BLOB_ALIGNMENT
+ *   index blob                          indexCount * index size bytes
+ *
+ * Every LOD indexes the same vertex blob. All values are little endian.
+ */
+
+const char MESH_MAGIC[4] = { 'G', 'L', 'M', 'H' };
+const uint32_t MESH_VERSION = 1;
+// Blobs start on page boundaries so mapped pages hold only one blob
+const uint64_t MESH_BLOB_ALIGNMENT = 4096;
+
+// Set in MeshFileHeader::flags when positions are unorm16 quantized
+const uint32_t MESH_FLAG_QUANTIZED = 1u << 0;
+
+struct MeshFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t attributeCount;
+    uint32_t lodCount;
+    uint32_t vertexStride;
+    uint64_t vertexCount;
+    uint64_t vertexOffset;
+    uint32_t indexType;         // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint32_t reserved0;
+    uint64_t indexCount;
+    uint64_t indexOffset;
+    float boundsMin[3];
+    float boundsMax[3];
+    // Quantization grid when MESH_FLAG_QUANTIZED is set
+    float quantizeMin[3];
+    float quantizeExtent[3];
+    uint32_t reserved[4];
+};
+static_assert(sizeof(MeshFileHeader) == 128, "Header must stay 128 bytes");
+
+// Runtime equivalent of one AttribFormat in a VertexLayout
+struct MeshAttribute {
+    uint32_t location;
+    uint32_t components;
+    uint32_t type;
+    uint32_t normalized;
+    uint32_t offset;
+    uint32_t integer;
+};
+
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // Simplification error relative to the mesh bounds diagonal (0 for
+    // LOD 0), see lod.hpp
+    float error;
+    uint32_t reserved;
+};
+
+// Rounds a byte offset up to the blob alignment
+inline uint64_t alignMeshOffset(uint64_t offset) {
+    return (offset + MESH_BLOB_ALIGNMENT - 1) & ~(MESH_BLOB_ALIGNMENT - 1);
+}
+
+// Builds the attribute descriptors for a VertexLayout
+template <typename Layout>
+struct MeshAttributesOf;
+
+template <typename... Attribs>
+struct MeshAttributesOf<VertexLayout<Attribs...>> {
+    static std::vector<MeshAttribute> get() {
+        using Layout = VertexLayout<Attribs...>;
+        const uint32_t components[] = { uint32_t(Attribs::components)... };
+        const uint32_t types[] = { uint32_t(Attribs::type)... };
+        const uint32_t normalized[] = { uint32_t(Attribs::normalized)... };
+        const uint32_t integer[] = { uint32_t(Attribs::integer)... };
+        std::vector<MeshAttribute> attributes(Layout::count);
+        for (uint32_t i = 0; i < Layout::count; ++i)
+            attributes[i] = { i, components[i], types[i], normalized[i],
+                              Layout::offsets[i], integer[i] };
+        return attributes;
+    }
+};
+
+// Everything needed to write a mesh file, blobs are referenced not copied
+struct MeshWriteInfo {
+    std::vector<MeshAttribute> attributes;
+    std::vector<MeshLod> lods;
+    uint32_t flags = 0;
+    uint32_t vertexStride = 0;
+    uint64_t vertexCount = 0;
+    const void* vertices = NULL;
+    uint32_t indexType = GL_UNSIGNED_INT;
+    uint64_t indexCount = 0;
+    const void* indices = NULL;
+    float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+    float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+    float quantizeMin[3] = { 0.0f, 0.0f, 0.0f };
+    float quantizeExtent[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+/**
+ * Writes a mesh file
+ *
+ * @param path  destination file path
+ * @param info  mesh contents, if no LODs are given one covering every
+ *              index is written
+ * @return whether the file was written successfully
+ */
+inline bool writeMeshFile(const char* path, const MeshWriteInfo& info) {
+    std::vector<MeshLod> lods = info.lods;
+    if (lods.empty())
+        lods.push_back({ 0, uint32_t(info.indexCount), 0.0f, 0 });
+    uint64_t indexSize = info.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+
+    MeshFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC));
+    header.version = MESH_VERSION;
+    header.flags = info.flags;
+    header.attributeCount = uint32_t(info.attributes.size());
+    header.lodCount = uint32_t(lods.size());
+    header.vertexStride = info.vertexStride;
+    header.vertexCount = info.vertexCount;
+    header.indexType = info.indexType;
+    header.indexCount = info.indexCount;
+    std::memcpy(header.boundsMin, info.boundsMin, sizeof(header.boundsMin));
+    std::memcpy(header.boundsMax, info.boundsMax, sizeof(header.boundsMax));
+    std::memcpy(header.quantizeMin, info.quantizeMin,
+                sizeof(header.quantizeMin));
+    std::memcpy(header.quantizeExtent, info.quantizeExtent,
+                sizeof(header.quantizeExtent));
+
+    uint64_t descriptorEnd = sizeof(MeshFileHeader) +
+        info.attributes.size() * sizeof(MeshAttribute) +
+        lods.size() * sizeof(MeshLod);
+    uint64_t vertexBytes = info.vertexCount * info.vertexStride;
+    header.vertexOffset = alignMeshOffset(descriptorEnd);
+    header.indexOffset = alignMeshOffset(header.vertexOffset + vertexBytes);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "ERROR::MESH::FILE_NOT_WRITABLE " << path << std::endl;
+        return false;
+    }
+    const char zeros[MESH_BLOB_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(info.attributes.data()),
+               info.attributes.size() * sizeof(MeshAttribute));
+    file.write(reinterpret_cast<const char*>(lods.data()),
+               lods.size() * sizeof(MeshLod));
+    file.write(zeros, std::streamsize(header.vertexOffset - descriptorEnd));
+    file.write(static_cast<const char*>(info.vertices),
+               std::streamsize(vertexBytes));
+    file.write(zeros, std::streamsize(header.indexOffset -
+                                      header.vertexOffset - vertexBytes));
+    file.write(static_cast<const char*>(info.indices),
+               std::streamsize(info.indexCount * indexSize));
+    if (!file) {
+        std::cout << "ERROR::MESH::WRITE_FAILED " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,1039 @@
+#ifndef MESH_IMPORTER_HPP
+#define MESH_IMPORTER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "index_optimizer.hpp"
+#include "mesh_file.hpp"
+#include "parallel.hpp"
+#include "vertex_layout.hpp"
+
+/**
+ * Parallel importer for text based mesh formats (OBJ and glTF/GLB).
+ *
+ * OBJ files are memory mapped and split into chunks at line boundaries.
+ * Worker threads grab chunks from a shared counter, so fast threads keep
+ * taking work until none is left:
+ * 1. parse each chunk into local positions/normals/texcoords and
+ *    triangulated face corners
+ * 2. prefix sum the per-chunk counts to resolve global and negative indices
+ * 3. deduplicate (position, texcoord, normal) corners through a concurrent
+ *    hash map shared by all threads
+ * 4. renumber vertices in first-use order and build the vertex array
+ *
+ * The output is ready to upload: interleaved ImportedVertexLayout vertices
+ * and 32-bit indices (see narrowIndices() for 16-bit).
+ */
+
+struct ImportedVertex {
+    float position[3];
+    float normal[3];
+    float texCoord[2];
+};
+
+using ImportedVertexLayout = VertexLayout<Pos3f, Normal3f, TexCoord2f>;
+static_assert(sizeof(ImportedVertex) == ImportedVertexLayout::stride,
+              "ImportedVertex must match its layout");
+
+struct ImportedMesh {
+    std::vector<ImportedVertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+struct ImportOptions {
+    // Worker threads, 0 uses every hardware thread
+    unsigned int threads = 0;
+    // Target OBJ chunk size in bytes
+    size_t chunkSize = size_t(4) << 20;
+};
+
+
+/****************
+ * NUMBER PARSING
+ ****************/
+
+/**
+ * Parses a decimal floating point number without locale or stream overhead.
+ * Accumulates up to 19 significant digits into an integer with a tight
+ * digit loop, then applies the decimal exponent once.
+ *
+ * @param cursor  start of the number, advanced past it
+ * @param end     end of the input
+ */
+inline float parseFloat(const char*& cursor, const char* end) {
+    static const double POWERS[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* p = cursor;
+    while (p < end && (*p == ' ' || *p == '\t'))
+        ++p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int significant = 0;
+    bool anyDigits = false;
+    for (; p < end && unsigned(*p - '0') < 10; ++p) {
+        anyDigits = true;
+        if (significant < 19) {
+            mantissa = mantissa * 10 + unsigned(*p - '0');
+            significant += mantissa != 0;
+        } else {
+            ++exponent;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && unsigned(*p - '0') < 10; ++p) {
+            anyDigits = true;
+            if (significant < 19) {
+                mantissa = mantissa * 10 + unsigned(*p - '0');
+                significant += mantissa != 0;
+                --exponent;
+            }
+        }
+    }
+    if (!anyDigits) {
+        cursor = p;
+        return 0.0f;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* exponentStart = p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            ++p;
+        }
+        if (p < end && unsigned(*p - '0') < 10) {
+            int value = 0;
+            for (; p < end && unsigned(*p - '0') < 10; ++p)
+                if (value < 10000)
+                    value = value * 10 + (*p - '0');
+            exponent += negativeExponent ? -value : value;
+        } else {
+            p = exponentStart;
+        }
+    }
+
+    double value = double(mantissa);
+    while (exponent > 22) {
+        value *= 1e22;
+        exponent -= 22;
+    }
+    while (exponent < -22) {
+        value /= 1e22;
+        exponent += 22;
+    }
+    value = exponent >= 0 ? value * POWERS[exponent] :
+        value / POWERS[-exponent];
+    cursor = p;
+    return float(negative ? -value : value);
+}
+
+// Parses an optionally signed decimal integer, advancing the cursor
+inline long parseInt(const char*& cursor, const char* end) {
+    const char* p = cursor;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    long value = 0;
+    for (; p < end && unsigned(*p - '0') < 10; ++p)
+        value = value * 10 + (*p - '0');
+    cursor = p;
+    return negative ? -value : value;
+}
+
+
+/****************
+ * CONCURRENT VERTEX MAP
+ ****************/
+
+/**
+ * Fixed capacity, insert-only, lock-free hash map from a face corner
+ * (position, texcoord, normal) to a vertex ID. Slots are claimed with a
+ * compare-and-swap and published with a release store, so concurrent
+ * inserts of the same corner always agree on one ID.
+ */
+class ConcurrentVertexMap {
+public:
+    struct Key {
+        uint32_t position;
+        uint32_t texCoord;     // 0 when absent, otherwise index + 1
+        uint32_t normal;       // 0 when absent, otherwise index + 1
+
+        bool operator==(const Key& other) const {
+            return position == other.position &&
+                texCoord == other.texCoord && normal == other.normal;
+        }
+    };
+
+    // Capacity is rounded up to a power of two of at least twice maxKeys
+    explicit ConcurrentVertexMap(size_t maxKeys) {
+        capacity = 16;
+        while (capacity < maxKeys * 2)
+            capacity <<= 1;
+        slots.reset(new Slot[capacity]);
+        keysById.resize(maxKeys);
+    }
+
+    // Returns the ID of the key, inserting it with the next free ID if new
+    uint32_t insert(const Key& key) {
+        size_t mask = capacity - 1;
+        for (size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            uint32_t state = slot.state.load(std::memory_order_acquire);
+            if (state == EMPTY) {
+                if (slot.state.compare_exchange_strong(
+                        state, WRITING, std::memory_order_acquire)) {
+                    uint32_t id = nextId.fetch_add(1,
+                                                   std::memory_order_relaxed);
+                    slot.key = key;
+                    slot.id = id;
+                    keysById[id] = key;
+                    slot.state.store(READY, std::memory_order_release);
+                    return id;
+                }
+            }
+            // Another thread is filling the slot, wait for its key
+            while (state == WRITING)
+                state = slot.state.load(std::memory_order_acquire);
+            if (slot.key == key)
+                return slot.id;
+        }
+    }
+
+    uint32_t size() const {
+        return nextId.load();
+    }
+
+    const Key& keyOf(uint32_t id) const {
+        return keysById[id];
+    }
+
+private:
+    static const uint32_t EMPTY = 0;
+    static const uint32_t WRITING = 1;
+    static const uint32_t READY = 2;
+
+    struct Slot {
+        std::atomic<uint32_t> state { EMPTY };
+        uint32_t id = 0;
+        Key key = { 0, 0, 0 };
+    };
+
+    static size_t hash(const Key& key) {
+        uint64_t h = uint64_t(key.position) * 0x9e3779b97f4a7c15ull;
+        h ^= (uint64_t(key.texCoord) + 0x632be59bd9b4e019ull) *
+            0xc2b2ae3d27d4eb4full;
+        h ^= (uint64_t(key.normal) + 0x165667b19e3779f9ull) *
+            0xff51afd7ed558ccdull;
+        return size_t(h ^ (h >> 29));
+    }
+
+    size_t capacity = 0;
+    std::unique_ptr<Slot[]> slots;
+    std::vector<Key> keysById;
+    std::atomic<uint32_t> nextId { 0 };
+};
+
+
+/****************
+ * OBJ
+ ****************/
+
+// Relative OBJ indices are stored as OBJ_RELATIVE + index into the chunk's
+// own attribute list (negative when they reach back into earlier chunks)
+const int64_t OBJ_RELATIVE = -(int64_t(1) << 62);
+
+struct ObjChunk {
+    const char* begin = NULL;
+    const char* end = NULL;
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> texCoords;
+    // Triangulated corners as (position, texcoord, normal). Positive values
+    // are 1-based file indices, 0 is absent, anything below 0 is relative.
+    std::vector<int64_t> corners;
+    size_t positionBase = 0;
+    size_t normalBase = 0;
+    size_t texCoordBase = 0;
+    size_t cornerBase = 0;
+    bool valid = true;
+};
+
+// Parses the v/vn/vt/f lines of one chunk
+inline void parseObjChunk(ObjChunk& chunk) {
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+    // First and previous corner of the face being fanned
+    int64_t face[3 * 2];
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(
+            std::memchr(p, '\n', size_t(end - p)));
+        if (!lineEnd)
+            lineEnd = end;
+
+        if (lineEnd - p > 2 && p[0] == 'v' && p[1] == ' ') {
+            p += 2;
+            for (int i = 0; i < 3; ++i)
+                chunk.positions.push_back(parseFloat(p, lineEnd));
+        } else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 'n') {
+            p += 2;
+            for (int i = 0; i < 3; ++i)
+                chunk.normals.push_back(parseFloat(p, lineEnd));
+        } else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 't') {
+            p += 2;
+            for (int i = 0; i < 2; ++i)
+                chunk.texCoords.push_back(parseFloat(p, lineEnd));
+        } else if (lineEnd - p > 2 && p[0] == 'f' && p[1] == ' ') {
+            p += 2;
+            int corners = 0;
+            int64_t counts[3] = { int64_t(chunk.positions.size() / 3),
+                                  int64_t(chunk.texCoords.size() / 2),
+                                  int64_t(chunk.normals.size() / 3) };
+            for (;;) {
+                while (p < lineEnd && (*p == ' ' || *p == '\t' || *p == '\r'))
+                    ++p;
+                if (p >= lineEnd)
+                    break;
+                int64_t corner[3] = { 0, 0, 0 };
+                for (int part = 0; part < 3; ++part) {
+                    if (part > 0) {
+                        if (p >= lineEnd || *p != '/')
+                            break;
+                        ++p;
+                    }
+                    const char* start = p;
+                    long index = parseInt(p, lineEnd);
+                    if (p == start)
+                        continue;
+                    if (index == 0)
+                        chunk.valid = false;
+                    corner[part] = index > 0 ? index :
+                        OBJ_RELATIVE + counts[part] + index;
+                }
+                if (corner[0] == 0) {
+                    chunk.valid = false;
+                    break;
+                }
+                // Fan triangulated as the corners arrive, so polygons of
+                // any size are kept whole
+                if (corners >= 2) {
+                    chunk.corners.insert(chunk.corners.end(), face,
+                                         face + 6);
+                    chunk.corners.insert(chunk.corners.end(), corner,
+                                         corner + 3);
+                }
+                std::memcpy(&face[corners == 0 ? 0 : 3], corner,
+                            sizeof(corner));
+                ++corners;
+            }
+        }
+        p = lineEnd + 1;
+    }
+}
+
+/**
+ * Imports a Wavefront OBJ file (v/vt/vn/f subset, polygons fan triangulated)
+ *
+ * @param path     OBJ file to import
+ * @param mesh     receives the vertices and indices
+ * @param options  thread count and chunk size
+ * @return whether the file was imported
+ */
+inline bool importObj(const char* path, ImportedMesh& mesh,
+                      const ImportOptions& options = ImportOptions()) {
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+    const char* data = reinterpret_cast<const char*>(file.data);
+    const char* dataEnd = data + file.size;
+    unsigned int threads = resolveThreadCount(options.threads);
+
+    // Split at line boundaries
+    std::vector<ObjChunk> chunks;
+    for (const char* begin = data; begin < dataEnd;) {
+        const char* end = begin + std::min(options.chunkSize,
+                                           size_t(dataEnd - begin));
+        if (end < dataEnd) {
+            const char* newline = static_cast<const char*>(
+                std::memchr(end, '\n', size_t(dataEnd - end)));
+            end = newline ? newline + 1 : dataEnd;
+        }
+        chunks.emplace_back();
+        chunks.back().begin = begin;
+        chunks.back().end = end;
+        begin = end;
+    }
+
+    // 1. Parse
+    parallelFor(chunks.size(), threads, [&](size_t i) {
+        parseObjChunk(chunks[i]);
+    });
+
+    // 2. Prefix sums
+    size_t positions = 0, normals = 0, texCoords = 0, corners = 0;
+    for (ObjChunk& chunk : chunks) {
+        if (!chunk.valid) {
+            std::cout << "ERROR::OBJ::INVALID_FACE_INDEX " << path << std::endl;
+            return false;
+        }
+        chunk.positionBase = positions;
+        chunk.normalBase = normals;
+        chunk.texCoordBase = texCoords;
+        chunk.cornerBase = corners;
+        positions += chunk.positions.size() / 3;
+        normals += chunk.normals.size() / 3;
+        texCoords += chunk.texCoords.size() / 2;
+        corners += chunk.corners.size() / 3;
+    }
+    if (corners > 0xffffffffu) {
+        std::cout << "ERROR::OBJ::TOO_MANY_VERTICES " << path << std::endl;
+        return false;
+    }
+
+    // 3. Deduplicate corners into vertices
+    ConcurrentVertexMap vertexMap(corners);
+    std::vector<uint32_t> indices(corners);
+    std::atomic<bool> valid { true };
+    parallelFor(chunks.size(), threads, [&](size_t i) {
+        const ObjChunk& chunk = chunks[i];
+        const size_t bases[3] = { chunk.positionBase, chunk.texCoordBase,
+                                  chunk.normalBase };
+        const size_t totals[3] = { positions, texCoords, normals };
+        for (size_t c = 0; c * 3 < chunk.corners.size(); ++c) {
+            uint32_t key[3];
+            for (int part = 0; part < 3; ++part) {
+                int64_t value = chunk.corners[c * 3 + part];
+                // Resolve to a 1-based global index, 0 stays absent
+                int64_t index = value >= 0 ? value :
+                    int64_t(bases[part]) + (value - OBJ_RELATIVE) + 1;
+                if (index > int64_t(totals[part]) || index < 0 ||
+                    (value < 0 && index == 0)) {
+                    valid = false;
+                    index = 0;
+                }
+                key[part] = uint32_t(index);
+            }
+            if (key[0] == 0) {
+                valid = false;
+                key[0] = 1;
+            }
+            indices[chunk.cornerBase + c] =
+                vertexMap.insert({ key[0] - 1, key[1], key[2] });
+        }
+    });
+    if (!valid) {
+        std::cout << "ERROR::OBJ::INDEX_OUT_OF_RANGE " << path << std::endl;
+        return false;
+    }
+
+    // 4. Renumber in first-use order so the output is deterministic
+    uint32_t vertexCount = vertexMap.size();
+    const uint32_t UNUSED = ~0u;
+    std::vector<uint32_t> remap(vertexCount, UNUSED);
+    std::vector<uint32_t> order(vertexCount);
+    uint32_t next = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == UNUSED) {
+            order[next] = index;
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    // Concatenate the per-chunk attributes for random access
+    std::vector<float> allPositions(positions * 3), allNormals(normals * 3),
+        allTexCoords(texCoords * 2);
+    parallelFor(chunks.size(), threads, [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        std::copy(chunk.positions.begin(), chunk.positions.end(),
+                  allPositions.begin() + chunk.positionBase * 3);
+        std::copy(chunk.normals.begin(), chunk.normals.end(),
+                  allNormals.begin() + chunk.normalBase * 3);
+        std::copy(chunk.texCoords.begin(), chunk.texCoords.end(),
+                  allTexCoords.begin() + chunk.texCoordBase * 2);
+        std::vector<float>().swap(chunk.positions);
+        std::vector<float>().swap(chunk.normals);
+        std::vector<float>().swap(chunk.texCoords);
+        std::vector<int64_t>().swap(chunk.corners);
+    });
+
+    mesh.vertices.resize(vertexCount);
+    size_t blocks = (size_t(vertexCount) + 65535) / 65536;
+    parallelFor(blocks, threads, [&](size_t block) {
+        size_t first = block * 65536;
+        size_t last = std::min<size_t>(first + 65536, vertexCount);
+        for (size_t v = first; v < last; ++v) {
+            const ConcurrentVertexMap::Key& key = vertexMap.keyOf(order[v]);
+            ImportedVertex& vertex = mesh.vertices[v];
+            std::memset(&vertex, 0, sizeof(vertex));
+            std::memcpy(vertex.position, &allPositions[key.position * 3ull],
+                        sizeof(vertex.position));
+            if (key.normal)
+                std::memcpy(vertex.normal,
+                            &allNormals[(key.normal - 1) * 3ull],
+                            sizeof(vertex.normal));
+            if (key.texCoord)
+                std::memcpy(vertex.texCoord,
+                            &allTexCoords[(key.texCoord - 1) * 2ull],
+                            sizeof(vertex.texCoord));
+        }
+    });
+    mesh.indices.swap(indices);
+    return true;
+}
+
+
+/****************
+ * JSON (glTF subset)
+ ****************/
+
+// Minimal JSON document model, enough to read glTF
+struct JsonValue {
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+    Type type = NUL;
+    double number = 0.0;
+    bool boolean = false;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue> object;
+
+    const JsonValue* find(const std::string& key) const {
+        auto found = object.find(key);
+        return found == object.end() ? NULL : &found->second;
+    }
+
+    double numberOr(const std::string& key, double fallback) const {
+        const JsonValue* value = find(key);
+        return value && value->type == NUMBER ? value->number : fallback;
+    }
+
+    // The number as an index or byte count, fallback unless it is whole and
+    // in range (converting a negative or huge double is undefined)
+    size_t sizeOr(size_t fallback) const {
+        if (type != NUMBER || !(number >= 0.0) ||
+            number >= double(SIZE_MAX) || number != std::floor(number))
+            return fallback;
+        return size_t(number);
+    }
+
+    size_t sizeOr(const std::string& key, size_t fallback) const {
+        const JsonValue* value = find(key);
+        return value ? value->sizeOr(fallback) : fallback;
+    }
+};
+
+class JsonParser {
+public:
+    JsonParser(const char* begin, const char* end) : p(begin), end(end) {}
+
+    // Parses one value, returns false on malformed input
+    bool parse(JsonValue& value, int depth = 0) {
+        skipSpace();
+        if (p >= end || depth > 128)
+            return false;
+        if (*p == '{') {
+            value.type = JsonValue::OBJECT;
+            ++p;
+            skipSpace();
+            if (p < end && *p == '}') {
+                ++p;
+                return true;
+            }
+            while (true) {
+                std::string key;
+                skipSpace();
+                if (!parseString(key))
+                    return false;
+                skipSpace();
+                if (p >= end || *p++ != ':')
+                    return false;
+                if (!parse(value.object[key], depth + 1))
+                    return false;
+                skipSpace();
+                if (p < end && *p == ',') {
+                    ++p;
+                    continue;
+                }
+                if (p < end && *p == '}') {
+                    ++p;
+                    return true;
+                }
+                return false;
+            }
+        }
+        if (*p == '[') {
+            value.type = JsonValue::ARRAY;
+            ++p;
+            skipSpace();
+            if (p < end && *p == ']') {
+                ++p;
+                return true;
+            }
+            while (true) {
+                value.array.emplace_back();
+                if (!parse(value.array.back(), depth + 1))
+                    return false;
+                skipSpace();
+                if (p < end && *p == ',') {
+                    ++p;
+                    continue;
+                }
+                if (p < end && *p == ']') {
+                    ++p;
+                    return true;
+                }
+                return false;
+            }
+        }
+        if (*p == '"') {
+            value.type = JsonValue::STRING;
+            return parseString(value.string);
+        }
+        if (matchWord("true")) {
+            value.type = JsonValue::BOOLEAN;
+            value.boolean = true;
+            return true;
+        }
+        if (matchWord("false")) {
+            value.type = JsonValue::BOOLEAN;
+            return true;
+        }
+        if (matchWord("null"))
+            return true;
+        const char* start = p;
+        value.type = JsonValue::NUMBER;
+        value.number = parseFloat(p, end);
+        return p != start;
+    }
+
+private:
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' ||
+                           *p == '\r'))
+            ++p;
+    }
+
+    bool matchWord(const char* word) {
+        size_t length = std::strlen(word);
+        if (size_t(end - p) >= length && std::memcmp(p, word, length) == 0) {
+            p += length;
+            return true;
+        }
+        return false;
+    }
+
+    // Escapes other than \uXXXX are decoded, \uXXXX is kept as ASCII '?'
+    bool parseString(std::string& out) {
+        if (p >= end || *p != '"')
+            return false;
+        for (++p; p < end && *p != '"'; ++p) {
+            if (*p != '\\') {
+                out += *p;
+                continue;
+            }
+            if (++p >= end)
+                return false;
+            switch (*p) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': out += '?'; p += std::min<ptrdiff_t>(4, end - p - 1);
+                    break;
+                default: out += *p; break;
+            }
+        }
+        if (p >= end)
+            return false;
+        ++p;
+        return true;
+    }
+
+    const char* p;
+    const char* end;
+};
+
+
+/****************
+ * GLTF
+ ****************/
+
+// Decodes standard base64, ignoring characters outside the alphabet
+inline std::vector<unsigned char> decodeBase64(const char* begin,
+                                               const char* end) {
+    std::vector<unsigned char> out;
+    uint32_t bits = 0;
+    int count = 0;
+    for (const char* p = begin; p < end; ++p) {
+        int value;
+        char c = *p;
+        if (c >= 'A' && c <= 'Z') value = c - 'A';
+        else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') value = c - '0' + 52;
+        else if (c == '+') value = 62;
+        else if (c == '/') value = 63;
+        else continue;
+        bits = (bits << 6) | uint32_t(value);
+        if (++count == 4) {
+            out.push_back(uint8_t(bits >> 16));
+            out.push_back(uint8_t(bits >> 8));
+            out.push_back(uint8_t(bits));
+            bits = 0;
+            count = 0;
+        }
+    }
+    if (count == 3) {
+        out.push_back(uint8_t(bits >> 10));
+        out.push_back(uint8_t(bits >> 2));
+    } else if (count == 2) {
+        out.push_back(uint8_t(bits >> 4));
+    }
+    return out;
+}
+
+// Where an accessor's elements are, checked against its buffer
+struct GltfAccessorLayout {
+    size_t count = 0;
+    size_t buffer = 0;
+    size_t offset = 0;
+    size_t stride = 0;
+    size_t componentSize = 0;
+    int componentType = 0;
+    bool normalized = false;
+};
+
+/**
+ * Finds and validates a glTF accessor without reading it. Counts come from
+ * the file, so every element must lie inside the buffer view and the view
+ * inside its buffer before anything is sized from them.
+ *
+ * @param document  parsed glTF JSON
+ * @param buffers   loaded buffers
+ * @param accessor  accessor index
+ * @param width     expected component count (1 for indices)
+ * @param layout    receives the element positions
+ * @return whether every element is inside the buffer
+ */
+inline bool findGltfAccessor(
+    const JsonValue& document,
+    const std::vector<std::vector<unsigned char>>& buffers, size_t accessor,
+    int width, GltfAccessorLayout& layout) {
+    const JsonValue* accessors = document.find("accessors");
+    const JsonValue* views = document.find("bufferViews");
+    if (!accessors || !views || accessor >= accessors->array.size())
+        return false;
+    const JsonValue& info = accessors->array[accessor];
+    size_t viewIndex = info.sizeOr("bufferView", SIZE_MAX);
+    if (viewIndex >= views->array.size())
+        return false;
+    const JsonValue& view = views->array[viewIndex];
+    layout.buffer = view.sizeOr("buffer", SIZE_MAX);
+    if (layout.buffer >= buffers.size())
+        return false;
+    size_t bufferSize = buffers[layout.buffer].size();
+    size_t viewOffset = view.sizeOr("byteOffset", 0);
+    size_t viewLength = view.sizeOr("byteLength", SIZE_MAX);
+    if (viewOffset > bufferSize || viewLength > bufferSize - viewOffset)
+        return false;
+
+    layout.componentType = int(info.sizeOr("componentType", 0));
+    switch (layout.componentType) {
+        case 5126: case 5125: layout.componentSize = 4; break;
+        case 5123: case 5122: layout.componentSize = 2; break;
+        case 5121: case 5120: layout.componentSize = 1; break;
+        default: return false;
+    }
+    layout.normalized = info.find("normalized") &&
+        info.find("normalized")->boolean;
+    size_t elementSize = layout.componentSize * size_t(width);
+    layout.stride = view.sizeOr("byteStride", 0);
+    if (layout.stride == 0)
+        layout.stride = elementSize;
+    size_t offset = info.sizeOr("byteOffset", 0);
+    layout.count = info.sizeOr("count", 0);
+    if (offset > viewLength)
+        return false;
+    size_t available = viewLength - offset;
+    if (layout.count > 0 && (elementSize > available ||
+                             layout.count - 1 > (available - elementSize) /
+                             layout.stride))
+        return false;
+    layout.offset = viewOffset + offset;
+    return true;
+}
+
+/**
+ * Reads a glTF accessor into floats or indices
+ *
+ * @param document   parsed glTF JSON
+ * @param buffers    loaded buffers
+ * @param accessor   accessor index
+ * @param width      expected component count (1 for indices)
+ * @param out        receives count * width values
+ * @return whether the accessor was readable
+ */
+template <typename T>
+bool readGltfAccessor(const JsonValue& document,
+                      const std::vector<std::vector<unsigned char>>& buffers,
+                      size_t accessor, int width, std::vector<T>& out) {
+    GltfAccessorLayout layout;
+    if (!findGltfAccessor(document, buffers, accessor, width, layout))
+        return false;
+    size_t count = layout.count;
+    size_t stride = layout.stride;
+    size_t offset = layout.offset;
+    size_t componentSize = layout.componentSize;
+    int componentType = layout.componentType;
+    bool normalized = layout.normalized;
+    const std::vector<unsigned char>& buffer = buffers[layout.buffer];
+
+    out.resize(count * width);
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned char* element = &buffer[offset + i * stride];
+        for (int c = 0; c < width; ++c) {
+            const unsigned char* source = element + c * componentSize;
+            double value;
+            switch (componentType) {
+                case 5126: { float v; std::memcpy(&v, source, 4);
+                             value = v; break; }
+                case 5125: { uint32_t v; std::memcpy(&v, source, 4);
+                             value = v; break; }
+                case 5123: { uint16_t v; std::memcpy(&v, source, 2);
+                             value = normalized ? v / 65535.0 : v; break; }
+                case 5122: { int16_t v; std::memcpy(&v, source, 2);
+                             value = normalized ? std::fmax(v / 32767.0, -1.0) :
+                                 v; break; }
+                case 5121: value = normalized ? *source / 255.0 : *source;
+                    break;
+                case 5120: { int8_t v = int8_t(*source);
+                             value = normalized ? std::fmax(v / 127.0, -1.0) :
+                                 v; break; }
+                default: return false;
+            }
+            out[i * width + c] = T(value);
+        }
+    }
+    return true;
+}
+
+/**
+ * Imports every triangle primitive of a glTF 2.0 (.gltf or .glb) file into
+ * one mesh. Node transforms are not applied. Primitives are decoded in
+ * parallel, each into its own slice of the output.
+ *
+ * @param path     .gltf (external or data URI buffers) or .glb file
+ * @param mesh     receives the vertices and indices
+ * @param options  thread count
+ * @return whether the file was imported
+ */
+inline bool importGltf(const char* path, ImportedMesh& mesh,
+                       const ImportOptions& options = ImportOptions()) {
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+    const char* json = reinterpret_cast<const char*>(file.data);
+    const char* jsonEnd = json + file.size;
+    std::vector<std::vector<unsigned char>> buffers;
+    const unsigned char* binaryChunk = NULL;
+    size_t binarySize = 0;
+
+    // GLB container: 12 byte header then JSON and BIN chunks
+    if (file.size >= 20 && std::memcmp(file.data, "glTF", 4) == 0) {
+        uint32_t jsonLength;
+        std::memcpy(&jsonLength, file.data + 12, 4);
+        json = reinterpret_cast<const char*>(file.data + 20);
+        jsonEnd = json + std::min<size_t>(jsonLength, file.size - 20);
+        size_t binaryHeader = 20 + size_t(jsonLength);
+        if (binaryHeader + 8 <= file.size) {
+            uint32_t binaryLength;
+            std::memcpy(&binaryLength, file.data + binaryHeader, 4);
+            binaryChunk = file.data + binaryHeader + 8;
+            binarySize = std::min<size_t>(binaryLength,
+                                          file.size - binaryHeader - 8);
+        }
+    }
+
+    JsonValue document;
+    JsonParser parser(json, jsonEnd);
+    if (!parser.parse(document) || document.type != JsonValue::OBJECT) {
+        std::cout << "ERROR::GLTF::INVALID_JSON " << path << std::endl;
+        return false;
+    }
+
+    // Load buffers from the GLB chunk, data URIs or files beside the asset
+    std::string directory = path;
+    size_t slash = directory.find_last_of("/\\");
+    directory = slash == std::string::npos ? "" :
+        directory.substr(0, slash + 1);
+    if (const JsonValue* list = document.find("buffers")) {
+        for (const JsonValue& buffer : list->array) {
+            buffers.emplace_back();
+            const JsonValue* uri = buffer.find("uri");
+            if (!uri) {
+                if (binaryChunk)
+                    buffers.back().assign(binaryChunk,
+                                          binaryChunk + binarySize);
+            } else if (uri->string.compare(0, 5, "data:") == 0) {
+                size_t comma = uri->string.find(',');
+                if (comma != std::string::npos)
+                    buffers.back() = decodeBase64(
+                        uri->string.data() + comma + 1,
+                        uri->string.data() + uri->string.size());
+            } else {
+                std::ifstream bin(directory + uri->string, std::ios::binary);
+                buffers.back().assign(std::istreambuf_iterator<char>(bin),
+                                      std::istreambuf_iterator<char>());
+            }
+        }
+    }
+
+    // Collect triangle primitives
+    struct Primitive {
+        const JsonValue* info;
+        size_t firstVertex = 0;
+        size_t firstIndex = 0;
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+    };
+    std::vector<Primitive> primitives;
+    if (const JsonValue* meshes = document.find("meshes"))
+        for (const JsonValue& gltfMesh : meshes->array)
+            if (const JsonValue* list = gltfMesh.find("primitives"))
+                for (const JsonValue& primitive : list->array)
+                    if (primitive.numberOr("mode", 4) == 4)
+                        primitives.push_back({ &primitive });
+
+    // Size every primitive first so they can be decoded in parallel, counts
+    // are only trusted once their accessors fit in the buffers
+    size_t vertexTotal = 0, indexTotal = 0;
+    for (Primitive& primitive : primitives) {
+        const JsonValue* attributes = primitive.info->find("attributes");
+        const JsonValue* position = attributes ?
+            attributes->find("POSITION") : NULL;
+        if (!position) {
+            std::cout << "ERROR::GLTF::MISSING_POSITIONS " << path << std::endl;
+            return false;
+        }
+        GltfAccessorLayout layout;
+        if (!findGltfAccessor(document, buffers, position->sizeOr(SIZE_MAX),
+                              3, layout)) {
+            std::cout << "ERROR::GLTF::INVALID_ACCESSOR " << path << std::endl;
+            return false;
+        }
+        primitive.vertexCount = primitive.indexCount = layout.count;
+        if (const JsonValue* indices = primitive.info->find("indices")) {
+            if (!findGltfAccessor(document, buffers,
+                                  indices->sizeOr(SIZE_MAX), 1, layout)) {
+                std::cout << "ERROR::GLTF::INVALID_ACCESSOR " << path <<
+                    std::endl;
+                return false;
+            }
+            primitive.indexCount = layout.count;
+        }
+        primitive.firstVertex = vertexTotal;
+        primitive.firstIndex = indexTotal;
+        vertexTotal += primitive.vertexCount;
+        indexTotal += primitive.indexCount;
+    }
+    if (vertexTotal > 0xffffffffu) {
+        std::cout << "ERROR::GLTF::TOO_MANY_VERTICES " << path << std::endl;
+        return false;
+    }
+
+    mesh.vertices.assign(vertexTotal, ImportedVertex());
+    mesh.indices.resize(indexTotal);
+    std::atomic<bool> valid { true };
+    size_t threads = resolveThreadCount(options.threads);
+    parallelFor(primitives.size(), threads, [&](size_t p) {
+        const Primitive& primitive = primitives[p];
+        const JsonValue* attributes = primitive.info->find("attributes");
+        std::vector<float> values;
+        const char* names[3] = { "POSITION", "NORMAL", "TEXCOORD_0" };
+        const int widths[3] = { 3, 3, 2 };
+        for (int a = 0; a < 3; ++a) {
+            const JsonValue* accessor = attributes->find(names[a]);
+            if (!accessor)
+                continue;
+            if (!readGltfAccessor(document, buffers, accessor->sizeOr(SIZE_MAX),
+                                  widths[a], values) ||
+                values.size() != primitive.vertexCount * widths[a]) {
+                valid = false;
+                return;
+            }
+            for (size_t v = 0; v < primitive.vertexCount; ++v) {
+                ImportedVertex& vertex =
+                    mesh.vertices[primitive.firstVertex + v];
+                float* target = a == 0 ? vertex.position :
+                    (a == 1 ? vertex.normal : vertex.texCoord);
+                std::memcpy(target, &values[v * widths[a]],
+                            widths[a] * sizeof(float));
+            }
+        }
+
+        uint32_t* indices = &mesh.indices[primitive.firstIndex];
+        const JsonValue* accessor = primitive.info->find("indices");
+        if (accessor) {
+            std::vector<uint32_t> local;
+            if (!readGltfAccessor(document, buffers, accessor->sizeOr(SIZE_MAX),
+                                  1, local) ||
+                local.size() != primitive.indexCount) {
+                valid = false;
+                return;
+            }
+            for (size_t i = 0; i < local.size(); ++i) {
+                if (local[i] >= primitive.vertexCount)
+                    valid = false;
+                indices[i] = uint32_t(primitive.firstVertex + local[i]);
+            }
+        } else {
+            for (size_t i = 0; i < primitive.indexCount; ++i)
+                indices[i] = uint32_t(primitive.firstVertex + i);
+        }
+    });
+    if (!valid) {
+        std::cout << "ERROR::GLTF::INVALID_ACCESSOR " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Imports a mesh picking the format from the file extension
+ *
+ * @param path     .obj, .gltf or .glb file
+ * @param mesh     receives the vertices and indices
+ * @param options  thread count and chunk size
+ */
+inline bool importMesh(const char* path, ImportedMesh& mesh,
+                       const ImportOptions& options = ImportOptions()) {
+    std::string name = path;
+    std::string extension = name.substr(name.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return char(std::tolower(c)); });
+    if (extension == "gltf" || extension == "glb")
+        return importGltf(path, mesh, options);
+    return importObj(path, mesh, options);
+}
+
+#endif
@@ -0,0 +1,240 @@
+#ifndef MESHLET_HPP
+#define MESHLET_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "math.hpp"
+
+/**
+ * Meshlets (clusters) for large indexed triangle meshes.
+ *
+ * buildMeshlets() splits a mesh into small clusters of connected triangles
+ * and reorders the index buffer so every cluster is one contiguous range,
+ * drawable as one DrawElementsIndirectCommand from the mesh's regular
+ * vertex/element buffers. Each cluster gets a bounding sphere and a normal
+ * cone so it can be frustum and backface culled on its own, e.g. as one
+ * object of a GpuCuller (see gpu_culling.hpp).
+ *
+ * The default limits (64 vertices, 124 triangles) match common mesh shader
+ * sizes, so the same clusters can later be fed to a mesh shader path.
+ */
+
+const size_t MESHLET_MAX_VERTICES = 64;
+const size_t MESHLET_MAX_TRIANGLES = 124;
+
+struct Meshlet {
+    // Range in the reordered index buffer
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // Unique vertices referenced by the range
+    uint32_t vertexCount;
+    uint32_t reserved;
+};
+
+// Culling data of one meshlet, in mesh space
+struct MeshletBounds {
+    Vec3 center;
+    float radius = 0.0f;
+    // Normal cone, coneCutoff is 1 when the cone is too wide to cull
+    Vec3 coneAxis;
+    float coneCutoff = 1.0f;
+};
+
+struct MeshletData {
+    // Original triangles regrouped, one range per meshlet
+    std::vector<uint32_t> indices;
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshletBounds> bounds;
+};
+
+// Bounding sphere and normal cone of triangles in a meshlet
+inline MeshletBounds computeMeshletBounds(const uint32_t* indices,
+                                          size_t indexCount,
+                                          const float* positions,
+                                          size_t positionStride) {
+    const char* base = reinterpret_cast<const char*>(positions);
+    auto position = [&](uint32_t vertex) {
+        const float* p = reinterpret_cast<const float*>(
+            base + vertex * positionStride);
+        return Vec3(p[0], p[1], p[2]);
+    };
+
+    MeshletBounds bounds;
+    if (indexCount == 0)
+        return bounds;
+    Vec3 lower = position(indices[0]), upper = lower;
+    for (size_t i = 1; i < indexCount; ++i) {
+        lower = minimum(lower, position(indices[i]));
+        upper = maximum(upper, position(indices[i]));
+    }
+    bounds.center = (lower + upper) * 0.5f;
+    for (size_t i = 0; i < indexCount; ++i)
+        bounds.radius = std::max(bounds.radius,
+                                 length(position(indices[i]) -
+                                        bounds.center));
+
+    // Axis is the area weighted mean normal, the cutoff comes from the
+    // normal farthest from it
+    std::vector<Vec3> normals;
+    normals.reserve(indexCount / 3);
+    Vec3 axis;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        Vec3 p0 = position(indices[i]);
+        Vec3 weighted = cross(position(indices[i + 1]) - p0,
+                              position(indices[i + 2]) - p0);
+        float area = length(weighted);
+        if (area <= 0.0f)
+            continue;
+        axis = axis + weighted;
+        normals.push_back(weighted / area);
+    }
+    float axisLength = length(axis);
+    if (normals.empty() || axisLength <= 0.0f)
+        return bounds;
+    bounds.coneAxis = axis / axisLength;
+    float minDot = 1.0f;
+    for (Vec3 normal : normals)
+        minDot = std::min(minDot, dot(normal, bounds.coneAxis));
+    // A cone of 90 degrees or more always has a front face
+    if (minDot > 0.0f)
+        bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    return bounds;
+}
+
+/**
+ * Splits a mesh into meshlets, greedily growing each one with the adjacent
+ * triangle that adds the fewest new vertices, then the closest one. Run
+ * optimizeVertexCache() first, clusters are seeded in triangle order.
+ *
+ * @param indices         triangle list indices
+ * @param positions       first vertex position, 3 floats
+ * @param positionStride  bytes between consecutive positions
+ * @param maxVertices     vertex limit per meshlet
+ * @param maxTriangles    triangle limit per meshlet
+ */
+inline MeshletData buildMeshlets(const uint32_t* indices, size_t indexCount,
+                                 const float* positions, size_t vertexCount,
+                                 size_t positionStride,
+                                 size_t maxVertices = MESHLET_MAX_VERTICES,
+                                 size_t maxTriangles = MESHLET_MAX_TRIANGLES) {
+    const char* base = reinterpret_cast<const char*>(positions);
+    auto position = [&](uint32_t vertex) {
+        const float* p = reinterpret_cast<const float*>(
+            base + vertex * positionStride);
+        return Vec3(p[0], p[1], p[2]);
+    };
+
+    MeshletData data;
+    size_t triangleCount = indexCount / 3;
+    data.indices.reserve(triangleCount * 3);
+    maxVertices = std::max<size_t>(maxVertices, 3);
+    maxTriangles = std::max<size_t>(maxTriangles, 1);
+
+    // Triangles around each vertex
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        ++adjacencyOffsets[indices[i] + 1];
+    for (size_t v = 0; v < vertexCount; ++v)
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(),
+                               adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+
+    std::vector<Vec3> centroids(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+        centroids[t] = (position(indices[t * 3]) +
+                        position(indices[t * 3 + 1]) +
+                        position(indices[t * 3 + 2])) / 3.0f;
+
+    std::vector<bool> emitted(triangleCount, false);
+    // Meshlet index + 1 of the meshlet currently holding a vertex
+    std::vector<uint32_t> vertexTag(vertexCount, 0);
+    std::vector<uint32_t> meshletVertices;
+    size_t seed = 0;
+    while (true) {
+        while (seed < triangleCount && emitted[seed])
+            ++seed;
+        if (seed == triangleCount)
+            break;
+
+        uint32_t tag = uint32_t(data.meshlets.size() + 1);
+        Meshlet meshlet = { uint32_t(data.indices.size()), 0, 0, 0 };
+        meshletVertices.clear();
+        Vec3 centroidSum;
+        size_t triangles = 0;
+        size_t next = seed;
+        while (true) {
+            emitted[next] = true;
+            for (int corner = 0; corner < 3; ++corner) {
+                uint32_t vertex = indices[next * 3 + corner];
+                data.indices.push_back(vertex);
+                if (vertexTag[vertex] != tag) {
+                    vertexTag[vertex] = tag;
+                    meshletVertices.push_back(vertex);
+                }
+            }
+            centroidSum = centroidSum + centroids[next];
+            if (++triangles == maxTriangles)
+                break;
+
+            // Best unemitted neighbour that still fits
+            Vec3 centroid = centroidSum / float(triangles);
+            size_t best = triangleCount;
+            int bestNew = 4;
+            float bestDistance = 0.0f;
+            for (uint32_t vertex : meshletVertices) {
+                for (uint32_t a = adjacencyOffsets[vertex];
+                     a < adjacencyOffsets[vertex + 1]; ++a) {
+                    uint32_t candidate = adjacency[a];
+                    if (emitted[candidate])
+                        continue;
+                    int newVertices = 0;
+                    for (int corner = 0; corner < 3; ++corner)
+                        newVertices += vertexTag[
+                            indices[candidate * 3 + corner]] != tag;
+                    if (meshletVertices.size() + size_t(newVertices) >
+                        maxVertices || newVertices > bestNew)
+                        continue;
+                    Vec3 offset = centroids[candidate] - centroid;
+                    float distance = dot(offset, offset);
+                    if (newVertices < bestNew || distance < bestDistance) {
+                        best = candidate;
+                        bestNew = newVertices;
+                        bestDistance = distance;
+                    }
+                }
+            }
+            if (best == triangleCount)
+                break;
+            next = best;
+        }
+
+        meshlet.indexCount = uint32_t(triangles * 3);
+        meshlet.vertexCount = uint32_t(meshletVertices.size());
+        data.meshlets.push_back(meshlet);
+        data.bounds.push_back(computeMeshletBounds(
+            &data.indices[meshlet.firstIndex], meshlet.indexCount, positions,
+            positionStride));
+    }
+    return data;
+}
+
+/**
+ * CPU version of the cone test: whether every triangle of the meshlet faces
+ * away from the eye
+ *
+ * @param bounds  meshlet bounds in the same space as eye
+ */
+inline bool isMeshletBackfacing(const MeshletBounds& bounds, Vec3 eye) {
+    Vec3 offset = bounds.center - eye;
+    return dot(offset, bounds.coneAxis) >=
+        bounds.coneCutoff * length(offset) + bounds.radius;
+}
+
+#endif
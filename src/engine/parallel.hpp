@@ -0,0 +1,50 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * Minimal fork-join helpers for data parallel engine stages. Worker threads
+ * are started per call, which costs tens of microseconds, so callers should
+ * hand over work in reasonably large pieces.
+ */
+
+// Resolves a requested thread count, 0 means every hardware thread
+inline unsigned int resolveThreadCount(unsigned int requested) {
+    if (requested)
+        return requested;
+    unsigned int hardware = std::thread::hardware_concurrency();
+    return hardware ? hardware : 1;
+}
+
+/**
+ * Runs task(index) for every index in [0, count) across worker threads,
+ * the calling thread included. Workers pull the next index from a shared
+ * counter, so threads that finish early keep taking work from the slower
+ * ones.
+ *
+ * @param count    number of tasks
+ * @param threads  maximum threads to use (see resolveThreadCount)
+ * @param task     callable taking a size_t index
+ */
+template <typename Task>
+void parallelFor(size_t count, unsigned int threads, const Task& task) {
+    std::atomic<size_t> next { 0 };
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+            task(i);
+    };
+    unsigned int workerCount = unsigned(std::min<size_t>(
+        resolveThreadCount(threads), count));
+    std::vector<std::thread> workers;
+    for (unsigned int t = 1; t < workerCount; ++t)
+        workers.emplace_back(worker);
+    worker();
+    for (std::thread& thread : workers)
+        thread.join();
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef PROGRAM_HPP
+#define PROGRAM_HPP
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+/**
+ * Builds GL programs from GLSL source strings held in the engine headers
+ * (compute passes, decode snippets). File based shaders for the samples use
+ * the Shader class in the sample directories instead.
+ */
+
+/**
+ * Reports on the status of the compilation of a GL shader
+ *
+ * @param shader      shader object to be queried for compilation status
+ * @param identifier  shader name to reference in log
+ * @return whether compilation succeeded
+ */
+inline bool checkShaderCompile(GLuint shader, const char* identifier) {
+    int success;
+    char infoLog[1024];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << identifier <<
+            "::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+    return success;
+}
+
+/**
+ * Compiles and links a program from any set of shader stages
+ *
+ * @param types    shader stage of each source (GL_VERTEX_SHADER, ...)
+ * @param sources  GLSL sources, NULL entries are skipped
+ * @param count    number of stages
+ * @return program object or 0 on failure
+ */
+inline unsigned int buildProgram(const GLenum* types,
+                                 const char* const* sources, int count) {
+    unsigned int program = glCreateProgram();
+    unsigned int shaders[6] = {};
+    bool success = count <= 6;
+    for (int i = 0; i < count && success; ++i) {
+        if (!sources[i])
+            continue;
+        shaders[i] = glCreateShader(types[i]);
+        glShaderSource(shaders[i], 1, &sources[i], NULL);
+        glCompileShader(shaders[i]);
+        const char* name = types[i] == GL_VERTEX_SHADER ? "VERTEX" :
+            (types[i] == GL_FRAGMENT_SHADER ? "FRAGMENT" :
+             (types[i] == GL_COMPUTE_SHADER ? "COMPUTE" : "STAGE"));
+        success = checkShaderCompile(shaders[i], name) && success;
+        glAttachShader(program, shaders[i]);
+    }
+    if (success) {
+        glLinkProgram(program);
+        int linked;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            char infoLog[1024];
+            glGetProgramInfoLog(program, 1024, NULL, infoLog);
+            std::cout << "ERROR::PROGRAM::LINKAGE_FAILED\n" << infoLog <<
+                std::endl;
+            success = false;
+        }
+    }
+    for (int i = 0; i < count && i < 6; ++i)
+        if (shaders[i])
+            glDeleteShader(shaders[i]);
+    if (!success) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// Compiles and links a vertex + fragment program, returns 0 on failure
+inline unsigned int buildProgram(const char* vertexSource,
+                                 const char* fragmentSource) {
+    const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    const char* sources[2] = { vertexSource, fragmentSource };
+    return buildProgram(types, sources, 2);
+}
+
+// Compiles and links a compute program, returns 0 on failure
+inline unsigned int buildComputeProgram(const char* computeSource) {
+    const GLenum type = GL_COMPUTE_SHADER;
+    return buildProgram(&type, &computeSource, 1);
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef RENDER_STATE_HPP
+#define RENDER_STATE_HPP
+
+#include <glad/glad.h>
+
+/**
+ * Shadows the draw-time bindings to skip redundant GL calls.
+ *
+ * This is only safe because resource creation and updates go through
+ * Direct State Access (see buffer.hpp and vertex_array.hpp) and therefore
+ * never change the bindings behind the cache's back. Call invalidate() after
+ * any code that binds objects directly.
+ */
+class RenderState {
+public:
+    void useProgram(unsigned int program) {
+        if (program != currentProgram) {
+            glUseProgram(program);
+            currentProgram = program;
+        }
+    }
+
+    void bindVertexArray(unsigned int vertexArray) {
+        if (vertexArray != currentVertexArray) {
+            glBindVertexArray(vertexArray);
+            currentVertexArray = vertexArray;
+        }
+    }
+
+    // Forget the shadowed state so the next calls always reach GL
+    void invalidate() {
+        currentProgram = INVALID;
+        currentVertexArray = INVALID;
+    }
+
+private:
+    static const unsigned int INVALID = ~0u;
+    unsigned int currentProgram = INVALID;
+    unsigned int currentVertexArray = INVALID;
+};
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef RENDER_THREAD_HPP
+#define RENDER_THREAD_HPP
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * Runs rendering on its own thread so event handling and simulation on the
+ * main thread are not held up by glfwSwapBuffers() blocking on vsync.
+ *
+ * The main thread keeps GLFW events (glfwPollEvents() must stay there) and
+ * the simulation; it fills a frame packet with everything the frame needs
+ * and publishes it. The render thread owns the GL context, takes the
+ * newest packet, draws it and swaps. Packets are double buffered, one is
+ * read by the render thread while the other is written, so the packet
+ * type can be plain data with no locking of its own.
+ *
+ * Input-to-present latency is measured from the time the main thread
+ * started the packet (sample input just before) to swap completion.
+ */
+
+// What publishing does when the render thread hasn't taken the last packet
+enum HandoffMode {
+    // Wait for it, every packet is drawn (throughput bound by the slower
+    // thread, at most one frame of extra latency)
+    HANDOFF_BLOCKING,
+    // Overwrite it, the main thread never waits and stale frames are dropped
+    HANDOFF_LATEST
+};
+
+/****************
+ * FRAME HANDOFF
+ ****************/
+
+template <typename Packet>
+class FrameHandoff {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FrameHandoff() = default;
+    FrameHandoff(const FrameHandoff&) = delete;
+    FrameHandoff& operator=(const FrameHandoff&) = delete;
+
+    void create(HandoffMode handoffMode) {
+        std::lock_guard<std::mutex> lock(mutex);
+        mode = handoffMode;
+        readIndex = 0;
+        ready = stopping = false;
+        published = dropped = 0;
+    }
+
+    /**
+     * Main thread: returns the packet to fill, call publish() when done.
+     * Sample input right before, the latency clock starts here.
+     */
+    Packet& beginWrite() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (mode == HANDOFF_BLOCKING)
+            changed.wait(lock, [this]() { return !ready || stopping; });
+        if (ready) {
+            ready = false;
+            ++dropped;
+        }
+        int index = 1 - readIndex;
+        startTimes[index] = Clock::now();
+        return packets[index];
+    }
+
+    void publish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready = true;
+            ++published;
+        }
+        changed.notify_all();
+    }
+
+    /**
+     * Render thread: waits for a new packet, which stays valid until the
+     * next call
+     *
+     * @param started  receives the time the packet was started
+     * @return NULL once stop() has been called
+     */
+    const Packet* acquire(Clock::time_point* started = NULL) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]() { return ready || stopping; });
+        if (!ready)
+            return NULL;
+        readIndex = 1 - readIndex;
+        ready = false;
+        if (started)
+            *started = startTimes[readIndex];
+        lock.unlock();
+        changed.notify_all();
+        return &packets[readIndex];
+    }
+
+    // Wakes both threads, acquire() returns NULL from now on
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            ready = false;
+        }
+        changed.notify_all();
+    }
+
+    uint64_t publishedCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return published;
+    }
+
+    // Packets overwritten before the render thread took them
+    uint64_t droppedCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return dropped;
+    }
+
+private:
+    Packet packets[2];
+    Clock::time_point startTimes[2];
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    HandoffMode mode = HANDOFF_BLOCKING;
+    // Packet owned by the render thread, the other one is written
+    int readIndex = 0;
+    bool ready = false;
+    bool stopping = false;
+    uint64_t published = 0;
+    uint64_t dropped = 0;
+};
+
+
+/****************
+ * RENDER THREAD
+ ****************/
+
+struct RenderThreadStats {
+    uint64_t framesPresented = 0;
+    uint64_t packetsDropped = 0;
+    double averageLatencyMs = 0.0;
+    double worstLatencyMs = 0.0;
+};
+
+/**
+ * Render thread for one window. Callbacks run on the render thread with the
+ * window's context current.
+ */
+template <typename Packet>
+class RenderThread {
+public:
+    struct Callbacks {
+        // Creates GL objects owned by the render thread (may be empty)
+        std::function<void()> init;
+        // Draws a packet, the thread swaps afterwards
+        std::function<void(const Packet&)> render;
+        // Deletes GL objects before the context is released (may be empty)
+        std::function<void()> shutdown;
+    };
+
+    RenderThread() = default;
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    ~RenderThread() {
+        destroy();
+    }
+
+    /**
+     * Moves the window's context to a new render thread. The calling
+     * (main) thread must not make GL calls until destroy().
+     *
+     * @param finish  glFinish() after each swap, so latency includes the
+     *                GPU work and the render thread can't queue frames ahead
+     */
+    void create(GLFWwindow* renderWindow, Callbacks renderCallbacks,
+                HandoffMode mode = HANDOFF_BLOCKING, bool finish = true) {
+        destroy();
+        window = renderWindow;
+        callbacks = std::move(renderCallbacks);
+        finishFrames = finish;
+        handoff.create(mode);
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            statistics = RenderThreadStats();
+            totalLatencyMs = 0.0;
+        }
+        glfwMakeContextCurrent(NULL);
+        thread = std::thread([this]() { run(); });
+    }
+
+    // Main thread: packet to fill for the next frame
+    Packet& beginFrame() {
+        return handoff.beginWrite();
+    }
+
+    // Main thread: hands the packet to the render thread
+    void submit() {
+        handoff.publish();
+    }
+
+    RenderThreadStats stats() const {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        RenderThreadStats result = statistics;
+        result.packetsDropped = handoff.droppedCount();
+        if (result.framesPresented)
+            result.averageLatencyMs = totalLatencyMs /
+                double(result.framesPresented);
+        return result;
+    }
+
+    // Stops the thread and makes the context current on the caller again
+    void destroy() {
+        if (!thread.joinable())
+            return;
+        handoff.stop();
+        thread.join();
+        glfwMakeContextCurrent(window);
+    }
+
+private:
+    GLFWwindow* window = NULL;
+    Callbacks callbacks;
+    bool finishFrames = true;
+    FrameHandoff<Packet> handoff;
+    std::thread thread;
+    mutable std::mutex statsMutex;
+    RenderThreadStats statistics;
+    double totalLatencyMs = 0.0;
+
+    void run() {
+        glfwMakeContextCurrent(window);
+        if (callbacks.init)
+            callbacks.init();
+        std::chrono::steady_clock::time_point started;
+        while (const Packet* packet = handoff.acquire(&started)) {
+            callbacks.render(*packet);
+            glfwSwapBuffers(window);
+            if (finishFrames)
+                glFinish();
+            std::chrono::duration<double, std::milli> latency =
+                std::chrono::steady_clock::now() - started;
+            std::lock_guard<std::mutex> lock(statsMutex);
+            ++statistics.framesPresented;
+            totalLatencyMs += latency.count();
+            statistics.worstLatencyMs = std::max(statistics.worstLatencyMs,
+                                                 latency.count());
+        }
+        if (callbacks.shutdown)
+            callbacks.shutdown();
+        glfwMakeContextCurrent(NULL);
+    }
+};
+
+#endif
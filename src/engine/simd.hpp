@@ -0,0 +1,289 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Thin wrappers over the SIMD instruction sets the engine targets.
+ *
+ * The backend is picked from the compiler's target flags:
+ * - ENGINE_SIMD_AVX2    x86 built with AVX2 (8-wide FloatWide)
+ * - ENGINE_SIMD_SSE     x86 with SSE2, the x86-64 baseline
+ * - ENGINE_SIMD_NEON    ARM with NEON (always on AArch64)
+ * - ENGINE_SIMD_SCALAR  anything else, or when ENGINE_NO_SIMD is defined
+ *
+ * Float4 is always 4 lanes and is used for single vectors and matrices.
+ * FloatWide is the widest native register (8 lanes with AVX2, otherwise
+ * Float4) and is used by the batched SoA kernels.
+ *
+ * Comparisons return a mask with every bit of a lane set where true, masks
+ * combine with | and &, and bitmask() packs the lanes' sign bits into an
+ * int (lane i in bit i).
+ */
+
+#if defined(ENGINE_NO_SIMD)
+#define ENGINE_SIMD_SCALAR 1
+#elif defined(__AVX2__)
+#define ENGINE_SIMD_AVX2 1
+#define ENGINE_SIMD_SSE 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENGINE_SIMD_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ENGINE_SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define ENGINE_SIMD_SCALAR 1
+#endif
+
+// Name of the compiled backend, for benchmark output
+inline const char* simdBackendName() {
+#if defined(ENGINE_SIMD_AVX2)
+    return "AVX2";
+#elif defined(ENGINE_SIMD_SSE)
+    return "SSE2";
+#elif defined(ENGINE_SIMD_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+
+/****************
+ * FLOAT4
+ ****************/
+
+struct Float4 {
+#if defined(ENGINE_SIMD_SSE)
+    __m128 v;
+
+    static Float4 load(const float* p) { return { _mm_loadu_ps(p) }; }
+    static Float4 splat(float s) { return { _mm_set1_ps(s) }; }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b) {
+        return { _mm_add_ps(a.v, b.v) };
+    }
+    friend Float4 operator-(Float4 a, Float4 b) {
+        return { _mm_sub_ps(a.v, b.v) };
+    }
+    friend Float4 operator*(Float4 a, Float4 b) {
+        return { _mm_mul_ps(a.v, b.v) };
+    }
+    friend Float4 minimum(Float4 a, Float4 b) {
+        return { _mm_min_ps(a.v, b.v) };
+    }
+    friend Float4 maximum(Float4 a, Float4 b) {
+        return { _mm_max_ps(a.v, b.v) };
+    }
+    // a * b + c, fused when the target has FMA
+    friend Float4 madd(Float4 a, Float4 b, Float4 c) {
+#if defined(__FMA__)
+        return { _mm_fmadd_ps(a.v, b.v, c.v) };
+#else
+        return { _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v) };
+#endif
+    }
+    friend Float4 absolute(Float4 a) {
+        return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) };
+    }
+    friend Float4 lessThan(Float4 a, Float4 b) {
+        return { _mm_cmplt_ps(a.v, b.v) };
+    }
+    friend Float4 operator|(Float4 a, Float4 b) {
+        return { _mm_or_ps(a.v, b.v) };
+    }
+    friend Float4 operator&(Float4 a, Float4 b) {
+        return { _mm_and_ps(a.v, b.v) };
+    }
+    int bitmask() const { return _mm_movemask_ps(v); }
+#elif defined(ENGINE_SIMD_NEON)
+    float32x4_t v;
+
+    static Float4 load(const float* p) { return { vld1q_f32(p) }; }
+    static Float4 splat(float s) { return { vdupq_n_f32(s) }; }
+    void store(float* p) const { vst1q_f32(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b) {
+        return { vaddq_f32(a.v, b.v) };
+    }
+    friend Float4 operator-(Float4 a, Float4 b) {
+        return { vsubq_f32(a.v, b.v) };
+    }
+    friend Float4 operator*(Float4 a, Float4 b) {
+        return { vmulq_f32(a.v, b.v) };
+    }
+    friend Float4 minimum(Float4 a, Float4 b) {
+        return { vminq_f32(a.v, b.v) };
+    }
+    friend Float4 maximum(Float4 a, Float4 b) {
+        return { vmaxq_f32(a.v, b.v) };
+    }
+    friend Float4 madd(Float4 a, Float4 b, Float4 c) {
+        return { vmlaq_f32(c.v, a.v, b.v) };
+    }
+    friend Float4 absolute(Float4 a) { return { vabsq_f32(a.v) }; }
+    friend Float4 lessThan(Float4 a, Float4 b) {
+        return { vreinterpretq_f32_u32(vcltq_f32(a.v, b.v)) };
+    }
+    friend Float4 operator|(Float4 a, Float4 b) {
+        return { vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.v),
+                                                 vreinterpretq_u32_f32(b.v))) };
+    }
+    friend Float4 operator&(Float4 a, Float4 b) {
+        return { vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v),
+                                                 vreinterpretq_u32_f32(b.v))) };
+    }
+    int bitmask() const {
+        uint32x4_t signs = vshrq_n_u32(vreinterpretq_u32_f32(v), 31);
+        return int(vgetq_lane_u32(signs, 0) | vgetq_lane_u32(signs, 1) << 1 |
+                   vgetq_lane_u32(signs, 2) << 2 |
+                   vgetq_lane_u32(signs, 3) << 3);
+    }
+#else
+    float v[4];
+
+    static Float4 load(const float* p) {
+        return { { p[0], p[1], p[2], p[3] } };
+    }
+    static Float4 splat(float s) { return { { s, s, s, s } }; }
+    void store(float* p) const {
+        for (int i = 0; i < 4; ++i)
+            p[i] = v[i];
+    }
+
+    friend Float4 operator+(Float4 a, Float4 b) {
+        return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2],
+                   a.v[3] + b.v[3] } };
+    }
+    friend Float4 operator-(Float4 a, Float4 b) {
+        return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2],
+                   a.v[3] - b.v[3] } };
+    }
+    friend Float4 operator*(Float4 a, Float4 b) {
+        return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2],
+                   a.v[3] * b.v[3] } };
+    }
+    friend Float4 minimum(Float4 a, Float4 b) {
+        Float4 r;
+        for (int i = 0; i < 4; ++i)
+            r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+        return r;
+    }
+    friend Float4 maximum(Float4 a, Float4 b) {
+        Float4 r;
+        for (int i = 0; i < 4; ++i)
+            r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+        return r;
+    }
+    friend Float4 madd(Float4 a, Float4 b, Float4 c) {
+        return a * b + c;
+    }
+    friend Float4 absolute(Float4 a) {
+        Float4 r;
+        for (int i = 0; i < 4; ++i)
+            r.v[i] = a.v[i] < 0.0f ? -a.v[i] : a.v[i];
+        return r;
+    }
+    friend Float4 lessThan(Float4 a, Float4 b) {
+        const uint32_t all = ~0u, none = 0u;
+        Float4 r;
+        for (int i = 0; i < 4; ++i)
+            std::memcpy(&r.v[i], a.v[i] < b.v[i] ? &all : &none, 4);
+        return r;
+    }
+    friend Float4 operator|(Float4 a, Float4 b) {
+        return combine(a, b, false);
+    }
+    friend Float4 operator&(Float4 a, Float4 b) {
+        return combine(a, b, true);
+    }
+    int bitmask() const {
+        int mask = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint32_t bits;
+            std::memcpy(&bits, &v[i], 4);
+            mask |= int(bits >> 31) << i;
+        }
+        return mask;
+    }
+
+private:
+    static Float4 combine(Float4 a, Float4 b, bool both) {
+        Float4 r;
+        for (int i = 0; i < 4; ++i) {
+            uint32_t x, y;
+            std::memcpy(&x, &a.v[i], 4);
+            std::memcpy(&y, &b.v[i], 4);
+            x = both ? x & y : x | y;
+            std::memcpy(&r.v[i], &x, 4);
+        }
+        return r;
+    }
+#endif
+};
+
+
+/****************
+ * FLOATWIDE
+ ****************/
+
+#if defined(ENGINE_SIMD_AVX2)
+struct Float8 {
+    __m256 v;
+
+    static Float8 load(const float* p) { return { _mm256_loadu_ps(p) }; }
+    static Float8 splat(float s) { return { _mm256_set1_ps(s) }; }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend Float8 operator+(Float8 a, Float8 b) {
+        return { _mm256_add_ps(a.v, b.v) };
+    }
+    friend Float8 operator-(Float8 a, Float8 b) {
+        return { _mm256_sub_ps(a.v, b.v) };
+    }
+    friend Float8 operator*(Float8 a, Float8 b) {
+        return { _mm256_mul_ps(a.v, b.v) };
+    }
+    friend Float8 minimum(Float8 a, Float8 b) {
+        return { _mm256_min_ps(a.v, b.v) };
+    }
+    friend Float8 maximum(Float8 a, Float8 b) {
+        return { _mm256_max_ps(a.v, b.v) };
+    }
+    friend Float8 madd(Float8 a, Float8 b, Float8 c) {
+#if defined(__FMA__)
+        return { _mm256_fmadd_ps(a.v, b.v, c.v) };
+#else
+        return { _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v) };
+#endif
+    }
+    friend Float8 absolute(Float8 a) {
+        return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) };
+    }
+    friend Float8 lessThan(Float8 a, Float8 b) {
+        return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) };
+    }
+    friend Float8 operator|(Float8 a, Float8 b) {
+        return { _mm256_or_ps(a.v, b.v) };
+    }
+    friend Float8 operator&(Float8 a, Float8 b) {
+        return { _mm256_and_ps(a.v, b.v) };
+    }
+    int bitmask() const { return _mm256_movemask_ps(v); }
+};
+
+using FloatWide = Float8;
+#else
+using FloatWide = Float4;
+#endif
+
+// Lanes in FloatWide
+const size_t SIMD_WIDTH = sizeof(FloatWide) / sizeof(float);
+
+#endif
@@ -0,0 +1,377 @@
+#ifndef TEXTURE_ATLAS_HPP
+#define TEXTURE_ATLAS_HPP
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "texture_compression.hpp"
+
+/**
+ * Packs many small RGBA8 textures into one GL_TEXTURE_2D_ARRAY so draws
+ * that use any of them share a single bind.
+ *
+ * ATLAS_SKYLINE packs the images into as few layers ("pages") as possible
+ * with the skyline bottom-left heuristic, ATLAS_ARRAY gives every image a
+ * layer of its own (best for same sized material sets). Either way each
+ * image gets an AtlasRegion mapping its [0, 1] texture coordinates into
+ * the array, applied to vertex data ahead of time with
+ * rewriteTexCoords() or in a shader from the regions table. Images can't
+ * repeat inside an atlas, so texture coordinates must stay in [0, 1].
+ *
+ * Every image is surrounded by a gutter that repeats its edge texels,
+ * which keeps linear filtering and the first mip levels from bleeding
+ * neighbours in; mip levels stop where the gutter is used up.
+ */
+
+enum AtlasMode { ATLAS_SKYLINE, ATLAS_ARRAY };
+
+// Placement of one image, laid out for an std430 SSBO
+struct AtlasRegion {
+    // Atlas coordinate = offset + coordinate * scale
+    float offset[2];
+    float scale[2];
+    uint32_t layer;
+    uint32_t reserved[3];
+};
+static_assert(sizeof(AtlasRegion) == 32, "AtlasRegion must match std430");
+
+/**
+ * Skyline rectangle packer: the free space is tracked as the top outline
+ * of the placed rectangles, each new one goes where its top edge ends up
+ * lowest
+ */
+class SkylinePacker {
+public:
+    void create(int packWidth, int packHeight) {
+        width = packWidth;
+        height = packHeight;
+        usedArea = 0;
+        skyline.assign(1, Segment { 0, 0, packWidth });
+    }
+
+    /**
+     * Finds room for a rectangle
+     *
+     * @param x, y  receives the position of its lower left corner
+     * @return false when the rectangle does not fit
+     */
+    bool insert(int rectWidth, int rectHeight, int& x, int& y) {
+        size_t best = SIZE_MAX;
+        int bestTop = INT32_MAX, bestWidth = INT32_MAX;
+        for (size_t i = 0; i < skyline.size(); ++i) {
+            int top;
+            if (!fit(i, rectWidth, rectHeight, top))
+                continue;
+            top += rectHeight;
+            if (top < bestTop ||
+                (top == bestTop && skyline[i].width < bestWidth)) {
+                best = i;
+                bestTop = top;
+                bestWidth = skyline[i].width;
+            }
+        }
+        if (best == SIZE_MAX)
+            return false;
+        x = skyline[best].x;
+        y = bestTop - rectHeight;
+        place(best, x, bestTop, rectWidth);
+        usedArea += size_t(rectWidth) * size_t(rectHeight);
+        return true;
+    }
+
+    // Fraction of the area covered by rectangles so far
+    float occupancy() const {
+        return float(usedArea) / (float(width) * float(height));
+    }
+
+    // Highest point of the outline, the part of the area in use
+    int usedHeight() const {
+        int top = 0;
+        for (const Segment& segment : skyline)
+            top = std::max(top, segment.y);
+        return top;
+    }
+
+private:
+    struct Segment {
+        int x;
+        int y;
+        int width;
+    };
+
+    int width = 0;
+    int height = 0;
+    size_t usedArea = 0;
+    std::vector<Segment> skyline;
+
+    // Lowest y a rectangle starting at segment i can sit at
+    bool fit(size_t i, int rectWidth, int rectHeight, int& y) const {
+        if (skyline[i].x + rectWidth > width)
+            return false;
+        y = 0;
+        int remaining = rectWidth;
+        for (size_t j = i; remaining > 0; ++j) {
+            y = std::max(y, skyline[j].y);
+            if (y + rectHeight > height)
+                return false;
+            remaining -= skyline[j].width;
+        }
+        return true;
+    }
+
+    // Raises the outline under a new rectangle and merges flat segments
+    void place(size_t i, int x, int top, int rectWidth) {
+        skyline.insert(skyline.begin() + long(i),
+                       Segment { x, top, rectWidth });
+        int right = x + rectWidth;
+        size_t j = i + 1;
+        while (j < skyline.size() && skyline[j].x < right) {
+            int end = skyline[j].x + skyline[j].width;
+            if (end <= right) {
+                skyline.erase(skyline.begin() + long(j));
+            } else {
+                skyline[j].width = end - right;
+                skyline[j].x = right;
+                break;
+            }
+        }
+        for (size_t k = 0; k + 1 < skyline.size();) {
+            if (skyline[k].y == skyline[k + 1].y) {
+                skyline[k].width += skyline[k + 1].width;
+                skyline.erase(skyline.begin() + long(k + 1));
+            } else {
+                ++k;
+            }
+        }
+    }
+};
+
+class TextureAtlas {
+public:
+    // GL_TEXTURE_2D_ARRAY holding every image, 0 until build()
+    GLuint texture = 0;
+    // Indexed by the value add() returned
+    std::vector<AtlasRegion> regions;
+    int layerCount = 0;
+    int layerWidth = 0;
+    int layerHeight = 0;
+
+    TextureAtlas() = default;
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    /**
+     * Queues an image, the pixels are copied
+     *
+     * @param rgba  tightly packed RGBA8, top row first
+     * @return index of the image's region once built
+     */
+    uint32_t add(const uint8_t* rgba, int width, int height) {
+        images.push_back(copyImage(rgba, width, height));
+        return uint32_t(images.size() - 1);
+    }
+
+    /**
+     * Packs the queued images and creates the texture array
+     *
+     * @param mode      packing strategy
+     * @param pageSize  width and height of a layer (ATLAS_SKYLINE only,
+     *                  ATLAS_ARRAY layers fit the largest image)
+     * @param padding   gutter texels around each image
+     * @param srgb      store colour data as sRGB
+     * @return false if an image is larger than a page
+     */
+    bool build(AtlasMode mode, int pageSize = 2048, int padding = 4,
+               bool srgb = true) {
+        if (images.empty())
+            return false;
+        regions.assign(images.size(), AtlasRegion());
+        std::vector<Placement> placements(images.size());
+        if (mode == ATLAS_ARRAY) {
+            layerWidth = layerHeight = 0;
+            for (const ImageLevel& image : images) {
+                layerWidth = std::max(layerWidth, image.width);
+                layerHeight = std::max(layerHeight, image.height);
+            }
+            for (size_t i = 0; i < images.size(); ++i)
+                placements[i] = { int(i), 0, 0 };
+            layerCount = int(images.size());
+            // The rest of each layer repeats the image edges
+            padding = 0;
+        } else if (!pack(pageSize, padding, placements)) {
+            return false;
+        }
+
+        // Mip levels that stay inside the gutter (all of them for arrays)
+        int levels = 1;
+        while ((std::max(layerWidth, layerHeight) >> levels) > 0 &&
+               (mode == ATLAS_ARRAY || (padding >> levels) > 0))
+            ++levels;
+
+        // Building again replaces the previous texture (0 is ignored)
+        glDeleteTextures(1, &texture);
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+        glTextureStorage3D(texture, levels, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8,
+                           layerWidth, layerHeight, layerCount);
+        std::vector<uint8_t> layer(size_t(layerWidth) * layerHeight * 4);
+        for (int l = 0; l < layerCount; ++l) {
+            std::fill(layer.begin(), layer.end(), uint8_t(0));
+            for (size_t i = 0; i < images.size(); ++i) {
+                if (placements[i].layer == l)
+                    blit(images[i], placements[i], padding,
+                         mode == ATLAS_ARRAY, layer);
+            }
+            glTextureSubImage3D(texture, 0, 0, 0, l, layerWidth, layerHeight,
+                                1, GL_RGBA, GL_UNSIGNED_BYTE, layer.data());
+        }
+        if (levels > 1)
+            glGenerateTextureMipmap(texture);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, levels > 1 ?
+                            GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        for (size_t i = 0; i < images.size(); ++i) {
+            AtlasRegion& region = regions[i];
+            region.offset[0] = float(placements[i].x) / float(layerWidth);
+            region.offset[1] = float(placements[i].y) / float(layerHeight);
+            region.scale[0] = float(images[i].width) / float(layerWidth);
+            region.scale[1] = float(images[i].height) / float(layerHeight);
+            region.layer = uint32_t(placements[i].layer);
+        }
+        return true;
+    }
+
+    // Image texels over layer texels, the packing efficiency
+    float occupancy() const {
+        size_t used = 0;
+        for (const ImageLevel& image : images)
+            used += size_t(image.width) * size_t(image.height);
+        return float(used) / (float(layerWidth) * float(layerHeight) *
+                              float(layerCount));
+    }
+
+    // Drops the CPU copies of the images, regions stay valid
+    void releaseImages() {
+        images.clear();
+        images.shrink_to_fit();
+    }
+
+    void destroy() {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+        regions.clear();
+        images.clear();
+        layerCount = 0;
+    }
+
+private:
+    // Position of an image's first texel (inside the gutter)
+    struct Placement {
+        int layer;
+        int x;
+        int y;
+    };
+
+    std::vector<ImageLevel> images;
+
+    // Skyline packs tallest first, opening a new page when one is full
+    bool pack(int pageSize, int padding, std::vector<Placement>& placements) {
+        std::vector<size_t> order(images.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return images[a].height > images[b].height;
+        });
+        std::vector<SkylinePacker> pages;
+        int usedHeight = 0;
+        for (size_t i : order) {
+            int width = images[i].width + padding * 2;
+            int height = images[i].height + padding * 2;
+            if (width > pageSize || height > pageSize) {
+                std::cout << "ERROR::TEXTURE_ATLAS::IMAGE_TOO_LARGE " <<
+                    images[i].width << "x" << images[i].height << std::endl;
+                return false;
+            }
+            int x = 0, y = 0;
+            size_t page = 0;
+            while (page < pages.size() &&
+                   !pages[page].insert(width, height, x, y))
+                ++page;
+            if (page == pages.size()) {
+                pages.emplace_back();
+                pages.back().create(pageSize, pageSize);
+                if (!pages.back().insert(width, height, x, y)) {
+                    std::cout << "ERROR::TEXTURE_ATLAS::PACK_FAILED" <<
+                        std::endl;
+                    return false;
+                }
+            }
+            placements[i] = { int(page), x + padding, y + padding };
+        }
+        for (const SkylinePacker& page : pages)
+            usedHeight = std::max(usedHeight, page.usedHeight());
+        layerWidth = pageSize;
+        // A single page is trimmed to what it uses
+        layerHeight = pages.size() == 1 ? usedHeight : pageSize;
+        layerCount = int(pages.size());
+        return true;
+    }
+
+    // Copies an image into a layer and fills its gutter (or, for arrays,
+    // the rest of the layer) with its edge texels
+    void blit(const ImageLevel& image, const Placement& placement, int padding,
+              bool fillLayer, std::vector<uint8_t>& layer) const {
+        int x0 = placement.x - padding, y0 = placement.y - padding;
+        int x1 = fillLayer ? layerWidth : placement.x + image.width + padding;
+        int y1 = fillLayer ? layerHeight :
+            placement.y + image.height + padding;
+        for (int y = y0; y < y1; ++y) {
+            int sourceY = std::min(std::max(y - placement.y, 0),
+                                   image.height - 1);
+            for (int x = x0; x < x1; ++x) {
+                int sourceX = std::min(std::max(x - placement.x, 0),
+                                       image.width - 1);
+                std::memcpy(&layer[(size_t(y) * layerWidth + x) * 4],
+                            &image.rgba[(size_t(sourceY) * image.width +
+                                         sourceX) * 4], 4);
+            }
+        }
+    }
+};
+
+/**
+ * Maps texture coordinates in vertex data into an atlas region
+ *
+ * @param vertices        first vertex
+ * @param vertexCount     vertices to rewrite
+ * @param stride          bytes between vertices
+ * @param texCoordOffset  byte offset of two floats (u, v) in a vertex
+ * @param layerOffset     byte offset of a float receiving the layer (e.g.
+ *                        the third TexCoord3f component), SIZE_MAX for none
+ */
+inline void rewriteTexCoords(void* vertices, size_t vertexCount,
+                             size_t stride, size_t texCoordOffset,
+                             size_t layerOffset, const AtlasRegion& region) {
+    uint8_t* bytes = static_cast<uint8_t*>(vertices);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        uint8_t* vertex = bytes + v * stride;
+        float uv[2];
+        std::memcpy(uv, vertex + texCoordOffset, sizeof(uv));
+        for (int axis = 0; axis < 2; ++axis)
+            uv[axis] = region.offset[axis] + uv[axis] * region.scale[axis];
+        std::memcpy(vertex + texCoordOffset, uv, sizeof(uv));
+        if (layerOffset != SIZE_MAX) {
+            float layer = float(region.layer);
+            std::memcpy(vertex + layerOffset, &layer, sizeof(layer));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,664 @@
+#ifndef TEXTURE_COMPRESSION_HPP
+#define TEXTURE_COMPRESSION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "parallel.hpp"
+#include "simd.hpp"
+
+/**
+ * Offline block compression of RGBA8 images for GPU texture formats.
+ *
+ *   BC1  4 bits per texel, RGB (four colour mode, alpha is dropped)
+ *   BC3  8 bits per texel, BC1 colour plus an interpolated alpha block
+ *   BC7  8 bits per texel, RGBA, encoded in mode 6 only (one subset, 7-bit
+ *        endpoints with p-bits, 4-bit indices). A full BC7 encoder also
+ *        searches the partitioned modes, mode 6 alone is fast and already
+ *        well ahead of BC1/BC3 on smooth colour.
+ *
+ * Endpoints start on the principal axis of each block's colours and are
+ * refined by least squares. Index selection tests four texels at a time
+ * with Float4 and compressImage() spreads block rows over threads.
+ * buildMipChain() makes the levels to compress, filtering in linear light
+ * for sRGB images.
+ */
+
+enum BlockFormat { BLOCK_BC1, BLOCK_BC3, BLOCK_BC7 };
+
+inline size_t blockBytes(BlockFormat format) {
+    return format == BLOCK_BC1 ? 8 : 16;
+}
+
+// Bytes of a compressed level, partial blocks at the edges count in full
+inline size_t compressedLevelSize(BlockFormat format, int width, int height) {
+    return size_t((width + 3) / 4) * size_t((height + 3) / 4) *
+        blockBytes(format);
+}
+
+
+/****************
+ * MIP CHAIN
+ ****************/
+
+// Tightly packed RGBA8 image, top row first
+struct ImageLevel {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+inline ImageLevel copyImage(const uint8_t* rgba, int width, int height) {
+    ImageLevel image;
+    image.width = width;
+    image.height = height;
+    image.rgba.assign(rgba, rgba + size_t(width) * height * 4);
+    return image;
+}
+
+inline float srgbToLinear(uint8_t value) {
+    static const std::vector<float> table = []() {
+        std::vector<float> values(256);
+        for (int i = 0; i < 256; ++i) {
+            float c = float(i) / 255.0f;
+            values[size_t(i)] = c <= 0.04045f ? c / 12.92f :
+                std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return values;
+    }();
+    return table[value];
+}
+
+inline uint8_t linearToSrgb(float value) {
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    float c = value <= 0.0031308f ? value * 12.92f :
+        1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return uint8_t(c * 255.0f + 0.5f);
+}
+
+/**
+ * Box filters an image down to 1x1
+ *
+ * @param rgba  level 0, tightly packed RGBA8
+ * @param srgb  colour channels hold sRGB values, averaged in linear light
+ * @return every level, level 0 first
+ */
+inline std::vector<ImageLevel> buildMipChain(const uint8_t* rgba, int width,
+                                             int height, bool srgb) {
+    std::vector<ImageLevel> levels(1);
+    levels[0].width = width;
+    levels[0].height = height;
+    levels[0].rgba.assign(rgba, rgba + size_t(width) * height * 4);
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const ImageLevel& source = levels.back();
+        ImageLevel level;
+        level.width = std::max(source.width / 2, 1);
+        level.height = std::max(source.height / 2, 1);
+        level.rgba.resize(size_t(level.width) * level.height * 4);
+        for (int y = 0; y < level.height; ++y) {
+            int y0 = std::min(y * 2, source.height - 1);
+            int y1 = std::min(y * 2 + 1, source.height - 1);
+            for (int x = 0; x < level.width; ++x) {
+                int x0 = std::min(x * 2, source.width - 1);
+                int x1 = std::min(x * 2 + 1, source.width - 1);
+                const uint8_t* texels[4] = {
+                    &source.rgba[(size_t(y0) * source.width + x0) * 4],
+                    &source.rgba[(size_t(y0) * source.width + x1) * 4],
+                    &source.rgba[(size_t(y1) * source.width + x0) * 4],
+                    &source.rgba[(size_t(y1) * source.width + x1) * 4]
+                };
+                uint8_t* target =
+                    &level.rgba[(size_t(y) * level.width + x) * 4];
+                for (int c = 0; c < 4; ++c) {
+                    if (srgb && c < 3) {
+                        float sum = 0.0f;
+                        for (const uint8_t* texel : texels)
+                            sum += srgbToLinear(texel[c]);
+                        target[c] = linearToSrgb(sum * 0.25f);
+                    } else {
+                        int sum = texels[0][c] + texels[1][c] +
+                            texels[2][c] + texels[3][c];
+                        target[c] = uint8_t((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+        levels.push_back(std::move(level));
+    }
+    return levels;
+}
+
+
+/****************
+ * BLOCK FITTING
+ ****************/
+
+// One 4x4 block as channel planes (R, G, B, A) in 0-255
+struct ColorBlock {
+    alignas(16) float channels[4][16];
+};
+
+// Copies a block out of an image, repeating edge texels past the border
+inline void loadColorBlock(const uint8_t* rgba, int width, int height,
+                           int blockX, int blockY, ColorBlock& block) {
+    for (int i = 0; i < 16; ++i) {
+        int x = std::min(blockX * 4 + (i & 3), width - 1);
+        int y = std::min(blockY * 4 + (i >> 2), height - 1);
+        const uint8_t* texel = &rgba[(size_t(y) * width + x) * 4];
+        for (int c = 0; c < 4; ++c)
+            block.channels[c][i] = float(texel[c]);
+    }
+}
+
+/**
+ * Picks the closest palette entry for every texel (squared error over the
+ * first channelCount channels), four texels per step
+ *
+ * @return summed squared error of the block
+ */
+inline float selectIndices(const ColorBlock& block, const float (*palette)[4],
+                           int paletteSize, int channelCount,
+                           uint8_t* indices) {
+    float total = 0.0f;
+    for (int group = 0; group < 16; group += 4) {
+        Float4 channels[4];
+        for (int c = 0; c < channelCount; ++c)
+            channels[c] = Float4::load(&block.channels[c][group]);
+        Float4 best = Float4::splat(1e30f);
+        Float4 bestIndex = Float4::splat(0.0f);
+        for (int p = 0; p < paletteSize; ++p) {
+            Float4 distance = Float4::splat(0.0f);
+            for (int c = 0; c < channelCount; ++c) {
+                Float4 difference = channels[c] - Float4::splat(palette[p][c]);
+                distance = madd(difference, difference, distance);
+            }
+            // Select without a blend: index += closer ? p - index : 0
+            Float4 closer = lessThan(distance, best);
+            best = minimum(best, distance);
+            bestIndex = bestIndex +
+                (closer & (Float4::splat(float(p)) - bestIndex));
+        }
+        float bestIndices[4], errors[4];
+        bestIndex.store(bestIndices);
+        best.store(errors);
+        for (int i = 0; i < 4; ++i) {
+            indices[group + i] = uint8_t(bestIndices[i]);
+            total += errors[i];
+        }
+    }
+    return total;
+}
+
+/**
+ * Endpoints spanning the block along the principal axis of its colours
+ * (power iteration on the covariance)
+ */
+inline void principalEndpoints(const ColorBlock& block, int channelCount,
+                               float low[4], float high[4]) {
+    float mean[4] = { 0, 0, 0, 0 };
+    for (int c = 0; c < channelCount; ++c) {
+        for (int i = 0; i < 16; ++i)
+            mean[c] += block.channels[c][i];
+        mean[c] /= 16.0f;
+    }
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; ++i)
+        for (int a = 0; a < channelCount; ++a)
+            for (int b = a; b < channelCount; ++b)
+                covariance[a][b] += (block.channels[a][i] - mean[a]) *
+                    (block.channels[b][i] - mean[b]);
+    for (int a = 0; a < channelCount; ++a)
+        for (int b = 0; b < a; ++b)
+            covariance[a][b] = covariance[b][a];
+
+    float axis[4] = { 1, 1, 1, 1 };
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float next[4] = { 0, 0, 0, 0 };
+        float largest = 0.0f;
+        for (int a = 0; a < channelCount; ++a) {
+            for (int b = 0; b < channelCount; ++b)
+                next[a] += covariance[a][b] * axis[b];
+            largest = std::max(largest, std::fabs(next[a]));
+        }
+        if (largest < 1e-6f)
+            break;
+        for (int a = 0; a < channelCount; ++a)
+            axis[a] = next[a] / largest;
+    }
+
+    float lowest = 1e30f, highest = -1e30f;
+    for (int i = 0; i < 16; ++i) {
+        float t = 0.0f;
+        for (int c = 0; c < channelCount; ++c)
+            t += (block.channels[c][i] - mean[c]) * axis[c];
+        lowest = std::min(lowest, t);
+        highest = std::max(highest, t);
+    }
+    float lengthSquared = 0.0f;
+    for (int c = 0; c < channelCount; ++c)
+        lengthSquared += axis[c] * axis[c];
+    lowest /= lengthSquared;
+    highest /= lengthSquared;
+    for (int c = 0; c < channelCount; ++c) {
+        low[c] = std::min(std::max(mean[c] + axis[c] * lowest, 0.0f),
+                          255.0f);
+        high[c] = std::min(std::max(mean[c] + axis[c] * highest, 0.0f),
+                           255.0f);
+    }
+}
+
+/**
+ * Least squares endpoints for fixed indices, where texel i is expected at
+ * low + weights[indices[i]] * (high - low)
+ *
+ * @return false when the indices do not constrain both endpoints
+ */
+inline bool refineEndpoints(const ColorBlock& block, int channelCount,
+                            const uint8_t* indices, const float* weights,
+                            float low[4], float high[4]) {
+    float aa = 0, ab = 0, bb = 0;
+    float xa[4] = { 0, 0, 0, 0 }, xb[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < 16; ++i) {
+        float b = weights[indices[i]], a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < channelCount; ++c) {
+            xa[c] += a * block.channels[c][i];
+            xb[c] += b * block.channels[c][i];
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f)
+        return false;
+    for (int c = 0; c < channelCount; ++c) {
+        low[c] = (bb * xa[c] - ab * xb[c]) / determinant;
+        high[c] = (aa * xb[c] - ab * xa[c]) / determinant;
+        low[c] = std::min(std::max(low[c], 0.0f), 255.0f);
+        high[c] = std::min(std::max(high[c], 0.0f), 255.0f);
+    }
+    return true;
+}
+
+
+/****************
+ * BC1
+ ****************/
+
+inline uint16_t packRgb565(const float color[4]) {
+    int r = int(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = int(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = int(color[2] * 31.0f / 255.0f + 0.5f);
+    return uint16_t(r << 11 | g << 5 | b);
+}
+
+inline void unpackRgb565(uint16_t packed, int color[3]) {
+    int r = packed >> 11, g = packed >> 5 & 63, b = packed & 31;
+    color[0] = r << 3 | r >> 2;
+    color[1] = g << 2 | g >> 4;
+    color[2] = b << 3 | b >> 2;
+}
+
+// Weight of color1 for each four colour mode index
+const float BC1_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+inline float fitBc1Colors(const ColorBlock& block, uint16_t color0,
+                          uint16_t color1, uint8_t* indices) {
+    int c0[3], c1[3];
+    unpackRgb565(color0, c0);
+    unpackRgb565(color1, c1);
+    float palette[4][4];
+    for (int p = 0; p < 4; ++p)
+        for (int c = 0; c < 3; ++c)
+            palette[p][c] = float(c0[c]) + BC1_WEIGHTS[p] *
+                float(c1[c] - c0[c]);
+    return selectIndices(block, palette, 4, 3, indices);
+}
+
+// Writes the 8 byte colour block shared by BC1 and BC3
+inline void encodeBc1Colors(const ColorBlock& block, uint8_t* output) {
+    float low[4], high[4];
+    principalEndpoints(block, 3, low, high);
+    uint16_t color0 = packRgb565(high), color1 = packRgb565(low);
+    uint8_t indices[16], candidate[16];
+    float error = fitBc1Colors(block, color0, color1, indices);
+    for (int iteration = 0; iteration < 2 && color0 != color1; ++iteration) {
+        if (!refineEndpoints(block, 3, indices, BC1_WEIGHTS, high, low))
+            break;
+        uint16_t refined0 = packRgb565(high), refined1 = packRgb565(low);
+        float refinedError = fitBc1Colors(block, refined0, refined1,
+                                          candidate);
+        if (refinedError >= error)
+            break;
+        error = refinedError;
+        color0 = refined0;
+        color1 = refined1;
+        std::memcpy(indices, candidate, sizeof(indices));
+    }
+
+    // Four colour mode needs color0 > color1, swapping flips 0/1 and 2/3
+    if (color0 < color1) {
+        std::swap(color0, color1);
+        for (uint8_t& index : indices)
+            index ^= 1;
+    }
+    uint32_t bits = 0;
+    if (color0 != color1)
+        for (int i = 0; i < 16; ++i)
+            bits |= uint32_t(indices[i]) << (i * 2);
+    output[0] = uint8_t(color0);
+    output[1] = uint8_t(color0 >> 8);
+    output[2] = uint8_t(color1);
+    output[3] = uint8_t(color1 >> 8);
+    std::memcpy(output + 4, &bits, 4);
+}
+
+// alwaysFourColor is set for the colour half of BC3 blocks
+inline void decodeBc1Colors(const uint8_t* input, uint8_t* texels,
+                            bool alwaysFourColor) {
+    uint16_t color0 = uint16_t(input[0] | input[1] << 8);
+    uint16_t color1 = uint16_t(input[2] | input[3] << 8);
+    int palette[4][4];
+    unpackRgb565(color0, palette[0]);
+    unpackRgb565(color1, palette[1]);
+    bool fourColor = alwaysFourColor || color0 > color1;
+    for (int c = 0; c < 3; ++c) {
+        if (fourColor) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    for (int p = 0; p < 4; ++p)
+        palette[p][3] = fourColor || p != 3 ? 255 : 0;
+    uint32_t bits;
+    std::memcpy(&bits, input + 4, 4);
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 4; ++c)
+            texels[i * 4 + c] = uint8_t(palette[bits >> (i * 2) & 3][c]);
+}
+
+
+/****************
+ * BC3
+ ****************/
+
+// Writes the 8 byte interpolated alpha block (eight value mode)
+inline void encodeBc3Alpha(const ColorBlock& block, uint8_t* output) {
+    int lowest = 255, highest = 0;
+    for (int i = 0; i < 16; ++i) {
+        int alpha = int(block.channels[3][i] + 0.5f);
+        lowest = std::min(lowest, alpha);
+        highest = std::max(highest, alpha);
+    }
+    output[0] = uint8_t(highest);
+    output[1] = uint8_t(lowest);
+    uint64_t bits = 0;
+    if (highest > lowest) {
+        float palette[8];
+        palette[0] = float(highest);
+        palette[1] = float(lowest);
+        for (int p = 2; p < 8; ++p)
+            palette[p] = float((8 - p) * highest + (p - 1) * lowest) / 7.0f;
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            float bestError = 1e30f;
+            for (int p = 0; p < 8; ++p) {
+                float error = std::fabs(block.channels[3][i] - palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            bits |= uint64_t(best) << (i * 3);
+        }
+    }
+    for (int b = 0; b < 6; ++b)
+        output[2 + b] = uint8_t(bits >> (b * 8));
+}
+
+inline void decodeBc3Alpha(const uint8_t* input, uint8_t* texels) {
+    int palette[8] = { input[0], input[1] };
+    if (palette[0] > palette[1]) {
+        for (int p = 2; p < 8; ++p)
+            palette[p] = ((8 - p) * palette[0] + (p - 1) * palette[1]) / 7;
+    } else {
+        for (int p = 2; p < 6; ++p)
+            palette[p] = ((6 - p) * palette[0] + (p - 1) * palette[1]) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t bits = 0;
+    for (int b = 0; b < 6; ++b)
+        bits |= uint64_t(input[2 + b]) << (b * 8);
+    for (int i = 0; i < 16; ++i)
+        texels[i * 4 + 3] = uint8_t(palette[bits >> (i * 3) & 7]);
+}
+
+
+/****************
+ * BC7
+ ****************/
+
+const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30,
+                               34, 38, 43, 47, 51, 55, 60, 64 };
+
+// 128-bit little endian bit stream, fields are written LSB first
+struct Bc7Bits {
+    uint64_t words[2] = { 0, 0 };
+    int position = 0;
+
+    void write(uint32_t value, int count) {
+        for (int b = 0; b < count; ++b, ++position)
+            words[position >> 6] |= uint64_t(value >> b & 1) <<
+                (position & 63);
+    }
+    uint32_t read(int count) {
+        uint32_t value = 0;
+        for (int b = 0; b < count; ++b, ++position)
+            value |= uint32_t(words[position >> 6] >> (position & 63) & 1) <<
+                b;
+        return value;
+    }
+};
+
+// Mode 6 endpoints: 7 bits per channel plus one p-bit per endpoint
+struct Bc7Mode6 {
+    int endpoints[2][4];
+    int pbits[2];
+};
+
+inline void expandBc7Mode6(const Bc7Mode6& mode, float palette[16][4]) {
+    for (int p = 0; p < 16; ++p) {
+        for (int c = 0; c < 4; ++c) {
+            int e0 = mode.endpoints[0][c] << 1 | mode.pbits[0];
+            int e1 = mode.endpoints[1][c] << 1 | mode.pbits[1];
+            palette[p][c] = float(((64 - BC7_WEIGHTS4[p]) * e0 +
+                                   BC7_WEIGHTS4[p] * e1 + 32) >> 6);
+        }
+    }
+}
+
+// Quantizes float endpoints, trying every p-bit pair
+inline float fitBc7Mode6(const ColorBlock& block, const float low[4],
+                         const float high[4], Bc7Mode6& mode,
+                         uint8_t* indices) {
+    float bestError = 1e30f;
+    uint8_t candidate[16];
+    for (int pbits = 0; pbits < 4; ++pbits) {
+        Bc7Mode6 trial;
+        trial.pbits[0] = pbits & 1;
+        trial.pbits[1] = pbits >> 1;
+        for (int c = 0; c < 4; ++c) {
+            const float values[2] = { low[c], high[c] };
+            for (int e = 0; e < 2; ++e) {
+                int q = int((values[e] - float(trial.pbits[e])) * 0.5f +
+                            0.5f);
+                trial.endpoints[e][c] = std::min(std::max(q, 0), 127);
+            }
+        }
+        float palette[16][4];
+        expandBc7Mode6(trial, palette);
+        float error = selectIndices(block, palette, 16, 4, candidate);
+        if (error < bestError) {
+            bestError = error;
+            mode = trial;
+            std::memcpy(indices, candidate, 16);
+        }
+    }
+    return bestError;
+}
+
+inline void encodeBc7Block(const ColorBlock& block, uint8_t* output) {
+    float low[4], high[4];
+    principalEndpoints(block, 4, low, high);
+    Bc7Mode6 mode;
+    uint8_t indices[16], candidate[16];
+    float error = fitBc7Mode6(block, low, high, mode, indices);
+    float weights[16];
+    for (int p = 0; p < 16; ++p)
+        weights[p] = float(BC7_WEIGHTS4[p]) / 64.0f;
+    for (int iteration = 0; iteration < 2; ++iteration) {
+        if (!refineEndpoints(block, 4, indices, weights, low, high))
+            break;
+        Bc7Mode6 refined;
+        float refinedError = fitBc7Mode6(block, low, high, refined,
+                                         candidate);
+        if (refinedError >= error)
+            break;
+        error = refinedError;
+        mode = refined;
+        std::memcpy(indices, candidate, sizeof(indices));
+    }
+
+    // The anchor (texel 0) index is stored without its top bit
+    if (indices[0] >= 8) {
+        for (int c = 0; c < 4; ++c)
+            std::swap(mode.endpoints[0][c], mode.endpoints[1][c]);
+        std::swap(mode.pbits[0], mode.pbits[1]);
+        for (uint8_t& index : indices)
+            index = uint8_t(15 - index);
+    }
+    Bc7Bits bits;
+    bits.write(1u << 6, 7);
+    for (int c = 0; c < 4; ++c)
+        for (int e = 0; e < 2; ++e)
+            bits.write(uint32_t(mode.endpoints[e][c]), 7);
+    bits.write(uint32_t(mode.pbits[0]), 1);
+    bits.write(uint32_t(mode.pbits[1]), 1);
+    bits.write(indices[0], 3);
+    for (int i = 1; i < 16; ++i)
+        bits.write(indices[i], 4);
+    std::memcpy(output, bits.words, 16);
+}
+
+/**
+ * Decodes a mode 6 block as written by encodeBc7Block()
+ *
+ * @return false (texels untouched) for blocks in any other mode
+ */
+inline bool decodeBc7Block(const uint8_t* input, uint8_t* texels) {
+    Bc7Bits bits;
+    std::memcpy(bits.words, input, 16);
+    if (bits.read(7) != 1u << 6)
+        return false;
+    Bc7Mode6 mode;
+    for (int c = 0; c < 4; ++c)
+        for (int e = 0; e < 2; ++e)
+            mode.endpoints[e][c] = int(bits.read(7));
+    mode.pbits[0] = int(bits.read(1));
+    mode.pbits[1] = int(bits.read(1));
+    float palette[16][4];
+    expandBc7Mode6(mode, palette);
+    for (int i = 0; i < 16; ++i) {
+        uint32_t index = bits.read(i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; ++c)
+            texels[i * 4 + c] = uint8_t(palette[index][c]);
+    }
+    return true;
+}
+
+
+/****************
+ * IMAGES
+ ****************/
+
+/**
+ * Compresses a tightly packed RGBA8 image, block rows run in parallel
+ *
+ * @param threads  maximum threads to use (see resolveThreadCount)
+ * @return blocks in row order, compressedLevelSize() bytes
+ */
+inline std::vector<uint8_t> compressImage(const uint8_t* rgba, int width,
+                                          int height, BlockFormat format,
+                                          unsigned int threads = 0) {
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t bytes = blockBytes(format);
+    std::vector<uint8_t> output(compressedLevelSize(format, width, height));
+    parallelFor(size_t(blocksY), threads, [&](size_t row) {
+        ColorBlock block;
+        for (int x = 0; x < blocksX; ++x) {
+            loadColorBlock(rgba, width, height, x, int(row), block);
+            uint8_t* target = &output[(row * size_t(blocksX) + x) * bytes];
+            if (format == BLOCK_BC1) {
+                encodeBc1Colors(block, target);
+            } else if (format == BLOCK_BC3) {
+                encodeBc3Alpha(block, target);
+                encodeBc1Colors(block, target + 8);
+            } else {
+                encodeBc7Block(block, target);
+            }
+        }
+    });
+    return output;
+}
+
+// Decodes blocks back to RGBA8, for measuring compression error
+inline void decompressImage(const uint8_t* blocks, int width, int height,
+                            BlockFormat format, uint8_t* rgba) {
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t bytes = blockBytes(format);
+    uint8_t texels[16 * 4];
+    for (int y = 0; y < blocksY; ++y) {
+        for (int x = 0; x < blocksX; ++x) {
+            const uint8_t* block = blocks + (size_t(y) * blocksX + x) * bytes;
+            std::memset(texels, 0, sizeof(texels));
+            if (format == BLOCK_BC1) {
+                decodeBc1Colors(block, texels, false);
+            } else if (format == BLOCK_BC3) {
+                decodeBc1Colors(block + 8, texels, true);
+                decodeBc3Alpha(block, texels);
+            } else {
+                decodeBc7Block(block, texels);
+            }
+            for (int i = 0; i < 16; ++i) {
+                int px = x * 4 + (i & 3), py = y * 4 + (i >> 2);
+                if (px < width && py < height)
+                    std::memcpy(&rgba[(size_t(py) * width + px) * 4],
+                                &texels[i * 4], 4);
+            }
+        }
+    }
+}
+
+// Peak signal to noise ratio in dB over the first channelCount channels
+inline double imagePsnr(const uint8_t* a, const uint8_t* b, int width,
+                        int height, int channelCount) {
+    double squared = 0.0;
+    size_t texels = size_t(width) * height;
+    for (size_t i = 0; i < texels; ++i) {
+        for (int c = 0; c < channelCount; ++c) {
+            double difference = double(a[i * 4 + c]) - double(b[i * 4 + c]);
+            squared += difference * difference;
+        }
+    }
+    double mse = squared / double(texels * channelCount);
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+#endif
@@ -0,0 +1,506 @@
+#ifndef TEXTURE_LOADER_HPP
+#define TEXTURE_LOADER_HPP
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// PNG/JPEG/HDR decoding, see README. Define STB_IMAGE_IMPLEMENTATION in
+// exactly one source file before including this header.
+#include <stb_image.h>
+
+#include "ktx2.hpp"
+#include "thread_pool.hpp"
+#include "vertex_layout.hpp"
+
+/**
+ * Asynchronous texture loading.
+ *
+ * load() returns a handle at once and queues the file on a worker pool,
+ * which decodes it (stb_image) to RGBA8, or RGBA16F for .hdr. update(),
+ * called once per frame on the render thread, copies decoded images into a
+ * persistently mapped pixel unpack buffer (PBO) ring and records the
+ * glTextureSubImage2D from it, so the copy to the texture happens on the
+ * GPU timeline rather than inside the call. Mipmaps are generated on the
+ * GPU. A handle resolves to its texture once the fence behind its upload
+ * has signalled, and to a checkerboard fallback until then.
+ *
+ * .ktx2 files are read and validated on the workers and their levels are
+ * staged as stored, block compressed data goes straight to
+ * glCompressedTextureSubImage2D without decoding or mip generation.
+ *
+ * Images are stored top row first, as decoded; samples flip texture
+ * coordinates rather than the pixels.
+ */
+
+// Default size of the PBO staging ring, bigger images upload directly
+const GLsizeiptr TEXTURE_STAGING_SIZE = 64 * 1024 * 1024;
+// Staging offsets are aligned for fast DMA on every vendor
+const GLsizeiptr TEXTURE_STAGING_ALIGNMENT = 256;
+
+enum TextureState { TEXTURE_LOADING, TEXTURE_READY, TEXTURE_FAILED };
+
+struct TextureHandle {
+    uint32_t index = UINT32_MAX;
+
+    bool valid() const {
+        return index != UINT32_MAX;
+    }
+};
+
+struct TextureLoadOptions {
+    // Store colour data as sRGB so sampling returns linear values
+    bool srgb = true;
+    bool mipmaps = true;
+};
+
+// Mip chain length of a full pyramid down to 1x1
+inline GLsizei mipLevelCount(int width, int height) {
+    return GLsizei(std::floor(std::log2(float(std::max(width, height))))) +
+        1;
+}
+
+class TextureLoader {
+public:
+    TextureLoader() = default;
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    /**
+     * Starts the decode workers and allocates the staging ring
+     *
+     * @param threads       decode worker count (see resolveThreadCount)
+     * @param stagingBytes  size of the PBO staging ring
+     * @return whether the loader is ready
+     */
+    bool create(unsigned int threads = 0,
+                GLsizeiptr stagingBytes = TEXTURE_STAGING_SIZE) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+            GL_MAP_COHERENT_BIT;
+        glCreateBuffers(1, &staging);
+        glNamedBufferStorage(staging, stagingBytes, NULL, flags);
+        mapped = static_cast<unsigned char*>(
+            glMapNamedBufferRange(staging, 0, stagingBytes, flags));
+        if (mapped == NULL) {
+            std::cout << "ERROR::TEXTURE_LOADER::STAGING_MAP_FAILED" <<
+                std::endl;
+            glDeleteBuffers(1, &staging);
+            staging = 0;
+            return false;
+        }
+        stagingSize = stagingBytes;
+        head = 0;
+        s3tcSupported = hasGlExtension("GL_EXT_texture_compression_s3tc");
+
+        // Magenta and grey checkerboard shown while loading or on failure
+        uint32_t checker[8 * 8];
+        for (int i = 0; i < 8 * 8; ++i)
+            checker[i] = ((i / 8 + i % 8) & 1) ? 0xFFFF00FFu : 0xFF404040u;
+        glCreateTextures(GL_TEXTURE_2D, 1, &fallback);
+        glTextureStorage2D(fallback, 1, GL_RGBA8, 8, 8);
+        glTextureSubImage2D(fallback, 0, 0, 0, 8, 8, GL_RGBA,
+                            GL_UNSIGNED_BYTE, checker);
+        glTextureParameteri(fallback, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(fallback, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        cancelled = false;
+        pool.create(threads);
+        return true;
+    }
+
+    /**
+     * Queues an image file for decoding, returns without touching the file
+     *
+     * @param path     PNG, JPEG, HDR or any other format stb_image reads,
+     *                 or KTX2 (options are ignored, the file decides)
+     * @param options  storage options
+     * @return handle, resolves to the fallback until the texture is ready
+     */
+    TextureHandle load(const char* path,
+                       TextureLoadOptions options = TextureLoadOptions()) {
+        TextureHandle handle;
+        handle.index = uint32_t(slots.size());
+        slots.push_back(Slot());
+        ++pending;
+        std::string file(path);
+        pool.submit([this, handle, file, options]() {
+            if (cancelled)
+                return;
+            DecodedImage image = decode(file, options);
+            image.slot = handle.index;
+            {
+                std::lock_guard<std::mutex> lock(decodedMutex);
+                decoded.push_back(std::move(image));
+            }
+            decodedReady.notify_one();
+        });
+        return handle;
+    }
+
+    /**
+     * Render thread step: marks finished uploads ready and starts uploads
+     * of newly decoded images while the staging ring has room
+     *
+     * @param uploadBudget  bytes to stage at most this call (at least one
+     *                      image is always staged), 0 for no limit
+     */
+    void update(GLsizeiptr uploadBudget = 0) {
+        while (!uploads.empty()) {
+            GLenum status = glClientWaitSync(uploads.front().fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED &&
+                status != GL_CONDITION_SATISFIED)
+                break;
+            retire();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(decodedMutex);
+            for (DecodedImage& image : decoded)
+                waiting.push_back(std::move(image));
+            decoded.clear();
+        }
+
+        GLsizeiptr staged = 0;
+        bool issued = false;
+        while (!waiting.empty()) {
+            DecodedImage& image = waiting.front();
+            if (!image.error.empty()) {
+                std::cout << "ERROR::TEXTURE_LOADER::DECODE_FAILED " <<
+                    image.path << " (" << image.error << ")" << std::endl;
+                slots[image.slot].state = TEXTURE_FAILED;
+                --pending;
+                waiting.pop_front();
+                continue;
+            }
+            if (image.ktx2.format && image.ktx2.format->s3tc &&
+                !s3tcSupported) {
+                std::cout << "ERROR::TEXTURE_LOADER::FORMAT_NOT_SUPPORTED " <<
+                    image.path << std::endl;
+                slots[image.slot].state = TEXTURE_FAILED;
+                --pending;
+                waiting.pop_front();
+                continue;
+            }
+            GLsizeiptr bytes = GLsizeiptr(image.pixels.size());
+            if (uploadBudget && staged > 0 && staged + bytes > uploadBudget)
+                break;
+            // Images too big for the ring are uploaded from client memory
+            GLsizeiptr offset = -1;
+            if (bytes <= stagingSize && !allocateStaging(bytes, offset))
+                break;
+            upload(image, offset);
+            staged += bytes;
+            issued = true;
+            waiting.pop_front();
+        }
+        if (issued) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            // Submit now so the fences signal without waiting for a swap
+            glFlush();
+        }
+    }
+
+    // Blocks until every queued texture is ready or failed (load screens)
+    void finish() {
+        while (pending > 0) {
+            update();
+            if (!uploads.empty()) {
+                glClientWaitSync(uploads.front().fence,
+                                 GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            } else if (waiting.empty()) {
+                std::unique_lock<std::mutex> lock(decodedMutex);
+                decodedReady.wait_for(lock, std::chrono::milliseconds(1),
+                                      [this]() { return !decoded.empty(); });
+            }
+        }
+    }
+
+    // Texture to sample for a handle, the fallback until it is ready
+    GLuint resolve(TextureHandle handle) const {
+        if (!handle.valid() || handle.index >= slots.size() ||
+            slots[handle.index].state != TEXTURE_READY)
+            return fallback;
+        return slots[handle.index].texture;
+    }
+
+    TextureState state(TextureHandle handle) const {
+        if (!handle.valid() || handle.index >= slots.size())
+            return TEXTURE_FAILED;
+        return slots[handle.index].state;
+    }
+
+    // Textures neither ready nor failed yet
+    size_t pendingCount() const {
+        return pending;
+    }
+
+    // Stops the workers (queued decodes are dropped) and deletes textures
+    void destroy() {
+        cancelled = true;
+        pool.destroy();
+        decoded.clear();
+        waiting.clear();
+        for (const Upload& upload : uploads)
+            glDeleteSync(upload.fence);
+        uploads.clear();
+        for (const Slot& slot : slots)
+            glDeleteTextures(1, &slot.texture);
+        slots.clear();
+        pending = 0;
+        if (staging) {
+            glUnmapNamedBuffer(staging);
+            glDeleteBuffers(1, &staging);
+        }
+        staging = 0;
+        mapped = NULL;
+        glDeleteTextures(1, &fallback);
+        fallback = 0;
+    }
+
+private:
+    struct Slot {
+        GLuint texture = 0;
+        TextureState state = TEXTURE_LOADING;
+    };
+
+    struct DecodedImage {
+        uint32_t slot = 0;
+        std::string path;
+        TextureLoadOptions options;
+        int width = 0;
+        int height = 0;
+        bool hdr = false;
+        // RGBA8, or RGBA16F when hdr, or the whole file for KTX2
+        std::vector<unsigned char> pixels;
+        // Levels of a KTX2 file, pointing into pixels (moves keep them)
+        Ktx2Image ktx2;
+        // Set when decoding failed
+        std::string error;
+    };
+
+    struct Upload {
+        uint32_t slot;
+        GLsync fence;
+        // Start in the staging ring, -1 when uploaded from client memory
+        GLsizeiptr offset;
+    };
+
+    ThreadPool pool;
+    std::atomic<bool> cancelled { false };
+    // Filled by the workers
+    std::mutex decodedMutex;
+    std::condition_variable decodedReady;
+    std::deque<DecodedImage> decoded;
+    // Render thread only
+    std::deque<DecodedImage> waiting;
+    std::deque<Upload> uploads;
+    std::vector<Slot> slots;
+    size_t pending = 0;
+    GLuint staging = 0;
+    unsigned char* mapped = NULL;
+    GLsizeiptr stagingSize = 0;
+    GLsizeiptr head = 0;
+    GLuint fallback = 0;
+    bool s3tcSupported = false;
+
+    // Worker thread: whole KTX2 file, validated
+    static bool readKtx2(DecodedImage& image) {
+        std::ifstream file(image.path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            image.error = "can't open file";
+            return false;
+        }
+        image.pixels.resize(size_t(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(image.pixels.data()),
+                  std::streamsize(image.pixels.size()));
+        if (!file || !parseKtx2(image.pixels.data(), image.pixels.size(),
+                                image.ktx2)) {
+            image.error = "invalid KTX2 file";
+            image.ktx2 = Ktx2Image();
+            return false;
+        }
+        image.width = image.ktx2.width;
+        image.height = image.ktx2.height;
+        return true;
+    }
+
+    // Worker thread: file to RGBA pixels
+    static DecodedImage decode(const std::string& path,
+                               TextureLoadOptions options) {
+        DecodedImage image;
+        image.path = path;
+        image.options = options;
+        const std::string extension = ".ktx2";
+        if (path.size() > extension.size() &&
+            path.compare(path.size() - extension.size(), extension.size(),
+                         extension) == 0) {
+            readKtx2(image);
+            return image;
+        }
+        int channels = 0;
+        image.hdr = stbi_is_hdr(path.c_str()) != 0;
+        if (image.hdr) {
+            float* data = stbi_loadf(path.c_str(), &image.width,
+                                     &image.height, &channels, 4);
+            if (data) {
+                size_t count = size_t(image.width) * image.height * 4;
+                image.pixels.resize(count * sizeof(uint16_t));
+                uint16_t* halves =
+                    reinterpret_cast<uint16_t*>(image.pixels.data());
+                for (size_t i = 0; i < count; ++i)
+                    halves[i] = packHalf(data[i]);
+                stbi_image_free(data);
+                return image;
+            }
+        } else {
+            unsigned char* data = stbi_load(path.c_str(), &image.width,
+                                            &image.height, &channels, 4);
+            if (data) {
+                image.pixels.assign(data, data + size_t(image.width) *
+                                    image.height * 4);
+                stbi_image_free(data);
+                return image;
+            }
+        }
+        const char* reason = stbi_failure_reason();
+        image.error = reason ? reason : "unknown error";
+        return image;
+    }
+
+    // Finds room in the ring after the uploads still in flight
+    bool allocateStaging(GLsizeiptr bytes, GLsizeiptr& offset) {
+        bytes = (bytes + TEXTURE_STAGING_ALIGNMENT - 1) &
+            ~(TEXTURE_STAGING_ALIGNMENT - 1);
+        const Upload* oldest = NULL;
+        for (const Upload& upload : uploads) {
+            if (upload.offset >= 0) {
+                oldest = &upload;
+                break;
+            }
+        }
+        if (oldest == NULL) {
+            offset = 0;
+        } else if (head > oldest->offset) {
+            // Free space is [head, end) then [0, oldest)
+            if (stagingSize - head >= bytes)
+                offset = head;
+            else if (oldest->offset > bytes)
+                offset = 0;
+            else
+                return false;
+        } else {
+            // Free space is [head, oldest)
+            if (oldest->offset - head <= bytes)
+                return false;
+            offset = head;
+        }
+        head = offset + bytes;
+        return true;
+    }
+
+    // Creates the texture and records its upload and mip generation
+    void upload(const DecodedImage& image, GLsizeiptr offset) {
+        if (image.ktx2.format) {
+            uploadKtx2(image, offset);
+            return;
+        }
+        GLsizei levels = image.options.mipmaps ?
+            mipLevelCount(image.width, image.height) : 1;
+        GLenum format = image.hdr ? GL_RGBA16F :
+            image.options.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        GLenum type = image.hdr ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE;
+        GLuint texture;
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, levels, format, image.width,
+                           image.height);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, levels > 1 ?
+                            GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        if (offset >= 0) {
+            std::memcpy(mapped + offset, image.pixels.data(),
+                        image.pixels.size());
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+            glTextureSubImage2D(texture, 0, 0, 0, image.width, image.height,
+                                GL_RGBA, type,
+                                reinterpret_cast<const void*>(offset));
+        } else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glTextureSubImage2D(texture, 0, 0, 0, image.width, image.height,
+                                GL_RGBA, type, image.pixels.data());
+        }
+        if (levels > 1)
+            glGenerateTextureMipmap(texture);
+
+        finishUpload(image.slot, texture, offset);
+    }
+
+    // Creates the texture of a KTX2 file and records its level uploads
+    void uploadKtx2(const DecodedImage& image, GLsizeiptr offset) {
+        const Ktx2Image& ktx2 = image.ktx2;
+        GLenum format = ktx2.format->internalFormat;
+        GLuint texture;
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, GLsizei(ktx2.levels.size()), format,
+                           ktx2.width, ktx2.height);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER,
+                            ktx2.levels.size() > 1 ?
+                            GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        // Levels are packed back to back, the file's padding is skipped
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, offset >= 0 ? staging : 0);
+        GLsizeiptr cursor = offset;
+        for (size_t level = 0; level < ktx2.levels.size(); ++level) {
+            const Ktx2Level& source = ktx2.levels[level];
+            const void* data = source.data;
+            if (offset >= 0) {
+                std::memcpy(mapped + cursor, source.data, source.size);
+                data = reinterpret_cast<const void*>(cursor);
+                cursor += GLsizeiptr(source.size);
+            }
+            if (ktx2.format->compressed)
+                glCompressedTextureSubImage2D(texture, GLint(level), 0, 0,
+                                              source.width, source.height,
+                                              format, GLsizei(source.size),
+                                              data);
+            else
+                glTextureSubImage2D(texture, GLint(level), 0, 0,
+                                    source.width, source.height, GL_RGBA,
+                                    GL_UNSIGNED_BYTE, data);
+        }
+        finishUpload(image.slot, texture, offset);
+    }
+
+    // Fences the commands recorded for a texture
+    void finishUpload(uint32_t slot, GLuint texture, GLsizeiptr offset) {
+        slots[slot].texture = texture;
+        Upload upload = { slot, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0),
+                          offset };
+        uploads.push_back(upload);
+    }
+
+    // Marks the oldest upload ready, its staging space becomes free
+    void retire() {
+        const Upload& upload = uploads.front();
+        glDeleteSync(upload.fence);
+        slots[upload.slot].state = TEXTURE_READY;
+        --pending;
+        uploads.pop_front();
+    }
+};
+
+#endif
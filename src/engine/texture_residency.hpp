@@ -0,0 +1,591 @@
+#ifndef TEXTURE_RESIDENCY_HPP
+#define TEXTURE_RESIDENCY_HPP
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ktx2.hpp"
+#include "mesh_file.hpp"
+#include "texture_compression.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * GPU memory accounting and mip streaming for textures under a budget.
+ *
+ * Every texture is added with a ResidencySource that can produce any of
+ * its levels. Only the small mip tail is uploaded at first; each frame the
+ * renderer calls use() with the finest level it needs (see
+ * mipLevelForCoverage()) and update() streams missing levels in, one level
+ * per texture at a time, coarse to fine. Level data is produced on worker
+ * threads.
+ *
+ * When a level does not fit in the budget, resident levels finer than
+ * anyone wants are dropped first, then the top mips of textures scored by
+ * frames since last use divided by priority (LRU weighted by priority).
+ * Textures used this frame are not trimmed below what they asked for, so a
+ * working set larger than the budget shows as deferred levels and a
+ * pressure above 1 rather than as thrashing.
+ *
+ * Textures are immutable storage, so changing the resident levels makes a
+ * new texture object, copies the shared levels on the GPU and deletes the
+ * old one. Resolve handles with texture() each frame rather than caching
+ * the name. Sampling parameters are set to trilinear and repeat, use a
+ * sampler object for anything else.
+ */
+
+/****************
+ * SOURCES
+ ****************/
+
+/**
+ * Where the levels of a texture come from. load is called on worker
+ * threads (and for the mip tail, once on the calling thread) and must fill
+ * data with exactly the level's bytes in format's layout.
+ */
+struct ResidencySource {
+    const Ktx2Format* format = NULL;
+    int width = 0;
+    int height = 0;
+    int levelCount = 0;
+    std::function<bool(int level, std::vector<uint8_t>& data)> load;
+};
+
+// Mip chain kept in system memory, e.g. from buildMipChain()
+inline ResidencySource mipChainSource(
+    std::shared_ptr<const std::vector<ImageLevel>> chain, bool srgb = true) {
+    ResidencySource source;
+    source.format = findKtx2Format(srgb ? KTX2_VK_FORMAT_R8G8B8A8_SRGB :
+                                   KTX2_VK_FORMAT_R8G8B8A8_UNORM);
+    source.width = (*chain)[0].width;
+    source.height = (*chain)[0].height;
+    source.levelCount = int(chain->size());
+    source.load = [chain](int level, std::vector<uint8_t>& data) {
+        data = (*chain)[size_t(level)].rgba;
+        return true;
+    };
+    return source;
+}
+
+/**
+ * Levels of a KTX2 file read through a memory mapping, so evicted levels
+ * cost no system memory either
+ *
+ * @return source, with a NULL format if the file could not be used
+ */
+inline ResidencySource ktx2FileSource(const char* path) {
+    struct Ktx2File {
+        MappedFile file;
+        Ktx2Image image;
+    };
+    std::shared_ptr<Ktx2File> ktx2 = std::make_shared<Ktx2File>();
+    ResidencySource source;
+    if (!ktx2->file.open(path) ||
+        !parseKtx2(ktx2->file.data, ktx2->file.size, ktx2->image))
+        return source;
+    source.format = ktx2->image.format;
+    source.width = ktx2->image.width;
+    source.height = ktx2->image.height;
+    source.levelCount = int(ktx2->image.levels.size());
+    source.load = [ktx2](int level, std::vector<uint8_t>& data) {
+        const Ktx2Level& stored = ktx2->image.levels[size_t(level)];
+        data.assign(stored.data, stored.data + stored.size);
+        return true;
+    };
+    return source;
+}
+
+/**
+ * Finest level worth having for a texture covering a number of screen
+ * pixels across (e.g. projected size from lodProjectionScale())
+ */
+inline int mipLevelForCoverage(int width, int height, float screenPixels) {
+    float texels = float(std::max(width, height));
+    if (screenPixels >= texels)
+        return 0;
+    return int(std::floor(std::log2(texels / std::max(screenPixels, 1.0f))));
+}
+
+
+/****************
+ * MANAGER
+ ****************/
+
+// serial tells a removed texture's handles from the slot's next texture
+struct ResidencyHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t serial = 0;
+
+    bool valid() const {
+        return index != UINT32_MAX;
+    }
+};
+
+struct ResidencyOptions {
+    // Levels no larger than this (texels a side) are always resident
+    int tailSize = 64;
+    // Level loads queued on the workers at most
+    int loadsInFlight = 16;
+    // Levels uploaded per update() at most
+    int uploadsPerFrame = 8;
+    unsigned int threads = 0;
+};
+
+// Counters for the last update()
+struct ResidencyStats {
+    uint64_t budgetBytes = 0;
+    uint64_t residentBytes = 0;
+    // Resident if every texture used had the levels it asked for
+    uint64_t wantedBytes = 0;
+    // wantedBytes / budgetBytes, above 1 the working set doesn't fit
+    float pressure = 0.0f;
+    size_t textures = 0;
+    size_t streamedLevels = 0;
+    uint64_t streamedBytes = 0;
+    size_t evictedLevels = 0;
+    uint64_t evictedBytes = 0;
+    // Levels wanted but left out because nothing could be evicted
+    size_t deferredLevels = 0;
+    // Levels wanted but waiting for a loader, the loadsInFlight limit
+    size_t throttledLevels = 0;
+    size_t loadingLevels = 0;
+};
+
+class TextureResidency {
+public:
+    TextureResidency() = default;
+    TextureResidency(const TextureResidency&) = delete;
+    TextureResidency& operator=(const TextureResidency&) = delete;
+
+    /**
+     * Starts the level loading workers
+     *
+     * @param budgetBytes  GPU memory the textures may use together
+     * @param options      tail size and streaming limits
+     */
+    void create(uint64_t budgetBytes,
+                ResidencyOptions options = ResidencyOptions()) {
+        budget = budgetBytes;
+        this->options = options;
+        cancelled = false;
+        frame = 1;
+        pool.create(options.threads);
+    }
+
+    /**
+     * Adds a texture, uploading its mip tail now
+     *
+     * @param source    level provider, see mipChainSource() and
+     *                  ktx2FileSource()
+     * @param priority  higher keeps its mips longer under pressure
+     * @return handle, invalid if the source has no usable format
+     */
+    ResidencyHandle add(ResidencySource source, float priority = 1.0f) {
+        ResidencyHandle handle;
+        if (source.format == NULL || source.levelCount <= 0 ||
+            !isKtx2FormatSupported(*source.format)) {
+            std::cout << "ERROR::TEXTURE_RESIDENCY::UNSUPPORTED_SOURCE" <<
+                std::endl;
+            return handle;
+        }
+        if (freeRecords.empty()) {
+            handle.index = uint32_t(records.size());
+            records.push_back(Record());
+        } else {
+            handle.index = freeRecords.back();
+            freeRecords.pop_back();
+        }
+        Record& record = records[handle.index];
+        uint32_t serial = record.serial;
+        record = Record();
+        record.serial = serial;
+        handle.serial = serial;
+        record.source = std::move(source);
+        record.priority = std::max(priority, 0.001f);
+        record.live = true;
+        record.tail = record.source.levelCount - 1;
+        while (record.tail > 0 &&
+               std::max(levelWidth(record, record.tail - 1),
+                        levelHeight(record, record.tail - 1)) <=
+               options.tailSize)
+            --record.tail;
+        record.wanted = record.tail;
+
+        // The tail is small, load it on this thread
+        record.base = record.source.levelCount;
+        std::vector<uint8_t> data;
+        for (int level = record.source.levelCount - 1; level >= record.tail;
+             --level) {
+            if (!record.source.load(level, data) ||
+                data.size() != levelBytes(record, level)) {
+                std::cout << "ERROR::TEXTURE_RESIDENCY::LOAD_FAILED" <<
+                    std::endl;
+                remove(handle);
+                return ResidencyHandle();
+            }
+            rebuild(record, level, data.data());
+        }
+        return handle;
+    }
+
+    // Whether a handle refers to a texture that has not been removed
+    bool alive(ResidencyHandle handle) const {
+        return handle.valid() && handle.index < records.size() &&
+            records[handle.index].live &&
+            records[handle.index].serial == handle.serial;
+    }
+
+    // Frees a texture, a level being loaded for it is discarded. Stale
+    // and invalid handles are ignored
+    void remove(ResidencyHandle handle) {
+        if (!alive(handle))
+            return;
+        Record& record = records[handle.index];
+        if (record.loading >= 0)
+            reserved -= levelBytes(record, record.loading);
+        resident -= residentBytes(handle);
+        glDeleteTextures(1, &record.texture);
+        uint32_t serial = record.serial;
+        record = Record();
+        record.serial = serial + 1;
+        freeRecords.push_back(handle.index);
+    }
+
+    /**
+     * Marks a texture used this frame
+     *
+     * @param level  finest level the draw needs, 0 for full detail
+     */
+    void use(ResidencyHandle handle, int level = 0) {
+        if (!alive(handle))
+            return;
+        Record& record = records[handle.index];
+        level = std::min(std::max(level, 0), record.tail);
+        if (record.lastUsed != frame) {
+            record.lastUsed = frame;
+            record.wanted = level;
+        } else {
+            record.wanted = std::min(record.wanted, level);
+        }
+    }
+
+    void setPriority(ResidencyHandle handle, float priority) {
+        if (alive(handle))
+            records[handle.index].priority = std::max(priority, 0.001f);
+    }
+
+    // Takes effect in the next update(), evicting if needed
+    void setBudget(uint64_t budgetBytes) {
+        budget = budgetBytes;
+    }
+
+    /**
+     * Render thread step, after this frame's use() calls: uploads finished
+     * loads, evicts over budget and queues loads for wanted levels
+     */
+    void update() {
+        currentStats = ResidencyStats();
+        std::deque<LoadedLevel> ready;
+        {
+            std::lock_guard<std::mutex> lock(loadedMutex);
+            ready.swap(loaded);
+        }
+        int uploads = 0;
+        while (!ready.empty() && uploads < options.uploadsPerFrame) {
+            LoadedLevel& level = ready.front();
+            Record& record = records[level.record];
+            if (record.live && record.serial == level.serial &&
+                record.loading == level.level) {
+                record.loading = -1;
+                reserved -= levelBytes(record, level.level);
+                if (level.succeeded &&
+                    level.data.size() == levelBytes(record, level.level)) {
+                    rebuild(record, level.level, level.data.data());
+                    ++currentStats.streamedLevels;
+                    currentStats.streamedBytes +=
+                        levelBytes(record, level.level);
+                    ++uploads;
+                }
+            }
+            --inFlight;
+            ready.pop_front();
+        }
+        // Over the upload limit, keep the rest for the next frame
+        if (!ready.empty()) {
+            std::lock_guard<std::mutex> lock(loadedMutex);
+            loaded.insert(loaded.begin(),
+                          std::make_move_iterator(ready.begin()),
+                          std::make_move_iterator(ready.end()));
+        }
+
+        // A lowered budget trims whatever isn't needed right now
+        while (resident + reserved > budget && evictOne())
+            ;
+
+        // Queue the next level of every texture used this frame that is
+        // short of what it wants, highest priority first
+        std::vector<uint32_t> wanting;
+        for (uint32_t i = 0; i < records.size(); ++i) {
+            const Record& record = records[i];
+            if (record.live && record.lastUsed == frame &&
+                record.wanted < record.base)
+                wanting.push_back(i);
+        }
+        std::sort(wanting.begin(), wanting.end(),
+                  [this](uint32_t a, uint32_t b) {
+                      return records[a].priority > records[b].priority;
+                  });
+        for (uint32_t index : wanting) {
+            Record& record = records[index];
+            if (record.loading >= 0)
+                continue;
+            if (inFlight >= options.loadsInFlight) {
+                currentStats.throttledLevels += size_t(record.base -
+                                                       record.wanted);
+                continue;
+            }
+            int level = record.base - 1;
+            uint64_t bytes = levelBytes(record, level);
+            while (resident + reserved + bytes > budget && evictOne())
+                ;
+            if (resident + reserved + bytes > budget) {
+                currentStats.deferredLevels += size_t(record.base -
+                                                      record.wanted);
+                continue;
+            }
+            request(index, level);
+        }
+
+        currentStats.budgetBytes = budget;
+        currentStats.residentBytes = resident;
+        currentStats.loadingLevels = size_t(inFlight);
+        for (uint32_t i = 0; i < records.size(); ++i) {
+            const Record& record = records[i];
+            if (!record.live)
+                continue;
+            ++currentStats.textures;
+            int first = record.lastUsed == frame ? record.wanted :
+                record.tail;
+            for (int level = first; level < record.source.levelCount;
+                 ++level)
+                currentStats.wantedBytes += levelBytes(record, level);
+        }
+        currentStats.pressure = budget ? float(double(
+            currentStats.wantedBytes) / double(budget)) : 0.0f;
+        ++frame;
+    }
+
+    // Current texture object, changes when levels stream in or out. 0
+    // for a handle that is not alive()
+    GLuint texture(ResidencyHandle handle) const {
+        return alive(handle) ? records[handle.index].texture : 0;
+    }
+
+    // Finest resident level, 0 when fully resident, -1 when not alive()
+    int residentLevel(ResidencyHandle handle) const {
+        return alive(handle) ? records[handle.index].base : -1;
+    }
+
+    // Bytes of one level, resident or not
+    uint64_t levelBytes(ResidencyHandle handle, int level) const {
+        return alive(handle) ? levelBytes(records[handle.index], level) : 0;
+    }
+
+    // GPU bytes the texture uses now
+    uint64_t residentBytes(ResidencyHandle handle) const {
+        if (!alive(handle))
+            return 0;
+        const Record& record = records[handle.index];
+        uint64_t bytes = 0;
+        for (int level = record.base; level < record.source.levelCount;
+             ++level)
+            bytes += levelBytes(record, level);
+        return bytes;
+    }
+
+    ResidencyStats stats() const {
+        return currentStats;
+    }
+
+    // Stops the workers (queued loads are dropped) and frees every texture
+    void destroy() {
+        cancelled = true;
+        pool.destroy();
+        loaded.clear();
+        inFlight = 0;
+        for (Record& record : records)
+            glDeleteTextures(1, &record.texture);
+        records.clear();
+        freeRecords.clear();
+        resident = reserved = 0;
+    }
+
+private:
+    struct Record {
+        ResidencySource source;
+        GLuint texture = 0;
+        // Finest resident level and the coarsest level always resident
+        int base = 0;
+        int tail = 0;
+        // Finest level asked for in the frame lastUsed
+        int wanted = 0;
+        // Level being loaded, -1 when none
+        int loading = -1;
+        float priority = 1.0f;
+        uint64_t lastUsed = 0;
+        // Tells a loaded level from one for an earlier texture in the slot
+        uint32_t serial = 0;
+        bool live = false;
+    };
+
+    struct LoadedLevel {
+        uint32_t record;
+        uint32_t serial;
+        int level;
+        bool succeeded;
+        std::vector<uint8_t> data;
+    };
+
+    ResidencyOptions options;
+    std::vector<Record> records;
+    std::vector<uint32_t> freeRecords;
+    uint64_t budget = 0;
+    uint64_t resident = 0;
+    // Bytes of levels being loaded, counted against the budget early
+    uint64_t reserved = 0;
+    uint64_t frame = 1;
+    ResidencyStats currentStats;
+
+    ThreadPool pool;
+    std::atomic<bool> cancelled { false };
+    std::mutex loadedMutex;
+    std::deque<LoadedLevel> loaded;
+    int inFlight = 0;
+
+    static int levelWidth(const Record& record, int level) {
+        return std::max(record.source.width >> level, 1);
+    }
+
+    static int levelHeight(const Record& record, int level) {
+        return std::max(record.source.height >> level, 1);
+    }
+
+    static uint64_t levelBytes(const Record& record, int level) {
+        return ktx2LevelSize(*record.source.format, levelWidth(record, level),
+                             levelHeight(record, level));
+    }
+
+    void request(uint32_t index, int level) {
+        Record& record = records[index];
+        record.loading = level;
+        reserved += levelBytes(record, level);
+        ++inFlight;
+        uint32_t serial = record.serial;
+        std::function<bool(int, std::vector<uint8_t>&)> load =
+            record.source.load;
+        pool.submit([this, index, serial, level, load]() {
+            LoadedLevel result;
+            result.record = index;
+            result.serial = serial;
+            result.level = level;
+            result.succeeded = !cancelled && load(level, result.data);
+            std::lock_guard<std::mutex> lock(loadedMutex);
+            loaded.push_back(std::move(result));
+        });
+    }
+
+    /**
+     * Drops one top mip: first a level finer than its texture was asked
+     * for this frame, else from the unused texture with the highest
+     * age / priority. Textures with a load in flight are skipped.
+     *
+     * @return false when nothing can be evicted
+     */
+    bool evictOne() {
+        int best = -1;
+        double bestScore = 0.0;
+        for (uint32_t i = 0; i < records.size(); ++i) {
+            const Record& record = records[i];
+            if (!record.live || record.loading >= 0 ||
+                record.base >= record.tail)
+                continue;
+            double score;
+            if (record.lastUsed == frame) {
+                if (record.base >= record.wanted)
+                    continue;
+                score = 1e30;
+            } else {
+                score = double(frame - record.lastUsed) / record.priority;
+            }
+            if (best < 0 || score > bestScore) {
+                best = int(i);
+                bestScore = score;
+            }
+        }
+        if (best < 0)
+            return false;
+        Record& record = records[size_t(best)];
+        uint64_t bytes = levelBytes(record, record.base);
+        rebuild(record, record.base + 1, NULL);
+        ++currentStats.evictedLevels;
+        currentStats.evictedBytes += bytes;
+        return true;
+    }
+
+    /**
+     * Replaces a texture's storage so its finest level is base, copying
+     * the levels both share. When growing by one level, data is that
+     * level's contents.
+     */
+    void rebuild(Record& record, int base, const uint8_t* data) {
+        const Ktx2Format& format = *record.source.format;
+        GLuint texture;
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, record.source.levelCount - base,
+                           format.internalFormat, levelWidth(record, base),
+                           levelHeight(record, base));
+        for (int level = std::max(base, record.base);
+             level < record.source.levelCount; ++level)
+            glCopyImageSubData(record.texture, GL_TEXTURE_2D,
+                               level - record.base, 0, 0, 0, texture,
+                               GL_TEXTURE_2D, level - base, 0, 0, 0,
+                               levelWidth(record, level),
+                               levelHeight(record, level), 1);
+        if (data != NULL) {
+            if (format.compressed)
+                glCompressedTextureSubImage2D(
+                    texture, 0, 0, 0, levelWidth(record, base),
+                    levelHeight(record, base), format.internalFormat,
+                    GLsizei(levelBytes(record, base)), data);
+            else
+                glTextureSubImage2D(texture, 0, 0, 0,
+                                    levelWidth(record, base),
+                                    levelHeight(record, base), GL_RGBA,
+                                    GL_UNSIGNED_BYTE, data);
+        }
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER,
+                            GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glDeleteTextures(1, &record.texture);
+
+        for (int level = base; level < record.base; ++level)
+            resident += levelBytes(record, level);
+        for (int level = record.base; level < base; ++level)
+            resident -= levelBytes(record, level);
+        record.texture = texture;
+        record.base = base;
+    }
+};
+
+#endif
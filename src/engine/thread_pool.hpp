@@ -0,0 +1,100 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "parallel.hpp"
+
+/**
+ * Persistent worker threads taking tasks from one FIFO queue, for long
+ * running background work (file IO, decoding) that should not block the
+ * render thread. Short data parallel loops should keep using parallelFor().
+ */
+class ThreadPool {
+public:
+    ThreadPool() = default;
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        destroy();
+    }
+
+    /**
+     * Starts the workers
+     *
+     * @param threads  worker count (see resolveThreadCount)
+     */
+    void create(unsigned int threads = 0) {
+        destroy();
+        stopping = false;
+        unsigned int count = resolveThreadCount(threads);
+        for (unsigned int t = 0; t < count; ++t)
+            workers.emplace_back([this]() { work(); });
+    }
+
+    // Queues a task, it runs on whichever worker is free first
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    // Blocks until the queue is empty and every worker is idle
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return tasks.empty() && busy == 0; });
+    }
+
+    size_t threadCount() const {
+        return workers.size();
+    }
+
+    // Finishes the queued tasks then joins the workers
+    void destroy() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+        workers.clear();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    size_t busy = 0;
+    bool stopping = false;
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            ++busy;
+            lock.unlock();
+            task();
+            lock.lock();
+            --busy;
+            if (tasks.empty() && busy == 0)
+                idle.notify_all();
+        }
+    }
+};
+
+#endif
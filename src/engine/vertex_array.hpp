@@ -0,0 +1,99 @@
+#ifndef VERTEX_ARRAY_HPP
+#define VERTEX_ARRAY_HPP
+
+#include <glad/glad.h>
+
+#include "buffer.hpp"
+
+/**
+ * Vertex Array Object configured through Direct State Access (GL 4.5).
+ *
+ * Uses the separated attribute format API: buffers are attached to binding
+ * points with setVertexBuffer() and attributes describe their format
+ * relative to a binding point with setAttribute(). Nothing here binds the
+ * VAO, only bind() does.
+ */
+class VertexArray {
+public:
+    // Contains vertex array object ID
+    unsigned int ID = 0;
+
+    VertexArray() {
+        glCreateVertexArrays(1, &ID);
+    }
+
+    /**
+     * Attaches a buffer to a vertex buffer binding point
+     *
+     * @param binding  binding point index
+     * @param buffer   buffer holding the vertex data
+     * @param offset   byte offset of the first vertex in the buffer
+     * @param stride   distance in bytes between consecutive vertices
+     */
+    void setVertexBuffer(GLuint binding, const Buffer& buffer,
+                         GLintptr offset, GLsizei stride) const {
+        glVertexArrayVertexBuffer(ID, binding, buffer.ID, offset, stride);
+    }
+
+    // Attaches the buffer used by glDrawElements calls
+    void setElementBuffer(const Buffer& buffer) const {
+        glVertexArrayElementBuffer(ID, buffer.ID);
+    }
+
+    /**
+     * Enables a vertex attribute and describes its format
+     *
+     * @param location        shader attribute location
+     * @param binding         binding point the attribute is sourced from
+     * @param components      number of components (1-4 or GL_BGRA)
+     * @param type            component type, e.g. GL_FLOAT
+     * @param normalized      whether integer types map to [0, 1]/[-1, 1]
+     * @param relativeOffset  byte offset of the attribute inside a vertex
+     */
+    void setAttribute(GLuint location, GLuint binding, GLint components,
+                      GLenum type, GLboolean normalized,
+                      GLuint relativeOffset) const {
+        glEnableVertexArrayAttrib(ID, location);
+        glVertexArrayAttribFormat(ID, location, components, type, normalized,
+                                  relativeOffset);
+        glVertexArrayAttribBinding(ID, location, binding);
+    }
+
+    /**
+     * Enables an integer vertex attribute, read as int/uint/ivec/uvec in
+     * the shader rather than converted to float
+     *
+     * @param location        shader attribute location
+     * @param binding         binding point the attribute is sourced from
+     * @param components      number of components (1-4)
+     * @param type            integer component type, e.g. GL_UNSIGNED_INT
+     * @param relativeOffset  byte offset of the attribute inside a vertex
+     */
+    void setIntegerAttribute(GLuint location, GLuint binding,
+                             GLint components, GLenum type,
+                             GLuint relativeOffset) const {
+        glEnableVertexArrayAttrib(ID, location);
+        glVertexArrayAttribIFormat(ID, location, components, type,
+                                   relativeOffset);
+        glVertexArrayAttribBinding(ID, location, binding);
+    }
+
+    // Advances a binding point once per divisor instances instead of once
+    // per vertex, 0 restores per vertex
+    void setBindingDivisor(GLuint binding, GLuint divisor) const {
+        glVertexArrayBindingDivisor(ID, binding, divisor);
+    }
+
+    // Activate the vertex array for drawing
+    void bind() const {
+        glBindVertexArray(ID);
+    }
+
+    // Deletes the vertex array object, the GL context must still be current
+    void destroy() {
+        glDeleteVertexArrays(1, &ID);
+        ID = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef VERTEX_COMPRESSION_HPP
+#define VERTEX_COMPRESSION_HPP
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "vertex_layout.hpp"
+
+/**
+ * Vertex compression stage.
+ *
+ * Shrinks a float vertex of position, normal and colour (36 bytes) to 16
+ * bytes:
+ * - positions are quantized to unorm16 against the mesh bounding box
+ * - normals are octahedral encoded into two snorm16 values
+ * - colours are packed as unorm8 x 4
+ *
+ * The same functions run offline (mesh conversion) and at runtime (meshes
+ * generated on the fly). Shaders undo the quantization with the GLSL in
+ * VERTEX_DECODE_GLSL.
+ */
+
+// Axis aligned bounding box used as the quantization grid
+struct QuantizationBounds {
+    float min[3] = { 0.0f, 0.0f, 0.0f };
+    float extent[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+// 16 byte compressed vertex, matches CompressedVertexLayout
+struct CompressedVertex {
+    uint16_t position[4];
+    uint32_t color;
+    int16_t normal[2];
+};
+
+using CompressedVertexLayout = VertexLayout<Pos4u16, Color4u8, Normal2s16>;
+static_assert(sizeof(CompressedVertex) == CompressedVertexLayout::stride,
+              "CompressedVertex must match its layout");
+
+/**
+ * Computes the bounding box of a set of positions
+ *
+ * @param positions  xyz triples
+ * @param count      number of positions
+ */
+inline QuantizationBounds computeBounds(const float* positions,
+                                        size_t count) {
+    QuantizationBounds bounds;
+    if (count == 0)
+        return bounds;
+    float max[3];
+    for (int axis = 0; axis < 3; ++axis)
+        bounds.min[axis] = max[axis] = positions[axis];
+    for (size_t i = 1; i < count; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            float value = positions[i * 3 + axis];
+            bounds.min[axis] = std::fmin(bounds.min[axis], value);
+            max[axis] = std::fmax(max[axis], value);
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis)
+        bounds.extent[axis] = max[axis] - bounds.min[axis];
+    return bounds;
+}
+
+// Quantizes one coordinate to unorm16 relative to the bounds on an axis
+inline uint16_t quantizeUnorm16(float value, float min, float extent) {
+    if (extent <= 0.0f)
+        return 0;
+    float normalized = (value - min) / extent;
+    normalized = normalized < 0.0f ? 0.0f :
+        (normalized > 1.0f ? 1.0f : normalized);
+    return uint16_t(normalized * 65535.0f + 0.5f);
+}
+
+// Maps [-1, 1] to a signed 16-bit normalised integer
+inline int16_t packSnorm16(float value) {
+    value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+    return int16_t(std::lround(value * 32767.0f));
+}
+
+/**
+ * Octahedral encoding of a unit vector into two values in [-1, 1]
+ *
+ * Projects the vector onto the octahedron |x| + |y| + |z| = 1 and folds the
+ * lower hemisphere over the diagonals so the result covers a square.
+ */
+inline void octEncode(const float normal[3], float encoded[2]) {
+    float length = std::fabs(normal[0]) + std::fabs(normal[1]) +
+        std::fabs(normal[2]);
+    if (length == 0.0f) {
+        encoded[0] = encoded[1] = 0.0f;
+        return;
+    }
+    float x = normal[0] / length;
+    float y = normal[1] / length;
+    if (normal[2] < 0.0f) {
+        float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = x;
+    encoded[1] = y;
+}
+
+// Inverse of octEncode, returns a unit vector
+inline void octDecode(const float encoded[2], float normal[3]) {
+    float x = encoded[0];
+    float y = encoded[1];
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    if (z < 0.0f) {
+        float unfoldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float unfoldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = unfoldedX;
+        y = unfoldedY;
+    }
+    float length = std::sqrt(x * x + y * y + z * z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
+
+/**
+ * Compresses interleaved-by-attribute vertex data
+ *
+ * @param positions  xyz triples
+ * @param normals    xyz unit vectors (may be NULL)
+ * @param colors     rgb triples in [0, 1] (may be NULL, white is used)
+ * @param count      number of vertices
+ * @param bounds     quantization grid, usually computeBounds(positions)
+ * @param out        receives count compressed vertices
+ */
+inline void compressVertices(const float* positions, const float* normals,
+                             const float* colors, size_t count,
+                             const QuantizationBounds& bounds,
+                             CompressedVertex* out) {
+    for (size_t i = 0; i < count; ++i) {
+        CompressedVertex& vertex = out[i];
+        for (int axis = 0; axis < 3; ++axis)
+            vertex.position[axis] = quantizeUnorm16(
+                positions[i * 3 + axis], bounds.min[axis],
+                bounds.extent[axis]);
+        vertex.position[3] = 0;
+
+        if (colors)
+            vertex.color = packColor4u8(colors[i * 3], colors[i * 3 + 1],
+                                        colors[i * 3 + 2]);
+        else
+            vertex.color = 0xffffffffu;
+
+        float encoded[2] = { 0.0f, 0.0f };
+        if (normals)
+            octEncode(&normals[i * 3], encoded);
+        vertex.normal[0] = packSnorm16(encoded[0]);
+        vertex.normal[1] = packSnorm16(encoded[1]);
+    }
+}
+
+// Convenience overload computing the bounds and returning a new array
+inline std::vector<CompressedVertex> compressVertices(
+        const float* positions, const float* normals, const float* colors,
+        size_t count, QuantizationBounds& bounds) {
+    bounds = computeBounds(positions, count);
+    std::vector<CompressedVertex> out(count);
+    compressVertices(positions, normals, colors, count, bounds, out.data());
+    return out;
+}
+
+/**
+ * Sets the uniforms VERTEX_DECODE_GLSL needs to dequantize positions
+ *
+ * @param program  linked shader program using the decode snippet
+ * @param bounds   bounds the mesh was quantized against
+ */
+inline void setQuantizationUniforms(unsigned int program,
+                                    const QuantizationBounds& bounds) {
+    glProgramUniform3fv(program,
+                        glGetUniformLocation(program, "uQuantizeMin"), 1,
+                        bounds.min);
+    glProgramUniform3fv(program,
+                        glGetUniformLocation(program, "uQuantizeExtent"), 1,
+                        bounds.extent);
+}
+
+/**
+ * GLSL decode functions, paste after the #version line of a vertex shader
+ * reading CompressedVertexLayout:
+ *
+ *   layout (location = 0) in vec4 aPos;      // unorm16, normalised by GL
+ *   layout (location = 1) in vec4 aColor;    // unorm8, normalised by GL
+ *   layout (location = 2) in vec2 aNormal;   // snorm16, normalised by GL
+ *
+ *   vec3 position = decodePosition(aPos.xyz);
+ *   vec3 normal = decodeNormal(aNormal);
+ */
+const char* const VERTEX_DECODE_GLSL =
+    "uniform vec3 uQuantizeMin;\n"
+    "uniform vec3 uQuantizeExtent;\n"
+    "vec3 decodePosition(vec3 quantized) {\n"
+    "    return uQuantizeMin + quantized * uQuantizeExtent;\n"
+    "}\n"
+    "vec3 decodeNormal(vec2 encoded) {\n"
+    "    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));\n"
+    "    float t = max(-n.z, 0.0);\n"
+    "    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);\n"
+    "    return normalize(n);\n"
+    "}\n";
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef VERTEX_LAYOUT_HPP
+#define VERTEX_LAYOUT_HPP
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#include "buffer.hpp"
+#include "vertex_array.hpp"
+
+/****************
+ * ATTRIBUTE FORMATS
+ *
+ * Each format describes how one attribute is stored inside a vertex. The
+ * packed formats cut vertex bandwidth: a unorm8 colour is 4 bytes instead
+ * of 12 and a 2_10_10_10 normal is 4 bytes instead of 12.
+ ****************/
+
+template <GLint Components, GLenum Type, GLboolean Normalized, GLuint Size,
+          bool Integer = false>
+struct AttribFormat {
+    static constexpr GLint components = Components;
+    static constexpr GLenum type = Type;
+    static constexpr GLboolean normalized = Normalized;
+    // Size in bytes inside the vertex
+    static constexpr GLuint size = Size;
+    // Integer attributes are read as ivec/uvec and use
+    // glVertexArrayAttribIFormat
+    static constexpr bool integer = Integer;
+};
+
+// 32-bit floats
+using Float1f = AttribFormat<1, GL_FLOAT, GL_FALSE, 4>;
+using Pos2f = AttribFormat<2, GL_FLOAT, GL_FALSE, 8>;
+using Pos3f = AttribFormat<3, GL_FLOAT, GL_FALSE, 12>;
+using Normal3f = AttribFormat<3, GL_FLOAT, GL_FALSE, 12>;
+using TexCoord2f = AttribFormat<2, GL_FLOAT, GL_FALSE, 8>;
+// u, v and texture array layer (see TextureAtlas)
+using TexCoord3f = AttribFormat<3, GL_FLOAT, GL_FALSE, 12>;
+using Color3f = AttribFormat<3, GL_FLOAT, GL_FALSE, 12>;
+using Color4f = AttribFormat<4, GL_FLOAT, GL_FALSE, 16>;
+
+// 16-bit half floats (see packHalf), padded to 4 byte multiples
+using TexCoord2h = AttribFormat<2, GL_HALF_FLOAT, GL_FALSE, 4>;
+using Pos4h = AttribFormat<4, GL_HALF_FLOAT, GL_FALSE, 8>;
+
+// Normalised integers
+using Color4u8 = AttribFormat<4, GL_UNSIGNED_BYTE, GL_TRUE, 4>;
+using Pos4u16 = AttribFormat<4, GL_UNSIGNED_SHORT, GL_TRUE, 8>;
+using TexCoord2u16 = AttribFormat<2, GL_UNSIGNED_SHORT, GL_TRUE, 4>;
+using Normal2s16 = AttribFormat<2, GL_SHORT, GL_TRUE, 4>;
+using Normal2s8 = AttribFormat<2, GL_BYTE, GL_TRUE, 2>;
+// x/y/z in signed 10 bits, w in signed 2 bits (see packSnorm1010102)
+using Normal4i1010102 = AttribFormat<4, GL_INT_2_10_10_10_REV, GL_TRUE, 4>;
+
+// Pure integers
+using Index1u32 = AttribFormat<1, GL_UNSIGNED_INT, GL_FALSE, 4, true>;
+
+
+/****************
+ * VERTEX LAYOUT
+ ****************/
+
+/**
+ * Compile-time description of an interleaved vertex.
+ *
+ * Attributes are assigned consecutive shader locations in the order given,
+ * so VertexLayout<Pos3f, Color3f> matches a shader declaring
+ * `layout (location = 0) in vec3 aPos` and `layout (location = 1) in vec3
+ * aColor`. The stride and every offset are constant expressions.
+ */
+template <typename... Attribs>
+struct VertexLayout {
+    static constexpr size_t count = sizeof...(Attribs);
+    static constexpr GLsizei stride = (0 + ... + Attribs::size);
+    static constexpr std::array<GLuint, count> offsets = [] {
+        std::array<GLuint, count> result {};
+        GLuint sizes[] = { Attribs::size... };
+        GLuint offset = 0;
+        for (size_t i = 0; i < count; ++i) {
+            result[i] = offset;
+            offset += sizes[i];
+        }
+        return result;
+    }();
+
+    // Byte offset of the attribute at index I
+    template <size_t I>
+    static constexpr GLuint offset() {
+        static_assert(I < count, "Attribute index out of range");
+        return offsets[I];
+    }
+
+    /**
+     * Issues the format calls describing this layout on a vertex array
+     *
+     * @param vertexArray    vertex array to configure
+     * @param binding        buffer binding point the attributes read from
+     * @param firstLocation  shader location of the first attribute
+     */
+    static void apply(const VertexArray& vertexArray, GLuint binding = 0,
+                      GLuint firstLocation = 0) {
+        applyAll(vertexArray.ID, binding, firstLocation,
+                 std::index_sequence_for<Attribs...>());
+    }
+
+    // Unique per layout type, used to key cached vertex arrays
+    static const void* id() {
+        static const char tag = 0;
+        return &tag;
+    }
+
+private:
+    template <size_t... I>
+    static void applyAll(GLuint vao, GLuint binding, GLuint firstLocation,
+                         std::index_sequence<I...>) {
+        (applyAttrib<Attribs>(vao, binding, firstLocation + GLuint(I),
+                              offsets[I]), ...);
+    }
+
+    template <typename Attrib>
+    static void applyAttrib(GLuint vao, GLuint binding, GLuint location,
+                            GLuint offset) {
+        glEnableVertexArrayAttrib(vao, location);
+        if constexpr (Attrib::integer)
+            glVertexArrayAttribIFormat(vao, location, Attrib::components,
+                                       Attrib::type, offset);
+        else
+            glVertexArrayAttribFormat(vao, location, Attrib::components,
+                                      Attrib::type, Attrib::normalized,
+                                      offset);
+        glVertexArrayAttribBinding(vao, location, binding);
+    }
+};
+
+
+/****************
+ * VERTEX ARRAY CACHE
+ ****************/
+
+/**
+ * Owns one vertex array per (layout, vertex buffer, element buffer)
+ * combination so that draw code can ask for a VAO instead of building and
+ * tracking them by hand. Lookups happen off the GL side entirely; a VAO is
+ * only created the first time a combination is requested.
+ */
+class VertexArrayCache {
+public:
+    /**
+     * Returns the vertex array for a layout reading from a buffer
+     *
+     * @param vertices  buffer holding interleaved vertices in Layout
+     * @param elements  optional element buffer (NULL for none)
+     * @param offset    byte offset of the first vertex in the buffer
+     */
+    template <typename Layout>
+    const VertexArray& get(const Buffer& vertices,
+                           const Buffer* elements = NULL,
+                           GLintptr offset = 0) {
+        Key key { Layout::id(), vertices.ID, elements ? elements->ID : 0,
+                  offset };
+        auto found = vertexArrays.find(key);
+        if (found != vertexArrays.end())
+            return found->second;
+
+        VertexArray vertexArray;
+        vertexArray.setVertexBuffer(0, vertices, offset, Layout::stride);
+        if (elements)
+            vertexArray.setElementBuffer(*elements);
+        Layout::apply(vertexArray);
+        return vertexArrays.emplace(key, vertexArray).first->second;
+    }
+
+    // Number of vertex arrays created so far
+    size_t size() const {
+        return vertexArrays.size();
+    }
+
+    // Deletes every cached vertex array, the GL context must still be current
+    void destroy() {
+        for (auto& entry : vertexArrays)
+            entry.second.destroy();
+        vertexArrays.clear();
+    }
+
+private:
+    struct Key {
+        const void* layout;
+        unsigned int vertexBuffer;
+        unsigned int elementBuffer;
+        GLintptr offset;
+
+        bool operator==(const Key& other) const {
+            return layout == other.layout &&
+                vertexBuffer == other.vertexBuffer &&
+                elementBuffer == other.elementBuffer &&
+                offset == other.offset;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            size_t hash = std::hash<const void*>()(key.layout);
+            hash ^= (size_t(key.vertexBuffer) << 1) ^
+                (size_t(key.elementBuffer) << 17) ^ size_t(key.offset);
+            return hash;
+        }
+    };
+
+    std::unordered_map<Key, VertexArray, KeyHash> vertexArrays;
+};
+
+
+/****************
+ * PACKING HELPERS
+ ****************/
+
+// Converts a float to IEEE 754 half precision (round to nearest even)
+inline uint16_t packHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t exponent = (bits >> 23) & 0xffu;
+    uint32_t mantissa = bits & 0x7fffffu;
+
+    // NaN and infinity
+    if (exponent == 0xffu)
+        return uint16_t(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    int halfExponent = int(exponent) - 127 + 15;
+    // Overflow to infinity
+    if (halfExponent >= 31)
+        return uint16_t(sign | 0x7c00u);
+    // Subnormal halves (or zero)
+    if (halfExponent <= 0) {
+        if (halfExponent < -10)
+            return uint16_t(sign);
+        mantissa |= 0x800000u;
+        uint32_t shift = uint32_t(14 - halfExponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1u);
+        if (remainder > halfway || (remainder == halfway && (half & 1u)))
+            ++half;
+        return uint16_t(sign | half);
+    }
+    uint32_t half = (uint32_t(halfExponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fffu;
+    // Carry into the exponent is correct, it rounds up to the next power
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+        ++half;
+    return uint16_t(sign | half);
+}
+
+// Converts IEEE 754 half precision back to a float
+inline float unpackHalf(uint16_t value) {
+    uint32_t sign = uint32_t(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    uint32_t bits;
+    if (exponent == 0x1fu) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // Normalise the subnormal half
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400u)) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Maps [0, 1] to an 8-bit unsigned normalised integer
+inline constexpr uint8_t packUnorm8(float value) {
+    value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return uint8_t(value * 255.0f + 0.5f);
+}
+
+// Packs an RGBA colour in [0, 1] for Color4u8 (R in the lowest byte)
+inline constexpr uint32_t packColor4u8(float r, float g, float b,
+                                       float a = 1.0f) {
+    return uint32_t(packUnorm8(r)) | (uint32_t(packUnorm8(g)) << 8) |
+        (uint32_t(packUnorm8(b)) << 16) | (uint32_t(packUnorm8(a)) << 24);
+}
+
+// Packs x/y/z/w in [-1, 1] for Normal4i1010102 (GL_INT_2_10_10_10_REV)
+inline constexpr uint32_t packSnorm1010102(float x, float y, float z,
+                                           float w = 0.0f) {
+    auto snorm = [](float value, float scale, uint32_t mask) {
+        value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+        float scaled = value * scale;
+        int rounded = int(scaled + (scaled < 0.0f ? -0.5f : 0.5f));
+        return uint32_t(rounded) & mask;
+    };
+    return snorm(x, 511.0f, 0x3ffu) | (snorm(y, 511.0f, 0x3ffu) << 10) |
+        (snorm(z, 511.0f, 0x3ffu) << 20) | (snorm(w, 1.0f, 0x3u) << 30);
+}
+
+#endif
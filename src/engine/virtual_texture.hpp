@@ -0,0 +1,903 @@
+#ifndef VIRTUAL_TEXTURE_HPP
+#define VIRTUAL_TEXTURE_HPP
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "buffer.hpp"
+#include "gl_extensions.hpp"
+#include "mesh_file.hpp"
+#include "texture_compression.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * Streaming virtual textures: only the pages of a huge texture that the
+ * current view samples are kept in GPU memory, in a cache of fixed size.
+ *
+ * Frame flow:
+ *   1. beginFeedback(), draw the textured geometry with a shader calling
+ *      virtualFeedback(uv), endFeedback(). This renders the page each pixel
+ *      wants into a small R32UI target and starts an async readback.
+ *   2. update() reads the previous feedback, refreshes the LRU age of the
+ *      pages in use, queues missing pages on the worker pool (which copy
+ *      them out of the memory mapped .vtex file), uploads pages the workers
+ *      finished into free or least recently used cache slots and rewrites
+ *      the page table.
+ *   3. Draw with a shader calling sampleVirtual(uv).
+ *
+ * The page table (an SSBO) maps every page of every level to the finest
+ * resident page covering it, so a missing page shows its coarser parent
+ * until it arrives. The coarsest level is a single page that is loaded in
+ * create() and never evicted.
+ *
+ * With ARB_sparse_texture, and a hardware page size matching the file's,
+ * pages are committed into a sparse texture of the full virtual size and
+ * sampled directly (bilinear at page seams may touch uncommitted memory).
+ * Otherwise the cache is a plain texture holding bordered pages and the
+ * shader does the indirection. Either way at most cachePages² pages are
+ * resident, whatever the size of the source texture.
+ */
+
+/****************
+ * FILE FORMAT
+ ****************/
+
+/**
+ * Tiled texture file (.vtex), fixed size pages so page i of the file is at
+ * pageOffset + i * pageBytes:
+ *
+ *   VirtualTextureHeader                fixed 64 bytes
+ *   padding to VIRTUAL_TEXTURE_ALIGNMENT
+ *   pages                               level 0 first, rows top to bottom
+ *
+ * A page is (pageSize + 2 * border)² RGBA8 texels, the border repeats the
+ * neighbouring pages' texels so bilinear filtering is seamless. Width and
+ * height are padded so that every level is a whole number of pages and the
+ * last level is exactly one page; contentWidth/Height is the image inside.
+ */
+
+const char VIRTUAL_TEXTURE_MAGIC[4] = { 'G', 'L', 'V', 'T' };
+const uint32_t VIRTUAL_TEXTURE_VERSION = 1;
+const uint64_t VIRTUAL_TEXTURE_ALIGNMENT = 4096;
+const int VIRTUAL_TEXTURE_MAX_LEVELS = 16;
+const int VIRTUAL_TEXTURE_MAX_PAGE_SIZE = 4096;
+
+// Set in VirtualTextureHeader::flags when texels are sRGB encoded
+const uint32_t VIRTUAL_TEXTURE_FLAG_SRGB = 1u << 0;
+
+struct VirtualTextureHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t width;
+    uint32_t height;
+    uint32_t contentWidth;
+    uint32_t contentHeight;
+    uint32_t pageSize;
+    uint32_t border;
+    uint32_t levelCount;
+    uint32_t pageCount;
+    uint32_t pageBytes;
+    uint64_t pageOffset;
+    uint32_t reserved[2];
+};
+static_assert(sizeof(VirtualTextureHeader) == 64,
+              "Header must stay 64 bytes");
+
+// Pages per side of a level of a padded virtual texture
+inline uint32_t virtualPagesAt(uint32_t size, uint32_t pageSize,
+                               uint32_t level) {
+    return (size >> level) / pageSize;
+}
+
+/**
+ * Writes an image as a tiled, mipmapped virtual texture
+ *
+ * @param rgba      tightly packed RGBA8, top row first
+ * @param pageSize  texels per page side without the border, use the
+ *                  sparse page size (128 for RGBA8) to allow sparse
+ *                  residency
+ * @param border    filter border around each page
+ * @param srgb      colour channels are sRGB (mips average in linear light)
+ * @return whether the file was written
+ */
+inline bool writeVirtualTextureFile(const char* path, const uint8_t* rgba,
+                                    int width, int height,
+                                    int pageSize = 128, int border = 4,
+                                    bool srgb = true) {
+    if (pageSize <= 0 || pageSize > VIRTUAL_TEXTURE_MAX_PAGE_SIZE ||
+        border < 0 || border >= pageSize) {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::BAD_PAGE_SIZE" << std::endl;
+        return false;
+    }
+    int levels = 1;
+    while ((std::max(width, height) - 1) >> (levels - 1) >= pageSize)
+        ++levels;
+    if (levels > VIRTUAL_TEXTURE_MAX_LEVELS) {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::TOO_LARGE" << std::endl;
+        return false;
+    }
+    // Padding the edges makes every level a whole number of pages
+    int unit = pageSize << (levels - 1);
+    int paddedWidth = (width + unit - 1) / unit * unit;
+    int paddedHeight = (height + unit - 1) / unit * unit;
+    std::vector<uint8_t> padded(size_t(paddedWidth) * paddedHeight * 4);
+    for (int y = 0; y < paddedHeight; ++y) {
+        const uint8_t* row = rgba + size_t(std::min(y, height - 1)) *
+            width * 4;
+        for (int x = 0; x < paddedWidth; ++x)
+            std::memcpy(&padded[(size_t(y) * paddedWidth + x) * 4],
+                        row + size_t(std::min(x, width - 1)) * 4, 4);
+    }
+    std::vector<ImageLevel> chain = buildMipChain(padded.data(), paddedWidth,
+                                                  paddedHeight, srgb);
+    padded = std::vector<uint8_t>();
+
+    VirtualTextureHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, VIRTUAL_TEXTURE_MAGIC, sizeof(header.magic));
+    header.version = VIRTUAL_TEXTURE_VERSION;
+    header.flags = srgb ? VIRTUAL_TEXTURE_FLAG_SRGB : 0;
+    header.width = uint32_t(paddedWidth);
+    header.height = uint32_t(paddedHeight);
+    header.contentWidth = uint32_t(width);
+    header.contentHeight = uint32_t(height);
+    header.pageSize = uint32_t(pageSize);
+    header.border = uint32_t(border);
+    header.levelCount = uint32_t(levels);
+    int paddedPage = pageSize + border * 2;
+    header.pageBytes = uint32_t(paddedPage * paddedPage * 4);
+    header.pageOffset = VIRTUAL_TEXTURE_ALIGNMENT;
+    for (int level = 0; level < levels; ++level)
+        header.pageCount +=
+            virtualPagesAt(header.width, header.pageSize, level) *
+            virtualPagesAt(header.height, header.pageSize, level);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    std::vector<char> start(VIRTUAL_TEXTURE_ALIGNMENT, 0);
+    std::memcpy(start.data(), &header, sizeof(header));
+    file.write(start.data(), std::streamsize(start.size()));
+    std::vector<uint8_t> page(header.pageBytes);
+    for (int level = 0; level < levels; ++level) {
+        const ImageLevel& source = chain[size_t(level)];
+        int pagesX = source.width / pageSize, pagesY = source.height /
+            pageSize;
+        for (int py = 0; py < pagesY; ++py) {
+            for (int px = 0; px < pagesX; ++px) {
+                for (int y = 0; y < paddedPage; ++y) {
+                    int sourceY = std::min(std::max(py * pageSize + y -
+                                                    border, 0),
+                                           source.height - 1);
+                    for (int x = 0; x < paddedPage; ++x) {
+                        int sourceX = std::min(std::max(px * pageSize + x -
+                                                        border, 0),
+                                               source.width - 1);
+                        std::memcpy(&page[(size_t(y) * paddedPage + x) * 4],
+                                    &source.rgba[(size_t(sourceY) *
+                                                  source.width + sourceX) *
+                                                 4], 4);
+                    }
+                }
+                file.write(reinterpret_cast<const char*>(page.data()),
+                           std::streamsize(page.size()));
+            }
+        }
+    }
+    if (!file) {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::WRITE_FAILED " << path <<
+            std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+/****************
+ * SHADERS
+ ****************/
+
+const GLuint VIRTUAL_TEXTURE_PAGE_TABLE_BINDING = 7;
+
+// Uniforms and mip selection shared by the feedback and sampling code
+const char* const VIRTUAL_TEXTURE_COMMON_GLSL =
+    "uniform vec2 uVirtualSize;\n"
+    "uniform vec2 uVirtualUvScale;\n"
+    "uniform float uVirtualPageSize;\n"
+    "uniform int uVirtualLevels;\n"
+    "uniform float uVirtualLodBias;\n"
+    "float virtualLevel(vec2 uv) {\n"
+    "    vec2 texel = uv * uVirtualSize;\n"
+    "    vec2 dx = dFdx(texel), dy = dFdy(texel);\n"
+    "    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));\n"
+    "    return clamp(lod + uVirtualLodBias, 0.0,\n"
+    "                 float(uVirtualLevels - 1));\n"
+    "}\n";
+
+// uint virtualFeedback(vec2 uv), the page id to write to the feedback
+// target (level << 24 | y << 12 | x)
+const char* const VIRTUAL_TEXTURE_FEEDBACK_GLSL =
+    "uint virtualFeedback(vec2 uv) {\n"
+    "    uv = clamp(uv, 0.0, 1.0) * uVirtualUvScale;\n"
+    "    int level = int(virtualLevel(uv));\n"
+    "    vec2 pages = max(floor(uVirtualSize / (uVirtualPageSize *\n"
+    "                                          exp2(float(level)))), 1.0);\n"
+    "    uvec2 page = uvec2(min(uv * pages, pages - 1.0));\n"
+    "    return uint(level) << 24 | page.y << 12 | page.x;\n"
+    "}\n";
+
+// Page table lookup, entries hold cache slot x/y and the resident level
+const char* const VIRTUAL_TEXTURE_TABLE_GLSL =
+    "layout (std430, binding = 7) readonly buffer VirtualPageTable {\n"
+    "    uvec4 virtualLevels[16];\n"
+    "    uint virtualPages[];\n"
+    "};\n"
+    "uniform sampler2D uVirtualTexture;\n"
+    "uint virtualEntry(vec2 uv) {\n"
+    "    uvec4 info = virtualLevels[int(virtualLevel(uv))];\n"
+    "    uvec2 page = min(uvec2(uv * vec2(info.xy)), info.xy - 1u);\n"
+    "    return virtualPages[info.z + page.y * info.x + page.x];\n"
+    "}\n";
+
+// vec4 sampleVirtual(vec2 uv) through the page cache
+const char* const VIRTUAL_TEXTURE_SOFTWARE_GLSL =
+    "uniform float uVirtualBorder;\n"
+    "uniform vec2 uVirtualCacheSize;\n"
+    "vec4 sampleVirtual(vec2 uv) {\n"
+    "    uv = clamp(uv, 0.0, 1.0) * uVirtualUvScale;\n"
+    "    uint entry = virtualEntry(uv);\n"
+    "    vec2 pages = vec2(virtualLevels[entry >> 16].xy);\n"
+    "    vec2 position = uv * pages;\n"
+    "    vec2 offset = (position - min(floor(position), pages - 1.0)) *\n"
+    "        uVirtualPageSize;\n"
+    "    vec2 slot = vec2(entry & 0xFFu, (entry >> 8) & 0xFFu);\n"
+    "    vec2 texel = slot * (uVirtualPageSize + 2.0 * uVirtualBorder) +\n"
+    "        uVirtualBorder + offset;\n"
+    "    return textureLod(uVirtualTexture, texel / uVirtualCacheSize,\n"
+    "                      0.0);\n"
+    "}\n";
+
+// vec4 sampleVirtual(vec2 uv) from the sparse texture
+const char* const VIRTUAL_TEXTURE_SPARSE_GLSL =
+    "vec4 sampleVirtual(vec2 uv) {\n"
+    "    uv = clamp(uv, 0.0, 1.0) * uVirtualUvScale;\n"
+    "    return textureLod(uVirtualTexture, uv,\n"
+    "                      float(virtualEntry(uv) >> 16));\n"
+    "}\n";
+
+
+/****************
+ * RUNTIME
+ ****************/
+
+enum VirtualTextureMode { VIRTUAL_TEXTURE_SOFTWARE, VIRTUAL_TEXTURE_SPARSE };
+
+struct VirtualTextureOptions {
+    // Resident pages per side of the cache, the GPU memory bound (at most
+    // 256)
+    int cachePages = 16;
+    // Feedback target is the view size divided by this
+    int feedbackDivisor = 8;
+    // Pages uploaded per update() at most
+    int uploadsPerFrame = 16;
+    // Page loads queued on the workers at most
+    int loadsInFlight = 64;
+    bool allowSparse = true;
+    unsigned int threads = 0;
+};
+
+struct VirtualTextureStats {
+    size_t residentPages = 0;
+    // Distinct pages in the last feedback read
+    size_t requestedPages = 0;
+    size_t loadingPages = 0;
+    // During the last update()
+    size_t uploadedPages = 0;
+    size_t evictedPages = 0;
+    // GPU memory holding pages (the cache texture, or committed pages)
+    uint64_t residentBytes = 0;
+    // All levels of the source texture
+    uint64_t virtualBytes = 0;
+};
+
+class VirtualTexture {
+public:
+    VirtualTexture() = default;
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+    /**
+     * Opens a .vtex file and creates the cache, page table and feedback
+     * target
+     *
+     * @param path        file written by writeVirtualTextureFile()
+     * @param viewWidth   size of the view the feedback pass covers
+     * @param viewHeight
+     * @param options     cache size, streaming limits and mode
+     * @return whether the texture is ready to draw
+     */
+    bool create(const char* path, int viewWidth, int viewHeight,
+                VirtualTextureOptions options = VirtualTextureOptions()) {
+        if (!file.open(path))
+            return false;
+        if (file.size < sizeof(header)) {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::TRUNCATED " << path <<
+                std::endl;
+            return false;
+        }
+        std::memcpy(&header, file.data, sizeof(header));
+        if (!readLevels()) {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::INVALID_FILE " << path <<
+                std::endl;
+            file.close();
+            return false;
+        }
+        this->options = options;
+        this->options.cachePages = std::min(std::max(options.cachePages, 2),
+                                            256);
+        cancelled = false;
+        frame = 0;
+
+        pageSlots.assign(header.pageCount, -1);
+        pageLoading.assign(header.pageCount, 0);
+        int slotCount = this->options.cachePages * this->options.cachePages;
+        slots.assign(size_t(slotCount), Slot());
+
+        currentMode = VIRTUAL_TEXTURE_SOFTWARE;
+        if (options.allowSparse && GLAD_GL_ARB_sparse_texture)
+            createSparseTexture();
+        if (currentMode == VIRTUAL_TEXTURE_SOFTWARE) {
+            int side = this->options.cachePages * paddedPageSize();
+            glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+            glTextureStorage2D(texture, 1, internalFormat(), side, side);
+        }
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER,
+                            currentMode == VIRTUAL_TEXTURE_SPARSE ?
+                            GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        tableEntries.assign(VIRTUAL_TEXTURE_MAX_LEVELS * 4 +
+                            header.pageCount, 0);
+        for (uint32_t level = 0; level < header.levelCount; ++level) {
+            tableEntries[level * 4] = levels[level].pagesX;
+            tableEntries[level * 4 + 1] = levels[level].pagesY;
+            tableEntries[level * 4 + 2] = levels[level].firstPage;
+        }
+        table = Buffer(GLsizeiptr(tableEntries.size() * sizeof(uint32_t)),
+                       NULL);
+
+        // The coarsest level (one page) is always resident
+        uint32_t top = levels[header.levelCount - 1].firstPage;
+        place(top, pageData(top), 0);
+        slots[0].locked = true;
+        writeTable();
+
+        feedbackWidth = std::max(viewWidth / options.feedbackDivisor, 1);
+        feedbackHeight = std::max(viewHeight / options.feedbackDivisor, 1);
+        glCreateTextures(GL_TEXTURE_2D, 1, &feedbackTexture);
+        glTextureStorage2D(feedbackTexture, 1, GL_R32UI, feedbackWidth,
+                           feedbackHeight);
+        glCreateRenderbuffers(1, &feedbackDepth);
+        glNamedRenderbufferStorage(feedbackDepth, GL_DEPTH_COMPONENT24,
+                                   feedbackWidth, feedbackHeight);
+        glCreateFramebuffers(1, &feedbackFramebuffer);
+        glNamedFramebufferTexture(feedbackFramebuffer, GL_COLOR_ATTACHMENT0,
+                                  feedbackTexture, 0);
+        glNamedFramebufferRenderbuffer(feedbackFramebuffer,
+                                       GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                                       feedbackDepth);
+        feedbackReadback = Buffer(GLsizeiptr(feedbackWidth) *
+                                  feedbackHeight * sizeof(uint32_t), NULL,
+                                  GL_CLIENT_STORAGE_BIT);
+        feedback.resize(size_t(feedbackWidth) * feedbackHeight);
+
+        pool.create(options.threads);
+        return true;
+    }
+
+    /**
+     * Binds and clears the feedback target, draw the textured geometry
+     * with a virtualFeedback() shader next. The viewport is left for the
+     * caller to restore.
+     */
+    void beginFeedback() const {
+        glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+        glViewport(0, 0, feedbackWidth, feedbackHeight);
+        const GLuint none[4] = { UINT32_MAX, 0, 0, 0 };
+        glClearNamedFramebufferuiv(feedbackFramebuffer, GL_COLOR, 0, none);
+        const GLfloat depth = 1.0f;
+        glClearNamedFramebufferfv(feedbackFramebuffer, GL_DEPTH, 0, &depth);
+    }
+
+    // Starts the readback of the feedback, skipped while one is pending
+    void endFeedback() {
+        if (feedbackFence)
+            return;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackReadback.ID);
+        glGetTextureImage(feedbackTexture, 0, GL_RED_INTEGER,
+                          GL_UNSIGNED_INT, GLsizei(feedbackReadback.size),
+                          NULL);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        feedbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    /**
+     * Render thread step: reads finished feedback, queues missing pages,
+     * uploads loaded pages and rewrites the page table
+     */
+    void update() {
+        ++frame;
+        currentStats.uploadedPages = 0;
+        currentStats.evictedPages = 0;
+        if (feedbackFence) {
+            GLenum status = glClientWaitSync(feedbackFence, 0, 0);
+            if (status == GL_ALREADY_SIGNALED ||
+                status == GL_CONDITION_SATISFIED) {
+                glDeleteSync(feedbackFence);
+                feedbackFence = NULL;
+                glGetNamedBufferSubData(feedbackReadback.ID, 0,
+                                        feedbackReadback.size,
+                                        feedback.data());
+                processFeedback();
+            }
+        }
+
+        std::deque<LoadedPage> ready;
+        {
+            std::lock_guard<std::mutex> lock(loadedMutex);
+            ready.swap(loaded);
+        }
+        bool dirty = false;
+        size_t uploaded = 0;
+        while (!ready.empty()) {
+            LoadedPage& page = ready.front();
+            int slot = uploaded < size_t(options.uploadsPerFrame) ?
+                allocateSlot() : -1;
+            if (slot < 0) {
+                // Over budget or every slot was used this frame: the page
+                // is requested again by a later feedback
+                pageLoading[page.page] = 0;
+                --inFlight;
+                ready.pop_front();
+                continue;
+            }
+            place(page.page, page.texels.data(), slot);
+            pageLoading[page.page] = 0;
+            --inFlight;
+            ++uploaded;
+            dirty = true;
+            ready.pop_front();
+        }
+        currentStats.uploadedPages = uploaded;
+        if (dirty || currentStats.evictedPages)
+            writeTable();
+    }
+
+    /**
+     * Sets the uniforms a feedback or sampling program uses, once after
+     * linking
+     *
+     * @param unit  texture unit bind() uses
+     */
+    void setUniforms(GLuint program, GLuint unit) const {
+        bool feedbackProgram =
+            glGetUniformLocation(program, "uVirtualTexture") < 0;
+        glProgramUniform2f(program,
+                           glGetUniformLocation(program, "uVirtualSize"),
+                           float(header.width), float(header.height));
+        glProgramUniform2f(program,
+                           glGetUniformLocation(program, "uVirtualUvScale"),
+                           float(header.contentWidth) / float(header.width),
+                           float(header.contentHeight) /
+                           float(header.height));
+        glProgramUniform1f(program,
+                           glGetUniformLocation(program, "uVirtualPageSize"),
+                           float(header.pageSize));
+        glProgramUniform1i(program,
+                           glGetUniformLocation(program, "uVirtualLevels"),
+                           GLint(header.levelCount));
+        // The feedback target is smaller, so its derivatives are larger
+        glProgramUniform1f(program,
+                           glGetUniformLocation(program, "uVirtualLodBias"),
+                           feedbackProgram ?
+                           -std::log2(float(options.feedbackDivisor)) :
+                           0.0f);
+        glProgramUniform1i(program,
+                           glGetUniformLocation(program, "uVirtualTexture"),
+                           GLint(unit));
+        glProgramUniform1f(program,
+                           glGetUniformLocation(program, "uVirtualBorder"),
+                           float(header.border));
+        float cacheSide = float(options.cachePages * paddedPageSize());
+        glProgramUniform2f(program,
+                           glGetUniformLocation(program, "uVirtualCacheSize"),
+                           cacheSide, cacheSide);
+    }
+
+    // Binds the page table and the page texture for sampleVirtual()
+    void bind(GLuint unit) const {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                         VIRTUAL_TEXTURE_PAGE_TABLE_BINDING, table.ID);
+        glBindTextureUnit(unit, texture);
+    }
+
+    // Fragment shader code defining virtualFeedback(uv)
+    static std::string feedbackGlsl() {
+        return std::string(VIRTUAL_TEXTURE_COMMON_GLSL) +
+            VIRTUAL_TEXTURE_FEEDBACK_GLSL;
+    }
+
+    // Fragment shader code defining sampleVirtual(uv) for the current mode
+    std::string samplingGlsl() const {
+        return std::string(VIRTUAL_TEXTURE_COMMON_GLSL) +
+            VIRTUAL_TEXTURE_TABLE_GLSL +
+            (currentMode == VIRTUAL_TEXTURE_SPARSE ?
+             VIRTUAL_TEXTURE_SPARSE_GLSL : VIRTUAL_TEXTURE_SOFTWARE_GLSL);
+    }
+
+    VirtualTextureMode mode() const {
+        return currentMode;
+    }
+
+    VirtualTextureStats stats() const {
+        VirtualTextureStats result = currentStats;
+        result.residentPages = 0;
+        for (const Slot& slot : slots)
+            result.residentPages += slot.page >= 0;
+        result.loadingPages = size_t(inFlight);
+        uint64_t texels = currentMode == VIRTUAL_TEXTURE_SPARSE ?
+            uint64_t(header.pageSize) * header.pageSize *
+            result.residentPages :
+            uint64_t(options.cachePages * paddedPageSize()) *
+            uint64_t(options.cachePages * paddedPageSize());
+        result.residentBytes = texels * 4;
+        result.virtualBytes = 0;
+        for (uint32_t level = 0; level < header.levelCount; ++level)
+            result.virtualBytes += uint64_t(header.width >> level) *
+                (header.height >> level) * 4;
+        return result;
+    }
+
+    // Stops the workers (queued loads are dropped) and frees everything
+    void destroy() {
+        cancelled = true;
+        pool.destroy();
+        loaded.clear();
+        inFlight = 0;
+        if (feedbackFence)
+            glDeleteSync(feedbackFence);
+        feedbackFence = NULL;
+        glDeleteTextures(1, &texture);
+        glDeleteTextures(1, &feedbackTexture);
+        glDeleteRenderbuffers(1, &feedbackDepth);
+        glDeleteFramebuffers(1, &feedbackFramebuffer);
+        texture = feedbackTexture = feedbackDepth = feedbackFramebuffer = 0;
+        table.destroy();
+        feedbackReadback.destroy();
+        slots.clear();
+        pageSlots.clear();
+        pageLoading.clear();
+        file.close();
+    }
+
+private:
+    struct LevelInfo {
+        uint32_t pagesX = 0;
+        uint32_t pagesY = 0;
+        uint32_t firstPage = 0;
+    };
+
+    struct Slot {
+        int64_t page = -1;
+        uint64_t lastUsed = 0;
+        bool locked = false;
+    };
+
+    struct LoadedPage {
+        uint32_t page;
+        std::vector<uint8_t> texels;
+    };
+
+    VirtualTextureOptions options;
+    VirtualTextureMode currentMode = VIRTUAL_TEXTURE_SOFTWARE;
+    MappedFile file;
+    VirtualTextureHeader header = {};
+    LevelInfo levels[VIRTUAL_TEXTURE_MAX_LEVELS];
+    // Cache slot of every page, -1 when not resident
+    std::vector<int32_t> pageSlots;
+    std::vector<uint8_t> pageLoading;
+    std::vector<Slot> slots;
+    uint64_t frame = 0;
+    VirtualTextureStats currentStats;
+
+    GLuint texture = 0;
+    Buffer table;
+    // Level infos (uvec4 each) followed by one entry per page
+    std::vector<uint32_t> tableEntries;
+
+    GLuint feedbackTexture = 0;
+    GLuint feedbackDepth = 0;
+    GLuint feedbackFramebuffer = 0;
+    int feedbackWidth = 0;
+    int feedbackHeight = 0;
+    Buffer feedbackReadback;
+    GLsync feedbackFence = NULL;
+    std::vector<uint32_t> feedback;
+
+    ThreadPool pool;
+    std::atomic<bool> cancelled { false };
+    std::mutex loadedMutex;
+    std::deque<LoadedPage> loaded;
+    int inFlight = 0;
+
+    /**
+     * Checks the header against the file and fills the page index range of
+     * each level. Every page array is sized from pageCount and indexed
+     * through the levels, so the two must agree.
+     */
+    bool readLevels() {
+        if (std::memcmp(header.magic, VIRTUAL_TEXTURE_MAGIC,
+                        sizeof(header.magic)) != 0 ||
+            header.version != VIRTUAL_TEXTURE_VERSION ||
+            header.levelCount == 0 ||
+            header.levelCount > uint32_t(VIRTUAL_TEXTURE_MAX_LEVELS) ||
+            header.pageSize == 0 ||
+            header.pageSize > uint32_t(VIRTUAL_TEXTURE_MAX_PAGE_SIZE) ||
+            header.border >= header.pageSize)
+            return false;
+        // Every level a whole number of pages, as the writer pads it, so
+        // each page's parent is a page of the next level
+        uint64_t unit = uint64_t(header.pageSize) << (header.levelCount - 1);
+        if (header.width % unit != 0 || header.height % unit != 0)
+            return false;
+        uint64_t padded = uint64_t(header.pageSize) + header.border * 2;
+        if (header.pageBytes != padded * padded * 4 ||
+            header.pageOffset > file.size ||
+            uint64_t(header.pageCount) * header.pageBytes >
+            file.size - header.pageOffset)
+            return false;
+        uint64_t first = 0;
+        for (uint32_t level = 0; level < header.levelCount; ++level) {
+            LevelInfo& info = levels[level];
+            info.pagesX = virtualPagesAt(header.width, header.pageSize, level);
+            info.pagesY = virtualPagesAt(header.height, header.pageSize,
+                                         level);
+            info.firstPage = uint32_t(first);
+            first += uint64_t(info.pagesX) * info.pagesY;
+            if (first > header.pageCount)
+                return false;
+        }
+        // Slot 0 is locked to the coarsest level, which must be one page
+        const LevelInfo& top = levels[header.levelCount - 1];
+        return first == header.pageCount && top.pagesX == 1 &&
+            top.pagesY == 1;
+    }
+
+    int paddedPageSize() const {
+        return int(header.pageSize + header.border * 2);
+    }
+
+    GLenum internalFormat() const {
+        return header.flags & VIRTUAL_TEXTURE_FLAG_SRGB ? GL_SRGB8_ALPHA8 :
+            GL_RGBA8;
+    }
+
+    const uint8_t* pageData(uint32_t page) const {
+        return file.data + header.pageOffset + uint64_t(page) *
+            header.pageBytes;
+    }
+
+    // Uses a sparse texture when a hardware page size matches the file's
+    void createSparseTexture() {
+        GLenum format = internalFormat();
+        GLint sizes = 0;
+        glGetInternalformativ(GL_TEXTURE_2D, format,
+                              GL_NUM_VIRTUAL_PAGE_SIZES_ARB, 1, &sizes);
+        std::vector<GLint> pageX(size_t(std::max(sizes, 0)));
+        std::vector<GLint> pageY(pageX.size());
+        if (sizes <= 0)
+            return;
+        glGetInternalformativ(GL_TEXTURE_2D, format,
+                              GL_VIRTUAL_PAGE_SIZE_X_ARB, sizes,
+                              pageX.data());
+        glGetInternalformativ(GL_TEXTURE_2D, format,
+                              GL_VIRTUAL_PAGE_SIZE_Y_ARB, sizes,
+                              pageY.data());
+        GLint index = -1;
+        for (GLint i = 0; i < sizes; ++i)
+            if (pageX[size_t(i)] == GLint(header.pageSize) &&
+                pageY[size_t(i)] == GLint(header.pageSize))
+                index = i;
+        if (index < 0)
+            return;
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureParameteri(texture, GL_TEXTURE_SPARSE_ARB, GL_TRUE);
+        glTextureParameteri(texture, GL_VIRTUAL_PAGE_SIZE_INDEX_ARB, index);
+        glTextureStorage2D(texture, GLsizei(header.levelCount), format,
+                           GLsizei(header.width), GLsizei(header.height));
+        // Levels in the mip tail can't be committed page by page
+        GLint sparseLevels = 0;
+        glGetTextureParameteriv(texture, GL_NUM_SPARSE_LEVELS_ARB,
+                                &sparseLevels);
+        if (sparseLevels < GLint(header.levelCount)) {
+            glDeleteTextures(1, &texture);
+            texture = 0;
+            return;
+        }
+        currentMode = VIRTUAL_TEXTURE_SPARSE;
+    }
+
+    // Level and position of a page
+    void locate(uint32_t page, uint32_t& level, uint32_t& x,
+                uint32_t& y) const {
+        level = 0;
+        while (level + 1 < header.levelCount &&
+               page >= levels[level + 1].firstPage)
+            ++level;
+        uint32_t local = page - levels[level].firstPage;
+        x = local % levels[level].pagesX;
+        y = local / levels[level].pagesX;
+    }
+
+    // Touches the pages the view sampled and queues the missing ones,
+    // coarse levels first so detail refines progressively
+    void processFeedback() {
+        std::vector<uint32_t> ids(feedback);
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        std::vector<uint32_t> missing;
+        size_t requested = 0;
+        for (uint32_t id : ids) {
+            uint32_t level = id >> 24, x = id & 0xFFFu, y = (id >> 12) &
+                0xFFFu;
+            if (id == UINT32_MAX || level >= header.levelCount ||
+                x >= levels[level].pagesX || y >= levels[level].pagesY)
+                continue;
+            ++requested;
+            uint32_t page = levels[level].firstPage +
+                y * levels[level].pagesX + x;
+            if (pageSlots[page] < 0 && !pageLoading[page])
+                missing.push_back(page);
+            // The page, or the ancestor standing in for it, is in use
+            for (; level < header.levelCount; ++level, x /= 2, y /= 2) {
+                uint32_t ancestor = levels[level].firstPage +
+                    y * levels[level].pagesX + x;
+                if (pageSlots[ancestor] >= 0)
+                    slots[size_t(pageSlots[ancestor])].lastUsed = frame;
+            }
+        }
+        currentStats.requestedPages = requested;
+        // Higher page indices are coarser levels
+        std::sort(missing.begin(), missing.end(),
+                  [](uint32_t a, uint32_t b) { return a > b; });
+        for (uint32_t page : missing) {
+            if (inFlight >= options.loadsInFlight)
+                break;
+            pageLoading[page] = 1;
+            ++inFlight;
+            const uint8_t* source = pageData(page);
+            size_t bytes = header.pageBytes;
+            pool.submit([this, page, source, bytes]() {
+                if (cancelled)
+                    return;
+                // Reading the mapping faults the page in from disk here,
+                // off the render thread
+                LoadedPage result;
+                result.page = page;
+                result.texels.assign(source, source + bytes);
+                std::lock_guard<std::mutex> lock(loadedMutex);
+                loaded.push_back(std::move(result));
+            });
+        }
+    }
+
+    // Free slot, else the least recently used one not used this frame
+    int allocateSlot() {
+        int best = -1;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            const Slot& slot = slots[i];
+            if (slot.page < 0)
+                return int(i);
+            if (slot.locked || slot.lastUsed >= frame - 1)
+                continue;
+            if (best < 0 || slot.lastUsed < slots[size_t(best)].lastUsed)
+                best = int(i);
+        }
+        if (best >= 0)
+            evict(best);
+        return best;
+    }
+
+    void evict(int index) {
+        Slot& slot = slots[size_t(index)];
+        uint32_t page = uint32_t(slot.page);
+        if (currentMode == VIRTUAL_TEXTURE_SPARSE)
+            commit(page, GL_FALSE);
+        pageSlots[page] = -1;
+        slot.page = -1;
+        ++currentStats.evictedPages;
+    }
+
+    void commit(uint32_t page, GLboolean state) {
+        uint32_t level, x, y;
+        locate(page, level, x, y);
+        GLsizei size = GLsizei(header.pageSize);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexPageCommitmentARB(GL_TEXTURE_2D, GLint(level), GLint(x) * size,
+                               GLint(y) * size, 0, size, size, 1, state);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // Uploads a page into a slot
+    void place(uint32_t page, const uint8_t* texels, int index) {
+        int padded = paddedPageSize();
+        if (currentMode == VIRTUAL_TEXTURE_SPARSE) {
+            commit(page, GL_TRUE);
+            uint32_t level, x, y;
+            locate(page, level, x, y);
+            // Only the interior, the hardware filters across pages
+            GLint size = GLint(header.pageSize);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, padded);
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, GLint(header.border));
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, GLint(header.border));
+            glTextureSubImage2D(texture, GLint(level), GLint(x) * size,
+                                GLint(y) * size, size, size, GL_RGBA,
+                                GL_UNSIGNED_BYTE, texels);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        } else {
+            int slotX = index % options.cachePages;
+            int slotY = index / options.cachePages;
+            glTextureSubImage2D(texture, 0, slotX * padded, slotY * padded,
+                                padded, padded, GL_RGBA, GL_UNSIGNED_BYTE,
+                                texels);
+        }
+        slots[size_t(index)].page = int64_t(page);
+        slots[size_t(index)].lastUsed = frame;
+        pageSlots[page] = index;
+    }
+
+    // Points every page at its finest resident ancestor and uploads the
+    // table
+    void writeTable() {
+        uint32_t* entries = tableEntries.data() +
+            VIRTUAL_TEXTURE_MAX_LEVELS * 4;
+        for (uint32_t level = header.levelCount; level-- > 0;) {
+            const LevelInfo& info = levels[level];
+            for (uint32_t y = 0; y < info.pagesY; ++y) {
+                for (uint32_t x = 0; x < info.pagesX; ++x) {
+                    uint32_t page = info.firstPage + y * info.pagesX + x;
+                    int32_t slot = pageSlots[page];
+                    if (slot >= 0) {
+                        uint32_t slotX = uint32_t(slot % options.cachePages);
+                        uint32_t slotY = uint32_t(slot / options.cachePages);
+                        entries[page] = slotX | slotY << 8 | level << 16;
+                    } else {
+                        // Only the coarsest level has no parent, and its
+                        // page is always resident
+                        const LevelInfo& parent = levels[level + 1];
+                        entries[page] = entries[parent.firstPage +
+                                                (y / 2) * parent.pagesX +
+                                                x / 2];
+                    }
+                }
+            }
+        }
+        table.update(0, table.size, tableEntries.data());
+    }
+};
+
+#endif
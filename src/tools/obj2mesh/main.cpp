@@ -0,0 +1,148 @@
+/****************
+ * Title:   tools/obj2mesh/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "engine/index_optimizer.hpp"
+#include "engine/lod.hpp"
+#include "engine/mesh_format.hpp"
+#include "engine/mesh_importer.hpp"
+#include "engine/vertex_compression.hpp"
+#include "engine/vertex_layout.hpp"
+
+// Offline converter from Wavefront OBJ or glTF to the binary .mesh format
+//
+// Usage: obj2mesh <input.obj|.gltf|.glb> <output.mesh> [--compress]
+//                 [--lods N]
+//
+// --lods N stores N levels of detail (full detail included), each with
+// about half the triangles of the previous one
+
+using CompressedObjVertexLayout =
+    VertexLayout<Pos4u16, Normal2s16, TexCoord2h>;
+
+struct CompressedObjVertex {
+    uint16_t position[4];
+    int16_t normal[2];
+    uint16_t texCoord[2];
+};
+static_assert(sizeof(CompressedObjVertex) ==
+              CompressedObjVertexLayout::stride, "");
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cout << "Usage: obj2mesh <input.obj|.gltf|.glb> <output.mesh> "
+            "[--compress] [--lods N]" << std::endl;
+        return -1;
+    }
+    bool compress = false;
+    int lodCount = 1;
+    for (int i = 3; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--compress") == 0)
+            compress = true;
+        else if (std::strcmp(argv[i], "--lods") == 0 && i + 1 < argc)
+            lodCount = std::max(1, std::atoi(argv[++i]));
+    }
+
+    ImportedMesh mesh;
+    if (!importMesh(argv[1], mesh))
+        return -1;
+    std::vector<ImportedVertex>& vertices = mesh.vertices;
+    std::vector<uint32_t>& indices = mesh.indices;
+
+    std::vector<float> positions(vertices.size() * 3);
+    for (size_t v = 0; v < vertices.size(); ++v)
+        std::memcpy(&positions[v * 3], vertices[v].position,
+                    sizeof(vertices[v].position));
+    QuantizationBounds bounds = computeBounds(positions.data(),
+                                              vertices.size());
+
+    // Optimize for the post-transform cache (per LOD) then for fetch
+    // locality over the whole chain
+    MeshWriteInfo info;
+    if (lodCount > 1 && !vertices.empty()) {
+        float diagonal = std::sqrt(bounds.extent[0] * bounds.extent[0] +
+                                   bounds.extent[1] * bounds.extent[1] +
+                                   bounds.extent[2] * bounds.extent[2]);
+        LodChain chain = buildLodChain(indices.data(), indices.size(),
+                                       vertices[0].position, vertices.size(),
+                                       sizeof(ImportedVertex),
+                                       size_t(lodCount), 0.5f, diagonal);
+        indices.swap(chain.indices);
+        info.lods = chain.lods;
+    } else {
+        optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+    }
+    size_t vertexCount = optimizeVertexFetch(indices.data(), indices.size(),
+                                             vertices.data(), vertices.size(),
+                                             sizeof(ImportedVertex));
+    vertices.resize(vertexCount);
+    IndexData indexData = narrowIndices(indices.data(), indices.size(),
+                                        vertexCount);
+
+    info.vertexCount = vertexCount;
+    info.indexType = indexData.type;
+    info.indexCount = indexData.count;
+    info.indices = indexData.bytes.data();
+    for (int axis = 0; axis < 3; ++axis) {
+        info.boundsMin[axis] = bounds.min[axis];
+        info.boundsMax[axis] = bounds.min[axis] + bounds.extent[axis];
+    }
+
+    std::vector<CompressedObjVertex> compressed;
+    if (compress) {
+        compressed.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            const ImportedVertex& source = vertices[v];
+            CompressedObjVertex& target = compressed[v];
+            for (int axis = 0; axis < 3; ++axis)
+                target.position[axis] = quantizeUnorm16(
+                    source.position[axis], bounds.min[axis],
+                    bounds.extent[axis]);
+            target.position[3] = 0;
+            float encoded[2];
+            octEncode(source.normal, encoded);
+            target.normal[0] = packSnorm16(encoded[0]);
+            target.normal[1] = packSnorm16(encoded[1]);
+            target.texCoord[0] = packHalf(source.texCoord[0]);
+            target.texCoord[1] = packHalf(source.texCoord[1]);
+        }
+        info.attributes =
+            MeshAttributesOf<CompressedObjVertexLayout>::get();
+        info.vertexStride = CompressedObjVertexLayout::stride;
+        info.vertices = compressed.data();
+        info.flags |= MESH_FLAG_QUANTIZED;
+        std::memcpy(info.quantizeMin, bounds.min, sizeof(bounds.min));
+        std::memcpy(info.quantizeExtent, bounds.extent,
+                    sizeof(bounds.extent));
+    } else {
+        info.attributes = MeshAttributesOf<ImportedVertexLayout>::get();
+        info.vertexStride = ImportedVertexLayout::stride;
+        info.vertices = vertices.data();
+    }
+
+    if (!writeMeshFile(argv[2], info))
+        return -1;
+    size_t triangles = info.lods.empty() ? indexData.count / 3 :
+        info.lods[0].indexCount / 3;
+    std::cout << "Wrote " << argv[2] << ": " << vertexCount << " vertices, " <<
+        triangles << " triangles, " << info.vertexStride <<
+        " byte vertices, " << indexData.indexSize() * 8 << "-bit indices" <<
+        std::endl;
+    for (size_t lod = 1; lod < info.lods.size(); ++lod)
+        std::cout << "  LOD " << lod << ": " <<
+            info.lods[lod].indexCount / 3 << " triangles, error " <<
+            info.lods[lod].error << std::endl;
+    return 0;
+}
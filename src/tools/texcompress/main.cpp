@@ -0,0 +1,132 @@
+/****************
+ * Title:   tools/texcompress/main.cpp
+ * Created: 2026/10/19
+ * Author:  Joseph Smith
+ ***************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "engine/ktx2.hpp"
+#include "engine/texture_compression.hpp"
+
+// Offline converter from PNG/JPEG/TGA to a mipmapped, block compressed KTX2
+//
+// Usage: texcompress <input> <output.ktx2> [--format bc1|bc3|bc7|rgba8]
+//                    [--linear] [--no-mips] [--threads N]
+//
+// BC7 (the default) suits most colour maps, BC1 is half the size for
+// opaque images and BC3 keeps smooth alpha. --linear stores data maps
+// (normals, roughness) without sRGB decoding.
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cout << "Usage: texcompress <input> <output.ktx2> "
+            "[--format bc1|bc3|bc7|rgba8] [--linear] [--no-mips] "
+            "[--threads N]" << std::endl;
+        return -1;
+    }
+    const char* formatName = "bc7";
+    bool srgb = true;
+    bool mipmaps = true;
+    unsigned int threads = 0;
+    for (int i = 3; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+            formatName = argv[++i];
+        else if (std::strcmp(argv[i], "--linear") == 0)
+            srgb = false;
+        else if (std::strcmp(argv[i], "--no-mips") == 0)
+            mipmaps = false;
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = unsigned(std::max(0, std::atoi(argv[++i])));
+    }
+
+    BlockFormat format = BLOCK_BC7;
+    bool compress = true;
+    Ktx2WriteInfo info;
+    if (std::strcmp(formatName, "bc1") == 0) {
+        format = BLOCK_BC1;
+        info.vkFormat = srgb ? KTX2_VK_FORMAT_BC1_RGB_SRGB :
+            KTX2_VK_FORMAT_BC1_RGB_UNORM;
+    } else if (std::strcmp(formatName, "bc3") == 0) {
+        format = BLOCK_BC3;
+        info.vkFormat = srgb ? KTX2_VK_FORMAT_BC3_SRGB :
+            KTX2_VK_FORMAT_BC3_UNORM;
+    } else if (std::strcmp(formatName, "bc7") == 0) {
+        info.vkFormat = srgb ? KTX2_VK_FORMAT_BC7_SRGB :
+            KTX2_VK_FORMAT_BC7_UNORM;
+    } else if (std::strcmp(formatName, "rgba8") == 0) {
+        compress = false;
+        info.vkFormat = srgb ? KTX2_VK_FORMAT_R8G8B8A8_SRGB :
+            KTX2_VK_FORMAT_R8G8B8A8_UNORM;
+    } else {
+        std::cout << "ERROR::TEXCOMPRESS::UNKNOWN_FORMAT " << formatName <<
+            std::endl;
+        return -1;
+    }
+
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(argv[1], &width, &height, &channels, 4);
+    if (pixels == NULL) {
+        std::cout << "ERROR::TEXCOMPRESS::LOAD_FAILED " << argv[1] << " (" <<
+            stbi_failure_reason() << ")" << std::endl;
+        return -1;
+    }
+    std::vector<ImageLevel> levels;
+    if (mipmaps) {
+        levels = buildMipChain(pixels, width, height, srgb);
+    } else {
+        levels.resize(1);
+        levels[0].width = width;
+        levels[0].height = height;
+        levels[0].rgba.assign(pixels, pixels + size_t(width) * height * 4);
+    }
+    stbi_image_free(pixels);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t rgbaBytes = 0, storedBytes = 0;
+    for (const ImageLevel& level : levels) {
+        if (compress)
+            info.levels.push_back(compressImage(level.rgba.data(),
+                                                level.width, level.height,
+                                                format, threads));
+        else
+            info.levels.push_back(level.rgba);
+        rgbaBytes += level.rgba.size();
+        storedBytes += info.levels.back().size();
+    }
+    std::chrono::duration<double, std::milli> encodeTime =
+        std::chrono::steady_clock::now() - start;
+
+    info.width = width;
+    info.height = height;
+    info.writer = "GL-graphics texcompress";
+    if (!writeKtx2File(argv[2], info))
+        return -1;
+
+    std::cout << "Wrote " << argv[2] << ": " << width << "x" << height <<
+        " " << formatName << ", " << levels.size() << " levels, " <<
+        storedBytes << " bytes (" << rgbaBytes << " as RGBA8, " <<
+        double(rgbaBytes) / double(storedBytes) << "x smaller)" << std::endl;
+    if (compress) {
+        std::vector<uint8_t> decoded(levels[0].rgba.size());
+        decompressImage(info.levels[0].data(), width, height, format,
+                        decoded.data());
+        // BC1 as written here has no alpha, leave it out of the error
+        int channelCount = format == BLOCK_BC1 ? 3 : 4;
+        std::cout << "  Encoded in " << encodeTime.count() << "ms, level 0 " <<
+            "PSNR " << imagePsnr(levels[0].rgba.data(), decoded.data(), width,
+                                 height, channelCount) << " dB" << std::endl;
+    }
+    return 0;
+}